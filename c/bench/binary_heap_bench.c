@@ -0,0 +1,116 @@
+/**
+ *  不同叉数 JBinaryHeap 的性能对比
+ *
+ *  插入 n 个随机优先级, 再全部弹出; 另外用 binary_heap_insert_batch 一次建堆,
+ *  输出每个元素的平均耗时。
+ *  inline 行是内联堆: int64 优先级加 8 字节数据存在堆中, 不调用比较函数。
+ *
+ *  编译:
+ *      gcc -O2 -march=native -std=c99 -o binary_heap_bench bench/binary_heap_bench.c \
+ *          src/data_struct/jbinary_heap.c src/base/jallocator.c -I src/base -I src/data_struct
+ *  运行:
+ *      ./binary_heap_bench [n ...]      默认 n 为 1000000 10000000
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "jbinary_heap.h"
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int compare_func(JBinaryHeapValue v1, JBinaryHeapValue v2) {
+    if ((*(uint64_t*)v1) > (*(uint64_t*)v2)) {
+        return JRET_BIGGER;
+    } else if ((*(uint64_t*)v1) < (*(uint64_t*)v2)) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int defaults[] = { 1000000, 10000000 };
+    unsigned int numSizes = argc > 1 ? argc - 1 : sizeof (defaults) / sizeof (defaults[0]);
+    unsigned int arities[] = { 2, 4, 8 };
+    uint64_t state = 88172645463325252ULL;
+    JBinaryHeap* heap;
+    uint64_t* priorities;
+    uint64_t payload;
+    JBinaryHeapValue* values;
+    unsigned int s, a, i, n;
+    double t0, t1, t2, t3;
+
+    printf("ns per element\n\n");
+    printf("%-8s %6s %11s %12s %12s %12s\n", "", "arity", "n", "insert", "pop", "batch");
+
+    for (s = 0; s < numSizes; ++s) {
+        n = argc > 1 ? (unsigned int) strtoul(argv[s + 1], NULL, 10) : defaults[s];
+        priorities = malloc(sizeof (uint64_t) * n);
+        values = malloc(sizeof (JBinaryHeapValue) * n);
+        if (JRET_PTR_NULL == priorities || JRET_PTR_NULL == values) {
+            printf("%u: out of memory, skipped\n", n);
+            free(priorities);
+            free(values);
+            continue;
+        }
+        for (i = 0; i < n; ++i) {
+            priorities[i] = xorshift(&state);
+            values[i] = &priorities[i];
+        }
+
+        for (a = 0; a < sizeof (arities) / sizeof (arities[0]); ++a) {
+            heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, arities[a], compare_func);
+
+            t0 = now();
+            for (i = 0; i < n; ++i) {
+                binary_heap_insert(heap, &priorities[i]);
+            }
+            t1 = now();
+            for (i = 0; i < n; ++i) {
+                binary_heap_pop(heap);
+            }
+            t2 = now();
+            binary_heap_insert_batch(heap, values, n);
+            t3 = now();
+
+            printf("%-8s %6u %11u %12.1f %12.1f %12.1f\n", "callback", arities[a], n, (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n, (t3 - t2) * 1e9 / n);
+            binary_heap_free(heap);
+
+            heap = binary_heap_new_inline(JBINARY_HEAP_TYPE_MIN, JBINARY_HEAP_KEY_INT64, sizeof (uint64_t), arities[a]);
+
+            t0 = now();
+            for (i = 0; i < n; ++i) {
+                binary_heap_insert_int64(heap, (int64_t) (priorities[i] >> 1), &priorities[i]);
+            }
+            t1 = now();
+            for (i = 0; i < n; ++i) {
+                binary_heap_pop_int64(heap, JRET_PTR_NULL, &payload);
+            }
+            t2 = now();
+
+            printf("%-8s %6u %11u %12.1f %12.1f %12s\n", "inline", arities[a], n, (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n, "-");
+            binary_heap_free(heap);
+        }
+        printf("\n");
+
+        free(priorities);
+        free(values);
+    }
+
+    return 0;
+}
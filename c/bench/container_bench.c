@@ -0,0 +1,449 @@
+/**
+ *  堆、AVL 树、集合的基本操作性能, 基于 jbench 测试框架
+ *
+ *  规模为 n 的测试项先生成 n 个不重复的 key(直接放在指针里), 操作序列按分布从中取 key:
+ *      sorted  --- 按升序依次取
+ *      random  --- 按随机顺序各取一次(key 本身也是打乱的)
+ *      zipf    --- 按 Zipf 分布(theta = 0.99)取 n 次, 少数 key 反复出现
+ *  测试项(每轮 n 个操作, 结果是每个操作的纳秒数):
+ *      heap    insert / pop / mixed        4 叉 JBinaryHeap; pop 和 mixed 先放入 n 个 key, mixed 交替插入和弹出
+ *      avl     insert / lookup / remove / scan
+ *                                          lookup、remove、scan 先放入全部 n 个 key; scan 是 avl_tree_next 遍历
+ *      set     insert / query / remove     同 avl
+ *  zipf 的重复 key: AVL 树照样插入(允许重复), 集合插入失败; remove 时只有第一次能找到。
+ *  100000000 这样的规模需要好几 GB 内存, 准备阶段申请不到内存的测试项会被跳过
+ *  (系统允许超量分配时可能直接被杀掉, 用 -f 只跑一部分)。
+ *
+ *  编译(make bench 也会编译):
+ *      gcc -O2 -march=native -std=c99 -o container_bench bench/container_bench.c bench/jbench.c \
+ *          src/data_struct/jbinary_heap.c src/data_struct/javl_tree.c src/data_struct/jset.c \
+ *          src/base/jthread_pool.c src/base/jallocator.c -I src/base -I src/data_struct -lpthread -lm
+ *  运行:
+ *      ./container_bench [-r reps] [-w warmup] [-t seconds] [-n size[,size...]] [-f filter] [-j file|-]
+ *      例如 ./container_bench -n 1000,1000000 -f avl/ -j avl.json
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "jbench.h"
+#include "jbinary_heap.h"
+#include "javl_tree.h"
+#include "jset.h"
+
+#define ZIPF_THETA              (0.99)
+#define HEAP_BATCH              (1 << 20)                       // 建堆时每次批量插入的数量
+
+typedef enum {
+    DIST_SORTED,
+    DIST_RANDOM,
+    DIST_ZIPF,
+    DIST_NUM
+} Dist;
+
+static const char* distNames[DIST_NUM] = { "sorted", "random", "zipf" };
+
+typedef struct {
+    size_t                  n;
+    Dist                    dist;
+    uintptr_t*              ops;                            // 操作序列
+    JBinaryHeap*            heap;
+    JAVLTree*               tree;
+    JAVLTreeNode*           cursor;
+    JSet*                   set;
+    uintptr_t               sink;                           // 防止结果被优化掉
+} Case;
+
+/* 第 i 个 key, 0 < key; sorted 是 1..n, 其它分布用可逆的混合函数打乱, 仍然不重复 */
+static uintptr_t universe(Dist dist, size_t i) {
+    uint64_t                h = i + 1;
+
+    if (DIST_SORTED == dist) {
+        return (uintptr_t) h;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return (uintptr_t) h;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static size_t gcd(size_t a, size_t b) {
+    size_t                  t;
+
+    while (b) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+/* YCSB 的 Zipf 生成器, 0 号最常出现 */
+static void zipf_fill(size_t* out, size_t n) {
+    uint64_t                state = 0x9e3779b97f4a7c15ULL;
+    double                  zetan = 0;
+    double                  zeta2 = 1 + pow(0.5, ZIPF_THETA);
+    double                  alpha = 1 / (1 - ZIPF_THETA);
+    double                  eta;
+    double                  u;
+    double                  uz;
+    size_t                  i;
+
+    for (i = 1; i <= n; ++i) {
+        zetan += 1 / pow((double) i, ZIPF_THETA);
+    }
+    eta = (1 - pow(2.0 / n, 1 - ZIPF_THETA)) / (1 - zeta2 / zetan);
+
+    for (i = 0; i < n; ++i) {
+        u = (xorshift(&state) >> 11) * (1.0 / 9007199254740992.0);
+        uz = u * zetan;
+        if (uz < 1) {
+            out[i] = 0;
+        } else if (uz < zeta2) {
+            out[i] = n > 1;
+        } else {
+            out[i] = (size_t) (n * pow(eta * u - eta + 1, alpha));
+            if (out[i] >= n) {
+                out[i] = n - 1;
+            }
+        }
+    }
+}
+
+static int case_init(Case* c, size_t n, Dist dist) {
+    size_t                  step;
+    size_t                  i;
+
+    c->n = n;
+    c->dist = dist;
+    c->ops = malloc(sizeof (uintptr_t) * n);
+    if (NULL == c->ops) {
+        return JRET_ERROR;
+    }
+
+    switch (dist) {
+    case DIST_SORTED:
+        for (i = 0; i < n; ++i) {
+            c->ops[i] = universe(dist, i);
+        }
+        break;
+    case DIST_RANDOM:
+        /* 与 n 互素的步长走一遍, 得到 0..n-1 的一个排列, 顺序又与插入顺序不同 */
+        for (step = n / 2 + 7919; gcd(step, n) != 1; ++step);
+        for (i = 0; i < n; ++i) {
+            c->ops[i] = universe(dist, (i * step + 12345) % n);
+        }
+        break;
+    default:
+        zipf_fill((size_t*) c->ops, n);
+        for (i = 0; i < n; ++i) {
+            c->ops[i] = universe(dist, c->ops[i]);
+        }
+        break;
+    }
+
+    return JRET_OK;
+}
+
+static int int_compare(void* value1, void* value2) {
+    uintptr_t               a = (uintptr_t) value1;
+    uintptr_t               b = (uintptr_t) value2;
+
+    if (a > b) {
+        return JRET_BIGGER;
+    } else if (a < b) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+static unsigned int int_hash(JSetValue value) {
+    uint64_t                h = (uintptr_t) value * 0x9e3779b97f4a7c15ULL;
+
+    return (unsigned int) (h >> 32);
+}
+
+static int int_equal(JSetValue v1, JSetValue v2) {
+    return v1 == v2;
+}
+
+/*================================ heap ================================*/
+static int heap_setup_empty(void* data) {
+    Case*                   c = data;
+
+    c->heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, 4, int_compare);
+
+    return NULL == c->heap ? JRET_ERROR : JRET_OK;
+}
+
+static int heap_setup_full(void* data) {
+    Case*                   c = data;
+    size_t                  i;
+    size_t                  num;
+
+    if (JRET_OK != heap_setup_empty(data)) {
+        return JRET_ERROR;
+    }
+    for (i = 0; i < c->n; i += num) {
+        num = c->n - i < HEAP_BATCH ? c->n - i : HEAP_BATCH;
+        if (JRET_OK != binary_heap_insert_batch(c->heap, (JBinaryHeapValue*) c->ops + i, (unsigned int) num)) {
+            binary_heap_free(c->heap);
+            c->heap = NULL;
+            return JRET_ERROR;
+        }
+    }
+
+    return JRET_OK;
+}
+
+static int heap_teardown(void* data) {
+    Case*                   c = data;
+
+    binary_heap_free(c->heap);
+    c->heap = NULL;
+
+    return JRET_OK;
+}
+
+static void heap_insert(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        binary_heap_insert(c->heap, (JBinaryHeapValue) c->ops[begin]);
+    }
+}
+
+static void heap_pop(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += (uintptr_t) binary_heap_pop(c->heap);
+    }
+}
+
+static void heap_mixed(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        if (begin & 1) {
+            c->sink += (uintptr_t) binary_heap_pop(c->heap);
+        } else {
+            binary_heap_insert(c->heap, (JBinaryHeapValue) c->ops[begin]);
+        }
+    }
+}
+
+/*================================ avl ================================*/
+static int avl_setup_empty(void* data) {
+    Case*                   c = data;
+
+    c->tree = avl_tree_new(int_compare);
+
+    return NULL == c->tree ? JRET_ERROR : JRET_OK;
+}
+
+static int avl_setup_full(void* data) {
+    Case*                   c = data;
+    size_t                  i;
+
+    if (JRET_OK != avl_setup_empty(data)) {
+        return JRET_ERROR;
+    }
+    for (i = 0; i < c->n; ++i) {
+        if (NULL == avl_tree_insert(c->tree, (JAVLTreeKey) universe(c->dist, i), NULL)) {
+            avl_tree_free(c->tree);
+            c->tree = NULL;
+            return JRET_ERROR;
+        }
+    }
+
+    return JRET_OK;
+}
+
+static int avl_teardown(void* data) {
+    Case*                   c = data;
+
+    avl_tree_free(c->tree);
+    c->tree = NULL;
+
+    return JRET_OK;
+}
+
+static int avl_setup_scan(void* data) {
+    Case*                   c = data;
+
+    c->cursor = avl_tree_first(c->tree);
+
+    return JRET_OK;
+}
+
+static void avl_insert(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        avl_tree_insert(c->tree, (JAVLTreeKey) c->ops[begin], NULL);
+    }
+}
+
+static void avl_lookup(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += (uintptr_t) avl_tree_lookup_node(c->tree, (JAVLTreeKey) c->ops[begin]);
+    }
+}
+
+static void avl_remove(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += avl_tree_remove(c->tree, (JAVLTreeKey) c->ops[begin]);
+    }
+}
+
+static void avl_scan(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += (uintptr_t) avl_tree_node_key(c->cursor);
+        c->cursor = avl_tree_next(c->cursor);
+    }
+}
+
+/*================================ set ================================*/
+static int set_setup_empty(void* data) {
+    Case*                   c = data;
+
+    c->set = jset_new(int_hash, int_equal);
+
+    return NULL == c->set ? JRET_ERROR : JRET_OK;
+}
+
+static int set_setup_full(void* data) {
+    Case*                   c = data;
+    size_t                  i;
+
+    if (JRET_OK != set_setup_empty(data)) {
+        return JRET_ERROR;
+    }
+    for (i = 0; i < c->n; ++i) {
+        if (JSET_TRUE != jset_insert(c->set, (JSetValue) universe(c->dist, i))) {
+            jset_free(c->set);
+            c->set = NULL;
+            return JRET_ERROR;
+        }
+    }
+
+    return JRET_OK;
+}
+
+static int set_teardown(void* data) {
+    Case*                   c = data;
+
+    jset_free(c->set);
+    c->set = NULL;
+
+    return JRET_OK;
+}
+
+static void set_insert(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jset_insert(c->set, (JSetValue) c->ops[begin]);
+    }
+}
+
+static void set_query(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jset_query(c->set, (JSetValue) c->ops[begin]);
+    }
+}
+
+static void set_remove(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jset_remove(c->set, (JSetValue) c->ops[begin]);
+    }
+}
+
+static void bench_case(JBench* bench, Case* c) {
+    const char*             dist = distNames[c->dist];
+    size_t                  n = c->n;
+
+    jbench_run(bench, "heap", "insert", dist, n, n, heap_setup_empty, heap_insert, heap_teardown, c);
+    jbench_run(bench, "heap", "pop", dist, n, n, heap_setup_full, heap_pop, heap_teardown, c);
+    jbench_run(bench, "heap", "mixed", dist, n, n, heap_setup_full, heap_mixed, heap_teardown, c);
+
+    jbench_run(bench, "avl", "insert", dist, n, n, avl_setup_empty, avl_insert, avl_teardown, c);
+    /* lookup 和 scan 不修改树, 共用一棵 */
+    if (jbench_selected(bench, "avl", "lookup", dist) || (DIST_ZIPF != c->dist && jbench_selected(bench, "avl", "scan", dist))) {
+        if (JRET_OK == avl_setup_full(c)) {
+            jbench_run(bench, "avl", "lookup", dist, n, n, NULL, avl_lookup, NULL, c);
+            if (DIST_ZIPF != c->dist) {
+                jbench_run(bench, "avl", "scan", dist, n, n, avl_setup_scan, avl_scan, NULL, c);
+            }
+            avl_teardown(c);
+        } else {
+            jbench_run(bench, "avl", "lookup", dist, n, n, avl_setup_full, avl_lookup, avl_teardown, c);
+        }
+    }
+    jbench_run(bench, "avl", "remove", dist, n, n, avl_setup_full, avl_remove, avl_teardown, c);
+
+    jbench_run(bench, "set", "insert", dist, n, n, set_setup_empty, set_insert, set_teardown, c);
+    if (jbench_selected(bench, "set", "query", dist)) {
+        if (JRET_OK == set_setup_full(c)) {
+            jbench_run(bench, "set", "query", dist, n, n, NULL, set_query, NULL, c);
+            set_teardown(c);
+        } else {
+            jbench_run(bench, "set", "query", dist, n, n, set_setup_full, set_query, set_teardown, c);
+        }
+    }
+    jbench_run(bench, "set", "remove", dist, n, n, set_setup_full, set_remove, set_teardown, c);
+}
+
+int main(int argc, char* argv[]) {
+    JBench*                 bench = jbench_new(argc, argv);
+    Case                    c = { 0 };
+    size_t                  i;
+    int                     d;
+
+    if (NULL == bench) {
+        return 2;
+    }
+
+    for (i = 0; i < jbench_num_sizes(bench); ++i) {
+        for (d = 0; d < DIST_NUM; ++d) {
+            if (JRET_OK != case_init(&c, jbench_size(bench, i), (Dist) d)) {
+                fprintf(stderr, "n = %zu: out of memory\n", jbench_size(bench, i));
+                continue;
+            }
+            bench_case(bench, &c);
+            free(c.ops);
+        }
+    }
+
+    if (c.sink == 42) {
+        fprintf(stderr, "\n");
+    }
+
+    return jbench_free(bench);
+}
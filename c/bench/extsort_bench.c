@@ -0,0 +1,154 @@
+/**
+ *  外部排序的吞吐量
+ *
+ *  边生成边添加随机记录(前 10 字节是 key, 其余是负载, 与 sortbenchmark.org 的 100 字节记录相同),
+ *  输出函数检查顺序、记录数和校验和。数据量默认是物理内存的 10 倍, 内存预算默认是物理内存的 1/4,
+ *  临时文件放在本地磁盘上, 页缓存放不下, 测的是真实的磁盘读写。
+ *  分别计时两个阶段:
+ *      add     --- 置换选择生成顺串(包括写顺串)
+ *      finish  --- 归并和输出(包括读顺串和中间几趟的写)
+ *
+ *  编译:
+ *      gcc -O2 -march=native -std=c99 -o extsort_bench bench/extsort_bench.c src/data_struct/jextsort.c \
+ *          src/data_struct/jbinary_heap.c src/base/jallocator.c -I src/base -I src/data_struct -lpthread
+ *  运行:
+ *      ./extsort_bench [dataMB [memoryMB [recordSize [tempDir]]]]
+ *          recordSize 默认 100, 为 0 时测变长记录(20 到 180 字节, 平均 100)
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "jextsort.h"
+
+#define KEY_SIZE                (10)
+#define MAX_RECORD              (180)
+
+typedef struct {
+    unsigned char           prev[KEY_SIZE];
+    uint64_t                count;
+    uint64_t                sum;
+    int                     sorted;
+} Check;
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_key(const void* record1, size_t size1, const void* record2, size_t size2) {
+    int ret = memcmp(record1, record2, KEY_SIZE);
+
+    (void) size1;
+    (void) size2;
+
+    return ret < 0 ? JRET_SMALLER : (ret > 0 ? JRET_BIGGER : JRET_EQUAL);
+}
+
+/* 与顺序无关的校验和: 每条记录的 key 和长度 */
+static uint64_t record_sum(const unsigned char* record, size_t size) {
+    uint64_t                key;
+
+    memcpy(&key, record, sizeof (key));
+
+    return key * 0x9e3779b97f4a7c15ULL + size;
+}
+
+static int check_output(void* data, const void* record, size_t size) {
+    Check*                  check = data;
+
+    if (check->count > 0 && memcmp(check->prev, record, KEY_SIZE) > 0) {
+        check->sorted = 0;
+    }
+    memcpy(check->prev, record, KEY_SIZE);
+    check->sum += record_sum(record, size);
+    ++ check->count;
+
+    return JRET_OK;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t ram = (uint64_t) sysconf(_SC_PHYS_PAGES) * (uint64_t) sysconf(_SC_PAGESIZE);
+    uint64_t dataBytes = argc > 1 ? strtoull(argv[1], NULL, 10) << 20 : ram * 10;
+    size_t memory = argc > 2 ? (size_t) strtoull(argv[2], NULL, 10) << 20 : (size_t) (ram / 4);
+    size_t recordSize = argc > 3 ? (size_t) strtoull(argv[3], NULL, 10) : 100;
+    const char* tempDir = argc > 4 ? argv[4] : NULL;
+    unsigned char record[MAX_RECORD];
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    uint64_t bytes = 0;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    JExtSort* sort;
+    JExtSortStats stats;
+    Check check;
+    double t0;
+    double t1;
+    double t2;
+    size_t size;
+    size_t i;
+
+    if ((0 != recordSize && recordSize < KEY_SIZE) || recordSize > MAX_RECORD) {
+        printf("usage: %s [dataMB [memoryMB [recordSize [tempDir]]]], recordSize 0 or %d..%d\n", argv[0], KEY_SIZE, MAX_RECORD);
+        return 1;
+    }
+
+    sort = jextsort_new(recordSize, compare_key, memory, tempDir);
+    if (NULL == sort) {
+        return 2;
+    }
+
+    printf("external sort: %.0f MB of %s records, memory %.0f MB (RAM %.0f MB)\n", dataBytes / 1048576.0,
+           0 == recordSize ? "variable" : "fixed", memory / 1048576.0, ram / 1048576.0);
+    fflush(stdout);
+
+    t0 = now();
+    while (bytes < dataBytes) {
+        size = 0 != recordSize ? recordSize : 20 + (size_t) (xorshift(&state) % (MAX_RECORD - 20 + 1));
+        for (i = 0; i < size; i += 8) {
+            uint64_t r = xorshift(&state);
+            memcpy(record + i, &r, size - i < 8 ? size - i : 8);
+        }
+        if (JRET_OK != jextsort_add(sort, record, size)) {
+            printf("add failed\n");
+            return 3;
+        }
+        sum += record_sum(record, size);
+        bytes += size;
+        ++ count;
+    }
+    t1 = now();
+
+    memset(&check, 0, sizeof (Check));
+    check.sorted = 1;
+    if (JRET_OK != jextsort_finish(sort, check_output, &check)) {
+        printf("finish failed\n");
+        return 4;
+    }
+    t2 = now();
+
+    jextsort_get_stats(sort, &stats);
+    printf("records %llu, runs %u (avg %.1f MB), merge passes %u, written %.0f MB, read %.0f MB\n",
+           (unsigned long long) count, stats.runs, stats.runs > 0 ? bytes / 1048576.0 / stats.runs : 0.0, stats.passes,
+           stats.bytesWritten / 1048576.0, stats.bytesRead / 1048576.0);
+    printf("add    %8.2f s  %8.1f MB/s\n", t1 - t0, bytes / 1048576.0 / (t1 - t0));
+    printf("finish %8.2f s  %8.1f MB/s\n", t2 - t1, bytes / 1048576.0 / (t2 - t1));
+    printf("total  %8.2f s  %8.1f MB/s\n", t2 - t0, bytes / 1048576.0 / (t2 - t0));
+    printf("check: %s\n", check.sorted && check.count == count && check.sum == sum ? "sorted" : "WRONG");
+
+    jextsort_free(sort);
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+#define _GNU_SOURCE
+#include "jbench.h"
+#include "jret.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define JBENCH_MAX_SIZES        (16)
+#define JBENCH_MAX_SIZE         (100000000)                     // -n 允许的最大规模
+#define JBENCH_MAX_REPS         (1000)
+#define JBENCH_SAMPLES          (1000)                          // 每轮大约分成这么多段
+#define JBENCH_MIN_CHUNK        (64)                            // 每段至少这么多个操作, 计时开销不超过 1%
+
+struct _JBench {
+    unsigned int            reps;
+    unsigned int            warmup;
+    double                  minTime;
+    size_t                  sizes[JBENCH_MAX_SIZES];
+    size_t                  numSizes;
+    const char*             filter;
+    FILE*                   json;
+    FILE*                   table;
+    unsigned int            numResults;
+    int                     failed;
+    size_t                  bytesPerOp;                     // 不为 0 时输出 GB/s
+
+    double*                 samples;                        // 当前测试项每段每个操作的纳秒数
+    size_t                  numSamples;
+    size_t                  samplesCapacity;
+};
+
+static double jbench_now(void) {
+    struct timespec         ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int jbench_compare_double(const void* a, const void* b) {
+    double                  x = *(const double*) a;
+    double                  y = *(const double*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int jbench_add_sample(JBench* bench, double ns) {
+    double*                 samples;
+    size_t                  capacity;
+
+    if (bench->numSamples == bench->samplesCapacity) {
+        capacity = bench->samplesCapacity ? bench->samplesCapacity * 2 : 4096;
+        samples = realloc(bench->samples, sizeof (double) * capacity);
+        if (JRET_PTR_NULL == samples) {
+            return JRET_ERROR;
+        }
+        bench->samples = samples;
+        bench->samplesCapacity = capacity;
+    }
+    bench->samples[bench->numSamples ++] = ns;
+
+    return JRET_OK;
+}
+
+static void jbench_usage(const char* name) {
+    fprintf(stderr, "usage: %s [-r reps] [-w warmup] [-t seconds] [-n size[,size...]] [-f filter] [-j file|-]\n", name);
+}
+
+static int jbench_parse_sizes(JBench* bench, char* text) {
+    char*                   end;
+
+    bench->numSizes = 0;
+    while (*text) {
+        if (bench->numSizes == JBENCH_MAX_SIZES) {
+            return JRET_ERROR;
+        }
+        bench->sizes[bench->numSizes] = strtoul(text, &end, 10);
+        if (end == text || 0 == bench->sizes[bench->numSizes] || bench->sizes[bench->numSizes] > JBENCH_MAX_SIZE) {
+            return JRET_ERROR;
+        }
+        ++ bench->numSizes;
+        text = ',' == *end ? end + 1 : end;
+    }
+
+    return 0 == bench->numSizes ? JRET_ERROR : JRET_OK;
+}
+
+JBench* jbench_new(int argc, char* argv[]) {
+    JBench*                 bench = calloc(1, sizeof (JBench));
+    const size_t            defaults[] = { 1000, 10000, 100000, 1000000 };
+    int                     opt;
+
+    if (JRET_PTR_NULL == bench) {
+        return JRET_PTR_NULL;
+    }
+
+    bench->reps = 5;
+    bench->warmup = 1;
+    bench->minTime = 0.1;
+    bench->table = stdout;
+    bench->numSizes = sizeof (defaults) / sizeof (defaults[0]);
+    memcpy(bench->sizes, defaults, sizeof (defaults));
+
+    while (-1 != (opt = getopt(argc, argv, "r:w:t:n:f:j:"))) {
+        switch (opt) {
+        case 'r':
+            bench->reps = (unsigned int) strtoul(optarg, JRET_PTR_NULL, 10);
+            break;
+        case 'w':
+            bench->warmup = (unsigned int) strtoul(optarg, JRET_PTR_NULL, 10);
+            break;
+        case 't':
+            bench->minTime = strtod(optarg, JRET_PTR_NULL);
+            break;
+        case 'n':
+            if (JRET_OK != jbench_parse_sizes(bench, optarg)) {
+                jbench_usage(argv[0]);
+                free(bench);
+                return JRET_PTR_NULL;
+            }
+            break;
+        case 'f':
+            bench->filter = optarg;
+            break;
+        case 'j':
+            if (0 == strcmp(optarg, "-")) {
+                bench->json = stdout;
+                bench->table = stderr;
+            } else {
+                bench->json = fopen(optarg, "w");
+                if (JRET_PTR_NULL == bench->json) {
+                    perror(optarg);
+                    free(bench);
+                    return JRET_PTR_NULL;
+                }
+            }
+            break;
+        default:
+            jbench_usage(argv[0]);
+            free(bench);
+            return JRET_PTR_NULL;
+        }
+    }
+
+    if (0 == bench->reps) {
+        bench->reps = 1;
+    }
+
+    fprintf(bench->table, "%-6s %-8s %-7s %11s %11s %9s %9s %9s %8s\n",
+            "bench", "op", "dist", "n", "ops", "median", "p99", "mean", "samples");
+
+    return bench;
+}
+
+int jbench_free(JBench* bench) {
+    int                     ret = bench->failed ? 1 : 0;
+
+    if (JRET_PTR_NULL != bench->json) {
+        fprintf(bench->json, 0 == bench->numResults ? "[]\n" : "\n]\n");
+        if (stdout != bench->json) {
+            fclose(bench->json);
+        }
+    }
+    free(bench->samples);
+    free(bench);
+
+    return ret;
+}
+
+size_t jbench_num_sizes(JBench* bench) {
+    return bench->numSizes;
+}
+
+size_t jbench_size(JBench* bench, size_t i) {
+    return bench->sizes[i];
+}
+
+void jbench_set_bytes(JBench* bench, size_t bytesPerOp) {
+    bench->bytesPerOp = bytesPerOp;
+}
+
+int jbench_selected(JBench* bench, const char* container, const char* op, const char* dist) {
+    char                    name[128];
+
+    if (JRET_PTR_NULL == bench->filter) {
+        return 1;
+    }
+    snprintf(name, sizeof (name), "%s/%s/%s", container, op, dist);
+
+    return JRET_PTR_NULL != strstr(name, bench->filter);
+}
+
+/* 执行一轮, record 为真时记录每段的耗时, 返回这一轮的总纳秒数, 失败返回负数; setup 成功后失败也会调用 teardown */
+static double jbench_rep(JBench* bench, size_t ops, size_t chunk, JBenchSetupFunc setup, JBenchRunFunc run, JBenchSetupFunc teardown,
+                         void* data, int record) {
+    double                  total = 0;
+    double                  t0;
+    double                  t1;
+    size_t                  begin;
+    size_t                  end;
+
+    if (JRET_PTR_NULL != setup && JRET_OK != setup(data)) {
+        return -1;
+    }
+
+    for (begin = 0; begin < ops; begin = end) {
+        end = ops - begin > chunk ? begin + chunk : ops;
+        t0 = jbench_now();
+        run(data, begin, end);
+        t1 = jbench_now();
+        total += t1 - t0;
+        if (record && JRET_OK != jbench_add_sample(bench, (t1 - t0) / (end - begin))) {
+            if (JRET_PTR_NULL != teardown) {
+                teardown(data);
+            }
+            return -1;
+        }
+    }
+
+    if (JRET_PTR_NULL != teardown && JRET_OK != teardown(data)) {
+        return -1;
+    }
+
+    return total;
+}
+
+void jbench_run(JBench* bench, const char* container, const char* op, const char* dist, size_t n, size_t ops,
+                JBenchSetupFunc setup, JBenchRunFunc run, JBenchSetupFunc teardown, void* data) {
+    size_t                  chunk = ops / JBENCH_SAMPLES;
+    unsigned int            reps = 0;
+    double                  total = 0;
+    double                  t;
+    double                  median;
+    double                  p99;
+    double                  mean;
+    unsigned int            i;
+
+    if (!jbench_selected(bench, container, op, dist) || 0 == ops) {
+        return;
+    }
+
+    if (chunk < JBENCH_MIN_CHUNK) {
+        chunk = JBENCH_MIN_CHUNK;
+    }
+
+    bench->numSamples = 0;
+    for (i = 0; i < bench->warmup; ++i) {
+        if (jbench_rep(bench, ops, chunk, setup, run, teardown, data, 0) < 0) {
+            break;
+        }
+    }
+
+    while (i == bench->warmup && (reps < bench->reps || (total < bench->minTime * 1e9 && reps < JBENCH_MAX_REPS))) {
+        t = jbench_rep(bench, ops, chunk, setup, run, teardown, data, 1);
+        if (t < 0) {
+            break;
+        }
+        total += t;
+        ++ reps;
+    }
+
+    if (reps < bench->reps) {
+        fprintf(bench->table, "%-6s %-8s %-7s %11zu %11zu   skipped (setup failed or out of memory)\n", container, op, dist, n, ops);
+        fflush(bench->table);
+        bench->failed = 1;
+        return;
+    }
+
+    qsort(bench->samples, bench->numSamples, sizeof (double), jbench_compare_double);
+    median = bench->samples[bench->numSamples / 2];
+    p99 = bench->samples[(size_t) ((bench->numSamples - 1) * 0.99)];
+    mean = total / ((double) ops * reps);
+
+    fprintf(bench->table, "%-6s %-8s %-7s %11zu %11zu %9.1f %9.1f %9.1f %8zu",
+            container, op, dist, n, ops, median, p99, mean, bench->numSamples);
+    if (0 != bench->bytesPerOp) {
+        fprintf(bench->table, " %7.2f GB/s", bench->bytesPerOp / mean);
+    }
+    fprintf(bench->table, "\n");
+    fflush(bench->table);
+
+    if (JRET_PTR_NULL != bench->json) {
+        fprintf(bench->json, "%s  {\"container\": \"%s\", \"op\": \"%s\", \"dist\": \"%s\", \"n\": %zu, \"ops\": %zu, \"reps\": %u, "
+                "\"samples\": %zu, \"median_ns\": %.2f, \"p99_ns\": %.2f, \"mean_ns\": %.2f, \"mops\": %.3f",
+                0 == bench->numResults ? "[\n" : ",\n", container, op, dist, n, ops, reps,
+                bench->numSamples, median, p99, mean, 1e3 / mean);
+        if (0 != bench->bytesPerOp) {
+            fprintf(bench->json, ", \"bytes_per_op\": %zu, \"gbps\": %.3f", bench->bytesPerOp, bench->bytesPerOp / mean);
+        }
+        fprintf(bench->json, "}");
+        fflush(bench->json);
+    }
+    ++ bench->numResults;
+}
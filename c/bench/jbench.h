@@ -0,0 +1,113 @@
+#ifndef JBENCH_H
+#define JBENCH_H
+
+/**
+ *  性能测试框架
+ *
+ *  每个测试项是 ops 个操作, 一轮测量把它们分成若干段依次执行, 每段单独计时,
+ *  所有测量轮次的分段耗时合在一起统计中位数和 p99(每个操作的纳秒数), 平均值按总时间计算。
+ *  先执行 warmup 轮不计入结果, 再至少执行 reps 轮, 总测量时间不到 minTime 时继续增加轮次,
+ *  规模小的测试项也能得到足够的样本。
+ *  每轮开始前调用 setup、结束后调用 teardown, 都不计时, 用来准备和清理容器。
+ *  处理字节流的测试项用 jbench_set_bytes 设置每个操作处理的字节数, 结果另外给出 GB/s。
+ *
+ *  命令行参数(jbench_new 解析):
+ *      -r N            至少测量 N 轮, 默认 5
+ *      -w N            预热 N 轮, 默认 1
+ *      -t SECONDS      每项至少测量的时间, 默认 0.1
+ *      -n N[,N...]     测试规模, 默认 1000,10000,100000,1000000, 最大 100000000
+ *      -f TEXT         只运行名字中包含 TEXT 的测试项
+ *      -j FILE         另外把结果以 JSON 数组写入 FILE, "-" 表示标准输出(此时表格写到标准错误)
+ *
+ *  用法:
+ *      JBench* bench = jbench_new(argc, argv);
+ *      for (i = 0; i < jbench_num_sizes(bench); ++i) {
+ *          jbench_run(bench, "avl", "insert", "random", jbench_size(bench, i), n, setup, run, teardown, &data);
+ *      }
+ *      return jbench_free(bench);
+ */
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 测试框架 */
+typedef struct _JBench JBench;
+
+/**
+ *  执行第 begin 到 end - 1 个操作
+ *
+ *  @param data             jbench_run 传入的用户数据
+ */
+typedef void (*JBenchRunFunc) (void* data, size_t begin, size_t end);
+
+/**
+ *  每轮测量前后调用, 不计时
+ *  setup 失败时不会调用 teardown, 要自己释放已经准备的部分; setup 成功后这一轮无论成败都会调用 teardown
+ *
+ *  @param data             jbench_run 传入的用户数据
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (例如内存不足), 跳过这个测试项
+ */
+typedef int (*JBenchSetupFunc) (void* data);
+
+
+/**
+ *  创建测试框架, 解析命令行参数
+ *
+ *  @return                 成功: 返回测试框架
+ *                          失败: 返回 RET_PTR_NULL (参数错误, 已经打印用法)
+ */
+JBench* jbench_new(int argc, char* argv[]);
+
+
+/**
+ *  结束测试, 写完 JSON 并释放
+ *
+ *  @return                 进程退出码, 有测试项失败时为 1
+ */
+int jbench_free(JBench* bench);
+
+
+/**
+ *  测试规模的数量和第 i 个规模
+ */
+size_t jbench_num_sizes(JBench* bench);
+size_t jbench_size(JBench* bench, size_t i);
+
+
+/**
+ *  运行一个测试项, 输出一行结果
+ *
+ *  @param bench            测试框架
+ *  @param container        容器名, 如 "heap"
+ *  @param op               操作名, 如 "insert"
+ *  @param dist             key 分布, 如 "zipf"
+ *  @param n                容器规模
+ *  @param ops              每轮的操作数
+ *  @param setup            每轮开始前调用, 可以为 RET_PTR_NULL
+ *  @param run              执行操作
+ *  @param teardown         每轮结束后调用, 可以为 RET_PTR_NULL
+ *  @param data             用户数据
+ */
+void jbench_run(JBench* bench, const char* container, const char* op, const char* dist, size_t n, size_t ops,
+                JBenchSetupFunc setup, JBenchRunFunc run, JBenchSetupFunc teardown, void* data);
+
+
+/**
+ *  设置之后的测试项每个操作处理的字节数, 表格和 JSON 中增加吞吐量(GB/s), 0 表示不统计
+ */
+void jbench_set_bytes(JBench* bench, size_t bytesPerOp);
+
+
+/**
+ *  测试项是否会被运行(没有被 -f 过滤掉), 用来跳过昂贵的准备工作
+ */
+int jbench_selected(JBench* bench, const char* container, const char* op, const char* dist);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JBENCH_H
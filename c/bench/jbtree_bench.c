@@ -0,0 +1,174 @@
+/**
+ *  JBTree 与 JAVLTree 的性能对比
+ *
+ *  随机 key 插入 n 个, 按另一个随机顺序查找 n 次, 再全部删除, 输出每种操作每个 key 的平均耗时。
+ *  AVL 和比较函数模式的 B+ 树使用同一个比较函数(key 就是整数, 不解引用),
+ *  整数模式的 B+ 树不调用比较函数。
+ *
+ *  编译(与库源码一起优化编译, -march=native 开启节点内 SIMD 查找):
+ *      gcc -O2 -march=native -std=c99 -o jbtree_bench bench/jbtree_bench.c \
+ *          src/data_struct/javl_tree.c src/data_struct/jbtree.c src/base/jallocator.c -I src/base -I src/data_struct
+ *  运行:
+ *      ./jbtree_bench [n ...]           默认 n 为 1000000 10000000 100000000
+ *
+ *  100M 个 key 时 AVL 树需要约 6GB 内存, 内存不足的规模会被跳过。
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "javl_tree.h"
+#include "jbtree.h"
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int int_compare(void* value1, void* value2) {
+    intptr_t a = (intptr_t) value1;
+    intptr_t b = (intptr_t) value2;
+
+    if (a > b) {
+        return JRET_BIGGER;
+    } else if (a < b) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+static void report(const char* name, unsigned int n, double insert, double lookup, double remove) {
+    printf("%-18s %11u %12.1f %12.1f %12.1f\n", name, n, insert * 1e9 / n, lookup * 1e9 / n, remove * 1e9 / n);
+}
+
+static int bench_avl(void** keys, void** probes, unsigned int n) {
+    JAVLTree* tree = avl_tree_new(int_compare);
+    double t0, t1, t2, t3;
+    unsigned int i;
+
+    if (JRET_PTR_NULL == tree) {
+        return JRET_ERROR;
+    }
+
+    t0 = now();
+    for (i = 0; i < n; ++i) {
+        if (JRET_PTR_NULL == avl_tree_insert(tree, keys[i], keys[i])) {
+            avl_tree_free(tree);
+            return JRET_ERROR;
+        }
+    }
+    t1 = now();
+    for (i = 0; i < n; ++i) {
+        if (JAVL_TREE_NULL == avl_tree_lookup(tree, probes[i])) {
+            printf("avl lookup failed\n");
+        }
+    }
+    t2 = now();
+    for (i = 0; i < n; ++i) {
+        avl_tree_remove(tree, keys[i]);
+    }
+    t3 = now();
+
+    report("JAVLTree", n, t1 - t0, t2 - t1, t3 - t2);
+    avl_tree_free(tree);
+
+    return JRET_OK;
+}
+
+static int bench_btree(const char* name, JBTree* tree, void** keys, void** probes, unsigned int n) {
+    double t0, t1, t2, t3;
+    unsigned int i;
+
+    if (JRET_PTR_NULL == tree) {
+        return JRET_ERROR;
+    }
+
+    t0 = now();
+    for (i = 0; i < n; ++i) {
+        if (JRET_OK != jbtree_insert(tree, keys[i], keys[i])) {
+            jbtree_free(tree);
+            return JRET_ERROR;
+        }
+    }
+    t1 = now();
+    for (i = 0; i < n; ++i) {
+        if (JBTREE_NULL == jbtree_lookup(tree, probes[i])) {
+            printf("%s lookup failed\n", name);
+        }
+    }
+    t2 = now();
+    for (i = 0; i < n; ++i) {
+        jbtree_remove(tree, keys[i]);
+    }
+    t3 = now();
+
+    report(name, n, t1 - t0, t2 - t1, t3 - t2);
+    jbtree_free(tree);
+
+    return JRET_OK;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int defaults[] = { 1000000, 10000000, 100000000 };
+    unsigned int numSizes = argc > 1 ? argc - 1 : sizeof (defaults) / sizeof (defaults[0]);
+    uint64_t state = 88172645463325252ULL;
+    unsigned int s, i, j, n;
+    void** keys;
+    void** probes;
+    void* tmp;
+
+    printf("B+ tree: %d keys per node, ns per key\n\n", JBTREE_MAX_KEYS);
+    printf("%-18s %11s %12s %12s %12s\n", "", "n", "insert", "lookup", "remove");
+
+    for (s = 0; s < numSizes; ++s) {
+        n = argc > 1 ? (unsigned int) strtoul(argv[s + 1], NULL, 10) : defaults[s];
+        keys = malloc(sizeof (void*) * n);
+        probes = malloc(sizeof (void*) * n);
+        if (JRET_PTR_NULL == keys || JRET_PTR_NULL == probes) {
+            printf("%u: out of memory, skipped\n", n);
+            free(keys);
+            free(probes);
+            continue;
+        }
+
+        /* 不重复的随机 key: 奇数乘法是 2^64 上的双射; 查找顺序是 key 的另一个随机排列 */
+        for (i = 0; i < n; ++i) {
+            keys[i] = (void*) (intptr_t) ((i + 1) * 0x9E3779B97F4A7C15ULL >> 1);
+            probes[i] = keys[i];
+        }
+        for (i = n - 1; i > 0; --i) {
+            j = xorshift(&state) % (i + 1);
+            tmp = probes[i];
+            probes[i] = probes[j];
+            probes[j] = tmp;
+        }
+
+        if (JRET_OK != bench_avl(keys, probes, n)) {
+            printf("%-18s %11u out of memory, skipped\n", "JAVLTree", n);
+        }
+        if (JRET_OK != bench_btree("JBTree (compare)", jbtree_new(int_compare), keys, probes, n)) {
+            printf("%-18s %11u out of memory, skipped\n", "JBTree (compare)", n);
+        }
+        if (JRET_OK != bench_btree("JBTree (integer)", jbtree_new_integer(), keys, probes, n)) {
+            printf("%-18s %11u out of memory, skipped\n", "JBTree (integer)", n);
+        }
+        printf("\n");
+
+        free(keys);
+        free(probes);
+    }
+
+    return 0;
+}
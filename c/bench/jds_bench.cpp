@@ -0,0 +1,265 @@
+/**
+ *  C++ 模板(jds::heap / jds::avl_map / jds::hash_set)与 C 接口、标准库容器的性能对比
+ *
+ *  key 都是不重复的随机 64 位整数, 输出每种操作每个元素的平均耗时:
+ *      堆:   插入 n 个, 再全部弹出
+ *      映射: 插入 n 个, 按另一个随机顺序查找 n 次, 再全部删除
+ *      集合: 同映射
+ *  C 接口的值是 void*, key 直接放在指针里, 比较和 hash 通过函数指针调用。
+ *
+ *  编译(C 源码用 gcc 编译, 再与测试程序一起链接):
+ *      gcc -O2 -march=native -std=c99 -c src/data_struct/jbinary_heap.c src/data_struct/javl_tree.c \
+ *          src/data_struct/jset.c src/base/jthread_pool.c src/base/jallocator.c -I src/base -I src/data_struct
+ *      g++ -O2 -march=native -std=c++11 -o jds_bench bench/jds_bench.cpp \
+ *          jbinary_heap.o javl_tree.o jset.o jthread_pool.o jallocator.o -I src/base -I src/data_struct -lpthread
+ *  运行:
+ *      ./jds_bench [n ...]              默认 n 为 1000000 10000000
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include <queue>
+#include <map>
+#include <unordered_set>
+#include <functional>
+
+#include "jbinary_heap.h"
+#include "javl_tree.h"
+#include "jset.h"
+#include "jbinary_heap.hpp"
+#include "javl_tree.hpp"
+#include "jset.hpp"
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int int_compare(void* value1, void* value2) {
+    uintptr_t a = (uintptr_t) value1;
+    uintptr_t b = (uintptr_t) value2;
+
+    if (a > b) {
+        return JRET_BIGGER;
+    } else if (a < b) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+static unsigned int int_hash(JSetValue value) {
+    uint64_t h = (uintptr_t) value;
+
+    return (unsigned int) (h ^ (h >> 32));
+}
+
+static int int_equal(JSetValue v1, JSetValue v2) {
+    return v1 == v2;
+}
+
+static void report(const char* name, unsigned int n, double t1, double t2, double t3) {
+    printf("%-26s %11u %12.1f %12.1f", name, n, t1 * 1e9 / n, t2 * 1e9 / n);
+    if (t3 >= 0) {
+        printf(" %12.1f\n", t3 * 1e9 / n);
+    } else {
+        printf(" %12s\n", "-");
+    }
+}
+
+static void bench_heap(const std::vector<uint64_t>& keys) {
+    unsigned int n = (unsigned int) keys.size();
+    unsigned int i;
+    double t0, t1, t2;
+
+    {
+        JBinaryHeap* heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, 4, int_compare);
+        t0 = now();
+        for (i = 0; i < n; ++i) {
+            binary_heap_insert(heap, (void*) (uintptr_t) keys[i]);
+        }
+        t1 = now();
+        for (i = 0; i < n; ++i) {
+            binary_heap_pop(heap);
+        }
+        t2 = now();
+        report("JBinaryHeap (4-ary)", n, t1 - t0, t2 - t1, -1);
+        binary_heap_free(heap);
+    }
+    {
+        jds::heap<uint64_t> heap;
+        t0 = now();
+        for (i = 0; i < n; ++i) {
+            heap.push(keys[i]);
+        }
+        t1 = now();
+        for (i = 0; i < n; ++i) {
+            heap.pop();
+        }
+        t2 = now();
+        report("jds::heap (4-ary)", n, t1 - t0, t2 - t1, -1);
+    }
+    {
+        std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > heap;
+        t0 = now();
+        for (i = 0; i < n; ++i) {
+            heap.push(keys[i]);
+        }
+        t1 = now();
+        for (i = 0; i < n; ++i) {
+            heap.pop();
+        }
+        t2 = now();
+        report("std::priority_queue", n, t1 - t0, t2 - t1, -1);
+    }
+}
+
+template <typename Map>
+static void bench_std_map(const char* name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& probes) {
+    unsigned int n = (unsigned int) keys.size();
+    unsigned int i;
+    double t0, t1, t2, t3;
+    Map map;
+
+    t0 = now();
+    for (i = 0; i < n; ++i) {
+        map.emplace(keys[i], keys[i]);
+    }
+    t1 = now();
+    for (i = 0; i < n; ++i) {
+        if (map.find(probes[i]) == map.end()) {
+            printf("%s lookup failed\n", name);
+        }
+    }
+    t2 = now();
+    for (i = 0; i < n; ++i) {
+        map.erase(keys[i]);
+    }
+    t3 = now();
+    report(name, n, t1 - t0, t2 - t1, t3 - t2);
+}
+
+static void bench_map(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& probes) {
+    unsigned int n = (unsigned int) keys.size();
+    unsigned int i;
+    double t0, t1, t2, t3;
+    JAVLTree* tree = avl_tree_new(int_compare);
+
+    t0 = now();
+    for (i = 0; i < n; ++i) {
+        avl_tree_insert(tree, (void*) (uintptr_t) keys[i], (void*) (uintptr_t) keys[i]);
+    }
+    t1 = now();
+    for (i = 0; i < n; ++i) {
+        if (JRET_PTR_NULL == avl_tree_lookup_node(tree, (void*) (uintptr_t) probes[i])) {
+            printf("JAVLTree lookup failed\n");
+        }
+    }
+    t2 = now();
+    for (i = 0; i < n; ++i) {
+        avl_tree_remove(tree, (void*) (uintptr_t) keys[i]);
+    }
+    t3 = now();
+    report("JAVLTree", n, t1 - t0, t2 - t1, t3 - t2);
+    avl_tree_free(tree);
+
+    bench_std_map<jds::avl_map<uint64_t, uint64_t> >("jds::avl_map", keys, probes);
+    bench_std_map<std::map<uint64_t, uint64_t> >("std::map", keys, probes);
+}
+
+template <typename Set>
+static void bench_std_set(const char* name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& probes) {
+    unsigned int n = (unsigned int) keys.size();
+    unsigned int i;
+    double t0, t1, t2, t3;
+    Set set;
+
+    t0 = now();
+    for (i = 0; i < n; ++i) {
+        set.insert(keys[i]);
+    }
+    t1 = now();
+    for (i = 0; i < n; ++i) {
+        if (0 == set.count(probes[i])) {
+            printf("%s lookup failed\n", name);
+        }
+    }
+    t2 = now();
+    for (i = 0; i < n; ++i) {
+        set.erase(keys[i]);
+    }
+    t3 = now();
+    report(name, n, t1 - t0, t2 - t1, t3 - t2);
+}
+
+static void bench_set(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& probes) {
+    unsigned int n = (unsigned int) keys.size();
+    unsigned int i;
+    double t0, t1, t2, t3;
+    JSet* set = jset_new(int_hash, int_equal);
+
+    t0 = now();
+    for (i = 0; i < n; ++i) {
+        jset_insert(set, (void*) (uintptr_t) keys[i]);
+    }
+    t1 = now();
+    for (i = 0; i < n; ++i) {
+        if (JSET_HAVE != jset_query(set, (void*) (uintptr_t) probes[i])) {
+            printf("JSet lookup failed\n");
+        }
+    }
+    t2 = now();
+    for (i = 0; i < n; ++i) {
+        jset_remove(set, (void*) (uintptr_t) keys[i]);
+    }
+    t3 = now();
+    report("JSet", n, t1 - t0, t2 - t1, t3 - t2);
+    jset_free(set);
+
+    bench_std_set<jds::hash_set<uint64_t> >("jds::hash_set", keys, probes);
+    bench_std_set<std::unordered_set<uint64_t> >("std::unordered_set", keys, probes);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int defaults[] = { 1000000, 10000000 };
+    unsigned int numSizes = argc > 1 ? argc - 1 : sizeof (defaults) / sizeof (defaults[0]);
+    uint64_t state = 88172645463325252ULL;
+    unsigned int s, i, j, n;
+
+    printf("ns per element\n\n");
+    printf("%-26s %11s %12s %12s %12s\n", "", "n", "insert", "lookup/pop", "remove");
+
+    for (s = 0; s < numSizes; ++s) {
+        n = argc > 1 ? (unsigned int) strtoul(argv[s + 1], NULL, 10) : defaults[s];
+        std::vector<uint64_t> keys(n);
+        std::vector<uint64_t> probes(n);
+
+        /* 不重复的随机 key: 奇数乘法是 2^64 上的双射; 查找顺序是 key 的另一个随机排列 */
+        for (i = 0; i < n; ++i) {
+            keys[i] = (i + 1) * 0x9E3779B97F4A7C15ULL;
+            probes[i] = keys[i];
+        }
+        for (i = n - 1; i > 0; --i) {
+            j = xorshift(&state) % (i + 1);
+            std::swap(probes[i], probes[j]);
+        }
+
+        bench_heap(keys);
+        bench_map(keys, probes);
+        bench_set(keys, probes);
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,462 @@
+/**
+ *  JList 与动态数组、普通双向链表的对比, 基于 jbench 测试框架
+ *
+ *  元素是 8 字节整数, 规模为 n 的测试项(结果是每个操作的纳秒数):
+ *      push    back / front        从空链表开始追加 n 个元素; 数组只测 back
+ *      pop     front               先放入 n 个元素再从头部逐个弹出; 数组不测
+ *      scan    block / cursor      顺序累加 n 个元素, 每个元素算一个操作;
+ *                                  jlist 的 block 是 jlist_cursor_block 按段遍历, cursor 是 jlist_cursor_next 逐个遍历
+ *      insert  random              在 n 个元素中随机位置插入 INSERT_OPS 个元素
+ *      remove  random              在 n 个元素中随机位置删除 INSERT_OPS 个元素
+ *  容器:
+ *      jlist   --- JList
+ *      array   --- JArray, 中间插入、删除移动后面的元素
+ *      dlist   --- 每个元素一次 malloc 的双向链表, 按下标访问时从较近的一端逐个跳过
+ *  每个规模结束后在标准错误输出三种容器每个元素占用的字节数(dlist 含 malloc 的头部)。
+ *
+ *  编译(make bench 也会编译):
+ *      gcc -O2 -march=native -std=c99 -o list_bench bench/list_bench.c bench/jbench.c \
+ *          src/data_struct/jlist.c src/data_struct/jarray.c src/base/jallocator.c -I src/base -I src/data_struct -lm
+ *  运行:
+ *      ./list_bench [-r reps] [-w warmup] [-t seconds] [-n size[,size...]] [-f filter] [-j file|-]
+ *      例如 ./list_bench -n 1000000 -f /scan/
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <malloc.h>
+
+#include "jbench.h"
+#include "jlist.h"
+#include "jarray.h"
+
+#define INSERT_OPS              (1000)
+
+typedef struct _DNode DNode;
+struct _DNode {
+    DNode*                  prev;
+    DNode*                  next;
+    uint64_t                value;
+};
+
+/* 对照: 普通双向链表 */
+typedef struct {
+    DNode*                  head;
+    DNode*                  tail;
+    size_t                  num;
+} DList;
+
+typedef struct {
+    size_t                  n;
+    JList*                  list;
+    JArray*                 array;
+    DList                   dlist;
+    JListCursor             cursor;                         // scan 时在各段之间接着遍历
+    DNode*                  dnode;
+    size_t*                 positions;                      // insert、remove 的随机位置
+    uint64_t                sink;                           // 防止结果被优化掉
+} Case;
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int dlist_push_back(DList* d, uint64_t value) {
+    DNode*                  node = malloc(sizeof (DNode));
+
+    if (NULL == node) {
+        return JRET_ERROR;
+    }
+    node->value = value;
+    node->next = NULL;
+    node->prev = d->tail;
+    if (NULL == d->tail) {
+        d->head = node;
+    } else {
+        d->tail->next = node;
+    }
+    d->tail = node;
+    ++ d->num;
+
+    return JRET_OK;
+}
+
+static int dlist_push_front(DList* d, uint64_t value) {
+    DNode*                  node = malloc(sizeof (DNode));
+
+    if (NULL == node) {
+        return JRET_ERROR;
+    }
+    node->value = value;
+    node->prev = NULL;
+    node->next = d->head;
+    if (NULL == d->head) {
+        d->tail = node;
+    } else {
+        d->head->prev = node;
+    }
+    d->head = node;
+    ++ d->num;
+
+    return JRET_OK;
+}
+
+/* 第 index 个节点, index 等于元素数时返回 NULL */
+static DNode* dlist_at(DList* d, size_t index) {
+    DNode*                  node;
+    size_t                  i;
+
+    if (index < d->num / 2) {
+        for (node = d->head, i = 0; i < index; ++i) {
+            node = node->next;
+        }
+    } else {
+        for (node = NULL, i = d->num; i > index; --i) {
+            node = NULL == node ? d->tail : node->prev;
+        }
+    }
+
+    return node;
+}
+
+static void dlist_unlink(DList* d, DNode* node) {
+    if (NULL == node->prev) {
+        d->head = node->next;
+    } else {
+        node->prev->next = node->next;
+    }
+    if (NULL == node->next) {
+        d->tail = node->prev;
+    } else {
+        node->next->prev = node->prev;
+    }
+    -- d->num;
+    free(node);
+}
+
+static void dlist_clear(DList* d) {
+    while (NULL != d->head) {
+        dlist_unlink(d, d->head);
+    }
+}
+
+static int case_fill(Case* c) {
+    uint64_t                i;
+
+    /* 分开填充, 各个容器的内存不交错 */
+    for (i = 0; i < c->n; ++i) {
+        if (JRET_OK != jlist_push_back(c->list, &i)) {
+            return JRET_ERROR;
+        }
+    }
+    for (i = 0; i < c->n; ++i) {
+        if (JRET_OK != jarray_append(c->array, &i)) {
+            return JRET_ERROR;
+        }
+    }
+    for (i = 0; i < c->n; ++i) {
+        if (JRET_OK != dlist_push_back(&c->dlist, i)) {
+            return JRET_ERROR;
+        }
+    }
+
+    return JRET_OK;
+}
+
+static int setup_empty(void* data) {
+    Case*                   c = data;
+
+    jlist_clear(c->list);
+    jarray_clear(c->array);
+    dlist_clear(&c->dlist);
+
+    return JRET_OK;
+}
+
+static int setup_full(void* data) {
+    Case*                   c = data;
+
+    setup_empty(c);
+    if (JRET_OK != case_fill(c)) {
+        return JRET_ERROR;
+    }
+    jlist_cursor_first(c->list, &c->cursor);
+    c->dnode = c->dlist.head;
+
+    return JRET_OK;
+}
+
+static void run_jlist_push_back(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t                v;
+
+    for (v = begin; v < end; ++v) {
+        jlist_push_back(c->list, &v);
+    }
+}
+
+static void run_jlist_push_front(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t                v;
+
+    for (v = begin; v < end; ++v) {
+        jlist_push_front(c->list, &v);
+    }
+}
+
+static void run_jlist_pop_front(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t                v;
+
+    for (; begin < end; ++begin) {
+        jlist_pop_front(c->list, &v);
+        c->sink += v;
+    }
+}
+
+static void run_jlist_scan_block(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t*               p;
+    uint64_t                sum = 0;
+    unsigned int            num;
+    unsigned int            take;
+    unsigned int            i;
+
+    while (begin < end) {
+        p = jlist_cursor_block(&c->cursor, &num);
+        take = end - begin < num ? (unsigned int) (end - begin) : num;
+        for (i = 0; i < take; ++i) {
+            sum += p[i];
+        }
+        begin += take;
+        if (take == num) {
+            jlist_cursor_next_block(&c->cursor);
+        } else {
+            c->cursor.offset += take;                       // 这一段没有用完, 下次从中间接着遍历
+        }
+    }
+    c->sink += sum;
+}
+
+static void run_jlist_scan_cursor(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += *(uint64_t*) jlist_cursor_get(&c->cursor);
+        jlist_cursor_next(&c->cursor);
+    }
+}
+
+static void run_jlist_insert(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t                v;
+
+    for (v = begin; v < end; ++v) {
+        jlist_insert(c->list, (unsigned int) (c->positions[v] % (jlist_num(c->list) + 1)), &v);
+    }
+}
+
+static void run_jlist_remove(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        jlist_remove(c->list, (unsigned int) (c->positions[begin] % jlist_num(c->list)), JRET_PTR_NULL);
+    }
+}
+
+static void run_array_push_back(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t                v;
+
+    for (v = begin; v < end; ++v) {
+        jarray_append(c->array, &v);
+    }
+}
+
+static void run_array_scan(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t*               p = jarray_data(c->array);
+    uint64_t                sum = 0;
+
+    for (; begin < end; ++begin) {
+        sum += p[begin];
+    }
+    c->sink += sum;
+}
+
+static void run_array_insert(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    uint64_t                v;
+
+    for (v = begin; v < end; ++v) {
+        jarray_insert(c->array, (unsigned int) (c->positions[v] % (jarray_num(c->array) + 1)), &v);
+    }
+}
+
+static void run_array_remove(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        jarray_remove(c->array, (unsigned int) (c->positions[begin] % jarray_num(c->array)));
+    }
+}
+
+static void run_dlist_push_back(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        dlist_push_back(&c->dlist, begin);
+    }
+}
+
+static void run_dlist_push_front(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        dlist_push_front(&c->dlist, begin);
+    }
+}
+
+static void run_dlist_pop_front(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += c->dlist.head->value;
+        dlist_unlink(&c->dlist, c->dlist.head);
+    }
+}
+
+static void run_dlist_scan(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += c->dnode->value;
+        c->dnode = c->dnode->next;
+    }
+}
+
+static void run_dlist_insert(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    DNode*                  next;
+    DNode*                  node;
+
+    for (; begin < end; ++begin) {
+        next = dlist_at(&c->dlist, c->positions[begin] % (c->dlist.num + 1));
+        if (NULL == next) {
+            dlist_push_back(&c->dlist, begin);
+            continue;
+        }
+        node = malloc(sizeof (DNode));
+        if (NULL == node) {
+            continue;
+        }
+        node->value = begin;
+        node->next = next;
+        node->prev = next->prev;
+        if (NULL == next->prev) {
+            c->dlist.head = node;
+        } else {
+            next->prev->next = node;
+        }
+        next->prev = node;
+        ++ c->dlist.num;
+    }
+}
+
+static void run_dlist_remove(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        dlist_unlink(&c->dlist, dlist_at(&c->dlist, c->positions[begin] % c->dlist.num));
+    }
+}
+
+/* 每个元素占用的字节数 */
+static void print_memory(Case* c) {
+    JMemoryStats            listStats;
+    JMemoryStats            arrayStats;
+    size_t                  dlistBytes = sizeof (c->dlist);
+    DNode*                  node;
+
+    jlist_memory_stats(c->list, &listStats);
+    jarray_memory_stats(c->array, &arrayStats);
+    for (node = c->dlist.head; NULL != node; node = node->next) {
+        dlistBytes += malloc_usable_size(node) + sizeof (size_t);
+    }
+
+    fprintf(stderr, "memory n=%zu, bytes per element: jlist %.2f, array %.2f, dlist %.2f\n", c->n,
+            (double) listStats.live / c->n, (double) arrayStats.live / c->n, (double) dlistBytes / c->n);
+}
+
+static void bench_case(JBench* bench, Case* c) {
+    size_t                  n = c->n;
+    size_t                  ops = n < INSERT_OPS ? n : INSERT_OPS;
+
+    jbench_run(bench, "jlist", "push", "back", n, n, setup_empty, run_jlist_push_back, NULL, c);
+    jbench_run(bench, "array", "push", "back", n, n, setup_empty, run_array_push_back, NULL, c);
+    jbench_run(bench, "dlist", "push", "back", n, n, setup_empty, run_dlist_push_back, NULL, c);
+    jbench_run(bench, "jlist", "push", "front", n, n, setup_empty, run_jlist_push_front, NULL, c);
+    jbench_run(bench, "dlist", "push", "front", n, n, setup_empty, run_dlist_push_front, NULL, c);
+
+    jbench_run(bench, "jlist", "pop", "front", n, n, setup_full, run_jlist_pop_front, NULL, c);
+    jbench_run(bench, "dlist", "pop", "front", n, n, setup_full, run_dlist_pop_front, NULL, c);
+
+    jbench_run(bench, "jlist", "scan", "block", n, n, setup_full, run_jlist_scan_block, NULL, c);
+    jbench_run(bench, "jlist", "scan", "cursor", n, n, setup_full, run_jlist_scan_cursor, NULL, c);
+    jbench_run(bench, "array", "scan", "block", n, n, setup_full, run_array_scan, NULL, c);
+    jbench_run(bench, "dlist", "scan", "cursor", n, n, setup_full, run_dlist_scan, NULL, c);
+
+    jbench_run(bench, "jlist", "insert", "random", n, ops, setup_full, run_jlist_insert, NULL, c);
+    jbench_run(bench, "array", "insert", "random", n, ops, setup_full, run_array_insert, NULL, c);
+    jbench_run(bench, "dlist", "insert", "random", n, ops, setup_full, run_dlist_insert, NULL, c);
+    jbench_run(bench, "jlist", "remove", "random", n, ops, setup_full, run_jlist_remove, NULL, c);
+    jbench_run(bench, "array", "remove", "random", n, ops, setup_full, run_array_remove, NULL, c);
+    jbench_run(bench, "dlist", "remove", "random", n, ops, setup_full, run_dlist_remove, NULL, c);
+
+    if (JRET_OK == setup_full(c)) {
+        print_memory(c);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    JBench*                 bench = jbench_new(argc, argv);
+    Case                    c;
+    uint64_t                state = 0x9e3779b97f4a7c15ULL;
+    size_t                  i;
+    size_t                  k;
+
+    if (NULL == bench) {
+        return 2;
+    }
+
+    c.list = jlist_new(sizeof (uint64_t));
+    c.array = jarray_new(sizeof (uint64_t));
+    c.positions = malloc(sizeof (size_t) * INSERT_OPS);
+    if (NULL == c.list || NULL == c.array || NULL == c.positions) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    c.dlist.head = NULL;
+    c.dlist.tail = NULL;
+    c.dlist.num = 0;
+    c.sink = 0;
+    for (k = 0; k < INSERT_OPS; ++k) {
+        c.positions[k] = (size_t) xorshift(&state);
+    }
+
+    for (i = 0; i < jbench_num_sizes(bench); ++i) {
+        c.n = jbench_size(bench, i);
+        bench_case(bench, &c);
+    }
+
+    setup_empty(&c);
+    jlist_free(c.list);
+    jarray_free(c.array);
+    free(c.positions);
+
+    return jbench_free(bench);
+}
@@ -0,0 +1,288 @@
+/**
+ *  多路归并的吞吐量对比
+ *
+ *  pop+ins --- 原来的做法: 每一路一个游标放进 JBinaryHeap, 每输出一个值 binary_heap_pop 再 binary_heap_insert
+ *  merge   --- JMerge, 数组输入, jmerge_read 每次输出 1024 个
+ *  stream  --- JMerge, 回调输入(每次复制一段), 同上
+ *  par     --- jmerge_parallel, 线程池的线程数见表头
+ *  total 个随机 64 位整数平均分成 k 路, 每一路排好序; 值是指向整数的指针, 比较函数解引用比较。
+ *  每项测 3 次取中位数, 输出每秒归并的百万个值。
+ *
+ *  编译:
+ *      gcc -O2 -march=native -std=c99 -o merge_bench bench/merge_bench.c src/data_struct/jmerge.c \
+ *          src/data_struct/jbinary_heap.c src/base/jthread_pool.c src/base/jallocator.c \
+ *          -I src/base -I src/data_struct -lpthread
+ *  运行:
+ *      ./merge_bench [total [threads]]         默认 total 为 4000000, threads 为 CPU 核数
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "jmerge.h"
+#include "jbinary_heap.h"
+
+#define REPS                    (3)
+#define BATCH                   (1024)
+
+typedef enum {
+    BENCH_POP_INSERT,
+    BENCH_MERGE,
+    BENCH_STREAM,
+    BENCH_PARALLEL,
+    BENCH_NUM
+} Bench;
+
+static const char* benchNames[BENCH_NUM] = { "pop+ins", "merge", "stream", "par" };
+
+/* 一路输入: 数组游标, 也用作 pop+ins 的堆元素和 stream 的回调数据 */
+typedef struct {
+    const JMergeValue*      next;
+    const JMergeValue*      end;
+} Run;
+
+typedef struct {
+    unsigned int            k;
+    size_t                  total;
+    uint64_t*               keys;
+    JMergeValue*            values;                 // k 路依次存放, 每一路有序
+    const JMergeValue**     arrays;
+    size_t*                 nums;
+    JMergeValue*            out;
+    Run*                    runs;
+} Case;
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_key(JMergeValue value1, JMergeValue value2) {
+    uint64_t                a = *(const uint64_t*) value1;
+    uint64_t                b = *(const uint64_t*) value2;
+
+    return a < b ? JRET_SMALLER : (a > b ? JRET_BIGGER : JRET_EQUAL);
+}
+
+static int compare_pointer(const void* a, const void* b) {
+    return compare_key(*(JMergeValue*) a, *(JMergeValue*) b) == JRET_SMALLER ? -1 : 1;
+}
+
+static int compare_run(JBinaryHeapValue value1, JBinaryHeapValue value2) {
+    return compare_key(*((Run*) value1)->next, *((Run*) value2)->next);
+}
+
+static unsigned int read_run(void* data, JMergeValue* values, unsigned int num) {
+    Run*                    run = data;
+    size_t                  n = run->end - run->next;
+
+    if (n > num) {
+        n = num;
+    }
+    memcpy(values, run->next, sizeof (JMergeValue) * n);
+    run->next += n;
+
+    return (unsigned int) n;
+}
+
+static int case_init(Case* c, unsigned int k, size_t total) {
+    uint64_t                state = 0x9e3779b97f4a7c15ULL + k;
+    size_t                  begin = 0;
+    size_t                  i;
+    unsigned int            j;
+
+    c->k = k;
+    c->total = total;
+    c->keys = malloc(sizeof (uint64_t) * total);
+    c->values = malloc(sizeof (JMergeValue) * total);
+    c->out = malloc(sizeof (JMergeValue) * total);
+    c->arrays = malloc(sizeof (JMergeValue*) * k);
+    c->nums = malloc(sizeof (size_t) * k);
+    c->runs = malloc(sizeof (Run) * k);
+    if (NULL == c->keys || NULL == c->values || NULL == c->out || NULL == c->arrays || NULL == c->nums || NULL == c->runs) {
+        return JRET_ERROR;
+    }
+
+    for (i = 0; i < total; ++i) {
+        c->keys[i] = xorshift(&state);
+        c->values[i] = &c->keys[i];
+    }
+    for (j = 0; j < k; ++j) {
+        c->arrays[j] = c->values + begin;
+        c->nums[j] = total * (j + 1) / k - begin;
+        qsort(c->values + begin, c->nums[j], sizeof (JMergeValue), compare_pointer);
+        begin += c->nums[j];
+    }
+
+    return JRET_OK;
+}
+
+static void case_free(Case* c) {
+    free(c->keys);
+    free(c->values);
+    free(c->out);
+    free(c->arrays);
+    free(c->nums);
+    free(c->runs);
+}
+
+static void reset_runs(Case* c) {
+    unsigned int            j;
+
+    for (j = 0; j < c->k; ++j) {
+        c->runs[j].next = c->arrays[j];
+        c->runs[j].end = c->arrays[j] + c->nums[j];
+    }
+}
+
+static int run_pop_insert(Case* c) {
+    JBinaryHeap*            heap = binary_heap_new(JBINARY_HEAP_TYPE_MIN, compare_run);
+    JMergeValue*            out = c->out;
+    Run*                    run;
+    unsigned int            j;
+
+    if (NULL == heap) {
+        return JRET_ERROR;
+    }
+
+    reset_runs(c);
+    for (j = 0; j < c->k; ++j) {
+        if (c->runs[j].next != c->runs[j].end) {
+            binary_heap_insert(heap, &c->runs[j]);
+        }
+    }
+    while (NULL != (run = binary_heap_pop(heap))) {
+        *out++ = *run->next++;
+        if (run->next != run->end) {
+            binary_heap_insert(heap, run);
+        }
+    }
+    binary_heap_free(heap);
+
+    return JRET_OK;
+}
+
+static int run_merge(Case* c, int stream) {
+    JMerge*                 merge = jmerge_new(compare_key);
+    size_t                  done = 0;
+    size_t                  n;
+    unsigned int            j;
+
+    if (NULL == merge) {
+        return JRET_ERROR;
+    }
+
+    reset_runs(c);
+    for (j = 0; j < c->k; ++j) {
+        if (stream) {
+            jmerge_add_stream(merge, read_run, &c->runs[j]);
+        } else {
+            jmerge_add_array(merge, c->arrays[j], c->nums[j]);
+        }
+    }
+    while ((n = jmerge_read(merge, c->out + done, BATCH)) > 0) {
+        done += n;
+    }
+    jmerge_free(merge);
+
+    return done == c->total ? JRET_OK : JRET_ERROR;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double                  x = *(const double*) a;
+    double                  y = *(const double*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* 返回每秒百万个值, 失败返回负数 */
+static double bench_one(Case* c, Bench bench, JThreadPool* pool) {
+    double                  samples[REPS];
+    double                  t0;
+    int                     ret = JRET_ERROR;
+    unsigned int            i;
+
+    for (i = 0; i < REPS; ++i) {
+        t0 = now();
+        switch (bench) {
+        case BENCH_POP_INSERT:
+            ret = run_pop_insert(c);
+            break;
+        case BENCH_MERGE:
+        case BENCH_STREAM:
+            ret = run_merge(c, BENCH_STREAM == bench);
+            break;
+        default:
+            ret = jmerge_parallel(compare_key, c->arrays, c->nums, c->k, c->out, pool);
+            break;
+        }
+        samples[i] = now() - t0;
+        if (JRET_OK != ret) {
+            return -1;
+        }
+    }
+
+    qsort(samples, REPS, sizeof (double), compare_double);
+
+    return c->total / samples[REPS / 2] * 1e3;
+}
+
+int main(int argc, char* argv[]) {
+    size_t total = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : 4000000;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = argc > 2 ? (unsigned int) strtoul(argv[2], NULL, 10) : (cpus > 0 ? (unsigned int) cpus : 1);
+    unsigned int ks[] = { 2, 8, 64, 512, 4096 };
+    JThreadPool* pool;
+    Case c;
+    unsigned int i;
+    int b;
+
+    if (0 == total || 0 == threads) {
+        printf("usage: %s [total [threads]]\n", argv[0]);
+        return 1;
+    }
+
+    pool = thread_pool_new(threads);
+    if (NULL == pool) {
+        return 2;
+    }
+
+    printf("k-way merge, Mvalues/s, %zu values, par uses %u threads\n\n", total, threads);
+    printf("%6s", "k");
+    for (b = 0; b < BENCH_NUM; ++b) {
+        printf(" %10s", benchNames[b]);
+    }
+    printf("\n");
+
+    for (i = 0; i < sizeof (ks) / sizeof (ks[0]); ++i) {
+        if (JRET_OK != case_init(&c, ks[i], total)) {
+            printf("%6u out of memory\n", ks[i]);
+            case_free(&c);
+            continue;
+        }
+        printf("%6u", ks[i]);
+        for (b = 0; b < BENCH_NUM; ++b) {
+            printf(" %10.2f", bench_one(&c, b, pool));
+            fflush(stdout);
+        }
+        printf("\n");
+        case_free(&c);
+    }
+
+    thread_pool_free(pool);
+
+    return 0;
+}
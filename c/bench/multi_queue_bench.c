@@ -0,0 +1,266 @@
+/**
+ *  并发优先级队列的吞吐量对比
+ *
+ *  mutex   --- 一个 JBinaryHeap 加一把互斥锁
+ *  relaxed --- JMultiQueue, multi_queue_pop
+ *  strict  --- JMultiQueue, multi_queue_pop_strict
+ *  队列先放入 prefill 个元素, 每个线程交替插入随机优先级和弹出, 总操作数固定,
+ *  输出每秒百万次操作; rank 列是宽松弹出的平均名次误差:
+ *  各线程并发插入 0..n-1 的随机排列后依次弹出, 弹出值前面还有几个没弹出的值, 0 表示严格有序。
+ *  分片数为线程数的 2 倍。
+ *
+ *  编译:
+ *      gcc -O2 -march=native -std=c99 -o multi_queue_bench bench/multi_queue_bench.c \
+ *          src/data_struct/jmulti_queue.c src/data_struct/jbinary_heap.c src/base/jallocator.c \
+ *          -I src/base -I src/data_struct -lpthread
+ *  运行:
+ *      ./multi_queue_bench [ops [prefill]]     默认 ops 为 4000000, prefill 为 1000000
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "jmulti_queue.h"
+
+typedef enum {
+    BENCH_MUTEX,
+    BENCH_RELAXED,
+    BENCH_STRICT
+} BenchKind;
+
+typedef struct {
+    BenchKind               kind;
+    JBinaryHeap*            heap;
+    pthread_mutex_t         lock;
+    JMultiQueue*            queue;
+    uint64_t*               keys;
+    unsigned int            opsPerThread;
+    pthread_barrier_t       start;
+} Bench;
+
+typedef struct {
+    Bench*                  bench;
+    unsigned int            index;
+} BenchThread;
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int compare_func(JBinaryHeapValue v1, JBinaryHeapValue v2) {
+    if ((*(uint64_t*)v1) > (*(uint64_t*)v2)) {
+        return JRET_BIGGER;
+    } else if ((*(uint64_t*)v1) < (*(uint64_t*)v2)) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+static void bench_push(Bench* bench, uint64_t* key) {
+    if (BENCH_MUTEX == bench->kind) {
+        pthread_mutex_lock(&bench->lock);
+        binary_heap_insert(bench->heap, key);
+        pthread_mutex_unlock(&bench->lock);
+    } else {
+        multi_queue_push(bench->queue, key);
+    }
+}
+
+static void bench_pop(Bench* bench) {
+    if (BENCH_MUTEX == bench->kind) {
+        pthread_mutex_lock(&bench->lock);
+        binary_heap_pop(bench->heap);
+        pthread_mutex_unlock(&bench->lock);
+    } else if (BENCH_RELAXED == bench->kind) {
+        multi_queue_pop(bench->queue);
+    } else {
+        multi_queue_pop_strict(bench->queue);
+    }
+}
+
+static void* bench_thread(void* arg) {
+    BenchThread* thread = arg;
+    Bench* bench = thread->bench;
+    uint64_t* keys = bench->keys + (size_t) thread->index * bench->opsPerThread;
+    unsigned int i;
+
+    pthread_barrier_wait(&bench->start);
+    for (i = 0; i < bench->opsPerThread; i += 2) {
+        bench_push(bench, &keys[i]);
+        bench_pop(bench);
+    }
+
+    return NULL;
+}
+
+static double bench_run(BenchKind kind, unsigned int numThreads, unsigned int ops, uint64_t* prefill, unsigned int numPrefill, uint64_t* keys) {
+    Bench bench;
+    BenchThread threads[64];
+    pthread_t ids[64];
+    unsigned int i;
+    double t0, t1;
+
+    bench.kind = kind;
+    bench.keys = keys;
+    bench.opsPerThread = ops / numThreads & ~1u;
+    bench.heap = JRET_PTR_NULL;
+    bench.queue = JRET_PTR_NULL;
+    pthread_mutex_init(&bench.lock, NULL);
+    pthread_barrier_init(&bench.start, NULL, numThreads + 1);
+
+    if (BENCH_MUTEX == kind) {
+        bench.heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, 4, compare_func);
+        for (i = 0; i < numPrefill; ++i) {
+            binary_heap_insert(bench.heap, &prefill[i]);
+        }
+    } else {
+        bench.queue = multi_queue_new(JBINARY_HEAP_TYPE_MIN, compare_func, numThreads * 2);
+        for (i = 0; i < numPrefill; ++i) {
+            multi_queue_push(bench.queue, &prefill[i]);
+        }
+    }
+
+    for (i = 0; i < numThreads; ++i) {
+        threads[i].bench = &bench;
+        threads[i].index = i;
+        pthread_create(&ids[i], NULL, bench_thread, &threads[i]);
+    }
+
+    pthread_barrier_wait(&bench.start);
+    t0 = now();
+    for (i = 0; i < numThreads; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+    t1 = now();
+
+    if (BENCH_MUTEX == kind) {
+        binary_heap_free(bench.heap);
+    } else {
+        multi_queue_free(bench.queue);
+    }
+    pthread_barrier_destroy(&bench.start);
+    pthread_mutex_destroy(&bench.lock);
+
+    return (double) bench.opsPerThread * numThreads / (t1 - t0) / 1e6;
+}
+
+typedef struct {
+    JMultiQueue*            queue;
+    uint64_t*               keys;
+    unsigned int            num;
+} RankFill;
+
+static void* rank_fill(void* arg) {
+    RankFill* fill = arg;
+    unsigned int i;
+
+    for (i = 0; i < fill->num; ++i) {
+        multi_queue_push(fill->queue, &fill->keys[i]);
+    }
+
+    return NULL;
+}
+
+/* 宽松弹出的平均名次误差 */
+static double bench_rank_error(unsigned int numThreads, unsigned int n) {
+    JMultiQueue* queue = multi_queue_new(JBINARY_HEAP_TYPE_MIN, compare_func, numThreads * 2);
+    uint64_t* keys = malloc(sizeof (uint64_t) * n);
+    unsigned char* popped = calloc(n, 1);
+    uint64_t state = 2463534242ULL;
+    uint64_t smallest = 0;
+    RankFill fills[64];
+    pthread_t ids[64];
+    uint64_t* key;
+    double total = 0;
+    unsigned int i, j, t;
+    uint64_t tmp;
+
+    for (i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    for (i = n - 1; i > 0; --i) {
+        j = xorshift(&state) % (i + 1);
+        tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+
+    for (i = 0; i < numThreads; ++i) {
+        fills[i].queue = queue;
+        fills[i].keys = keys + (size_t) n / numThreads * i;
+        fills[i].num = i + 1 == numThreads ? n - n / numThreads * i : n / numThreads;
+        pthread_create(&ids[i], NULL, rank_fill, &fills[i]);
+    }
+    for (i = 0; i < numThreads; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+
+    for (i = 0; i < n; ++i) {
+        key = multi_queue_pop(queue);
+        popped[*key] = 1;
+        for (t = 0, j = (unsigned int) smallest; j < *key; ++j) {
+            t += !popped[j];
+        }
+        total += t;
+        while (smallest < n && popped[smallest]) {
+            ++ smallest;
+        }
+    }
+
+    multi_queue_free(queue);
+    free(keys);
+    free(popped);
+
+    return total / n;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int ops = argc > 1 ? (unsigned int) strtoul(argv[1], NULL, 10) : 4000000;
+    unsigned int numPrefill = argc > 2 ? (unsigned int) strtoul(argv[2], NULL, 10) : 1000000;
+    unsigned int threads[] = { 1, 2, 4, 8, 16, 32, 64 };
+    uint64_t state = 88172645463325252ULL;
+    uint64_t* prefill = malloc(sizeof (uint64_t) * numPrefill);
+    uint64_t* keys = malloc(sizeof (uint64_t) * ops);
+    unsigned int i;
+
+    if (JRET_PTR_NULL == prefill || JRET_PTR_NULL == keys) {
+        printf("out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < numPrefill; ++i) {
+        prefill[i] = xorshift(&state);
+    }
+    for (i = 0; i < ops; ++i) {
+        keys[i] = xorshift(&state);
+    }
+
+    printf("Mops/s, push + pop pairs, prefill %u\n\n", numPrefill);
+    printf("%8s %10s %10s %10s %10s\n", "threads", "mutex", "relaxed", "strict", "rank");
+    for (i = 0; i < sizeof (threads) / sizeof (threads[0]); ++i) {
+        printf("%8u %10.2f %10.2f %10.2f %10.1f\n", threads[i],
+               bench_run(BENCH_MUTEX, threads[i], ops, prefill, numPrefill, keys),
+               bench_run(BENCH_RELAXED, threads[i], ops, prefill, numPrefill, keys),
+               bench_run(BENCH_STRICT, threads[i], ops, prefill, numPrefill, keys),
+               bench_rank_error(threads[i], 100000));
+        fflush(stdout);
+    }
+
+    free(prefill);
+    free(keys);
+
+    return 0;
+}
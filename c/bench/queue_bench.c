@@ -0,0 +1,383 @@
+/**
+ *  有界队列的吞吐量和跨核延迟对比
+ *
+ *  mutex   --- 同样容量的环形缓冲区加一把互斥锁(相当于现在流水线中的 "链表 + 互斥锁")
+ *  spsc    --- JQueue, JQUEUE_TYPE_SPSC, 只测 1 个生产者 1 个消费者
+ *  mpmc    --- JQueue, JQUEUE_TYPE_MPMC
+ *  *_n     --- 同上, 用 jqueue_push_n / jqueue_pop_n 每次 32 个
+ *
+ *  吞吐量: p 个生产者各插入 ops / p 个值, c 个消费者弹出, 全部弹出的时间, 输出每秒百万个值;
+ *          队列满、空时忙等, 每失败 64 次让出一次 CPU。
+ *  延迟:   两个线程用两个队列来回传一个值, 每个来回单独计时, 输出单程(来回的一半)的中位数和 p99 纳秒数;
+ *          cond 是互斥锁加条件变量, futex 是 blocking 的 JQueue 用 jqueue_pop_wait 等待, 这两项会睡眠。
+ *  容量为 1024; 线程数超过 CPU 核数时结果主要反映调度, 延迟需要至少 2 个核才有意义。
+ *
+ *  编译:
+ *      gcc -O2 -march=native -std=c99 -o queue_bench bench/queue_bench.c src/data_struct/jqueue.c \
+ *          -I src/base -I src/data_struct -lpthread
+ *  运行:
+ *      ./queue_bench [ops [rounds]]            默认 ops 为 4000000, rounds 为 200000
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "jqueue.h"
+
+#define CAPACITY                (1024)
+#define BATCH                   (32)
+#define SPINS                   (64)                    // 忙等多少次失败后让出 CPU
+
+typedef enum {
+    KIND_MUTEX,
+    KIND_SPSC,
+    KIND_SPSC_N,
+    KIND_MPMC,
+    KIND_MPMC_N,
+    KIND_COND,
+    KIND_FUTEX,
+    KIND_NUM
+} Kind;
+
+static const char* kindNames[KIND_NUM] = { "mutex", "spsc", "spsc_n", "mpmc", "mpmc_n", "cond", "futex" };
+
+/* 对照: 环形缓冲区加互斥锁, cond 时用条件变量等待 */
+typedef struct {
+    pthread_mutex_t         lock;
+    pthread_cond_t          notEmpty;
+    pthread_cond_t          notFull;
+    JQueueValue             slots[CAPACITY];
+    unsigned int            head;
+    unsigned int            num;
+} MutexQueue;
+
+typedef struct {
+    Kind                    kind;
+    JQueue*                 queue;
+    MutexQueue              mutexQueue;
+} Queue;
+
+typedef struct {
+    Queue*                  queue;
+    unsigned int            num;                        // 生产者插入的个数, 消费者为 0
+    unsigned long*          popped;                     // 所有消费者弹出的总数
+    unsigned long           total;
+    pthread_barrier_t*      start;
+} Worker;
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void relax(unsigned int* spins) {
+    if (++ *spins >= SPINS) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+static int queue_init(Queue* queue, Kind kind) {
+    queue->kind = kind;
+    queue->queue = JRET_PTR_NULL;
+    pthread_mutex_init(&queue->mutexQueue.lock, NULL);
+    pthread_cond_init(&queue->mutexQueue.notEmpty, NULL);
+    pthread_cond_init(&queue->mutexQueue.notFull, NULL);
+    queue->mutexQueue.head = 0;
+    queue->mutexQueue.num = 0;
+
+    if (KIND_MUTEX == kind || KIND_COND == kind) {
+        return JRET_OK;
+    }
+    queue->queue = jqueue_new(KIND_SPSC == kind || KIND_SPSC_N == kind || KIND_FUTEX == kind ? JQUEUE_TYPE_SPSC : JQUEUE_TYPE_MPMC,
+                              CAPACITY, KIND_FUTEX == kind);
+
+    return JRET_PTR_NULL == queue->queue ? JRET_ERROR : JRET_OK;
+}
+
+static void queue_destroy(Queue* queue) {
+    jqueue_free(queue->queue);
+    pthread_cond_destroy(&queue->mutexQueue.notFull);
+    pthread_cond_destroy(&queue->mutexQueue.notEmpty);
+    pthread_mutex_destroy(&queue->mutexQueue.lock);
+}
+
+/* 插入 values 的前若干个, 返回个数 */
+static unsigned int queue_push(Queue* queue, JQueueValue* values, unsigned int num) {
+    MutexQueue*             m = &queue->mutexQueue;
+    unsigned int            n = 0;
+
+    switch (queue->kind) {
+    case KIND_MUTEX:
+        pthread_mutex_lock(&m->lock);
+        if (m->num < CAPACITY) {
+            m->slots[(m->head + m->num ++) % CAPACITY] = values[0];
+            n = 1;
+        }
+        pthread_mutex_unlock(&m->lock);
+        return n;
+    case KIND_COND:
+        pthread_mutex_lock(&m->lock);
+        while (CAPACITY == m->num) {
+            pthread_cond_wait(&m->notFull, &m->lock);
+        }
+        m->slots[(m->head + m->num ++) % CAPACITY] = values[0];
+        pthread_cond_signal(&m->notEmpty);
+        pthread_mutex_unlock(&m->lock);
+        return 1;
+    case KIND_FUTEX:
+        return JRET_OK == jqueue_push_wait(queue->queue, values[0], -1);
+    case KIND_SPSC_N:
+    case KIND_MPMC_N:
+        return jqueue_push_n(queue->queue, values, num);
+    default:
+        return JRET_OK == jqueue_push(queue->queue, values[0]);
+    }
+}
+
+static unsigned int queue_pop(Queue* queue, JQueueValue* values) {
+    MutexQueue*             m = &queue->mutexQueue;
+    unsigned int            n = 0;
+
+    switch (queue->kind) {
+    case KIND_MUTEX:
+        pthread_mutex_lock(&m->lock);
+        if (0 != m->num) {
+            values[0] = m->slots[m->head];
+            m->head = (m->head + 1) % CAPACITY;
+            -- m->num;
+            n = 1;
+        }
+        pthread_mutex_unlock(&m->lock);
+        return n;
+    case KIND_COND:
+        pthread_mutex_lock(&m->lock);
+        while (0 == m->num) {
+            pthread_cond_wait(&m->notEmpty, &m->lock);
+        }
+        values[0] = m->slots[m->head];
+        m->head = (m->head + 1) % CAPACITY;
+        -- m->num;
+        pthread_cond_signal(&m->notFull);
+        pthread_mutex_unlock(&m->lock);
+        return 1;
+    case KIND_FUTEX:
+        return JRET_OK == jqueue_pop_wait(queue->queue, values, -1);
+    case KIND_SPSC_N:
+    case KIND_MPMC_N:
+        return jqueue_pop_n(queue->queue, values, BATCH);
+    default:
+        return JRET_OK == jqueue_pop(queue->queue, values);
+    }
+}
+
+static void* producer(void* arg) {
+    Worker*                 worker = arg;
+    JQueueValue             values[BATCH];
+    unsigned int            spins = 0;
+    unsigned int            done = 0;
+    unsigned int            batch;
+    unsigned int            n;
+    unsigned int            i;
+
+    pthread_barrier_wait(worker->start);
+    while (done < worker->num) {
+        batch = worker->num - done < BATCH ? worker->num - done : BATCH;
+        for (i = 0; i < batch; ++i) {
+            values[i] = (JQueueValue) (uintptr_t) (done + i);
+        }
+        n = queue_push(worker->queue, values, batch);
+        if (0 == n) {
+            relax(&spins);
+        }
+        done += n;
+    }
+
+    return NULL;
+}
+
+static void* consumer(void* arg) {
+    Worker*                 worker = arg;
+    JQueueValue             values[BATCH];
+    unsigned int            spins = 0;
+    unsigned int            n;
+
+    pthread_barrier_wait(worker->start);
+    while (__atomic_load_n(worker->popped, __ATOMIC_RELAXED) < worker->total) {
+        n = queue_pop(worker->queue, values);
+        if (0 == n) {
+            relax(&spins);
+            continue;
+        }
+        __atomic_fetch_add(worker->popped, n, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/* 返回每秒百万个值, 失败返回负数 */
+static double bench_throughput(Kind kind, unsigned int numProducers, unsigned int numConsumers, unsigned int ops) {
+    Queue                   queue;
+    Worker                  workers[64];
+    pthread_t               ids[64];
+    pthread_barrier_t       start;
+    unsigned long           popped = 0;
+    unsigned int            numThreads = numProducers + numConsumers;
+    unsigned int            perProducer = ops / numProducers;
+    unsigned int            i;
+    double                  t0;
+    double                  t1;
+
+    if (JRET_OK != queue_init(&queue, kind)) {
+        return -1;
+    }
+    pthread_barrier_init(&start, NULL, numThreads + 1);
+
+    for (i = 0; i < numThreads; ++i) {
+        workers[i].queue = &queue;
+        workers[i].num = i < numProducers ? perProducer : 0;
+        workers[i].popped = &popped;
+        workers[i].total = (unsigned long) perProducer * numProducers;
+        workers[i].start = &start;
+        pthread_create(&ids[i], NULL, i < numProducers ? producer : consumer, &workers[i]);
+    }
+
+    pthread_barrier_wait(&start);
+    t0 = now();
+    for (i = 0; i < numThreads; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+    t1 = now();
+
+    pthread_barrier_destroy(&start);
+    queue_destroy(&queue);
+
+    return (double) perProducer * numProducers / (t1 - t0) * 1e3;
+}
+
+typedef struct {
+    Queue*                  ping;
+    Queue*                  pong;
+    unsigned int            rounds;
+} Echo;
+
+static void* echo(void* arg) {
+    Echo*                   e = arg;
+    JQueueValue             value;
+    unsigned int            spins = 0;
+    unsigned int            i;
+
+    for (i = 0; i < e->rounds; ++i) {
+        while (0 == queue_pop(e->ping, &value)) {
+            relax(&spins);
+        }
+        while (0 == queue_push(e->pong, &value, 1)) {
+            relax(&spins);
+        }
+    }
+
+    return NULL;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double                  x = *(const double*) a;
+    double                  y = *(const double*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* 单程延迟的中位数和 p99 纳秒数 */
+static int bench_latency(Kind kind, unsigned int rounds, double* median, double* p99) {
+    Queue                   ping;
+    Queue                   pong;
+    Echo                    e = { &ping, &pong, rounds };
+    pthread_t               id;
+    double*                 samples = malloc(sizeof (double) * rounds);
+    JQueueValue             value = JRET_PTR_NULL;
+    unsigned int            spins = 0;
+    unsigned int            i;
+    double                  t0;
+
+    if (JRET_PTR_NULL == samples || JRET_OK != queue_init(&ping, kind) || JRET_OK != queue_init(&pong, kind)) {
+        free(samples);
+        return JRET_ERROR;
+    }
+
+    pthread_create(&id, NULL, echo, &e);
+    for (i = 0; i < rounds; ++i) {
+        t0 = now();
+        while (0 == queue_push(&ping, &value, 1)) {
+            relax(&spins);
+        }
+        while (0 == queue_pop(&pong, &value)) {
+            relax(&spins);
+        }
+        samples[i] = (now() - t0) / 2;
+    }
+    pthread_join(id, NULL);
+
+    qsort(samples, rounds, sizeof (double), compare_double);
+    *median = samples[rounds / 2];
+    *p99 = samples[(size_t) ((rounds - 1) * 0.99)];
+
+    free(samples);
+    queue_destroy(&ping);
+    queue_destroy(&pong);
+
+    return JRET_OK;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int ops = argc > 1 ? (unsigned int) strtoul(argv[1], NULL, 10) : 4000000;
+    unsigned int rounds = argc > 2 ? (unsigned int) strtoul(argv[2], NULL, 10) : 200000;
+    unsigned int threads[] = { 1, 2, 4, 8 };
+    Kind throughputKinds[] = { KIND_MUTEX, KIND_SPSC, KIND_SPSC_N, KIND_MPMC, KIND_MPMC_N };
+    Kind latencyKinds[] = { KIND_MUTEX, KIND_SPSC, KIND_MPMC, KIND_COND, KIND_FUTEX };
+    double median;
+    double p99;
+    unsigned int i;
+    unsigned int k;
+
+    if (0 == ops || 0 == rounds) {
+        printf("usage: %s [ops [rounds]]\n", argv[0]);
+        return 1;
+    }
+
+    printf("throughput, Mops/s, %u values, capacity %d\n\n", ops, CAPACITY);
+    printf("%8s", "threads");
+    for (k = 0; k < sizeof (throughputKinds) / sizeof (throughputKinds[0]); ++k) {
+        printf(" %10s", kindNames[throughputKinds[k]]);
+    }
+    printf("\n");
+    for (i = 0; i < sizeof (threads) / sizeof (threads[0]); ++i) {
+        printf("%5up%uc", threads[i], threads[i]);
+        for (k = 0; k < sizeof (throughputKinds) / sizeof (throughputKinds[0]); ++k) {
+            if (1 != threads[i] && (KIND_SPSC == throughputKinds[k] || KIND_SPSC_N == throughputKinds[k])) {
+                printf(" %10s", "-");
+            } else {
+                printf(" %10.2f", bench_throughput(throughputKinds[k], threads[i], threads[i], ops));
+            }
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    printf("\none-way latency, ns, %u round trips\n\n", rounds);
+    printf("%8s %10s %10s\n", "queue", "median", "p99");
+    for (k = 0; k < sizeof (latencyKinds) / sizeof (latencyKinds[0]); ++k) {
+        if (JRET_OK != bench_latency(latencyKinds[k], rounds, &median, &p99)) {
+            printf("%8s %10s\n", kindNames[latencyKinds[k]], "failed");
+            continue;
+        }
+        printf("%8s %10.1f %10.1f\n", kindNames[latencyKinds[k]], median, p99);
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+/**
+ *  JString 的 UTF-8 校验、统计字符数、转码和查找的吞吐量, 基于 jbench 测试框架
+ *
+ *  规模为 n 的测试项生成约 n 字节的文本, 切成 1KB 的块, 每块单独是合法的 UTF-8(末尾用空格补齐),
+ *  模拟逐行处理爬虫抓下来的网页; 每个操作处理一块, 每轮至少处理 4MB, 结果另外给出 GB/s。
+ *  n 决定文本能否放进缓存, 1000000 以上基本是内存带宽。
+ *  文本分布:
+ *      ascii   --- 英文
+ *      cjk     --- 中文, 几乎都是 3 字节字符
+ *      mixed   --- 网页, 七成 ASCII 标签, 其余是中文和少量 4 字节的 emoji
+ *  实现(第一列): c、sse2、avx2 分别是 jstring_set_simd 强制的实现, CPU 不支持的跳过;
+ *  libc 是 glibc 的 memchr / memmem, 作为查找的对照。
+ *  测试项:
+ *      validate    jstring_utf8_valid
+ *      length      jstring_utf8_length
+ *      to_utf16    jstring_utf8_to_utf16
+ *      to_utf32    jstring_utf8_to_utf32
+ *      from16      jstring_utf16_to_utf8, 输入是预先转好的 UTF-16, 字节数仍按 UTF-8 计
+ *      memchr      查找不存在的字节, 扫描整块
+ *      memmem      查找不存在的 5 字节子串, 首字节是常见字节
+ *
+ *  编译(make bench 也会编译):
+ *      gcc -O2 -march=native -std=c99 -o string_bench bench/string_bench.c bench/jbench.c \
+ *          src/data_struct/jstring.c -I src/base -I src/data_struct -lm
+ *  运行:
+ *      ./string_bench [-r reps] [-w warmup] [-t seconds] [-n size[,size...]] [-f filter] [-j file|-]
+ *      例如 ./string_bench -n 100000 -f /cjk -j string.json
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "jbench.h"
+#include "jstring.h"
+
+#define BLOCK_SIZE              (1024)
+#define MIN_OPS                 (4096)                          // 每轮至少处理的块数
+
+typedef enum {
+    DIST_ASCII,
+    DIST_CJK,
+    DIST_MIXED,
+    DIST_NUM
+} Dist;
+
+static const char* distNames[DIST_NUM] = { "ascii", "cjk", "mixed" };
+
+typedef struct {
+    size_t                  numBlocks;
+    char*                   text;                           // numBlocks * BLOCK_SIZE 字节
+    uint16_t*               utf16;                          // 每块转成的 UTF-16, 每块最多 BLOCK_SIZE 个单元
+    size_t*                 utf16Num;
+    uint16_t*               out16;
+    uint32_t*               out32;
+    char*                   out8;
+    const char*             needle;
+    size_t                  needleSize;
+    size_t                  sink;                           // 防止结果被优化掉
+} Case;
+
+static uint64_t xorshift(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* 按分布取一个码点 */
+static uint32_t random_codepoint(Dist dist, uint64_t* state) {
+    static const char       ascii[] = "the quick brown fox jumps over a lazy dog, THE END. 0123456789 <div class=\"a\"></div>\n";
+    uint64_t                r = xorshift(state);
+    unsigned int            p = r % 100;
+
+    r >>= 8;
+    if (DIST_ASCII == dist || (DIST_MIXED == dist && p < 70)) {
+        return (unsigned char) ascii[r % (sizeof (ascii) - 1)];
+    }
+    if (DIST_CJK == dist && p < 5) {
+        return 0xFF0C;                                              // 全角逗号
+    }
+    if (DIST_MIXED == dist && p >= 98) {
+        return 0x1F600 + r % 80;                                    // emoji
+    }
+
+    return 0x4E00 + r % 0x5000;                                     // 常用汉字
+}
+
+/* 生成一块, 合法的 UTF-8, 不够的部分补空格 */
+static void fill_block(Dist dist, char* block, uint64_t* state) {
+    size_t                  size = 0;
+    uint32_t                cp;
+
+    while (size + 4 <= BLOCK_SIZE) {
+        cp = random_codepoint(dist, state);
+        size += jstring_utf32_to_utf8(&cp, 1, block + size);
+    }
+    memset(block + size, ' ', BLOCK_SIZE - size);
+}
+
+static int case_init(Case* c, Dist dist, size_t n) {
+    uint64_t                state = 0x9e3779b97f4a7c15ULL + dist;
+    size_t                  i;
+
+    memset(c, 0, sizeof (Case));
+    c->numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    c->text = malloc(c->numBlocks * BLOCK_SIZE);
+    c->utf16 = malloc(c->numBlocks * BLOCK_SIZE * sizeof (uint16_t));
+    c->utf16Num = malloc(c->numBlocks * sizeof (size_t));
+    c->out16 = malloc(BLOCK_SIZE * sizeof (uint16_t));
+    c->out32 = malloc(BLOCK_SIZE * sizeof (uint32_t));
+    c->out8 = malloc(BLOCK_SIZE * 3);
+    if (NULL == c->text || NULL == c->utf16 || NULL == c->utf16Num || NULL == c->out16 || NULL == c->out32 || NULL == c->out8) {
+        return JRET_ERROR;
+    }
+
+    for (i = 0; i < c->numBlocks; ++i) {
+        fill_block(dist, c->text + i * BLOCK_SIZE, &state);
+        c->utf16Num[i] = jstring_utf8_to_utf16(c->text + i * BLOCK_SIZE, BLOCK_SIZE, c->utf16 + i * BLOCK_SIZE);
+        if (JSTRING_NPOS == c->utf16Num[i]) {
+            return JRET_ERROR;
+        }
+    }
+
+    c->needle = DIST_ASCII == dist ? "the \x01" : "\xe4\xb8\x80 \x01";
+    c->needleSize = 5;
+
+    return JRET_OK;
+}
+
+static void case_free(Case* c) {
+    free(c->text);
+    free(c->utf16);
+    free(c->utf16Num);
+    free(c->out16);
+    free(c->out32);
+    free(c->out8);
+}
+
+static const char* block_at(Case* c, size_t op) {
+    return c->text + (op % c->numBlocks) * BLOCK_SIZE;
+}
+
+static void run_validate(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jstring_utf8_valid(block_at(c, begin), BLOCK_SIZE);
+    }
+}
+
+static void run_length(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jstring_utf8_length(block_at(c, begin), BLOCK_SIZE);
+    }
+}
+
+static void run_to_utf16(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jstring_utf8_to_utf16(block_at(c, begin), BLOCK_SIZE, c->out16);
+    }
+}
+
+static void run_to_utf32(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jstring_utf8_to_utf32(block_at(c, begin), BLOCK_SIZE, c->out32);
+    }
+}
+
+static void run_from16(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+    size_t                  i;
+
+    for (; begin < end; ++begin) {
+        i = begin % c->numBlocks;
+        c->sink += jstring_utf16_to_utf8(c->utf16 + i * BLOCK_SIZE, c->utf16Num[i], c->out8);
+    }
+}
+
+static void run_memchr(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jstring_memchr(block_at(c, begin), BLOCK_SIZE, '\x01');
+    }
+}
+
+static void run_memmem(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += jstring_memmem(block_at(c, begin), BLOCK_SIZE, c->needle, c->needleSize);
+    }
+}
+
+static void run_libc_memchr(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += (uintptr_t) memchr(block_at(c, begin), '\x01', BLOCK_SIZE);
+    }
+}
+
+static void run_libc_memmem(void* data, size_t begin, size_t end) {
+    Case*                   c = data;
+
+    for (; begin < end; ++begin) {
+        c->sink += (uintptr_t) memmem(block_at(c, begin), BLOCK_SIZE, c->needle, c->needleSize);
+    }
+}
+
+static void bench_case(JBench* bench, Case* c, Dist dist, size_t n) {
+    static const JStringSimd    simds[] = { JSTRING_SIMD_NONE, JSTRING_SIMD_SSE2, JSTRING_SIMD_AVX2 };
+    static const char*          simdNames[] = { "c", "sse2", "avx2" };
+    const char*                 name = distNames[dist];
+    size_t                      ops = c->numBlocks < MIN_OPS ? MIN_OPS : c->numBlocks;
+    size_t                      i;
+
+    for (i = 0; i < sizeof (simds) / sizeof (simds[0]); ++i) {
+        if (JRET_OK != jstring_set_simd(simds[i])) {
+            continue;
+        }
+        jbench_run(bench, simdNames[i], "validate", name, n, ops, NULL, run_validate, NULL, c);
+        jbench_run(bench, simdNames[i], "length", name, n, ops, NULL, run_length, NULL, c);
+        jbench_run(bench, simdNames[i], "to_utf16", name, n, ops, NULL, run_to_utf16, NULL, c);
+        jbench_run(bench, simdNames[i], "to_utf32", name, n, ops, NULL, run_to_utf32, NULL, c);
+        jbench_run(bench, simdNames[i], "from16", name, n, ops, NULL, run_from16, NULL, c);
+        jbench_run(bench, simdNames[i], "memchr", name, n, ops, NULL, run_memchr, NULL, c);
+        jbench_run(bench, simdNames[i], "memmem", name, n, ops, NULL, run_memmem, NULL, c);
+    }
+
+    jbench_run(bench, "libc", "memchr", name, n, ops, NULL, run_libc_memchr, NULL, c);
+    jbench_run(bench, "libc", "memmem", name, n, ops, NULL, run_libc_memmem, NULL, c);
+}
+
+int main(int argc, char* argv[]) {
+    JBench*                 bench = jbench_new(argc, argv);
+    Case                    c;
+    size_t                  i;
+    int                     dist;
+
+    if (NULL == bench) {
+        return 2;
+    }
+
+    jbench_set_bytes(bench, BLOCK_SIZE);
+    for (i = 0; i < jbench_num_sizes(bench); ++i) {
+        for (dist = 0; dist < DIST_NUM; ++dist) {
+            if (JRET_OK != case_init(&c, dist, jbench_size(bench, i))) {
+                fprintf(stderr, "%s/%zu: out of memory\n", distNames[dist], jbench_size(bench, i));
+                case_free(&c);
+                continue;
+            }
+            bench_case(bench, &c, dist, jbench_size(bench, i));
+            case_free(&c);
+        }
+    }
+
+    return jbench_free(bench);
+}
@@ -0,0 +1,227 @@
+/**
+ *  JTimerWheel 与 JBinaryHeap 的定时器性能对比
+ *
+ *  模拟 n 个连接的超时: 每个连接有一个 [min, max) tick 的超时定时器,
+ *  每个 tick 有 activity 个随机连接收到数据, 取消旧定时器重新设置; 定时器到期时也重新设置。
+ *  大部分定时器在到期前就被取消。
+ *
+ *  wheel     --- JTimerWheel, 取消和设置都是 O(1)
+ *  handle    --- JBinaryHeap 句柄模式, 修改到期时间后 binary_heap_update, O(log n)
+ *  tombstone --- 内联堆, 取消只给连接的版本号加 1, 重新插入新的一项, 旧项出堆时丢弃
+ *  输出平均每次操作(设置、取消、触发)的耗时, 以及触发的次数(同一 tick 内触发顺序不同, 次数只是大致相同)。
+ *
+ *  编译:
+ *      gcc -O2 -march=native -std=c99 -o timer_wheel_bench bench/timer_wheel_bench.c \
+ *          src/data_struct/jtimer_wheel.c src/data_struct/jbinary_heap.c src/base/jallocator.c \
+ *          -I src/base -I src/data_struct
+ *  运行:
+ *      ./timer_wheel_bench [n [ticks [activity]]]      默认 n 为 1000000, ticks 为 200000, activity 为 20
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "jtimer_wheel.h"
+
+#define TIMEOUT_MIN     (10000)
+#define TIMEOUT_MAX     (60000)
+
+typedef struct {
+    JTimer                  timer;
+    uint64_t                expire;
+    JBinaryHeapHandle       handle;
+    uint32_t                generation;
+} Conn;
+
+typedef struct {
+    uint32_t                index;
+    uint32_t                generation;
+} Entry;
+
+static Conn*                conns;
+static uint64_t             state;
+static uint64_t             now;
+static unsigned long        fired;
+
+static double clock_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t* s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static uint64_t timeout(void) {
+    return now + TIMEOUT_MIN + xorshift(&state) % (TIMEOUT_MAX - TIMEOUT_MIN);
+}
+
+int conn_compare(JBinaryHeapValue v1, JBinaryHeapValue v2) {
+    if (((Conn*) v1)->expire > ((Conn*) v2)->expire) {
+        return JRET_BIGGER;
+    } else if (((Conn*) v1)->expire < ((Conn*) v2)->expire) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+static JTimerWheel*         wheel;
+
+void on_timeout(JTimer* timer, void* data) {
+    ++ fired;
+    timer_wheel_arm(wheel, timer, timeout());
+}
+
+static double run_wheel(unsigned int n, unsigned int ticks, unsigned int activity) {
+    unsigned int i, t;
+    double t0, t1;
+
+    state = 88172645463325252ULL;
+    now = 0;
+    fired = 0;
+    wheel = timer_wheel_new(0);
+    for (i = 0; i < n; ++i) {
+        timer_wheel_timer_init(&conns[i].timer, on_timeout, &conns[i]);
+    }
+
+    t0 = clock_now();
+    for (i = 0; i < n; ++i) {
+        timer_wheel_arm(wheel, &conns[i].timer, timeout());
+    }
+    for (t = 0; t < ticks; ++t) {
+        ++ now;
+        for (i = 0; i < activity; ++i) {
+            timer_wheel_arm(wheel, &conns[xorshift(&state) % n].timer, timeout());
+        }
+        timer_wheel_advance(wheel, now);
+    }
+    t1 = clock_now();
+
+    timer_wheel_free(wheel);
+
+    return t1 - t0;
+}
+
+static double run_handle(unsigned int n, unsigned int ticks, unsigned int activity) {
+    JBinaryHeap* heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, 4, conn_compare);
+    Conn* conn;
+    unsigned int i, t;
+    double t0, t1;
+
+    state = 88172645463325252ULL;
+    now = 0;
+    fired = 0;
+
+    t0 = clock_now();
+    for (i = 0; i < n; ++i) {
+        conns[i].expire = timeout();
+        binary_heap_insert_with_handle(heap, &conns[i], &conns[i].handle);
+    }
+    for (t = 0; t < ticks; ++t) {
+        ++ now;
+        for (i = 0; i < activity; ++i) {
+            conn = &conns[xorshift(&state) % n];
+            conn->expire = timeout();
+            binary_heap_update(heap, conn->handle);
+        }
+        for (;;) {
+            conn = binary_heap_peek(heap);
+            if (JRET_PTR_NULL == conn || conn->expire > now) {
+                break;
+            }
+            ++ fired;
+            conn->expire = timeout();
+            binary_heap_update(heap, conn->handle);
+        }
+    }
+    t1 = clock_now();
+
+    binary_heap_free(heap);
+
+    return t1 - t0;
+}
+
+static double run_tombstone(unsigned int n, unsigned int ticks, unsigned int activity, unsigned int* maxSize) {
+    JBinaryHeap* heap = binary_heap_new_inline(JBINARY_HEAP_TYPE_MIN, JBINARY_HEAP_KEY_INT64, sizeof (Entry), 4);
+    Entry entry;
+    int64_t key;
+    unsigned int i, t;
+    double t0, t1;
+
+    state = 88172645463325252ULL;
+    now = 0;
+    fired = 0;
+    *maxSize = 0;
+
+    t0 = clock_now();
+    for (i = 0; i < n; ++i) {
+        conns[i].generation = 0;
+        entry.index = i;
+        entry.generation = 0;
+        binary_heap_insert_int64(heap, (int64_t) timeout(), &entry);
+    }
+    for (t = 0; t < ticks; ++t) {
+        ++ now;
+        for (i = 0; i < activity; ++i) {
+            entry.index = (uint32_t) (xorshift(&state) % n);
+            entry.generation = ++ conns[entry.index].generation;
+            binary_heap_insert_int64(heap, (int64_t) timeout(), &entry);
+        }
+        if (binary_heap_num(heap) > *maxSize) {
+            *maxSize = binary_heap_num(heap);
+        }
+        while (JRET_OK == binary_heap_peek_int64(heap, &key, JRET_PTR_NULL) && (uint64_t) key <= now) {
+            binary_heap_pop_int64(heap, JRET_PTR_NULL, &entry);
+            if (entry.generation != conns[entry.index].generation) {
+                continue;                                               // 已取消
+            }
+            ++ fired;
+            binary_heap_insert_int64(heap, (int64_t) timeout(), &entry);
+        }
+    }
+    t1 = clock_now();
+
+    binary_heap_free(heap);
+
+    return t1 - t0;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int n = argc > 1 ? (unsigned int) strtoul(argv[1], NULL, 10) : 1000000;
+    unsigned int ticks = argc > 2 ? (unsigned int) strtoul(argv[2], NULL, 10) : 200000;
+    unsigned int activity = argc > 3 ? (unsigned int) strtoul(argv[3], NULL, 10) : 20;
+    unsigned int maxSize;
+    double ops;
+    double t;
+
+    conns = malloc(sizeof (Conn) * n);
+    if (JRET_PTR_NULL == conns) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    printf("n %u, ticks %u, activity %u per tick, timeout [%u, %u)\n\n", n, ticks, activity, TIMEOUT_MIN, TIMEOUT_MAX);
+    printf("%-10s %12s %12s %12s\n", "", "ns/op", "fired", "heap max");
+
+    t = run_wheel(n, ticks, activity);
+    ops = (double) n + (double) ticks * activity + fired;
+    printf("%-10s %12.1f %12lu %12s\n", "wheel", t * 1e9 / ops, fired, "-");
+
+    t = run_handle(n, ticks, activity);
+    printf("%-10s %12.1f %12lu %12s\n", "handle", t * 1e9 / ops, fired, "-");
+
+    t = run_tombstone(n, ticks, activity, &maxSize);
+    printf("%-10s %12.1f %12lu %12u\n", "tombstone", t * 1e9 / ops, fired, maxSize);
+
+    free(conns);
+
+    return 0;
+}
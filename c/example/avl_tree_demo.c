@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "javl_tree.h"
@@ -19,6 +20,35 @@ void my_print(JAVLTreeKey key) {
     printf("%d\t", *((int*)key));
 }
 
+int my_range_print(JAVLTreeNode* node, void* data) {
+    my_print(avl_tree_node_key(node));
+    return JRET_OK;
+}
+
+/* 嵌入式用法: 节点放在用户自己的结构体中 */
+struct session {
+    int             id;
+    const char*     name;
+    JAVLTreeNode    node;
+};
+
+/* 快照记录: 4 字节 id 加名字 */
+size_t session_save(JAVLTreeKey key, JAVLTreeValue value, void* buf, size_t size) {
+    const char* name = ((struct session*) value)->name;
+    size_t len = sizeof (int) + strlen(name) + 1;
+
+    if (size >= len) {
+        memcpy(buf, key, sizeof (int));
+        strcpy((char*) buf + sizeof (int), name);
+    }
+
+    return len;
+}
+
+int session_compare(JAVLTreeKey key, const void* record, size_t size) {
+    return my_compare(key, (JAVLTreeKey) record);
+}
+
 
 int main(void) {
     JAVLTree* tree = avl_tree_new(my_compare);
@@ -54,9 +84,60 @@ int main(void) {
     printf("\npost order traversal binary tree. result as follow:\n");
     postorder_print_tree(avl_tree_root_node(tree), my_print);               // 后续遍历
 
+    /* 游标遍历和范围查询 */
+    printf("\ncursor traversal from last to first:\n");
+    for (JAVLTreeNode* node = avl_tree_last(tree); JRET_PTR_NULL != node; node = avl_tree_prev(node)) {
+        my_print(avl_tree_node_key(node));
+    }
+
+    printf("\nkeys in [%d, %d):\n", values[1], values[5]);
+    avl_tree_range(tree, &values[1], &values[5], my_range_print, JRET_PTR_NULL);
+
+    /* 顺序统计: 排名和第 k 小 */
+    avl_tree_enable_order_statistics(tree);
+    printf("\nrank of %d is %u, median is %d\n", values[4], avl_tree_rank(tree, &values[4]),
+           *(int*) avl_tree_node_key(avl_tree_select(tree, avl_tree_num_entries(tree) / 2)));
+
     avl_tree_free(tree);
     printf("\n\n");
 
+    /* 由有序的 key 直接构建 */
+    JAVLTreeKey sortedKeys[sizeof (values) / sizeof (int)];
+    for (i = 0; i < sizeof (values) / sizeof (int); ++ i) {
+        sortedKeys[i] = &values[i];
+    }
+    tree = avl_tree_new_from_sorted(sortedKeys, sortedKeys, sizeof (values) / sizeof (int), my_compare);
+    printf("sorted build, before order traversal:\n");
+    before_print_tree(avl_tree_root_node(tree), my_print);
+    avl_tree_free(tree);
+    printf("\n\n");
+
+    /* 嵌入式树, 插入删除都不申请内存 */
+    struct session sessions[] = { { 3, "c" }, { 1, "a" }, { 2, "b" } };
+    JAVLTree* intrusiveTree = avl_tree_new_intrusive(my_compare);
+    for (i = 0; i < sizeof (sessions) / sizeof (struct session); ++ i) {
+        avl_tree_insert_intrusive(intrusiveTree, &sessions[i].node, &sessions[i].id, &sessions[i]);
+    }
+
+    JAVLTreeNode* node = avl_tree_lookup_node(intrusiveTree, &key);
+    if (JRET_PTR_NULL != node) {
+        printf("session %d is %s\n", key, JAVL_TREE_ENTRY(node, struct session, node)->name);
+    }
+
+    avl_tree_remove_node(intrusiveTree, &sessions[0].node);
+    printf("intrusive tree's node number is %d\n\n", avl_tree_num_entries(intrusiveTree));
+
+    /* 快照: 保存后映射回来直接查找, 不需要重新插入 */
+    if (JRET_OK == avl_tree_save(intrusiveTree, "avl_tree_demo.snap", session_save)) {
+        JAVLTreeMapped* mapped = avl_tree_open_mapped("avl_tree_demo.snap", session_compare);
+        const char* record = avl_tree_mapped_lookup(mapped, &key, JRET_PTR_NULL);
+        printf("snapshot has %u sessions, session %d is %s\n\n", avl_tree_mapped_num(mapped), key,
+               JRET_PTR_NULL != record ? record + sizeof (int) : "missing");
+        avl_tree_mapped_close(mapped);
+        remove("avl_tree_demo.snap");
+    }
+    avl_tree_free(intrusiveTree);
+
     return 0;
 }
 
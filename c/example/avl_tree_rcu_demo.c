@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "javl_tree_rcu.h"
+
+#define NUM_READERS     4
+#define NUM_KEYS        10000
+
+static int keys[NUM_KEYS];
+static int stop = 0;
+
+int my_compare(JAVLTreeKey value1, JAVLTreeKey value2) {
+
+    if (*(int*)value1 > *(int*)value2) {
+        return JRET_BIGGER;
+    } else if (*(int*)value1 < *(int*)value2) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+int my_range_count(JAVLTreeNode* node, void* data) {
+    ++ *(unsigned int*) data;
+    return JRET_OK;
+}
+
+/* 读线程: 不加锁查询, 和写线程同时运行 */
+void* reader(void* arg) {
+    JAVLTreeRCU* tree = arg;
+    unsigned long found = 0;
+    unsigned int i = 0;
+
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        if (JAVL_TREE_NULL != avl_tree_rcu_lookup(tree, &keys[i % NUM_KEYS])) {
+            ++ found;
+        }
+        ++ i;
+    }
+
+    return (void*) found;
+}
+
+int main(void) {
+    JAVLTreeRCU* tree = avl_tree_rcu_new(my_compare);
+    pthread_t threads[NUM_READERS];
+    unsigned int i;
+    unsigned int num = 0;
+    int lo = 100;
+    int hi = 200;
+    void* found;
+
+    for (i = 0; i < NUM_KEYS; ++ i) {
+        keys[i] = i;
+    }
+
+    for (i = 0; i < NUM_READERS; ++ i) {
+        pthread_create(&threads[i], NULL, reader, tree);
+    }
+
+    /* 写线程: 读线程运行期间插入全部 key, 再删除奇数 key */
+    for (i = 0; i < NUM_KEYS; ++ i) {
+        avl_tree_rcu_insert(tree, &keys[i], &keys[i]);
+    }
+    for (i = 1; i < NUM_KEYS; i += 2) {
+        avl_tree_rcu_remove(tree, &keys[i]);
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    for (i = 0; i < NUM_READERS; ++ i) {
+        pthread_join(threads[i], &found);
+        printf("reader %u found %lu keys\n", i, (unsigned long) found);
+    }
+
+    printf("\ntree's entry number is %u\n", avl_tree_rcu_num_entries(tree));
+    avl_tree_rcu_range(tree, &lo, &hi, my_range_count, &num);
+    printf("keys in [%d, %d): %u\n", lo, hi, num);
+    printf("lookup 42: %s\n", JAVL_TREE_NULL != avl_tree_rcu_lookup(tree, &keys[42]) ? "have" : "not have");
+    printf("lookup 43: %s\n", JAVL_TREE_NULL != avl_tree_rcu_lookup(tree, &keys[43]) ? "have" : "not have");
+
+    avl_tree_rcu_free(tree);
+
+    return 0;
+}
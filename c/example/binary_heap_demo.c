@@ -28,6 +28,17 @@ int main(void) {
 
     JBinaryHeap* minheap = JRET_PTR_NULL;
     JBinaryHeap* maxheap = JRET_PTR_NULL;
+    JBinaryHeap* dheap = JRET_PTR_NULL;
+    JBinaryHeap* batchheap = JRET_PTR_NULL;
+    JBinaryHeapValue batch[] = { &a, &b, &c, &d, &e, &f, &g, &h };
+    JBinaryHeapValue top[3];
+    JBinaryHeap* timers = JRET_PTR_NULL;
+    JBinaryHeapHandle handles[4];
+    int deadlines[] = { 30, 10, 20, 40 };
+    JBinaryHeap* jobs = JRET_PTR_NULL;
+    double priority;
+    char name[8];
+    char names[3][8] = { "backup", "deploy", "cleanup" };
 
     // 最小堆
     minheap = binary_heap_new(JBINARY_HEAP_TYPE_MIN, compare_func);
@@ -35,6 +46,9 @@ int main(void) {
     // 最大堆
     maxheap = binary_heap_new(JBINARY_HEAP_TYPE_MAX, compare_func);
 
+    // 4 叉最小堆
+    dheap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, 4, compare_func);
+
     // 最小堆插入
     binary_heap_insert(minheap, &a);
     binary_heap_insert(minheap, &b);
@@ -63,6 +77,14 @@ int main(void) {
     binary_heap_insert(maxheap, &k);
     binary_heap_insert(maxheap, &l);
 
+    // 4 叉堆插入
+    binary_heap_insert(dheap, &a);
+    binary_heap_insert(dheap, &b);
+    binary_heap_insert(dheap, &c);
+    binary_heap_insert(dheap, &d);
+    binary_heap_insert(dheap, &e);
+    binary_heap_insert(dheap, &f);
+
 
     // 最小堆输出
     printf("min heap size: %d\n", binary_heap_num(minheap));
@@ -78,4 +100,48 @@ int main(void) {
         printf("%d\t", *((int*)binary_heap_pop(maxheap)));
     }
     puts("\n");
+
+    // 4 叉堆输出
+    printf("\n4-ary min heap size: %d\n", binary_heap_num(dheap));
+    for(unsigned int i = binary_heap_num(dheap); i > 0; --i) {
+        printf("%d\t", *((int*)binary_heap_pop(dheap)));
+    }
+    puts("\n");
+
+    // 由数组建堆, 一次弹出最小的 3 个
+    batchheap = binary_heap_new_from_array(JBINARY_HEAP_TYPE_MIN, compare_func, batch, sizeof (batch) / sizeof (batch[0]));
+    binary_heap_pop_n(batchheap, top, 3);
+    printf("\nsmallest 3 of batch: %d\t%d\t%d\n", *((int*)top[0]), *((int*)top[1]), *((int*)top[2]));
+
+    // 句柄: 修改任意元素的优先级或删除任意元素
+    timers = binary_heap_new(JBINARY_HEAP_TYPE_MIN, compare_func);
+    for (unsigned int i = 0; i < 4; ++i) {
+        binary_heap_insert_with_handle(timers, &deadlines[i], &handles[i]);
+    }
+    deadlines[3] = 5;                                   // 40 提前到 5
+    binary_heap_update(timers, handles[3]);
+    binary_heap_remove(timers, handles[1]);             // 取消 10
+    printf("\ntimers:");
+    while (binary_heap_num(timers) > 0) {
+        printf("\t%d", *((int*)binary_heap_pop(timers)));
+    }
+    printf("\n");
+
+    // 内联堆: double 优先级 + 8 字节数据, 不需要比较函数
+    jobs = binary_heap_new_inline(JBINARY_HEAP_TYPE_MAX, JBINARY_HEAP_KEY_DOUBLE, sizeof (name), 8);
+    binary_heap_insert_double(jobs, 0.5, names[0]);
+    binary_heap_insert_double(jobs, 2.25, names[1]);
+    binary_heap_insert_double(jobs, -1.0, names[2]);
+    printf("\njobs:");
+    while (JRET_OK == binary_heap_pop_double(jobs, &priority, name)) {
+        printf("\t%s(%g)", name, priority);
+    }
+    printf("\n");
+
+    binary_heap_free(jobs);
+    binary_heap_free(timers);
+    binary_heap_free(batchheap);
+    binary_heap_free(dheap);
+    binary_heap_free(maxheap);
+    binary_heap_free(minheap);
 }
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "jallocator.h"
+#include "javl_tree.h"
+#include "jbinary_heap.h"
+
+int int_compare(void* value1, void* value2) {
+    intptr_t a = (intptr_t) value1;
+    intptr_t b = (intptr_t) value2;
+
+    if (a > b) {
+        return JRET_BIGGER;
+    } else if (a < b) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+static void print_stats(const char* name, JMemoryStats* stats) {
+    printf("%-24s live %9zu  peak %9zu  wasted %9zu\n", name, stats->live, stats->peak, stats->wasted);
+}
+
+int main(void) {
+    JArena* arena = jarena_new(0);
+    JSlab* slab = jslab_new(sizeof (JAVLTreeNode));
+    JAVLTree* tree = JRET_PTR_NULL;
+    JBinaryHeap* heap = JRET_PTR_NULL;
+    JMemoryStats stats;
+    intptr_t i;
+
+    /* 节点从 slab 申请, 删除的节点回到空闲链表给下一次插入用 */
+    tree = avl_tree_new_with_allocator(int_compare, jslab_allocator(slab));
+    for (i = 0; i < 10000; ++i) {
+        avl_tree_insert(tree, (void*) i, (void*) i);
+    }
+    for (i = 0; i < 10000; i += 2) {
+        avl_tree_remove(tree, (void*) i);
+    }
+    avl_tree_memory_stats(tree, &stats);
+    print_stats("avl tree (slab)", &stats);
+    jslab_stats(slab, &stats);
+    print_stats("slab", &stats);
+    avl_tree_free(tree);
+
+    /* arena 中的树销毁时不逐个释放节点, 销毁 arena 时一起释放 */
+    tree = avl_tree_new_with_allocator(int_compare, jarena_allocator(arena));
+    for (i = 0; i < 10000; ++i) {
+        avl_tree_insert(tree, (void*) i, (void*) i);
+    }
+    avl_tree_memory_stats(tree, &stats);
+    print_stats("avl tree (arena)", &stats);
+    avl_tree_free(tree);
+
+    /* 堆每次扩容一倍, 预留的空间计入 wasted */
+    heap = binary_heap_new_with_allocator(JBINARY_HEAP_TYPE_MIN, 4, int_compare, jarena_allocator(arena));
+    binary_heap_set_growth(heap, 100, 0);
+    for (i = 0; i < 5000; ++i) {
+        binary_heap_insert(heap, (void*) (5000 - i));
+    }
+    binary_heap_memory_stats(heap, &stats);
+    print_stats("heap (arena)", &stats);
+    printf("heap top: %ld\n", (long) (intptr_t) binary_heap_pop(heap));
+    binary_heap_free(heap);
+
+    jarena_stats(arena, &stats);
+    print_stats("arena", &stats);
+
+    jarena_free(arena);
+    jslab_free(slab);
+
+    return 0;
+}
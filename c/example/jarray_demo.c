@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "jarray.h"
+
+static void print_array(const char* title, JArray* array) {
+    int* data = jarray_data(array);
+    unsigned int i;
+
+    printf("%s (num %u, capacity %u):", title, jarray_num(array), jarray_capacity(array));
+    for (i = 0; i < jarray_num(array); ++ i) {
+        printf(" %d", data[i]);
+    }
+    printf("\n");
+}
+
+int main(void) {
+    JArray* array = jarray_new(sizeof (int));
+    JArray* copy = jarray_new(sizeof (int));
+    JArray* keys = jarray_new(sizeof (uint64_t));
+    JMemoryStats stats;
+    int values[] = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5 };
+    int key = 5;
+    int v = 7;
+    unsigned int i;
+    uint64_t k;
+
+    /* 追加 */
+    for (i = 0; i < 4; ++ i) {
+        jarray_append(array, &values[i]);
+    }
+    jarray_append_n(array, values + 4, sizeof (values) / sizeof (int) - 4);
+    print_array("append", array);
+
+    jarray_insert(array, 0, &v);
+    print_array("insert 7 at 0", array);
+
+    /* 查找所有的 5 */
+    printf("find %d at:", key);
+    for (i = jarray_find(array, &key, 0); JARRAY_NOT_FOUND != i; i = jarray_find(array, &key, i + 1)) {
+        printf(" %u", i);
+    }
+    printf("\n");
+
+    jarray_remove(array, 1);
+    print_array("remove index 1 (ordered)", array);
+    jarray_swap_remove(array, 1);
+    print_array("swap remove index 1", array);
+
+    jarray_append_n(copy, jarray_data(array), jarray_num(array));
+    printf("copy equal: %s\n", jarray_equal(array, copy) ? "yes" : "no");
+    jarray_swap_remove(copy, 0);
+    printf("after change, copy equal: %s\n", jarray_equal(array, copy) ? "yes" : "no");
+
+    /* 定长 key, 预留空间后不再扩容 */
+    jarray_set_growth(keys, 100, 16);
+    jarray_reserve(keys, 1000);
+    for (k = 0; k < 1000; ++ k) {
+        uint64_t x = k * 0x9e3779b97f4a7c15ull;
+        jarray_append(keys, &x);
+    }
+    k = 777 * 0x9e3779b97f4a7c15ull;
+    printf("\nkey of 777 at %u, capacity %u\n", jarray_find(keys, &k, 0), jarray_capacity(keys));
+
+    jarray_clear(keys);
+    jarray_memory_stats(keys, &stats);
+    printf("after clear: live %zu, wasted %zu\n", stats.live, stats.wasted);
+    jarray_shrink(keys);
+    jarray_memory_stats(keys, &stats);
+    printf("after shrink: live %zu, wasted %zu, peak %zu\n", stats.live, stats.wasted, stats.peak);
+
+    jarray_free(array);
+    jarray_free(copy);
+    jarray_free(keys);
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "jbtree.h"
+
+int my_compare(JBTreeKey value1, JBTreeKey value2) {
+
+    if (*(int*)value1 > *(int*)value2) {
+        return JRET_BIGGER;
+    } else if (*(int*)value1 < *(int*)value2) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+int my_range_print(JBTreeKey key, JBTreeValue value, void* data) {
+    printf("%ld\t", (long) JBTREE_KEY_INT(key));
+    return JRET_OK;
+}
+
+int main(void) {
+    JBTree* tree = jbtree_new(my_compare);
+    JBTree* numbers = jbtree_new_integer();
+    JBTreeKey* array = JRET_PTR_NULL;
+    unsigned int i;
+    int values[] = { 5, 3, 8, 1, 9, 2, 7 };
+    int key = 8;
+
+    /* 比较函数模式 */
+    for (i = 0; i < sizeof (values) / sizeof (int); ++ i) {
+        jbtree_insert(tree, &values[i], &values[i]);
+    }
+
+    printf("tree's entry number is %u\n", jbtree_num_entries(tree));
+    printf("lookup %d: %s\n", key, JBTREE_NULL != jbtree_lookup(tree, &key) ? "have" : "not have");
+    jbtree_remove(tree, &key);
+    printf("after remove, lookup %d: %s\n", key, JBTREE_NULL != jbtree_lookup(tree, &key) ? "have" : "not have");
+
+    array = jbtree_to_array(tree);
+    printf("\nall keys:\n");
+    for (i = 0; i < jbtree_num_entries(tree); ++ i) {
+        printf("%d\t", *(int*) array[i]);
+    }
+    printf("\n");
+    free(array);
+
+    /* 整数 key 模式: 不需要比较函数, key 不占用额外内存 */
+    for (i = 0; i < 1000; ++ i) {
+        jbtree_insert(numbers, JBTREE_INT_KEY(i * 3), JRET_PTR_NULL);
+    }
+
+    printf("\nkeys in [100, 130):\n");
+    jbtree_range(numbers, JBTREE_INT_KEY(100), JBTREE_INT_KEY(130), my_range_print, JRET_PTR_NULL);
+    printf("\n\n");
+
+    jbtree_free(numbers);
+    jbtree_free(tree);
+
+    return 0;
+}
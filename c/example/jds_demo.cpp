@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "jbinary_heap.hpp"
+#include "javl_tree.hpp"
+#include "jset.hpp"
+
+/* 按截止时间排序的任务, 只能移动 */
+struct Job {
+    int                         deadline;
+    std::unique_ptr<std::string> name;
+
+    Job(int d, const char* n) : deadline(d), name(new std::string(n)) {}
+};
+
+struct JobEarlier {
+    bool operator()(const Job& a, const Job& b) const { return a.deadline < b.deadline;}
+};
+
+int main(void) {
+    jds::heap<Job, JobEarlier> jobs;
+    jds::avl_map<std::string, int> counts;
+    jds::hash_set<int> seen;
+    int values[] = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5 };
+    const char* words[] = { "pear", "apple", "fig", "apple", "pear", "apple" };
+
+    /* 堆: emplace 直接构造, take 移出堆顶 */
+    jobs.emplace(30, "backup");
+    jobs.emplace(10, "deploy");
+    jobs.emplace(20, "review");
+    printf("jobs by deadline:\n");
+    while (!jobs.empty()) {
+        Job job = jobs.take();
+        printf("%d\t%s\n", job.deadline, job.name->c_str());
+    }
+
+    /* 有序映射 */
+    for (const char* word : words) {
+        ++ counts[word];
+    }
+    printf("\nword counts:\n");
+    for (auto& kv : counts) {
+        printf("%s\t%d\n", kv.first.c_str(), kv.second);
+    }
+    counts.erase("fig");
+    printf("after erase fig, entry number is %zu\n", counts.size());
+
+    /* 集合 */
+    for (int value : values) {
+        printf("insert %d: %s\n", value, seen.insert(value).second ? "ok" : "exist");
+    }
+    printf("\nset's entry number is %zu, have 4: %s\n", seen.size(), seen.count(4) ? "yes" : "no");
+
+    return 0;
+}
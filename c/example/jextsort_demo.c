@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jextsort.h"
+
+static int compare_int(const void* record1, size_t size1, const void* record2, size_t size2) {
+    int a;
+    int b;
+
+    memcpy(&a, record1, sizeof (int));
+    memcpy(&b, record2, sizeof (int));
+
+    return a < b ? JRET_SMALLER : (a > b ? JRET_BIGGER : JRET_EQUAL);
+}
+
+static int compare_string(const void* record1, size_t size1, const void* record2, size_t size2) {
+    int ret = memcmp(record1, record2, size1 < size2 ? size1 : size2);
+
+    if (0 == ret) {
+        ret = size1 < size2 ? -1 : (size1 > size2);
+    }
+
+    return ret < 0 ? JRET_SMALLER : (ret > 0 ? JRET_BIGGER : JRET_EQUAL);
+}
+
+/* 检查顺序, 记下前几个 */
+typedef struct {
+    int         prev;
+    int         sorted;
+    unsigned    count;
+} IntCheck;
+
+static int output_int(void* data, const void* record, size_t size) {
+    IntCheck* check = data;
+    int v;
+
+    memcpy(&v, record, sizeof (int));
+    if (check->count > 0 && v < check->prev) {
+        check->sorted = 0;
+    }
+    if (check->count < 8) {
+        printf(" %d", v);
+    }
+    check->prev = v;
+    ++ check->count;
+
+    return JRET_OK;
+}
+
+static int output_string(void* data, const void* record, size_t size) {
+    printf(" %.*s", (int) size, (const char*) record);
+    return JRET_OK;
+}
+
+int main(void) {
+    const char* words[] = { "pear", "fig", "apple", "banana", "kiwi", "cherry", "date" };
+    JExtSort* sort;
+    JExtSortStats stats;
+    IntCheck check = { 0, 1, 0 };
+    unsigned int i;
+    int v;
+
+    /* 变长记录, 数据少, 只在内存中排序 */
+    sort = jextsort_new(0, compare_string, 0, NULL);
+    for (i = 0; i < sizeof (words) / sizeof (words[0]); ++ i) {
+        jextsort_add(sort, words[i], strlen(words[i]));
+    }
+    printf("words:");
+    jextsort_finish(sort, output_string, NULL);
+    printf("\n");
+    jextsort_free(sort);
+
+    /* 四百万个 int, 预算取最小值(8 块), 会写出顺串再归并 */
+    sort = jextsort_new(sizeof (int), compare_int, 0, NULL);
+    srand(1);
+    for (i = 0; i < 4000000; ++ i) {
+        v = rand();
+        jextsort_add(sort, &v, sizeof (int));
+    }
+    printf("ints:");
+    jextsort_finish(sort, output_int, &check);
+    printf(" ...\n");
+    jextsort_get_stats(sort, &stats);
+    printf("records %llu, output %u, %s\n", (unsigned long long) stats.records, check.count, check.sorted ? "sorted" : "wrong");
+    printf("runs %u, merge passes %u, written %llu bytes, read %llu bytes\n", stats.runs, stats.passes,
+           (unsigned long long) stats.bytesWritten, (unsigned long long) stats.bytesRead);
+    jextsort_free(sort);
+
+    return 0;
+}
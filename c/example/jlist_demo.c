@@ -0,0 +1,104 @@
+#include <stdio.h>
+
+#include "jlist.h"
+
+static void print_list(const char* title, JList* list) {
+    JListCursor cursor;
+    unsigned int n;
+    unsigned int i;
+    int* p;
+    int ret;
+
+    printf("%s (num %u):", title, jlist_num(list));
+    for (ret = jlist_cursor_first(list, &cursor); JRET_OK == ret; ret = jlist_cursor_next_block(&cursor)) {
+        p = jlist_cursor_block(&cursor, &n);
+        for (i = 0; i < n; ++ i) {
+            printf(" %d", p[i]);
+        }
+    }
+    printf("\n");
+}
+
+int main(void) {
+    JList* list = jlist_new(sizeof (int));
+    JList* other = jlist_new(sizeof (int));
+    JList* tail;
+    JListCursor cursor;
+    JMemoryStats stats;
+    long long sum = 0;
+    unsigned int n;
+    unsigned int i;
+    int* p;
+    int v;
+    int ret;
+
+    /* 两端插入、弹出 */
+    for (v = 1; v <= 5; ++ v) {
+        jlist_push_back(list, &v);
+    }
+    v = 0;
+    jlist_push_front(list, &v);
+    print_list("push", list);
+
+    jlist_pop_front(list, &v);
+    printf("pop front: %d\n", v);
+    jlist_pop_back(list, &v);
+    printf("pop back: %d\n", v);
+
+    /* 按下标插入、删除 */
+    v = 100;
+    jlist_insert(list, 2, &v);
+    print_list("insert 100 at 2", list);
+    jlist_remove(list, 0, &v);
+    printf("remove index 0: %d\n", v);
+    printf("get index 1: %d\n", *(int*) jlist_get(list, 1));
+
+    /* 游标: 删除偶数, 在每个奇数前插入它的相反数 */
+    for (ret = jlist_cursor_first(list, &cursor); JRET_OK == ret; ) {
+        v = *(int*) jlist_cursor_get(&cursor);
+        if (0 == v % 2) {
+            jlist_cursor_remove(&cursor, NULL);
+            ret = jlist_cursor_valid(&cursor) ? JRET_OK : JRET_ERROR;
+            continue;
+        }
+        v = -v;
+        jlist_cursor_insert(&cursor, &v);
+        jlist_cursor_next(&cursor);
+        ret = jlist_cursor_next(&cursor);
+    }
+    print_list("cursor edit", list);
+
+    /* 整段移动 */
+    for (v = 10; v < 13; ++ v) {
+        jlist_push_back(other, &v);
+    }
+    jlist_splice(list, 1, other);
+    print_list("splice at 1", list);
+    printf("other after splice: num %u\n", jlist_num(other));
+
+    tail = jlist_split(list, 3);
+    print_list("split at 3, head", list);
+    print_list("split at 3, tail", tail);
+
+    /* 一百万个元素, 按段遍历 */
+    jlist_clear(list);
+    for (v = 0; v < 1000000; ++ v) {
+        jlist_push_back(list, &v);
+    }
+    for (ret = jlist_cursor_first(list, &cursor); JRET_OK == ret; ret = jlist_cursor_next_block(&cursor)) {
+        p = jlist_cursor_block(&cursor, &n);
+        for (i = 0; i < n; ++ i) {
+            sum += p[i];
+        }
+    }
+    jlist_memory_stats(list, &stats);
+    printf("sum of 0..999999: %lld\n", sum);
+    printf("memory: live %zu, wasted %zu, %.2f bytes per element\n",
+           stats.live, stats.wasted, (double) stats.live / jlist_num(list));
+
+    jlist_free(list);
+    jlist_free(other);
+    jlist_free(tail);
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+
+#include "jmerge.h"
+
+typedef struct {
+    int*            values;
+    unsigned int    num;
+    unsigned int    next;
+} Segment;
+
+static int compare_int(JMergeValue value1, JMergeValue value2) {
+    int a = *(int*) value1;
+    int b = *(int*) value2;
+
+    return a < b ? JRET_SMALLER : (a > b ? JRET_BIGGER : JRET_EQUAL);
+}
+
+/* 回调输入: 每次最多给 2 个, 模拟从文件里分段读 */
+static unsigned int read_segment(void* data, JMergeValue* values, unsigned int num) {
+    Segment* segment = data;
+    unsigned int n = 0;
+
+    while (n < num && n < 2 && segment->next < segment->num) {
+        values[n++] = &segment->values[segment->next++];
+    }
+
+    return n;
+}
+
+int main(void) {
+    int a[] = { 1, 4, 7, 10 };
+    int b[] = { 2, 4, 8 };
+    int c[] = { 0, 3, 5, 6, 9, 11 };
+    JMergeValue va[4];
+    JMergeValue vb[3];
+    Segment segment = { c, 6, 0 };
+    JMergeValue buffer[4];
+    JMerge* merge = jmerge_new(compare_int);
+    JThreadPool* pool = thread_pool_new(2);
+    static int big[4][1000];
+    static JMergeValue bigValues[4][1000];
+    static JMergeValue out[4000];
+    const JMergeValue* arrays[4];
+    size_t nums[4];
+    size_t n;
+    size_t i;
+    int j;
+    int sorted = 1;
+
+    for (i = 0; i < 4; ++ i) {
+        va[i] = &a[i];
+    }
+    for (i = 0; i < 3; ++ i) {
+        vb[i] = &b[i];
+    }
+
+    /* 两路数组加一路回调, 每次读 4 个 */
+    jmerge_add_array(merge, va, 4);
+    jmerge_add_array(merge, vb, 3);
+    jmerge_add_stream(merge, read_segment, &segment);
+    printf("inputs: %u\n", jmerge_num_inputs(merge));
+    while ((n = jmerge_read(merge, buffer, 4)) > 0) {
+        printf("batch:");
+        for (i = 0; i < n; ++ i) {
+            printf(" %d", *(int*) buffer[i]);
+        }
+        printf("\n");
+    }
+    jmerge_free(merge);
+
+    /* 并行归并: 4 个数组, 第 j 个是 j, j + 4, j + 8 ... */
+    for (j = 0; j < 4; ++ j) {
+        for (i = 0; i < 1000; ++ i) {
+            big[j][i] = (int) i * 4 + j;
+            bigValues[j][i] = &big[j][i];
+        }
+        arrays[j] = bigValues[j];
+        nums[j] = 1000;
+    }
+    if (JRET_OK == jmerge_parallel(compare_int, arrays, nums, 4, out, pool)) {
+        for (i = 0; i < 4000; ++ i) {
+            if (*(int*) out[i] != (int) i) {
+                sorted = 0;
+            }
+        }
+        printf("parallel merge of 4000 values: %s\n", sorted ? "sorted" : "wrong");
+    }
+
+    thread_pool_free(pool);
+
+    return 0;
+}
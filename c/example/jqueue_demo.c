@@ -0,0 +1,94 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "jqueue.h"
+
+#define NUM_PRODUCERS   3
+#define NUM_CONSUMERS   2
+#define NUM_TASKS       1000
+
+static JQueue* tasks;
+
+static void* producer(void* arg) {
+    uintptr_t id = (uintptr_t) arg;
+    uintptr_t i;
+
+    for (i = 1; i <= NUM_TASKS; ++ i) {
+        jqueue_push_wait(tasks, (JQueueValue) (id * NUM_TASKS + i), -1);
+    }
+
+    return NULL;
+}
+
+static void* consumer(void* arg) {
+    unsigned long* sum = arg;
+    JQueueValue value;
+
+    /* 关闭后取完剩下的值才返回失败 */
+    while (JRET_OK == jqueue_pop_wait(tasks, &value, -1)) {
+        *sum += (uintptr_t) value;
+    }
+
+    return NULL;
+}
+
+int main(void) {
+    JQueue* queue = jqueue_new(JQUEUE_TYPE_SPSC, 10, 0);
+    JQueueValue values[8];
+    JQueueValue value;
+    pthread_t producers[NUM_PRODUCERS];
+    pthread_t consumers[NUM_CONSUMERS];
+    unsigned long sums[NUM_CONSUMERS] = { 0 };
+    unsigned long expect = 0;
+    unsigned int n;
+    uintptr_t i;
+
+    /* 不等待的批量操作, 容量 10 取为 16 */
+    printf("capacity: %u\n", jqueue_capacity(queue));
+    for (i = 0; i < 8; ++ i) {
+        values[i] = (JQueueValue) i;
+    }
+    n = jqueue_push_n(queue, values, 8);
+    n += jqueue_push_n(queue, values, 8);
+    n += jqueue_push_n(queue, values, 8);
+    printf("push 24, pushed %u, num %u\n", n, jqueue_num(queue));
+    printf("push when full: %s\n", JRET_OK == jqueue_push(queue, values[0]) ? "ok" : "failed");
+
+    n = jqueue_pop_n(queue, values, 5);
+    printf("pop_n 5:");
+    for (i = 0; i < n; ++ i) {
+        printf(" %lu", (unsigned long) (uintptr_t) values[i]);
+    }
+    printf("\n");
+    while (JRET_OK == jqueue_pop(queue, &value)) {
+    }
+    printf("num after pop all: %u\n", jqueue_num(queue));
+    jqueue_free(queue);
+
+    /* 流水线: 多个生产者、消费者, 阻塞等待, 生产者都结束后关闭队列 */
+    tasks = jqueue_new(JQUEUE_TYPE_MPMC, 64, 1);
+    for (i = 0; i < NUM_CONSUMERS; ++ i) {
+        pthread_create(&consumers[i], NULL, consumer, &sums[i]);
+    }
+    for (i = 0; i < NUM_PRODUCERS; ++ i) {
+        pthread_create(&producers[i], NULL, producer, (void*) i);
+    }
+    for (i = 0; i < NUM_PRODUCERS; ++ i) {
+        pthread_join(producers[i], NULL);
+    }
+    jqueue_close(tasks);
+    for (i = 0; i < NUM_CONSUMERS; ++ i) {
+        pthread_join(consumers[i], NULL);
+    }
+
+    for (i = 0; i < NUM_PRODUCERS * NUM_TASKS; ++ i) {
+        expect += i + 1;
+    }
+    printf("pipeline sum: %lu, expect %lu\n", sums[0] + sums[1], expect);
+    printf("push after close: %s\n", JRET_OK == jqueue_push(tasks, values[0]) ? "ok" : "failed");
+    jqueue_free(tasks);
+
+    return 0;
+}
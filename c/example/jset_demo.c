@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jset.h"
+
+unsigned int int_hash(JSetValue value) {
+    return (unsigned int) *(int*) value;
+}
+
+int int_equal(JSetValue v1, JSetValue v2) {
+    return *(int*) v1 == *(int*) v2;
+}
+
+/* 快照记录就是 int 本身 */
+size_t int_save(JSetValue value, void* buf, size_t size) {
+    if (size >= sizeof (int)) {
+        memcpy(buf, value, sizeof (int));
+    }
+    return sizeof (int);
+}
+
+int int_record_equal(JSetValue value, const void* record, size_t size) {
+    return sizeof (int) == size && *(int*) value == *(const int*) record;
+}
+
+int main(void) {
+    JSet* set = jset_new(int_hash, int_equal);
+    JSet* other = jset_new(int_hash, int_equal);
+    JSet* result = JRET_PTR_NULL;
+    JSetIterator iter;
+    unsigned int i;
+    int values[] = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5 };
+    int others[] = { 2, 7, 1, 8, 2, 8 };
+    static int bigValues[100];
+    static int smallValues[10];
+    JSet* big;
+    JSet* small;
+    int* p;
+    int own = 1;
+    int key = 4;
+
+    for (i = 0; i < sizeof (values) / sizeof (int); ++ i) {
+        printf("insert %d: %s\n", values[i], JSET_TRUE == jset_insert(set, &values[i]) ? "ok" : "exist");
+    }
+
+    printf("\nset's entry number is %d\n", jset_num_entries(set));
+    printf("query %d: %s\n", key, JSET_HAVE == jset_query(set, &key) ? "have" : "not have");
+
+    jset_remove(set, &key);
+    printf("after remove, query %d: %s\n", key, JSET_HAVE == jset_query(set, &key) ? "have" : "not have");
+
+    printf("\nall values:\n");
+    for (jset_iterate(set, &iter); JSET_TRUE == jset_iter_has_more(&iter);) {
+        printf("%d\t", *(int*) jset_iter_next(&iter));
+    }
+    printf("\n");
+
+    /* 集合运算 */
+    for (i = 0; i < sizeof (others) / sizeof (int); ++ i) {
+        jset_insert(other, &others[i]);
+    }
+
+    result = jset_union(set, other);
+    printf("\nunion entry number is %d\n", jset_num_entries(result));
+    jset_free(result);
+
+    result = jset_intersection(set, other);
+    printf("intersection:\n");
+    for (jset_iterate(result, &iter); JSET_TRUE == jset_iter_has_more(&iter);) {
+        printf("%d\t", *(int*) jset_iter_next(&iter));
+    }
+    printf("\n\n");
+    jset_free(result);
+
+    /* 原地求交集: 两个集合的值相等但各自存放, 保留下来的必须是 big 自己的指针 */
+    big = jset_new(int_hash, int_equal);
+    small = jset_new(int_hash, int_equal);
+    for (i = 0; i < 100; ++ i) {
+        bigValues[i] = (int) i;
+        jset_insert(big, &bigValues[i]);
+    }
+    for (i = 0; i < 10; ++ i) {
+        smallValues[i] = (int) i * 10;
+        jset_insert(small, &smallValues[i]);
+    }
+    jset_intersect_inplace(big, small);
+    for (jset_iterate(big, &iter); JSET_TRUE == jset_iter_has_more(&iter);) {
+        p = jset_iter_next(&iter);
+        if (p < bigValues || p >= bigValues + 100) {
+            own = 0;
+        }
+    }
+    printf("intersect inplace: %u values, %s\n\n", jset_num_entries(big), own ? "own pointers" : "WRONG pointers");
+    jset_free(small);
+    jset_free(big);
+
+    /* 快照: 保存后映射回来直接查找 */
+    if (JRET_OK == jset_save(set, "jset_demo.snap", int_save)) {
+        JSetMapped* mapped = jset_open_mapped("jset_demo.snap", int_hash, int_record_equal);
+        key = 9;
+        printf("snapshot has %u values, query %d: %s\n", jset_mapped_num(mapped), key,
+               JRET_PTR_NULL != jset_mapped_lookup(mapped, &key, JRET_PTR_NULL) ? "have" : "not have");
+        jset_mapped_close(mapped);
+        remove("jset_demo.snap");
+    }
+
+    jset_free(other);
+    jset_free(set);
+
+    return 0;
+}
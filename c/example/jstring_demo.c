@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "jstring.h"
+#include "jset.h"
+#include "javl_tree.h"
+
+static const char* simd_name(JStringSimd simd) {
+    switch (simd) {
+    case JSTRING_SIMD_AVX2: return "avx2";
+    case JSTRING_SIMD_SSE2: return "sse2";
+    default:                return "c";
+    }
+}
+
+static void free_string(JSetValue value) {
+    jstring_free(value);
+}
+
+int main(void) {
+    JString* str = jstring_new("你好");
+    JSet* set = jset_new(jstring_hash_func, jstring_equal_func);
+    JAVLTree* tree = avl_tree_new(jstring_compare_func);
+    JAVLTreeNode* node;
+    JString* key;
+    const char* words[] = { "banana", "苹果", "apple", "香蕉", "apple", "cherry" };
+    const char bad[] = "abc\xed\xa0\x80";                      // 编码了代理区 U+D800
+    uint16_t utf16[64];
+    uint32_t utf32[64];
+    char utf8[256];
+    size_t num;
+    size_t i;
+
+    printf("simd: %s\n", simd_name(jstring_simd()));
+
+    /* 追加与查找 */
+    jstring_append(str, ", unicode 世界 😀", 21);
+    printf("\"%s\": %zu bytes, %zu characters, utf-8: %s\n",
+           jstring_data(str), jstring_size(str), jstring_length(str), jstring_is_utf8(str) ? "yes" : "no");
+    printf("find \"世界\" at byte %zu, find ',' at byte %zu\n",
+           jstring_find(str, "世界", 6, 0), jstring_find_byte(str, ',', 0));
+
+    /* 转码 */
+    num = jstring_utf8_to_utf16(jstring_data(str), jstring_size(str), utf16);
+    printf("utf-16 units: %zu (emoji is a surrogate pair)\n", num);
+    num = jstring_utf16_to_utf8(utf16, num, utf8);
+    utf8[num] = '\0';
+    printf("back to utf-8: %s\n", utf8);
+    num = jstring_utf8_to_utf32(jstring_data(str), jstring_size(str), utf32);
+    printf("utf-32 codepoints: %zu, last U+%X\n", num, (unsigned int) utf32[num - 1]);
+    printf("\"abc\\xed\\xa0\\x80\" is utf-8: %s, to utf-16: %s\n",
+           jstring_utf8_valid(bad, sizeof (bad) - 1) ? "yes" : "no",
+           JSTRING_NPOS == jstring_utf8_to_utf16(bad, sizeof (bad) - 1, utf16) ? "error" : "ok");
+
+    /* 作为集合和 AVL 树的 key */
+    jset_register_free_function(set, free_string);
+    for (i = 0; i < sizeof (words) / sizeof (words[0]); ++i) {
+        key = jstring_new(words[i]);
+        if (JSET_TRUE != jset_insert(set, key)) {
+            printf("set: \"%s\" already exists\n", words[i]);
+            jstring_free(key);
+            continue;
+        }
+        avl_tree_insert(tree, key, JRET_PTR_NULL);
+    }
+    key = jstring_new("香蕉");
+    printf("set has %u strings, query \"香蕉\": %s\n", jset_num_entries(set), JSET_HAVE == jset_query(set, key) ? "have" : "not have");
+    jstring_free(key);
+
+    printf("tree in byte order:");
+    for (node = avl_tree_first(tree); node; node = avl_tree_next(node)) {
+        printf(" %s", jstring_data(avl_tree_node_key(node)));
+    }
+    printf("\n");
+
+    avl_tree_free(tree);
+    jset_free(set);
+    jstring_free(str);
+
+    return 0;
+}
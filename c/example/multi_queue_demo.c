@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "jmulti_queue.h"
+
+#define NUM_PRODUCERS   4
+#define NUM_PER_THREAD  10000
+
+static int jobs[NUM_PRODUCERS * NUM_PER_THREAD];
+
+int my_compare(JBinaryHeapValue value1, JBinaryHeapValue value2) {
+
+    if (*(int*)value1 > *(int*)value2) {
+        return JRET_BIGGER;
+    } else if (*(int*)value1 < *(int*)value2) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+/* 生产者: 各自插入一段任务, 插入只锁本地分片 */
+void* producer(void* arg) {
+    JMultiQueue* queue = arg;
+    static unsigned int next = 0;
+    unsigned int first = __atomic_fetch_add(&next, NUM_PER_THREAD, __ATOMIC_RELAXED);
+    unsigned int i;
+
+    for (i = 0; i < NUM_PER_THREAD; ++ i) {
+        multi_queue_push(queue, &jobs[first + i]);
+    }
+
+    return NULL;
+}
+
+int main(void) {
+    JMultiQueue* queue = multi_queue_new(JBINARY_HEAP_TYPE_MIN, my_compare, 8);
+    pthread_t threads[NUM_PRODUCERS];
+    unsigned int i;
+    unsigned int num = 0;
+    unsigned int inversions = 0;
+    int last = -1;
+    int* job;
+
+    for (i = 0; i < NUM_PRODUCERS * NUM_PER_THREAD; ++ i) {
+        jobs[i] = rand() % 100000;
+    }
+
+    for (i = 0; i < NUM_PRODUCERS; ++ i) {
+        pthread_create(&threads[i], NULL, producer, queue);
+    }
+    for (i = 0; i < NUM_PRODUCERS; ++ i) {
+        pthread_join(threads[i], NULL);
+    }
+    printf("queue has %u jobs in %u shards\n", multi_queue_num(queue), multi_queue_num_shards(queue));
+
+    /* 宽松弹出: 顺序接近但不保证严格递增 */
+    for (i = 0; i < 20000; ++ i) {
+        job = multi_queue_pop(queue);
+        if (*job < last) {
+            ++ inversions;
+        }
+        last = *job;
+        ++ num;
+    }
+    printf("relaxed pop %u jobs, %u out of order\n", num, inversions);
+
+    /* 严格弹出: 严格递增 */
+    num = 0;
+    inversions = 0;
+    last = -1;
+    while (NULL != (job = multi_queue_pop_strict(queue))) {
+        if (*job < last) {
+            ++ inversions;
+        }
+        last = *job;
+        ++ num;
+    }
+    printf("strict pop %u jobs, %u out of order\n", num, inversions);
+
+    printf("queue is %s\n", 0 == multi_queue_num(queue) ? "empty" : "not empty");
+    multi_queue_free(queue);
+
+    return 0;
+}
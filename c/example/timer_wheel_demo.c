@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "jtimer_wheel.h"
+
+#define NUM_CONNS       5
+
+struct conn {
+    int             fd;
+    JTimer          timeout;
+};
+
+static JTimerWheel* wheel;
+static uint64_t now = 0;
+
+void on_timeout(JTimer* timer, void* data) {
+    struct conn* c = data;
+
+    printf("  tick %llu: conn %d timeout (expire %llu)\n", (unsigned long long) now, c->fd, (unsigned long long) timer->expire);
+}
+
+void on_heartbeat(JTimer* timer, void* data) {
+    printf("  tick %llu: heartbeat (expire %llu)\n", (unsigned long long) now, (unsigned long long) timer->expire);
+    timer_wheel_arm(wheel, timer, timer->expire + 300);         // 回调中重新设置自己, 按固定周期
+}
+
+int main(void) {
+    struct conn conns[NUM_CONNS];
+    JTimer heartbeat;
+    JTimer far;
+    uint64_t next;
+    int i;
+
+    wheel = timer_wheel_new(now);
+
+    for (i = 0; i < NUM_CONNS; ++ i) {
+        conns[i].fd = i;
+        timer_wheel_timer_init(&conns[i].timeout, on_timeout, &conns[i]);
+        timer_wheel_arm(wheel, &conns[i].timeout, now + 100 * (i + 1));
+    }
+    timer_wheel_timer_init(&heartbeat, on_heartbeat, NULL);
+    timer_wheel_arm(wheel, &heartbeat, now + 300);
+
+    /* 超出时间轮范围, 放在堆中 */
+    timer_wheel_timer_init(&far, on_timeout, &conns[0]);
+    timer_wheel_arm(wheel, &far, now + 100000000);
+
+    /* conn 1 收到数据: 推迟超时; conn 3 关闭: 取消 */
+    timer_wheel_arm(wheel, &conns[1].timeout, now + 1000);
+    timer_wheel_cancel(wheel, &conns[3].timeout);
+    printf("%u timers armed\n", timer_wheel_num(wheel));
+
+    timer_wheel_next_expire(wheel, &next);
+    printf("next expire: %llu\n", (unsigned long long) next);
+
+    for (now = 0; now <= 1000; now += 50) {
+        timer_wheel_advance(wheel, now);
+    }
+    printf("%u timers armed at tick %llu\n", timer_wheel_num(wheel), (unsigned long long) now);
+
+    timer_wheel_cancel(wheel, &heartbeat);
+    now = 100000000;
+    printf("advance to %llu: %u fired\n", (unsigned long long) now, timer_wheel_advance(wheel, now));
+
+    timer_wheel_free(wheel);
+
+    return 0;
+}
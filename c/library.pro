@@ -5,6 +5,9 @@ CONFIG -= qt
 
 # flags
 QMAKE_CXXFLAGS += -Wall
+LIBS += -lpthread
+# 开启容器内部计数(jstats.h)
+#DEFINES += JDS_STATS
 
 # head path
 INCLUDEPATH += \
@@ -14,18 +17,67 @@ INCLUDEPATH += \
 # head
 HEADERS += \
     src/base/jret.h \
+    src/base/jallocator.h \
+    src/base/jstats.h \
+    src/base/jsnapshot.h \
+    src/base/jthread_pool.h \
+    src/data_struct/jarray.h \
     src/data_struct/javl_tree.h \
+    src/data_struct/javl_tree_rcu.h \
+    src/data_struct/jbtree.h \
+    src/data_struct/jextsort.h \
     src/data_struct/jbinary_heap.h \
-    src/data_struct/jset.h
+    src/data_struct/jlist.h \
+    src/data_struct/jmerge.h \
+    src/data_struct/jmulti_queue.h \
+    src/data_struct/jqueue.h \
+    src/data_struct/jtimer_wheel.h \
+    src/data_struct/jset.h \
+    src/data_struct/jset_group.h \
+    src/data_struct/jstring.h \
+    src/data_struct/jbinary_heap.hpp \
+    src/data_struct/javl_tree.hpp \
+    src/data_struct/jset.hpp
 
 # source
 SOURCES += \
+    src/base/jallocator.c \
+    src/base/jsnapshot.c \
+    src/base/jthread_pool.c \
+    src/data_struct/jarray.c \
     src/data_struct/javl_tree.c \
+    src/data_struct/javl_tree_rcu.c \
+    src/data_struct/jbtree.c \
+    src/data_struct/jextsort.c \
     src/data_struct/jbinary_heap.c \
-    src/data_struct/jset.cpp
+    src/data_struct/jlist.c \
+    src/data_struct/jmerge.c \
+    src/data_struct/jmulti_queue.c \
+    src/data_struct/jqueue.c \
+    src/data_struct/jtimer_wheel.c \
+    src/data_struct/jset.c \
+    src/data_struct/jstring.c
 
 #========================== demo ========================
 SOURCES += \
 #    main.c\
+#    example/jallocator_demo.c\
+#    example/jarray_demo.c\
+#    example/jlist_demo.c\
+#    example/jmerge_demo.c\
+#    example/jextsort_demo.c\
 #    example/avl_tree_demo.c\
+#    example/avl_tree_rcu_demo.c\
     example/binary_heap_demo.c\
+#    example/jbtree_demo.c\
+#    example/multi_queue_demo.c\
+#    example/jqueue_demo.c\
+#    example/timer_wheel_demo.c\
+#    example/jset_demo.c\
+#    example/jstring_demo.c\
+#    example/jds_demo.cpp\
+
+#========================== bench =======================
+# make bench: 用 -O2 编译 bench/ 下的性能测试
+bench.commands = make -C $$PWD bench
+QMAKE_EXTRA_TARGETS += bench
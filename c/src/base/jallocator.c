@@ -0,0 +1,350 @@
+#define _GNU_SOURCE
+#include "jallocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define JALLOCATOR_MALLOC_ALIGN     (16)                        // malloc 返回的地址至少按 16 字节对齐
+#define JARENA_BLOCK_SIZE           (64 * 1024)
+#define JSLAB_PAGE_SIZE             (64 * 1024)
+#define JSLAB_MIN_OBJECTS           (8)                         // 每页至少放这么多个对象
+
+static size_t align_up(size_t n, size_t align) { return (n + align - 1) & ~(align - 1);}
+
+static void stats_add(JMemoryStats* stats, size_t size) {
+    stats->live += size;
+    if (stats->live > stats->peak) {
+        stats->peak = stats->live;
+    }
+}
+
+
+/* 默认分配器 */
+static void* default_alloc(void* data, size_t size, size_t align) {
+    void*                   ptr = JRET_PTR_NULL;
+
+    (void) data;
+    if (align <= JALLOCATOR_MALLOC_ALIGN) {
+        return malloc(size);
+    }
+
+    if (0 != posix_memalign(&ptr, align, size)) {
+        return JRET_PTR_NULL;
+    }
+
+    return ptr;
+}
+
+static void default_free(void* data, void* ptr, size_t size, size_t align) {
+    (void) data;
+    (void) size;
+    (void) align;
+    free(ptr);
+}
+
+static const JAllocator defaultAllocator = { default_alloc, default_free, JRET_PTR_NULL };
+
+const JAllocator* jallocator_default(void) {
+    return &defaultAllocator;
+}
+
+void* jallocator_alloc(const JAllocator* allocator, JMemoryStats* stats, size_t size, size_t align) {
+    void*                   ptr = allocator->alloc(allocator->data, size, align);
+
+    if (JRET_PTR_NULL != ptr && JRET_PTR_NULL != stats) {
+        stats_add(stats, size);
+    }
+
+    return ptr;
+}
+
+void jallocator_free(const JAllocator* allocator, JMemoryStats* stats, void* ptr, size_t size, size_t align) {
+    if (JRET_PTR_NULL == ptr) {
+        return;
+    }
+
+    if (JRET_PTR_NULL != stats) {
+        stats->live -= size;
+    }
+    if (JRET_PTR_NULL != allocator->free) {
+        allocator->free(allocator->data, ptr, size, align);
+    }
+}
+
+void* jallocator_realloc(const JAllocator* allocator, JMemoryStats* stats, void* ptr, size_t oldSize, size_t newSize, size_t align) {
+    void*                   newPtr = jallocator_alloc(allocator, stats, newSize, align);
+
+    if (JRET_PTR_NULL == newPtr) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_PTR_NULL != ptr) {
+        memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+        jallocator_free(allocator, stats, ptr, oldSize, align);
+    }
+
+    return newPtr;
+}
+
+
+/**
+ *  顺序分配器
+ *  块从系统申请, 块头之后是可分配的空间, 在当前块上移动 used 分配;
+ *  当前块放不下时申请新块, 大的申请单独占一块并挂在当前块后面, 当前块可以继续使用
+ */
+typedef struct _JArenaBlock JArenaBlock;
+struct _JArenaBlock {
+    JArenaBlock*            next;
+    size_t                  size;                               // 可分配空间的大小
+    size_t                  used;
+};
+
+#define JARENA_HEADER_SIZE  (align_up(sizeof (JArenaBlock), JALLOCATOR_MALLOC_ALIGN))
+
+struct _JArena {
+    JAllocator              allocator;
+    JArenaBlock*            blocks;                             // 第一块是当前块
+    size_t                  blockSize;
+    size_t                  allocated;                          // 分出去的字节数
+    JMemoryStats            stats;
+};
+
+static JArenaBlock* arena_new_block(JArena* arena, size_t size) {
+    JArenaBlock*            block = malloc(JARENA_HEADER_SIZE + size);
+
+    if (JRET_PTR_NULL == block) {
+        return JRET_PTR_NULL;
+    }
+
+    block->size = size;
+    block->used = 0;
+    stats_add(&arena->stats, JARENA_HEADER_SIZE + size);
+
+    return block;
+}
+
+/* 在块中按对齐切出 size 字节, 放不下返回空 */
+static void* arena_block_take(JArenaBlock* block, size_t size, size_t align) {
+    uintptr_t               base = (uintptr_t) block + JARENA_HEADER_SIZE;
+    uintptr_t               start = align_up(base + block->used, align);
+
+    if (start + size > base + block->size) {
+        return JRET_PTR_NULL;
+    }
+    block->used = start + size - base;
+
+    return (void*) start;
+}
+
+static void* arena_alloc(void* data, size_t size, size_t align) {
+    JArena*                 arena = data;
+    JArenaBlock*            block;
+    void*                   ptr;
+
+    if (JRET_PTR_NULL != arena->blocks) {
+        ptr = arena_block_take(arena->blocks, size, align);
+        if (JRET_PTR_NULL != ptr) {
+            arena->allocated += size;
+            return ptr;
+        }
+    }
+
+    if (size + align > arena->blockSize / 4) {                  // 大的申请单独一块, 不打断当前块
+        block = arena_new_block(arena, size + align);
+        if (JRET_PTR_NULL == block) {
+            return JRET_PTR_NULL;
+        }
+        if (JRET_PTR_NULL == arena->blocks) {
+            block->next = JRET_PTR_NULL;
+            arena->blocks = block;
+        } else {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        }
+    } else {
+        block = arena_new_block(arena, arena->blockSize);
+        if (JRET_PTR_NULL == block) {
+            return JRET_PTR_NULL;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    arena->allocated += size;
+    return arena_block_take(block, size, align);
+}
+
+JArena* jarena_new(size_t blockSize) {
+    JArena*                 arena = malloc(sizeof (JArena));
+
+    if (JRET_PTR_NULL == arena) {
+        return JRET_PTR_NULL;
+    }
+
+    arena->allocator.alloc = arena_alloc;
+    arena->allocator.free = JRET_PTR_NULL;
+    arena->allocator.data = arena;
+    arena->blocks = JRET_PTR_NULL;
+    arena->blockSize = 0 == blockSize ? JARENA_BLOCK_SIZE : blockSize;
+    arena->allocated = 0;
+    memset(&arena->stats, 0, sizeof (JMemoryStats));
+
+    return arena;
+}
+
+void jarena_reset(JArena* arena) {
+    JArenaBlock*            block;
+
+    while (JRET_PTR_NULL != arena->blocks) {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        free(block);
+    }
+    arena->allocated = 0;
+    arena->stats.live = 0;
+}
+
+void jarena_free(JArena* arena) {
+    jarena_reset(arena);
+    free(arena);
+}
+
+const JAllocator* jarena_allocator(JArena* arena) {
+    return &arena->allocator;
+}
+
+void jarena_stats(JArena* arena, JMemoryStats* stats) {
+    *stats = arena->stats;
+    stats->wasted = arena->stats.live - arena->allocated;
+}
+
+
+/**
+ *  固定大小对象分配器
+ *  每页开头是页头, 之后是连续的对象; 释放的对象通过自身的前 8 字节串成空闲链表
+ */
+typedef struct _JSlabPage JSlabPage;
+struct _JSlabPage {
+    JSlabPage*              next;
+};
+
+struct _JSlab {
+    JAllocator              allocator;
+    size_t                  objectSize;                         // 按 objectAlign 取整后的大小
+    size_t                  objectAlign;
+    size_t                  pageSize;
+    size_t                  headerSize;                         // 页头按对象对齐后的大小
+    JSlabPage*              pages;
+    void*                   freeList;
+    size_t                  liveObjects;
+    JMemoryStats            stats;
+};
+
+static int slab_owns(JSlab* slab, size_t size, size_t align) {
+    return size <= slab->objectSize && align <= slab->objectAlign;
+}
+
+/* 申请一页, 页中的对象全部放入空闲链表 */
+static int slab_new_page(JSlab* slab) {
+    JSlabPage*              page = JRET_PTR_NULL;
+    char*                   object;
+    char*                   end;
+
+    if (0 != posix_memalign((void**) &page, slab->objectAlign, slab->pageSize)) {
+        return JRET_ERROR;
+    }
+    page->next = slab->pages;
+    slab->pages = page;
+    stats_add(&slab->stats, slab->pageSize);
+
+    end = (char*) page + slab->pageSize - slab->objectSize;
+    for (object = (char*) page + slab->headerSize; object <= end; object += slab->objectSize) {
+        *(void**) object = slab->freeList;
+        slab->freeList = object;
+    }
+
+    return JRET_OK;
+}
+
+static void* slab_alloc(void* data, size_t size, size_t align) {
+    JSlab*                  slab = data;
+    void*                   object;
+
+    if (!slab_owns(slab, size, align)) {
+        return default_alloc(JRET_PTR_NULL, size, align);
+    }
+
+    if (JRET_PTR_NULL == slab->freeList && JRET_OK != slab_new_page(slab)) {
+        return JRET_PTR_NULL;
+    }
+
+    object = slab->freeList;
+    slab->freeList = *(void**) object;
+    ++ slab->liveObjects;
+
+    return object;
+}
+
+static void slab_free(void* data, void* ptr, size_t size, size_t align) {
+    JSlab*                  slab = data;
+
+    if (!slab_owns(slab, size, align)) {
+        default_free(JRET_PTR_NULL, ptr, size, align);
+        return;
+    }
+
+    *(void**) ptr = slab->freeList;
+    slab->freeList = ptr;
+    -- slab->liveObjects;
+}
+
+JSlab* jslab_new(size_t objectSize) {
+    JSlab*                  slab = JRET_PTR_NULL;
+
+    if (0 == objectSize) {
+        return JRET_PTR_NULL;
+    }
+
+    slab = malloc(sizeof (JSlab));
+    if (JRET_PTR_NULL == slab) {
+        return JRET_PTR_NULL;
+    }
+
+    slab->objectAlign = objectSize >= 64 ? 64 : JALLOCATOR_MALLOC_ALIGN;
+    slab->objectSize = align_up(objectSize, slab->objectAlign);
+    slab->headerSize = align_up(sizeof (JSlabPage), slab->objectAlign);
+    slab->pageSize = JSLAB_PAGE_SIZE;
+    if (slab->pageSize < slab->headerSize + slab->objectSize * JSLAB_MIN_OBJECTS) {
+        slab->pageSize = slab->headerSize + slab->objectSize * JSLAB_MIN_OBJECTS;
+    }
+    slab->allocator.alloc = slab_alloc;
+    slab->allocator.free = slab_free;
+    slab->allocator.data = slab;
+    slab->pages = JRET_PTR_NULL;
+    slab->freeList = JRET_PTR_NULL;
+    slab->liveObjects = 0;
+    memset(&slab->stats, 0, sizeof (JMemoryStats));
+
+    return slab;
+}
+
+void jslab_free(JSlab* slab) {
+    JSlabPage*              page;
+
+    while (JRET_PTR_NULL != slab->pages) {
+        page = slab->pages;
+        slab->pages = page->next;
+        free(page);
+    }
+    free(slab);
+}
+
+const JAllocator* jslab_allocator(JSlab* slab) {
+    return &slab->allocator;
+}
+
+void jslab_stats(JSlab* slab, JMemoryStats* stats) {
+    *stats = slab->stats;
+    stats->wasted = slab->stats.live - slab->liveObjects * slab->objectSize;
+}
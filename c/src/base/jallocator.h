@@ -0,0 +1,201 @@
+#ifndef JALLOCATOR_H
+#define JALLOCATOR_H
+#include "jret.h"
+
+/**
+ *  内存分配器
+ *
+ *  容器不直接调用 malloc/free, 而是通过 JAllocator 申请和释放内存,
+ *  创建容器时用 *_new_with_allocator 传入分配器, 不传时使用 jallocator_default (malloc/free)。
+ *
+ *  库里提供两种分配器:
+ *      JArena --- 按块顺序切分(bump), 单个释放是空操作, 销毁 arena 时整体释放;
+ *                 容器发现分配器没有 free 函数时, 销毁容器不再逐个释放节点
+ *      JSlab  --- 固定大小对象的空闲链表, 适合树节点这类大小相同、频繁申请释放的对象
+ *  两者都不是线程安全的, 多线程使用时每个线程一个。
+ *
+ *  每个容器记录自己通过分配器申请的内存(JMemoryStats), 用 *_memory_stats 查询。
+ *
+ *  调用：
+ *      jarena_new / jslab_new --- 创建
+ *      jarena_free / jslab_free --- 销毁, 同时释放从它申请的所有内存
+ */
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  申请内存
+ *
+ *  @param data             JAllocator.data
+ *  @param size             字节数
+ *  @param align            起始地址对齐, 2 的幂
+ *
+ *  @return                 成功: 返回内存
+ *                          失败: 返回 RET_PTR_NULL
+ */
+typedef void* (*JAllocatorAllocFunc) (void* data, size_t size, size_t align);
+
+/**
+ *  释放内存, size 和 align 与申请时相同
+ */
+typedef void (*JAllocatorFreeFunc) (void* data, void* ptr, size_t size, size_t align);
+
+/* 分配器 */
+typedef struct _JAllocator JAllocator;
+struct _JAllocator {
+    JAllocatorAllocFunc     alloc;
+    JAllocatorFreeFunc      free;                   // 为空表示内存只能整体释放
+    void*                   data;                   // 传给 alloc/free 的用户数据
+};
+
+/* 内存统计, 单位字节 */
+typedef struct _JMemoryStats JMemoryStats;
+struct _JMemoryStats {
+    size_t                  live;                   // 当前占用
+    size_t                  peak;                   // 占用的最大值
+    size_t                  wasted;                 // 当前占用中没有存放数据的部分(预留容量、空槽、块尾等)
+};
+
+/* 固定大小对象分配器 */
+typedef struct _JSlab JSlab;
+
+/* 顺序分配器 */
+typedef struct _JArena JArena;
+
+
+/**
+ *  默认分配器, 使用 malloc/free, 对齐大于 16 时使用 posix_memalign
+ *
+ *  @return                 分配器, 不需要释放
+ */
+const JAllocator* jallocator_default(void);
+
+
+/**
+ *  通过分配器申请内存并计入统计, 容器内部使用
+ *
+ *  @param allocator        分配器
+ *  @param stats            统计, 可以为 RET_PTR_NULL
+ *  @param size             字节数
+ *  @param align            对齐
+ *
+ *  @return                 成功: 返回内存
+ *                          失败: 返回 RET_PTR_NULL
+ */
+void* jallocator_alloc(const JAllocator* allocator, JMemoryStats* stats, size_t size, size_t align);
+
+
+/**
+ *  通过分配器释放内存并计入统计, 分配器没有 free 函数时只更新统计
+ *
+ *  @param allocator        分配器
+ *  @param stats            统计, 可以为 RET_PTR_NULL
+ *  @param ptr              内存, 可以为 RET_PTR_NULL
+ *  @param size             申请时的字节数
+ *  @param align            申请时的对齐
+ */
+void jallocator_free(const JAllocator* allocator, JMemoryStats* stats, void* ptr, size_t size, size_t align);
+
+
+/**
+ *  改变内存大小: 申请新内存, 复制 min(oldSize, newSize) 字节, 释放旧内存
+ *
+ *  @return                 成功: 返回新内存
+ *                          失败: 返回 RET_PTR_NULL, 旧内存不变
+ */
+void* jallocator_realloc(const JAllocator* allocator, JMemoryStats* stats, void* ptr, size_t oldSize, size_t newSize, size_t align);
+
+
+/**
+ *  创建顺序分配器
+ *
+ *  @param blockSize        每次向系统申请的块大小, 0 表示默认 64KB; 超过块大小 1/4 的申请单独占一块
+ *
+ *  @return                 成功: 返回 arena
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JArena* jarena_new(size_t blockSize);
+
+
+/**
+ *  销毁 arena, 从它申请的内存全部释放
+ *
+ *  @param arena            arena
+ */
+void jarena_free(JArena* arena);
+
+
+/**
+ *  释放所有块, arena 可以继续使用; 之前从它申请的内存都失效
+ *
+ *  @param arena            arena
+ */
+void jarena_reset(JArena* arena);
+
+
+/**
+ *  arena 的分配器接口, 生命周期与 arena 相同
+ *
+ *  @param arena            arena
+ *
+ *  @return                 分配器, free 为空
+ */
+const JAllocator* jarena_allocator(JArena* arena);
+
+
+/**
+ *  arena 的内存统计: live 为向系统申请的块的总大小, wasted 为块中没有分出去的部分
+ *
+ *  @param arena            arena
+ *  @param stats            统计结果
+ */
+void jarena_stats(JArena* arena, JMemoryStats* stats);
+
+
+/**
+ *  创建固定大小对象分配器
+ *
+ *  不超过 objectSize 的申请从 slab 中分配, 更大的申请转给默认分配器。
+ *  对象不小于 64 字节时按 64 字节对齐, 否则按 16 字节对齐, 对齐要求更高的申请也转给默认分配器。
+ *
+ *  @param objectSize       对象大小
+ *
+ *  @return                 成功: 返回 slab
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JSlab* jslab_new(size_t objectSize);
+
+
+/**
+ *  销毁 slab, 从它申请的对象全部释放
+ *
+ *  @param slab             slab
+ */
+void jslab_free(JSlab* slab);
+
+
+/**
+ *  slab 的分配器接口, 生命周期与 slab 相同
+ *
+ *  @param slab             slab
+ *
+ *  @return                 分配器
+ */
+const JAllocator* jslab_allocator(JSlab* slab);
+
+
+/**
+ *  slab 的内存统计: live 为页的总大小, wasted 为空闲对象和页尾不够一个对象的部分
+ *
+ *  @param slab             slab
+ *  @param stats            统计结果
+ */
+void jslab_stats(JSlab* slab, JMemoryStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JALLOCATOR_H
@@ -2,7 +2,7 @@
 #define JRET_H
 
 #ifdef __cplusplus
-extern "C"
+extern "C" {
 #endif
 
 /**
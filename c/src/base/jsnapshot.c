@@ -0,0 +1,229 @@
+#define _GNU_SOURCE
+#include "jsnapshot.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JSNAPSHOT_BYTE_ORDER        (0x01020304U)
+#define JSNAPSHOT_ALIGN             (8)
+
+static const unsigned char zeros[JSNAPSHOT_HEADER_SIZE];
+
+static uint64_t align_up(uint64_t n) { return (n + JSNAPSHOT_ALIGN - 1) & ~(uint64_t) (JSNAPSHOT_ALIGN - 1);}
+
+static void jsnapshot_writer_release(JSnapshotWriter* writer) {
+    free(writer->path);
+    free(writer->tmpPath);
+    free(writer->buf);
+    memset(writer, 0, sizeof (JSnapshotWriter));
+}
+
+int jsnapshot_writer_open(JSnapshotWriter* writer, const char* path, uint64_t dataOffset) {
+    size_t                  len = strlen(path);
+    int                     fd;
+
+    memset(writer, 0, sizeof (JSnapshotWriter));
+    writer->path = malloc(len + 1);
+    writer->tmpPath = malloc(len + sizeof (".tmp.XXXXXX"));
+    if (JRET_PTR_NULL == writer->path || JRET_PTR_NULL == writer->tmpPath) {
+        jsnapshot_writer_release(writer);
+        return JRET_ERROR;
+    }
+    memcpy(writer->path, path, len + 1);
+    memcpy(writer->tmpPath, path, len);
+    memcpy(writer->tmpPath + len, ".tmp.XXXXXX", sizeof (".tmp.XXXXXX"));
+
+    fd = mkstemp(writer->tmpPath);
+    if (fd < 0) {
+        jsnapshot_writer_release(writer);
+        return JRET_ERROR;
+    }
+
+    fchmod(fd, 0644);                                           // mkstemp 创建的文件只有属主可读
+    writer->file = fdopen(fd, "w");
+    if (JRET_PTR_NULL == writer->file) {
+        close(fd);
+        unlink(writer->tmpPath);
+        jsnapshot_writer_release(writer);
+        return JRET_ERROR;
+    }
+
+    writer->dataOffset = dataOffset;
+    writer->offset = dataOffset;
+    if (0 != fseeko(writer->file, (off_t) dataOffset, SEEK_SET)) {
+        jsnapshot_writer_abort(writer);
+        return JRET_ERROR;
+    }
+
+    return JRET_OK;
+}
+
+void* jsnapshot_writer_buffer(JSnapshotWriter* writer, size_t size) {
+    void*                   buf;
+
+    if (size > writer->bufSize) {
+        buf = realloc(writer->buf, size);
+        if (JRET_PTR_NULL == buf) {
+            return JRET_PTR_NULL;
+        }
+        writer->buf = buf;
+        writer->bufSize = size;
+    }
+
+    return writer->buf;
+}
+
+int jsnapshot_writer_record(JSnapshotWriter* writer, const void* data, size_t size, uint64_t* offset) {
+    uint64_t                len = size;
+    size_t                  pad = align_up(size) - size;
+
+    if (1 != fwrite(&len, sizeof (len), 1, writer->file)
+            || (size > 0 && 1 != fwrite(data, size, 1, writer->file))
+            || (pad > 0 && 1 != fwrite(zeros, pad, 1, writer->file))) {
+        return JRET_ERROR;
+    }
+
+    *offset = writer->offset;
+    writer->offset += sizeof (len) + size + pad;
+
+    return JRET_OK;
+}
+
+/* fsync path 所在的目录, 让改名本身落盘; 目录不支持 fsync(EINVAL)时只能不管 */
+static int jsnapshot_sync_dir(const char* path) {
+    const char*             slash = strrchr(path, '/');
+    size_t                  len = JRET_PTR_NULL == slash ? 1 : (slash == path ? 1 : (size_t) (slash - path));
+    char*                   dir = malloc(len + 1);
+    int                     fd;
+    int                     ret = JRET_ERROR;
+
+    if (JRET_PTR_NULL == dir) {
+        return JRET_ERROR;
+    }
+
+    memcpy(dir, JRET_PTR_NULL == slash ? "." : path, len);
+    dir[len] = '\0';
+
+    fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        if (0 == fsync(fd) || EINVAL == errno) {
+            ret = JRET_OK;
+        }
+        close(fd);
+    }
+    free(dir);
+
+    return ret;
+}
+
+int jsnapshot_writer_commit(JSnapshotWriter* writer, JSnapshotHeader* header, const void* index, size_t indexSize) {
+    FILE*                   file = writer->file;
+    int                     ok;
+
+    header->version = JSNAPSHOT_VERSION;
+    header->byteOrder = JSNAPSHOT_BYTE_ORDER;
+    header->indexOffset = JSNAPSHOT_HEADER_SIZE;
+    header->dataOffset = writer->dataOffset;
+    header->fileSize = writer->offset;
+
+    ok = JSNAPSHOT_HEADER_SIZE + indexSize <= writer->dataOffset
+        && 0 == fseeko(file, 0, SEEK_SET)
+        && 1 == fwrite(header, sizeof (JSnapshotHeader), 1, file)
+        && 1 == fwrite(zeros, JSNAPSHOT_HEADER_SIZE - sizeof (JSnapshotHeader), 1, file)
+        && (0 == indexSize || 1 == fwrite(index, indexSize, 1, file))
+        && 0 == fflush(file)
+        && 0 == fsync(fileno(file));
+
+    writer->file = JRET_PTR_NULL;
+    if (0 != fclose(file) || !ok || 0 != rename(writer->tmpPath, writer->path)) {
+        unlink(writer->tmpPath);
+        jsnapshot_writer_release(writer);
+        return JRET_ERROR;
+    }
+
+    /* 已经改名, 新文件留在原处; 目录没能 fsync 时崩溃可能丢掉这次改名, 报告失败 */
+    ok = JRET_OK == jsnapshot_sync_dir(writer->path);
+    jsnapshot_writer_release(writer);
+
+    return ok ? JRET_OK : JRET_ERROR;
+}
+
+void jsnapshot_writer_abort(JSnapshotWriter* writer) {
+    if (JRET_PTR_NULL != writer->file) {
+        fclose(writer->file);
+        unlink(writer->tmpPath);
+    }
+    jsnapshot_writer_release(writer);
+}
+
+int jsnapshot_map(JSnapshot* snapshot, const char* path, const char magic[8]) {
+    const JSnapshotHeader*  header;
+    struct stat             st;
+    void*                   base;
+    int                     fd;
+
+    memset(snapshot, 0, sizeof (JSnapshot));
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return JRET_ERROR;
+    }
+    if (0 != fstat(fd, &st) || st.st_size < JSNAPSHOT_HEADER_SIZE) {
+        close(fd);
+        return JRET_ERROR;
+    }
+
+    base = mmap(JRET_PTR_NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                                                  // 映射不依赖文件描述符
+    if (MAP_FAILED == base) {
+        return JRET_ERROR;
+    }
+
+    header = base;
+    if (0 != memcmp(header->magic, magic, sizeof (header->magic))
+            || JSNAPSHOT_VERSION != header->version
+            || JSNAPSHOT_BYTE_ORDER != header->byteOrder
+            || JSNAPSHOT_HEADER_SIZE != header->indexOffset
+            || header->dataOffset < header->indexOffset
+            || header->dataOffset % JSNAPSHOT_ALIGN != 0
+            || header->fileSize != (uint64_t) st.st_size
+            || header->dataOffset > header->fileSize) {
+        munmap(base, (size_t) st.st_size);
+        return JRET_ERROR;
+    }
+
+    snapshot->base = base;
+    snapshot->size = (size_t) st.st_size;
+    snapshot->header = header;
+
+    return JRET_OK;
+}
+
+void jsnapshot_unmap(JSnapshot* snapshot) {
+    if (JRET_PTR_NULL != snapshot->base) {
+        munmap((void*) snapshot->base, snapshot->size);
+    }
+    memset(snapshot, 0, sizeof (JSnapshot));
+}
+
+const void* jsnapshot_record(JSnapshot* snapshot, uint64_t offset, size_t* size) {
+    uint64_t                len;
+
+    if (offset < snapshot->header->dataOffset || offset % JSNAPSHOT_ALIGN != 0 || offset > snapshot->size - sizeof (len)) {
+        return JRET_PTR_NULL;
+    }
+
+    memcpy(&len, snapshot->base + offset, sizeof (len));
+    if (len > snapshot->size - offset - sizeof (len)) {
+        return JRET_PTR_NULL;
+    }
+
+    *size = (size_t) len;
+
+    return snapshot->base + offset + sizeof (len);
+}
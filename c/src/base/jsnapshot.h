@@ -0,0 +1,152 @@
+#ifndef JSNAPSHOT_H
+#define JSNAPSHOT_H
+#include "jret.h"
+
+/**
+ *  快照文件
+ *
+ *  容器把内容写成不含指针的扁平文件, 重启后 mmap 只读打开直接查找, 不需要逐个插入重建,
+ *  只有被访问到的页才会从磁盘读入。avl_tree_save / jset_save 使用, 一般不直接调用。
+ *
+ *  文件格式(本机字节序, 所有位置都是相对文件开头的字节偏移, 文件可以随意移动和复制):
+ *      [0, 64)                 JSnapshotHeader
+ *      [64, dataOffset)        索引, 格式由容器决定(AVL 树是隐式树, 集合是 hash 表)
+ *      [dataOffset, fileSize)  记录, 每条是 8 字节的长度加用户序列化的内容, 按 8 字节对齐
+ *
+ *  写入时先写到同目录的临时文件, 全部写完并 fsync 后再改名, 再 fsync 所在目录让改名落盘,
+ *  覆盖旧快照时不会留下半个文件。
+ *  打开时只检查文件头, 读取记录时检查偏移是否越界, 不扫描整个文件。
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSNAPSHOT_VERSION           (1)
+#define JSNAPSHOT_HEADER_SIZE       (64)
+
+/* 文件头 */
+typedef struct _JSnapshotHeader JSnapshotHeader;
+struct _JSnapshotHeader {
+    char                    magic[8];               // 容器类型
+    uint32_t                version;
+    uint32_t                byteOrder;              // 0x01020304, 用来识别不同字节序的机器写的文件
+    uint64_t                num;                    // 记录数
+    uint64_t                capacity;               // 索引的槽数
+    uint64_t                indexOffset;
+    uint64_t                dataOffset;
+    uint64_t                fileSize;
+};
+
+/* 写快照 */
+typedef struct _JSnapshotWriter JSnapshotWriter;
+struct _JSnapshotWriter {
+    FILE*                   file;
+    char*                   path;                   // 最终的文件名
+    char*                   tmpPath;                // 正在写的临时文件
+    uint64_t                dataOffset;             // 记录区的位置
+    uint64_t                offset;                 // 下一条记录的位置
+    void*                   buf;                    // 序列化用的缓冲区
+    size_t                  bufSize;
+};
+
+/* 只读映射的快照 */
+typedef struct _JSnapshot JSnapshot;
+struct _JSnapshot {
+    const unsigned char*    base;
+    size_t                  size;
+    const JSnapshotHeader*  header;
+};
+
+
+/**
+ *  开始写快照, 记录从 dataOffset 开始写
+ *
+ *  @param writer           写快照的状态
+ *  @param path             快照文件名
+ *  @param dataOffset       记录区的位置, 即文件头加索引的大小, 8 的倍数
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (不能创建临时文件或内存不足)
+ */
+int jsnapshot_writer_open(JSnapshotWriter* writer, const char* path, uint64_t dataOffset);
+
+
+/**
+ *  序列化缓冲区, 保证至少有 size 字节, 内容不保留
+ *
+ *  @return                 成功：返回缓冲区
+ *                          失败：返回 RET_PTR_NULL
+ */
+void* jsnapshot_writer_buffer(JSnapshotWriter* writer, size_t size);
+
+
+/**
+ *  追加一条记录
+ *
+ *  @param writer           写快照的状态
+ *  @param data             记录内容
+ *  @param size             字节数
+ *  @param offset           返回记录的位置, 写入索引
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (写文件失败)
+ */
+int jsnapshot_writer_record(JSnapshotWriter* writer, const void* data, size_t size, uint64_t* offset);
+
+
+/**
+ *  写入文件头和索引, fsync 后改名为最终的文件名并 fsync 所在目录, 然后释放 writer
+ *  header 中 magic、num、capacity 由调用者填写, 其余字段在这里填写
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (写文件失败, 临时文件已删除, 旧快照不变;
+ *                                          或改名后目录 fsync 失败, 新快照已在原处但崩溃后可能丢失)
+ */
+int jsnapshot_writer_commit(JSnapshotWriter* writer, JSnapshotHeader* header, const void* index, size_t indexSize);
+
+
+/**
+ *  放弃写快照, 删除临时文件并释放 writer
+ */
+void jsnapshot_writer_abort(JSnapshotWriter* writer);
+
+
+/**
+ *  只读映射快照文件并检查文件头, 索引大小是否与 num、capacity 相符由容器检查
+ *
+ *  @param snapshot         返回映射的快照
+ *  @param path             快照文件名
+ *  @param magic            期望的容器类型, 8 字节
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (打不开、不是这种快照、版本或字节序不同、文件被截断)
+ */
+int jsnapshot_map(JSnapshot* snapshot, const char* path, const char magic[8]);
+
+
+/**
+ *  解除映射
+ */
+void jsnapshot_unmap(JSnapshot* snapshot);
+
+
+/**
+ *  读取记录
+ *
+ *  @param snapshot         快照
+ *  @param offset           记录的位置, 来自索引
+ *  @param size             返回记录的字节数
+ *
+ *  @return                 成功：返回记录内容, 按 8 字节对齐
+ *                          失败：返回 RET_PTR_NULL (位置越界, 文件损坏)
+ */
+const void* jsnapshot_record(JSnapshot* snapshot, uint64_t offset, size_t* size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JSNAPSHOT_H
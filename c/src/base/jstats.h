@@ -0,0 +1,29 @@
+#ifndef JSTATS_H
+#define JSTATS_H
+
+/**
+ *  容器内部计数器
+ *
+ *  定位容器变慢的原因(比较函数太慢、旋转太多、频繁扩容、hash 冲突)用的计数,
+ *  编译库时定义 JDS_STATS 才会计数(make STATS=1 或者 qmake 中 DEFINES += JDS_STATS),
+ *  默认不编译: 不增加任何指令, 容器结构体中也没有计数字段。
+ *
+ *  各容器的 *_get_stats 返回计数、*_reset_stats 清零, 与 *_memory_stats 相互独立。
+ *  计数不是原子的, 与容器本身一样要求同一时刻只有一个线程修改容器;
+ *  导出到监控时在修改容器的线程中(或加同一把锁)读取。
+ *
+ *  本文件只在容器的 .c 中使用。
+ */
+#include <stdint.h>
+
+#ifdef JDS_STATS
+#define JSTATS_INC(counter)         ((counter) += 1)
+#define JSTATS_ADD(counter, n)      ((counter) += (n))
+#define JSTATS_MAX(counter, v)      do { if ((counter) < (uint64_t) (v)) { (counter) = (v); } } while (0)
+#else
+#define JSTATS_INC(counter)         ((void) 0)
+#define JSTATS_ADD(counter, n)      ((void) (n))                    // 只求值 n, 计数用的局部变量不会报未使用
+#define JSTATS_MAX(counter, v)      ((void) (v))
+#endif
+
+#endif // JSTATS_H
@@ -0,0 +1,165 @@
+#define _GNU_SOURCE
+#include "jthread_pool.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+struct _JThreadPool {
+    pthread_t*              threads;                    // 工作线程, 不包括调用线程
+    unsigned int            numWorkers;
+    pthread_mutex_t         runLock;                    // 同一时间只执行一批任务
+    pthread_mutex_t         lock;
+    pthread_cond_t          wake;                       // 通知工作线程有新任务
+    pthread_cond_t          done;                       // 通知调用线程工作线程都已完成
+    unsigned long           generation;                 // 每批任务加 1
+    unsigned int            busyWorkers;
+    int                     stop;
+
+    JThreadPoolTaskFunc     func;
+    void*                   data;
+    unsigned int            numTasks;
+    unsigned int            nextTask;                   // 下一个要领取的任务, 原子操作
+};
+
+/* 领取并执行任务, 直到任务全部被领取 */
+static void thread_pool_work(JThreadPool* pool) {
+    unsigned int            task;
+
+    for (;;) {
+        task = __atomic_fetch_add(&pool->nextTask, 1, __ATOMIC_RELAXED);
+        if (task >= pool->numTasks) {
+            break;
+        }
+        pool->func(task, pool->data);
+    }
+}
+
+static void* thread_pool_worker(void* arg) {
+    JThreadPool*            pool = arg;
+    unsigned long           seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+
+        if (pool->stop) {
+            break;
+        }
+
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        thread_pool_work(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        if (0 == -- pool->busyWorkers) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return JRET_PTR_NULL;
+}
+
+
+JThreadPool* thread_pool_new(unsigned int numThreads) {
+    JThreadPool*            pool = JRET_PTR_NULL;
+    long                    cpus;
+    unsigned int            i;
+
+    if (0 == numThreads) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = cpus > 0 ? (unsigned int) cpus : 1;
+    }
+
+    pool = malloc(sizeof (JThreadPool));
+    if (JRET_PTR_NULL == pool) {
+        return JRET_PTR_NULL;
+    }
+
+    pool->numWorkers = numThreads - 1;
+    pool->threads = malloc(sizeof (pthread_t) * (pool->numWorkers + 1));
+    if (JRET_PTR_NULL == pool->threads) {
+        free(pool);
+        return JRET_PTR_NULL;
+    }
+
+    pthread_mutex_init(&pool->runLock, JRET_PTR_NULL);
+    pthread_mutex_init(&pool->lock, JRET_PTR_NULL);
+    pthread_cond_init(&pool->wake, JRET_PTR_NULL);
+    pthread_cond_init(&pool->done, JRET_PTR_NULL);
+    pool->generation = 0;
+    pool->busyWorkers = 0;
+    pool->stop = 0;
+    pool->numTasks = 0;
+    pool->nextTask = 0;
+
+    for (i = 0; i < pool->numWorkers; ++i) {
+        if (0 != pthread_create(&pool->threads[i], JRET_PTR_NULL, thread_pool_worker, pool)) {
+            pool->numWorkers = i;                       // 只保留已经创建的线程
+            break;
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_free(JThreadPool* pool) {
+    unsigned int            i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->numWorkers; ++i) {
+        pthread_join(pool->threads[i], JRET_PTR_NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->runLock);
+    free(pool->threads);
+    free(pool);
+}
+
+unsigned int thread_pool_num_threads(JThreadPool* pool) {
+    return pool->numWorkers + 1;
+}
+
+void thread_pool_run(JThreadPool* pool, unsigned int numTasks, JThreadPoolTaskFunc func, void* data) {
+    unsigned int            i;
+
+    if (0 == pool->numWorkers || numTasks <= 1) {       // 不值得唤醒工作线程
+        for (i = 0; i < numTasks; ++i) {
+            func(i, data);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->runLock);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->func = func;
+    pool->data = data;
+    pool->numTasks = numTasks;
+    pool->nextTask = 0;
+    pool->busyWorkers = pool->numWorkers;
+    ++ pool->generation;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    thread_pool_work(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busyWorkers > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->runLock);
+}
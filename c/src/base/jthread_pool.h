@@ -0,0 +1,75 @@
+#ifndef JTHREAD_POOL_H
+#define JTHREAD_POOL_H
+#include "jret.h"
+
+/**
+ *  线程池
+ *  固定数量的工作线程, 以 fork-join 的方式执行一批任务:
+ *  调用 thread_pool_run 的线程也参与执行, 所有任务完成后才返回。
+ *  任务由各线程抢占领取, 任务数多于线程数时可以自动均衡负载。
+ *
+ *  调用：
+ *      thread_pool_new --- 创建
+ *      thread_pool_free --- 销毁
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 线程池 */
+typedef struct _JThreadPool JThreadPool;
+
+/**
+ *  任务函数
+ *
+ *  @param task             任务编号, 从 0 到 numTasks - 1
+ *  @param data             thread_pool_run 传入的用户数据
+ */
+typedef void (*JThreadPoolTaskFunc) (unsigned int task, void* data);
+
+
+/**
+ *  创建线程池
+ *
+ *  @param numThreads       参与计算的线程数(包括调用线程), 0 表示使用 CPU 核数
+ *
+ *  @return                 成功: 返回线程池
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JThreadPool* thread_pool_new(unsigned int numThreads);
+
+
+/**
+ *  销毁线程池, 等待所有工作线程退出
+ *
+ *  @param pool             线程池
+ */
+void thread_pool_free(JThreadPool* pool);
+
+
+/**
+ *  参与计算的线程数(包括调用线程)
+ *
+ *  @param pool             线程池
+ *
+ *  @return                 线程数
+ */
+unsigned int thread_pool_num_threads(JThreadPool* pool);
+
+
+/**
+ *  执行一批任务, 所有任务完成后返回
+ *  多个线程同时调用时会依次执行
+ *
+ *  @param pool             线程池
+ *  @param numTasks         任务数量
+ *  @param func             任务函数
+ *  @param data             传给任务函数的用户数据
+ */
+void thread_pool_run(JThreadPool* pool, unsigned int numTasks, JThreadPoolTaskFunc func, void* data);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JTHREAD_POOL_H
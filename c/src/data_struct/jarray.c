@@ -0,0 +1,373 @@
+#include "jarray.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JARRAY_VECTOR_WIDTH     (32)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define JARRAY_VECTOR_WIDTH     (16)
+#endif
+
+#define JARRAY_GROWTH           (50)                // 默认每次扩容增加当前容量的百分比
+#define JARRAY_MIN_GROWTH       (8)                 // 默认每次扩容至少增加的元素数
+#define JARRAY_MAX_ALIGN        (16)
+
+struct _JArray {
+    unsigned char*          data;
+    unsigned int            num;
+    unsigned int            capacity;
+    unsigned int            elementSize;
+    unsigned int            align;                  // 元素数组的对齐, 元素大小能整除的最大 2 的幂, 不超过 16
+
+    /* 内存 */
+    const JAllocator*       allocator;
+    JMemoryStats            memStats;
+    unsigned int            growthPercent;          // 扩容时增加当前容量的百分比
+    unsigned int            growthMin;              // 扩容时至少增加的元素数
+};
+
+static unsigned char* array_at(JArray* array, unsigned int index) {
+    return array->data + (size_t) array->elementSize * index;
+}
+
+/* 把元素数组改为 capacity 个元素, 已有元素复制过去; capacity 为 0 时释放 */
+static int array_resize(JArray* array, unsigned int capacity) {
+    size_t                  oldSize = (size_t) array->elementSize * array->capacity;
+    unsigned char*          data = JRET_PTR_NULL;
+
+    if (0 == capacity) {
+        jallocator_free(array->allocator, &array->memStats, array->data, oldSize, array->align);
+    } else {
+        data = jallocator_realloc(array->allocator, &array->memStats, array->data,
+                                  oldSize, (size_t) array->elementSize * capacity, array->align);
+        if (JRET_PTR_NULL == data) {
+            return JRET_ERROR;
+        }
+    }
+
+    array->data = data;
+    array->capacity = capacity;
+
+    return JRET_OK;
+}
+
+/**
+ * 确保还能放下 num 个元素
+ * 按容量的百分比扩容, 追加 n 个元素只复制 O(n) 次, 策略由 jarray_set_growth 设置
+ */
+static int array_grow(JArray* array, unsigned int num) {
+    unsigned long long      growth;
+    unsigned long long      newSize;
+
+    if (array->capacity - array->num >= num) {
+        return JRET_OK;
+    }
+
+    growth = (unsigned long long) array->capacity * array->growthPercent / 100;
+    if (growth < array->growthMin) {
+        growth = array->growthMin;
+    }
+    newSize = array->capacity + growth;
+    if (newSize < (unsigned long long) array->num + num) {
+        newSize = (unsigned long long) array->num + num;
+    }
+    if (newSize > UINT_MAX || newSize * array->elementSize > SIZE_MAX) {
+        return JRET_ERROR;
+    }
+
+    return array_resize(array, (unsigned int) newSize);
+}
+
+#ifdef JARRAY_VECTOR_WIDTH
+/* 逐字节比较一个向量, 相等的字节对应的位为 1 */
+static uint32_t array_match_vector(const unsigned char* p, const unsigned char* pattern) {
+#if defined(__AVX2__)
+    return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) p),
+                                                             _mm256_loadu_si256((const __m256i*) pattern)));
+#else
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) p),
+                                                       _mm_loadu_si128((const __m128i*) pattern)));
+#endif
+}
+
+/**
+ * 每个元素对应 elementSize 位的掩码, 只有这几位全为 1 时元素相等,
+ * 依次与右移 1、2、4 位的自己相与后, 元素第一个字节的那一位表示整个元素是否相等
+ */
+static uint32_t array_fold_mask(uint32_t mask, unsigned int elementSize) {
+    unsigned int            shift;
+
+    for (shift = 1; shift < elementSize; shift <<= 1) {
+        mask &= mask >> shift;
+    }
+
+    switch (elementSize) {
+    case 2:  return mask & 0x55555555u;
+    case 4:  return mask & 0x11111111u;
+    case 8:  return mask & 0x01010101u;
+    default: return mask;
+    }
+}
+
+/* 元素大小为 1、2、4、8 时把元素重复铺满一个向量, 一次比较 JARRAY_VECTOR_WIDTH / elementSize 个元素 */
+static unsigned int array_find_vector(JArray* array, const void* element, unsigned int from) {
+    unsigned char           pattern[JARRAY_VECTOR_WIDTH];
+    const unsigned char*    p = array_at(array, from);
+    const unsigned char*    end = array_at(array, array->num);
+    unsigned int            elementSize = array->elementSize;
+    uint32_t                mask;
+    unsigned int            i;
+
+    for (i = 0; i < JARRAY_VECTOR_WIDTH; i += elementSize) {
+        memcpy(pattern + i, element, elementSize);
+    }
+
+    for (; end - p >= JARRAY_VECTOR_WIDTH; p += JARRAY_VECTOR_WIDTH) {
+        mask = array_fold_mask(array_match_vector(p, pattern), elementSize);
+        if (0 != mask) {
+            return (unsigned int) ((p - array->data + __builtin_ctz(mask)) / elementSize);
+        }
+    }
+
+    for (; p < end; p += elementSize) {
+        if (0 == memcmp(p, element, elementSize)) {
+            return (unsigned int) ((p - array->data) / elementSize);
+        }
+    }
+
+    return JARRAY_NOT_FOUND;
+}
+#endif
+
+
+JArray* jarray_new(unsigned int elementSize) {
+    return jarray_new_with_allocator(elementSize, JRET_PTR_NULL);
+}
+
+
+JArray* jarray_new_with_allocator(unsigned int elementSize, const JAllocator* allocator) {
+    JArray*                 array = JRET_PTR_NULL;
+    JMemoryStats            memStats = { 0, 0, 0 };
+
+    if (0 == elementSize) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_PTR_NULL == allocator) {
+        allocator = jallocator_default();
+    }
+
+    array = jallocator_alloc(allocator, &memStats, sizeof (JArray), sizeof (void*));
+    if (JRET_PTR_NULL == array) {
+        return JRET_PTR_NULL;
+    }
+
+    array->data = JRET_PTR_NULL;
+    array->num = 0;
+    array->capacity = 0;
+    array->elementSize = elementSize;
+    array->align = elementSize & -elementSize;
+    if (array->align > JARRAY_MAX_ALIGN) {
+        array->align = JARRAY_MAX_ALIGN;
+    }
+    array->allocator = allocator;
+    array->memStats = memStats;
+    array->growthPercent = JARRAY_GROWTH;
+    array->growthMin = JARRAY_MIN_GROWTH;
+
+    return array;
+}
+
+
+void jarray_free(JArray* array) {
+    if (JRET_PTR_NULL == array) {
+        return;
+    }
+
+    array_resize(array, 0);
+    jallocator_free(array->allocator, JRET_PTR_NULL, array, sizeof (JArray), sizeof (void*));
+}
+
+
+int jarray_set_growth(JArray* array, unsigned int growthPercent, unsigned int minGrowth) {
+    if (0 == growthPercent && 0 == minGrowth) {
+        return JRET_ERROR;
+    }
+
+    array->growthPercent = growthPercent;
+    array->growthMin = minGrowth;
+
+    return JRET_OK;
+}
+
+
+int jarray_reserve(JArray* array, unsigned int capacity) {
+    if (capacity <= array->capacity) {
+        return JRET_OK;
+    }
+
+    if ((unsigned long long) capacity * array->elementSize > SIZE_MAX) {
+        return JRET_ERROR;
+    }
+
+    return array_resize(array, capacity);
+}
+
+
+int jarray_shrink(JArray* array) {
+    if (array->num == array->capacity) {
+        return JRET_OK;
+    }
+
+    return array_resize(array, array->num);
+}
+
+
+int jarray_append(JArray* array, const void* element) {
+    return jarray_append_n(array, element, 1);
+}
+
+
+int jarray_append_n(JArray* array, const void* elements, unsigned int num) {
+    if (0 == num) {
+        return JRET_OK;
+    }
+
+    if (JRET_OK != array_grow(array, num)) {
+        return JRET_ERROR;
+    }
+
+    memcpy(array_at(array, array->num), elements, (size_t) array->elementSize * num);
+    array->num += num;
+
+    return JRET_OK;
+}
+
+
+int jarray_insert(JArray* array, unsigned int index, const void* element) {
+    if (index > array->num) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_OK != array_grow(array, 1)) {
+        return JRET_ERROR;
+    }
+
+    memmove(array_at(array, index + 1), array_at(array, index), (size_t) array->elementSize * (array->num - index));
+    memcpy(array_at(array, index), element, array->elementSize);
+    ++ array->num;
+
+    return JRET_OK;
+}
+
+
+int jarray_remove(JArray* array, unsigned int index) {
+    if (index >= array->num) {
+        return JRET_ERROR;
+    }
+
+    -- array->num;
+    memmove(array_at(array, index), array_at(array, index + 1), (size_t) array->elementSize * (array->num - index));
+
+    return JRET_OK;
+}
+
+
+int jarray_swap_remove(JArray* array, unsigned int index) {
+    if (index >= array->num) {
+        return JRET_ERROR;
+    }
+
+    -- array->num;
+    if (index != array->num) {
+        memcpy(array_at(array, index), array_at(array, array->num), array->elementSize);
+    }
+
+    return JRET_OK;
+}
+
+
+void jarray_clear(JArray* array) {
+    array->num = 0;
+}
+
+
+void* jarray_get(JArray* array, unsigned int index) {
+    if (index >= array->num) {
+        return JRET_PTR_NULL;
+    }
+
+    return array_at(array, index);
+}
+
+
+void* jarray_data(JArray* array) {
+    return array->data;
+}
+
+
+unsigned int jarray_num(JArray* array) {
+    return array->num;
+}
+
+
+unsigned int jarray_capacity(JArray* array) {
+    return array->capacity;
+}
+
+
+unsigned int jarray_find(JArray* array, const void* element, unsigned int from) {
+    unsigned int            i;
+
+    if (from >= array->num) {
+        return JARRAY_NOT_FOUND;
+    }
+
+#ifdef JARRAY_VECTOR_WIDTH
+    switch (array->elementSize) {
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+        return array_find_vector(array, element, from);
+    default:
+        break;
+    }
+#endif
+
+    for (i = from; i < array->num; ++i) {
+        if (0 == memcmp(array_at(array, i), element, array->elementSize)) {
+            return i;
+        }
+    }
+
+    return JARRAY_NOT_FOUND;
+}
+
+
+int jarray_equal(JArray* array1, JArray* array2) {
+    if (array1->elementSize != array2->elementSize || array1->num != array2->num) {
+        return 0;
+    }
+
+    if (0 == array1->num) {
+        return 1;
+    }
+
+    return 0 == memcmp(array1->data, array2->data, (size_t) array1->elementSize * array1->num);
+}
+
+
+void jarray_memory_stats(JArray* array, JMemoryStats* stats) {
+    if (JRET_PTR_NULL == stats) {
+        return;
+    }
+
+    *stats = array->memStats;
+    stats->wasted = (size_t) array->elementSize * (array->capacity - array->num);
+}
@@ -0,0 +1,246 @@
+#ifndef JARRAY_H
+#define JARRAY_H
+#include "jret.h"
+#include "jallocator.h"
+
+/**
+ *  动态数组
+ *
+ *  元素大小在创建时固定, 元素直接存放在一块连续内存中(不是指针数组)。
+ *  空间不够时按容量的百分比扩容(默认 50%, 即 1.5 倍), 均摊 O(1) 追加;
+ *  可以预留空间或把容量缩小到元素数。
+ *
+ *  删除有两种:
+ *      jarray_remove       --- 后面的元素前移, 保持顺序, O(n)
+ *      jarray_swap_remove  --- 用最后一个元素填补, 不保持顺序, O(1)
+ *
+ *  查找按字节比较整个元素(memcmp 语义), 适合整数、定长 key 这类没有填充字节的元素;
+ *  元素大小为 1、2、4、8 字节时用 SIMD(SSE2 一次 16 字节, AVX2 一次 32 字节)比较。
+ *
+ *  用法:
+ *      JArray* array = jarray_new(sizeof (int));
+ *      int v = 42;
+ *      jarray_append(array, &v);
+ *      int* data = jarray_data(array);         // 扩容后失效
+ *
+ *  注意：
+ *      不是线程安全的。
+ *      jarray_get、jarray_data 返回的指针在扩容、缩小后失效, 不要用它们作为追加、插入的元素。
+ *
+ *  调用：
+ *      jarray_new --- 创建
+ *      jarray_free --- 销毁
+ */
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 动态数组 */
+typedef struct _JArray JArray;
+
+/* 查找不到时返回的下标 */
+#define JARRAY_NOT_FOUND ((unsigned int) -1)
+
+
+/**
+ *  创建数组
+ *
+ *  @param elementSize      元素字节数
+ *
+ *  @return                 成功: 返回数组
+ *                          失败: 返回 RET_PTR_NULL (元素大小为 0 或内存不足)
+ */
+JArray* jarray_new(unsigned int elementSize);
+
+
+/**
+ *  使用指定的分配器创建数组, 元素数组通过它申请和扩容
+ *
+ *  @param elementSize      元素字节数
+ *  @param allocator        分配器, RET_PTR_NULL 表示默认分配器
+ *
+ *  @return                 成功: 返回数组
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JArray* jarray_new_with_allocator(unsigned int elementSize, const JAllocator* allocator);
+
+
+/**
+ *  销毁数组
+ *
+ *  @param array            数组
+ */
+void jarray_free(JArray* array);
+
+
+/**
+ *  设置扩容策略: 空间不够时容量增加 max(当前容量 * growthPercent / 100, minGrowth),
+ *  且至少能放下要追加的元素。默认 growthPercent 为 50, minGrowth 为 8
+ *
+ *  @param array            数组
+ *  @param growthPercent    按当前容量增加的百分比
+ *  @param minGrowth        每次至少增加的元素数
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (两个参数都为 0)
+ */
+int jarray_set_growth(JArray* array, unsigned int growthPercent, unsigned int minGrowth);
+
+
+/**
+ *  预留空间, 之后追加到 capacity 个元素之前不会再扩容
+ *
+ *  @param array            数组
+ *  @param capacity         容量, 不大于当前容量时什么也不做
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足, 数组不变)
+ */
+int jarray_reserve(JArray* array, unsigned int capacity);
+
+
+/**
+ *  把容量缩小到元素数, 释放多余的空间
+ *
+ *  @param array            数组
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足, 数组不变)
+ */
+int jarray_shrink(JArray* array);
+
+
+/**
+ *  在末尾追加一个元素
+ *
+ *  @param array            数组
+ *  @param element          元素, 复制 elementSize 字节
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足)
+ */
+int jarray_append(JArray* array, const void* element);
+
+
+/**
+ *  在末尾批量追加元素, 最多扩容一次
+ *
+ *  @param array            数组
+ *  @param elements         连续存放的 num 个元素, 不能指向数组自身
+ *  @param num              元素数
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足, 数组不变)
+ */
+int jarray_append_n(JArray* array, const void* elements, unsigned int num);
+
+
+/**
+ *  在 index 处插入元素, 后面的元素后移
+ *
+ *  @param array            数组
+ *  @param index            位置, 等于元素数时追加到末尾
+ *  @param element          元素
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (位置越界或内存不足)
+ */
+int jarray_insert(JArray* array, unsigned int index, const void* element);
+
+
+/**
+ *  删除 index 处的元素, 后面的元素前移, 保持顺序
+ *
+ *  @param array            数组
+ *  @param index            位置
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (位置越界)
+ */
+int jarray_remove(JArray* array, unsigned int index);
+
+
+/**
+ *  删除 index 处的元素, 用最后一个元素填补, 不保持顺序, O(1)
+ *
+ *  @param array            数组
+ *  @param index            位置
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (位置越界)
+ */
+int jarray_swap_remove(JArray* array, unsigned int index);
+
+
+/**
+ *  删除所有元素, 不释放空间
+ *
+ *  @param array            数组
+ */
+void jarray_clear(JArray* array);
+
+
+/**
+ *  第 index 个元素
+ *
+ *  @param array            数组
+ *  @param index            位置
+ *
+ *  @return                 成功: 返回元素的地址
+ *                          失败: 返回 RET_PTR_NULL (位置越界)
+ */
+void* jarray_get(JArray* array, unsigned int index);
+
+
+/**
+ *  元素数组
+ *
+ *  @param array            数组
+ *
+ *  @return                 元素数组, 没有申请过空间时为 RET_PTR_NULL
+ */
+void* jarray_data(JArray* array);
+
+
+/**
+ *  元素数和容量
+ */
+unsigned int jarray_num(JArray* array);
+unsigned int jarray_capacity(JArray* array);
+
+
+/**
+ *  从 from 开始顺序查找与 element 逐字节相等的第一个元素
+ *
+ *  @param array            数组
+ *  @param element          要查找的元素
+ *  @param from             开始的位置
+ *
+ *  @return                 找到: 返回下标
+ *                          没找到: 返回 JARRAY_NOT_FOUND
+ */
+unsigned int jarray_find(JArray* array, const void* element, unsigned int from);
+
+
+/**
+ *  两个数组的元素大小、元素数和内容是否都相同
+ *
+ *  @return                 相同返回 1, 否则返回 0
+ */
+int jarray_equal(JArray* array1, JArray* array2);
+
+
+/**
+ *  数组的内存统计, wasted 是预留但没有存放元素的空间
+ *
+ *  @param array            数组
+ *  @param stats            统计结果
+ */
+void jarray_memory_stats(JArray* array, JMemoryStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JARRAY_H
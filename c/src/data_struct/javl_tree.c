@@ -1,15 +1,8 @@
 #include "javl_tree.h"
+#include "jstats.h"
 #include <stdlib.h>
-
-
-/* AVL 平衡二叉树的节点 */
-struct _JAVLTreeNode {
-    JAVLTreeNode*           children[2];
-    JAVLTreeNode*           parent;
-    JAVLTreeKey             key;
-    JAVLTreeValue           value;
-    int                     height;
-};
+#include <string.h>
+#include <stdint.h>
 
 
 /* AVL 平衡二叉树 */
@@ -17,8 +10,29 @@ struct _JAVLTree {
     JAVLTreeNode*           rootNode;
     JAVLTreeCompareFunc     compareFunc;
     unsigned int            numNodes;
+    int                     intrusive;              // 节点是否由用户提供
+    int                     orderStatistics;        // 是否维护子树节点数
+    const JAllocator*       allocator;
+    JMemoryStats            memStats;
+#ifdef JDS_STATS
+    JAVLTreeStats           stats;
+#endif
 };
 
+/* 调用比较函数, 开启计数时记录次数 */
+static int avl_tree_compare(JAVLTree* tree, JAVLTreeKey key1, JAVLTreeKey key2) {
+    JSTATS_INC(tree->stats.comparisons);
+    return tree->compareFunc(key1, key2);
+}
+
+static JAVLTreeNode* avl_tree_node_alloc(JAVLTree* tree) {
+    return jallocator_alloc(tree->allocator, &tree->memStats, sizeof (JAVLTreeNode), sizeof (void*));
+}
+
+static void avl_tree_node_free(JAVLTree* tree, JAVLTreeNode* node) {
+    jallocator_free(tree->allocator, &tree->memStats, node, sizeof (JAVLTreeNode), sizeof (void*));
+}
+
 
 /* 递归删除子树节点(后序遍历) */
 static void avl_tree_subtree(JAVLTree* tree, JAVLTreeNode* node) {
@@ -28,11 +42,20 @@ static void avl_tree_subtree(JAVLTree* tree, JAVLTreeNode* node) {
 
     avl_tree_subtree(tree, node->children[JAVL_TREE_NODE_LEFT]);
     avl_tree_subtree(tree, node->children[JAVL_TREE_NODE_RIGHT]);
-    free(node);
+    avl_tree_node_free(tree, node);
+}
+
+/* 子树节点数, 只在开启顺序统计时有效 */
+static unsigned int avl_tree_subtree_size(JAVLTreeNode* node) {
+    if (JRET_PTR_NULL == node) {
+        return 0;
+    }
+
+    return node->size;
 }
 
 /* 更新子节点高度值 */
-static void avl_tree_update_height(JAVLTreeNode* node) {
+static void avl_tree_update_height(JAVLTree* tree, JAVLTreeNode* node) {
 
     JAVLTreeNode*            leftSubTree = JRET_PTR_NULL;
     JAVLTreeNode*            rightSubTree = JRET_PTR_NULL;
@@ -50,6 +73,11 @@ static void avl_tree_update_height(JAVLTreeNode* node) {
     } else {
         node->height = rightHeight + 1;
     }
+
+    /* 开启顺序统计时同时更新子树节点数 */
+    if (tree->orderStatistics) {
+        node->size = avl_tree_subtree_size(leftSubTree) + avl_tree_subtree_size(rightSubTree) + 1;
+    }
 }
 
 /* 节点相对于父节点的哪一边 */
@@ -78,7 +106,7 @@ static void avl_tree_node_replace(JAVLTree* tree, JAVLTreeNode* node1, JAVLTreeN
     } else {
         side = avl_tree_node_parent_sider(node1);   // node1 是左子树还是右子树
         node1->parent->children[side] = node2;      // node2 加入到 node1 父节点的子节点中
-        avl_tree_update_height(node1->parent);      // 更新子节点高度
+        avl_tree_update_height(tree, node1->parent);      // 更新子节点高度
     }
 }
 
@@ -106,6 +134,8 @@ static JAVLTreeNode *avl_tree_rotate(JAVLTree *tree, JAVLTreeNode *node, JAVLTre
 
     JAVLTreeNode                     *newRoot = JRET_PTR_NULL;
 
+    JSTATS_INC(tree->stats.rotations);
+
     /**
      * 针对如下失衡子树(括号里表示高度)
      *                  z (4)                               (3)  y
@@ -134,8 +164,8 @@ static JAVLTreeNode *avl_tree_rotate(JAVLTree *tree, JAVLTreeNode *node, JAVLTre
         node->children[1 - direction]->parent = node;
     }
 
-    avl_tree_update_height(newRoot);                                                    // 更新 y 及子节点高度
-    avl_tree_update_height(node);                                                       // 更新 z 及子节点高度
+    avl_tree_update_height(tree, node);                                                 // 先更新 z, 它现在是 y 的子节点
+    avl_tree_update_height(tree, newRoot);                                              // 再更新 y 及子节点高度
 
     return newRoot;
 }
@@ -181,7 +211,7 @@ static JAVLTreeNode *avl_tree_node_balance(JAVLTree *tree, JAVLTreeNode *node) {
         node = avl_tree_rotate(tree, node, JAVL_TREE_NODE_RIGHT);
     }
 
-    avl_tree_update_height(node);                                                       // 更新节点高度
+    avl_tree_update_height(tree, node);                                                       // 更新节点高度
 
     return node;
 }
@@ -189,45 +219,101 @@ static JAVLTreeNode *avl_tree_node_balance(JAVLTree *tree, JAVLTreeNode *node) {
 /* 从给定节点开始到跟节点, 针对需要执行旋转的子树进行旋转操作 */
 static void avl_tree_balance_to_root(JAVLTree *tree, JAVLTreeNode *node) {
     JAVLTreeNode *rover;
+    unsigned int levels = 0;
     rover = node;
     while (rover != JRET_PTR_NULL) {
         rover = avl_tree_node_balance(tree, rover);
         rover = rover->parent;
+        ++ levels;
     }
+
+    JSTATS_INC(tree->stats.rebalances);
+    JSTATS_ADD(tree->stats.rebalanceLevels, levels);
+    JSTATS_MAX(tree->stats.maxRebalanceLevels, levels);
 }
 
 
 /* 创建 */
 JAVLTree* avl_tree_new(JAVLTreeCompareFunc compare_func){
+    return avl_tree_new_with_allocator(compare_func, JRET_PTR_NULL);
+}
+
+JAVLTree* avl_tree_new_with_allocator(JAVLTreeCompareFunc compare_func, const JAllocator* allocator) {
     JAVLTree*                newTree = JRET_PTR_NULL;
+    JMemoryStats             memStats = { 0, 0, 0 };
+
+    if (JRET_PTR_NULL == allocator) {
+        allocator = jallocator_default();
+    }
 
-    newTree = (JAVLTree*)malloc(sizeof (JAVLTree));
+    newTree = jallocator_alloc(allocator, &memStats, sizeof (JAVLTree), sizeof (void*));
     if(JRET_PTR_NULL == newTree) {
         return JRET_PTR_NULL;
     }
+    newTree->allocator = allocator;
+    newTree->memStats = memStats;
     newTree->rootNode = JRET_PTR_NULL;
     newTree->compareFunc = compare_func;
     newTree->numNodes = 0;
+    newTree->intrusive = 0;
+    newTree->orderStatistics = 0;
+    avl_tree_reset_stats(newTree);
+
+    return newTree;
+}
+
+JAVLTree* avl_tree_new_intrusive(JAVLTreeCompareFunc compare_func) {
+    JAVLTree*                newTree = JRET_PTR_NULL;
+
+    newTree = avl_tree_new(compare_func);
+    if(JRET_PTR_NULL != newTree) {
+        newTree->intrusive = 1;
+    }
 
     return newTree;
 }
 
 
-/* 销毁 */
+/* 销毁, 分配器只能整体释放(arena)时不需要逐个释放节点 */
 void avl_tree_free(JAVLTree* tree) {
-    avl_tree_subtree(tree, tree->rootNode);
-    free(tree);
+    if (!tree->intrusive && JRET_PTR_NULL != tree->allocator->free) {
+        avl_tree_subtree(tree, tree->rootNode);
+    }
+    jallocator_free(tree->allocator, JRET_PTR_NULL, tree, sizeof (JAVLTree), sizeof (void*));
+}
+
+void avl_tree_memory_stats(JAVLTree* tree, JMemoryStats* stats) {
+    *stats = tree->memStats;
+    stats->wasted = 0;                                              // 每个节点单独申请, 没有预留空间
+}
+
+int avl_tree_get_stats(JAVLTree* tree, JAVLTreeStats* stats) {
+#ifdef JDS_STATS
+    *stats = tree->stats;
+    return JRET_OK;
+#else
+    (void) tree;
+    memset(stats, 0, sizeof (JAVLTreeStats));
+    return JRET_ERROR;
+#endif
+}
+
+void avl_tree_reset_stats(JAVLTree* tree) {
+#ifdef JDS_STATS
+    memset(&tree->stats, 0, sizeof (JAVLTreeStats));
+#else
+    (void) tree;
+#endif
 }
 
 
 /**
- *  插入 key value
+ *  把节点链接到树中
  *      1. 从根节点向下查找,找到叶子结点再插入
- *
+ *      2. 从插入位置向上重新平衡
  */
-JAVLTreeNode *avl_tree_insert(JAVLTree *tree, JAVLTreeKey key, JAVLTreeValue value) {
+static void avl_tree_link_node(JAVLTree *tree, JAVLTreeNode *newNode, JAVLTreeKey key, JAVLTreeValue value) {
     JAVLTreeNode **rover;
-    JAVLTreeNode *newNode;
     JAVLTreeNode *previousNode;
 
     rover = &tree->rootNode;
@@ -235,31 +321,303 @@ JAVLTreeNode *avl_tree_insert(JAVLTree *tree, JAVLTreeKey key, JAVLTreeValue val
 
     while (*rover != JRET_PTR_NULL) {
         previousNode = *rover;
-        if (tree->compareFunc(key, (*rover)->key) < 0) {
+        if (JRET_SMALLER == avl_tree_compare(tree, key, (*rover)->key)) {
             rover = &((*rover)->children[JAVL_TREE_NODE_LEFT]);
         } else {
             rover = &((*rover)->children[JAVL_TREE_NODE_RIGHT]);
         }
     }
 
-    newNode = (JAVLTreeNode *) malloc(sizeof(JAVLTreeNode));         // 找到叶子节点后根据 key value 创建新节点
-    if (JRET_PTR_NULL == newNode) {
-        return JRET_PTR_NULL;
-    }
-
     newNode->children[JAVL_TREE_NODE_LEFT] = JRET_PTR_NULL;
     newNode->children[JAVL_TREE_NODE_RIGHT] = JRET_PTR_NULL;
     newNode->parent = previousNode;                                 // 将新节点加入树中
     newNode->key = key;
     newNode->value = value;
     newNode->height = 1;                                            // 此时新节点变为了树的叶子节点
+    newNode->size = 1;
     *rover = newNode;                                               // 更新目前节点的指针 --- 为了向上更新高度
     avl_tree_balance_to_root(tree, previousNode);                   // 重新平衡二叉树
     ++ tree->numNodes;                                              // 树的节点加1
+}
+
+/* 插入 key value */
+JAVLTreeNode *avl_tree_insert(JAVLTree *tree, JAVLTreeKey key, JAVLTreeValue value) {
+    JAVLTreeNode *newNode;
+
+    if (tree->intrusive) {
+        return JRET_PTR_NULL;
+    }
+
+    newNode = avl_tree_node_alloc(tree);                            // 根据 key value 创建新节点
+    if (JRET_PTR_NULL == newNode) {
+        return JRET_PTR_NULL;
+    }
+    avl_tree_link_node(tree, newNode, key, value);
 
     return newNode;
 }
 
+/* 嵌入式插入, 节点由用户提供 */
+JAVLTreeNode *avl_tree_insert_intrusive(JAVLTree *tree, JAVLTreeNode *node, JAVLTreeKey key, JAVLTreeValue value) {
+    if (!tree->intrusive) {
+        return JRET_PTR_NULL;
+    }
+    avl_tree_link_node(tree, node, key, value);
+
+    return node;
+}
+
+/* 检查 key 是否从小到大有序 */
+static int avl_tree_keys_sorted(JAVLTree* tree, JAVLTreeKey* keys, unsigned int num) {
+    unsigned int i;
+
+    for (i = 1; i < num; ++i) {
+        if (JRET_SMALLER == avl_tree_compare(tree, keys[i], keys[i - 1])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* 为有序的 key 申请节点, 节点指针依次放入 nodes */
+static int avl_tree_alloc_nodes(JAVLTree* tree, JAVLTreeNode** nodes, JAVLTreeKey* keys, JAVLTreeValue* values, unsigned int num) {
+    unsigned int i;
+
+    for (i = 0; i < num; ++i) {
+        nodes[i] = avl_tree_node_alloc(tree);
+        if (JRET_PTR_NULL == nodes[i]) {
+            while (i > 0) {
+                avl_tree_node_free(tree, nodes[--i]);
+            }
+            return JRET_ERROR;
+        }
+        nodes[i]->key = keys[i];
+        nodes[i]->value = JRET_PTR_NULL == values ? JAVL_TREE_NULL : values[i];
+    }
+
+    return JRET_OK;
+}
+
+/**
+ *  由有序的节点数组 [lo, hi) 构建完全平衡的子树
+ *  每次取中间节点作为子树根节点, 左右子树节点数最多差 1, 高度最多差 1
+ */
+static JAVLTreeNode *avl_tree_build(JAVLTree *tree, JAVLTreeNode **nodes, unsigned int lo, unsigned int hi, JAVLTreeNode *parent) {
+    JAVLTreeNode *node;
+    unsigned int mid;
+
+    if (lo >= hi) {
+        return JRET_PTR_NULL;
+    }
+
+    mid = lo + (hi - lo) / 2;
+    node = nodes[mid];
+    node->parent = parent;
+    node->children[JAVL_TREE_NODE_LEFT] = avl_tree_build(tree, nodes, lo, mid, node);
+    node->children[JAVL_TREE_NODE_RIGHT] = avl_tree_build(tree, nodes, mid + 1, hi, node);
+    avl_tree_update_height(tree, node);
+
+    return node;
+}
+
+/* 子树中 key 最小(side 为左)或最大(side 为右)的节点 */
+static JAVLTreeNode *avl_tree_subtree_edge(JAVLTreeNode *node, JAVLTreeNodeSide side) {
+    while (node->children[side] != JRET_PTR_NULL) {
+        node = node->children[side];
+    }
+
+    return node;
+}
+
+/**
+ *  拼接两棵子树: left 中的 key <= node <= right 中的 key
+ *  沿较高子树靠内侧的边向下, 找到高度与较矮子树相当的位置放入 node,
+ *  再从该位置向上重新平衡, 结果成为树的根
+ */
+static void avl_tree_join(JAVLTree *tree, JAVLTreeNode *left, JAVLTreeNode *node, JAVLTreeNode *right) {
+    JAVLTreeNode *taller;
+    JAVLTreeNode *shorter;
+    JAVLTreeNode *rover;
+    JAVLTreeNode *previousNode = JRET_PTR_NULL;
+    JAVLTreeNodeSide side;
+    int leftHeight = avl_tree_subtree_height(left);
+    int rightHeight = avl_tree_subtree_height(right);
+    int shorterHeight;
+
+    if (leftHeight <= rightHeight + 1 && rightHeight <= leftHeight + 1) {   // 高度相当, node 直接作为根
+        node->children[JAVL_TREE_NODE_LEFT] = left;
+        node->children[JAVL_TREE_NODE_RIGHT] = right;
+        node->parent = JRET_PTR_NULL;
+        if (JRET_PTR_NULL != left) {
+            left->parent = node;
+        }
+        if (JRET_PTR_NULL != right) {
+            right->parent = node;
+        }
+        avl_tree_update_height(tree, node);
+        tree->rootNode = node;
+        return;
+    }
+
+    if (leftHeight > rightHeight) {                                         // 沿左子树的右边界向下
+        taller = left;
+        shorter = right;
+        shorterHeight = rightHeight;
+        side = JAVL_TREE_NODE_RIGHT;
+    } else {                                                                // 沿右子树的左边界向下
+        taller = right;
+        shorter = left;
+        shorterHeight = leftHeight;
+        side = JAVL_TREE_NODE_LEFT;
+    }
+
+    taller->parent = JRET_PTR_NULL;
+    tree->rootNode = taller;
+    rover = taller;
+    while (avl_tree_subtree_height(rover) > shorterHeight + 1) {
+        previousNode = rover;
+        rover = rover->children[side];
+    }
+
+    node->children[side] = shorter;
+    node->children[1 - side] = rover;
+    node->parent = previousNode;
+    previousNode->children[side] = node;
+    if (JRET_PTR_NULL != shorter) {
+        shorter->parent = node;
+    }
+    if (JRET_PTR_NULL != rover) {
+        rover->parent = node;
+    }
+    avl_tree_update_height(tree, node);
+    avl_tree_balance_to_root(tree, previousNode);
+}
+
+/* 把有序的新节点与树中已有节点归并, 再重建整棵树; key 相等时已有节点在前, 与逐个插入一致 */
+static int avl_tree_merge_rebuild(JAVLTree *tree, JAVLTreeNode **nodes, unsigned int num) {
+    JAVLTreeNode *node;
+    JAVLTreeNode **existing;
+    JAVLTreeNode **merged;
+    unsigned int total = tree->numNodes + num;
+    unsigned int i = 0, j = 0, k = 0;
+
+    existing = malloc(sizeof (JAVLTreeNode*) * tree->numNodes);
+    merged = malloc(sizeof (JAVLTreeNode*) * total);
+    if (JRET_PTR_NULL == existing || JRET_PTR_NULL == merged) {
+        free(existing);
+        free(merged);
+        return JRET_ERROR;
+    }
+
+    for (node = avl_tree_first(tree); node != JRET_PTR_NULL; node = avl_tree_next(node)) {
+        existing[i++] = node;
+    }
+    i = 0;
+    while (i < tree->numNodes && j < num) {
+        if (JRET_SMALLER == avl_tree_compare(tree, nodes[j]->key, existing[i]->key)) {
+            merged[k++] = nodes[j++];
+        } else {
+            merged[k++] = existing[i++];
+        }
+    }
+    while (i < tree->numNodes) {
+        merged[k++] = existing[i++];
+    }
+    while (j < num) {
+        merged[k++] = nodes[j++];
+    }
+
+    tree->rootNode = avl_tree_build(tree, merged, 0, total, JRET_PTR_NULL);
+    free(existing);
+    free(merged);
+
+    return JRET_OK;
+}
+
+JAVLTree* avl_tree_new_from_sorted(JAVLTreeKey* keys, JAVLTreeValue* values, unsigned int num, JAVLTreeCompareFunc compare_func) {
+    JAVLTree*                newTree = JRET_PTR_NULL;
+
+    newTree = avl_tree_new(compare_func);
+    if (JRET_PTR_NULL == newTree) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_OK != avl_tree_insert_sorted(newTree, keys, values, num)) {
+        avl_tree_free(newTree);
+        return JRET_PTR_NULL;
+    }
+
+    return newTree;
+}
+
+int avl_tree_insert_sorted(JAVLTree *tree, JAVLTreeKey *keys, JAVLTreeValue *values, unsigned int num) {
+    JAVLTreeNode **nodes;
+    JAVLTreeNode *root = tree->rootNode;
+    unsigned int total = tree->numNodes + num;
+    unsigned int logTotal = 1;
+    unsigned int i;
+    int appendRight = 0;
+    int appendLeft = 0;
+
+    if (tree->intrusive || !avl_tree_keys_sorted(tree, keys, num)) {
+        return JRET_ERROR;
+    }
+
+    if (0 == num) {
+        return JRET_OK;
+    }
+
+    while ((total >> logTotal) > 0) {
+        ++ logTotal;
+    }
+
+    /* key 相等时与逐个插入一致: 新 key 排在已有 key 的右边 */
+    if (JRET_PTR_NULL != root) {
+        appendRight = JRET_SMALLER != avl_tree_compare(tree, keys[0], avl_tree_subtree_edge(root, JAVL_TREE_NODE_RIGHT)->key);
+        appendLeft = JRET_SMALLER == avl_tree_compare(tree, keys[num - 1], avl_tree_subtree_edge(root, JAVL_TREE_NODE_LEFT)->key);
+    }
+
+    /* 先申请好所有节点再链接, 申请失败时树不变 */
+    nodes = malloc(sizeof (JAVLTreeNode*) * num);
+    if (JRET_PTR_NULL == nodes) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_OK != avl_tree_alloc_nodes(tree, nodes, keys, values, num)) {
+        free(nodes);
+        return JRET_ERROR;
+    }
+
+    /* 批量较小且与已有 key 交错: 逐个链接比重建整棵树便宜 */
+    if (JRET_PTR_NULL != root && !appendRight && !appendLeft && num * logTotal < tree->numNodes) {
+        for (i = 0; i < num; ++i) {
+            avl_tree_link_node(tree, nodes[i], nodes[i]->key, nodes[i]->value);
+        }
+        free(nodes);
+        return JRET_OK;
+    }
+
+    if (JRET_PTR_NULL == root) {                                                        // 空树: 直接构建
+        tree->rootNode = avl_tree_build(tree, nodes, 0, num, JRET_PTR_NULL);
+    } else if (appendRight) {
+        avl_tree_join(tree, root, nodes[0], avl_tree_build(tree, nodes, 1, num, JRET_PTR_NULL));           // 整批追加在右边
+    } else if (appendLeft) {
+        avl_tree_join(tree, avl_tree_build(tree, nodes, 0, num - 1, JRET_PTR_NULL), nodes[num - 1], root);  // 整批追加在左边
+    } else if (JRET_OK != avl_tree_merge_rebuild(tree, nodes, num)) {                   // 与已有节点归并后重建
+        for (i = 0; i < num; ++i) {
+            avl_tree_node_free(tree, nodes[i]);
+        }
+        free(nodes);
+        return JRET_ERROR;
+    }
+
+    tree->numNodes = total;
+    free(nodes);
+
+    return JRET_OK;
+}
+
 /**
  *  根据给定 node 查找树中最近的 node 节点并替代(旋转过程中的子树替换)
  *  没找到返回 NULL
@@ -295,7 +653,7 @@ static JAVLTreeNode *avl_tree_node_get_replacement(JAVLTree *tree, JAVLTreeNode
     }
     child = result->children[side];
     avl_tree_node_replace(tree, result, child);
-    avl_tree_update_height(result->parent);
+    avl_tree_update_height(tree, result->parent);
 
     return result;
 }
@@ -328,10 +686,13 @@ void avl_tree_remove_node(JAVLTree *tree, JAVLTreeNode *node) {
             }
         }
         swapNode->height = node->height;
+        swapNode->size = node->size;
         avl_tree_node_replace(tree, node, swapNode);
     }
 
-    free(node);
+    if (!tree->intrusive) {
+        avl_tree_node_free(tree, node);
+    }
     --tree->numNodes;
     avl_tree_balance_to_root(tree, balanceStartpoint);
 }
@@ -359,7 +720,7 @@ JAVLTreeNode *avl_tree_lookup_node(JAVLTree *tree, JAVLTreeKey key) {
 
     node = tree->rootNode;
     while (node != JRET_PTR_NULL) {
-        diff = tree->compareFunc(key, node->key);
+        diff = avl_tree_compare(tree, key, node->key);
         if (diff == JRET_EQUAL) {
             return node;
         } else if (diff == JRET_SMALLER) {
@@ -413,27 +774,110 @@ unsigned int avl_tree_num_entries(JAVLTree *tree) {
     return tree->numNodes;
 }
 
-static void avl_tree_to_array_add_subtree(JAVLTreeNode *subtree, JAVLTreeValue *array, int *index) {
-    if (subtree == JRET_PTR_NULL) {
-        return;
+JAVLTreeNode *avl_tree_first(JAVLTree *tree) {
+    if (JRET_PTR_NULL == tree->rootNode) {
+        return JRET_PTR_NULL;
     }
 
-    avl_tree_to_array_add_subtree(subtree->children[JAVL_TREE_NODE_LEFT], array, index);
-    array[*index] = subtree->key;
-    ++*index;
-    avl_tree_to_array_add_subtree(subtree->children[JAVL_TREE_NODE_RIGHT], array, index);
+    return avl_tree_subtree_edge(tree->rootNode, JAVL_TREE_NODE_LEFT);
 }
 
-/* 以后序遍历的方式把值copy到数组 */
+JAVLTreeNode *avl_tree_last(JAVLTree *tree) {
+    if (JRET_PTR_NULL == tree->rootNode) {
+        return JRET_PTR_NULL;
+    }
+
+    return avl_tree_subtree_edge(tree->rootNode, JAVL_TREE_NODE_RIGHT);
+}
+
+/**
+ *  中序遍历中 side 方向的相邻节点
+ *      有 side 子树: 该子树中离 node 最近的节点
+ *      没有: 向上找到第一个从 1 - side 方向进入的祖先
+ */
+static JAVLTreeNode *avl_tree_step(JAVLTreeNode *node, JAVLTreeNodeSide side) {
+    if (JRET_PTR_NULL != node->children[side]) {
+        return avl_tree_subtree_edge(node->children[side], 1 - side);
+    }
+
+    while (JRET_PTR_NULL != node->parent && node == node->parent->children[side]) {
+        node = node->parent;
+    }
+
+    return node->parent;
+}
+
+JAVLTreeNode *avl_tree_next(JAVLTreeNode *node) {
+    return avl_tree_step(node, JAVL_TREE_NODE_RIGHT);
+}
+
+JAVLTreeNode *avl_tree_prev(JAVLTreeNode *node) {
+    return avl_tree_step(node, JAVL_TREE_NODE_LEFT);
+}
+
+/**
+ *  从根向下查找第一个不在 key 左边的节点
+ *  inclusive 为真时 key 相等的节点也算(lower bound), 否则不算(upper bound)
+ */
+static JAVLTreeNode *avl_tree_bound(JAVLTree *tree, JAVLTreeKey key, int inclusive) {
+    JAVLTreeNode *node = tree->rootNode;
+    JAVLTreeNode *result = JRET_PTR_NULL;
+    int diff;
+
+    while (node != JRET_PTR_NULL) {
+        diff = avl_tree_compare(tree, node->key, key);
+        if (diff == JRET_BIGGER || (inclusive && diff == JRET_EQUAL)) {
+            result = node;
+            node = node->children[JAVL_TREE_NODE_LEFT];
+        } else {
+            node = node->children[JAVL_TREE_NODE_RIGHT];
+        }
+    }
+
+    return result;
+}
+
+JAVLTreeNode *avl_tree_lower_bound(JAVLTree *tree, JAVLTreeKey key) {
+    return avl_tree_bound(tree, key, 1);
+}
+
+JAVLTreeNode *avl_tree_upper_bound(JAVLTree *tree, JAVLTreeKey key) {
+    return avl_tree_bound(tree, key, 0);
+}
+
+unsigned int avl_tree_range(JAVLTree *tree, JAVLTreeKey lo, JAVLTreeKey hi, JAVLTreeRangeFunc func, void *data) {
+    JAVLTreeNode *node;
+    unsigned int num = 0;
+
+    for (node = avl_tree_lower_bound(tree, lo); node != JRET_PTR_NULL; node = avl_tree_next(node)) {
+        if (JRET_SMALLER != avl_tree_compare(tree, node->key, hi)) {
+            break;
+        }
+
+        ++ num;
+        if (JRET_OK != func(node, data)) {
+            break;
+        }
+    }
+
+    return num;
+}
+
+/* 按 key 的顺序把 key copy到数组 */
 JAVLTreeValue *avl_tree_to_array(JAVLTree *tree) {
     JAVLTreeValue *array;
-    int index = 0;
+    JAVLTreeNode *node;
+    unsigned int index = 0;
 
     array = malloc(sizeof(JAVLTreeValue) * tree->numNodes);
     if (array == JRET_PTR_NULL) {
         return JRET_PTR_NULL;
     }
-    avl_tree_to_array_add_subtree(tree->rootNode, array, &index);
+
+    for (node = avl_tree_first(tree); node != JRET_PTR_NULL; node = avl_tree_next(node)) {
+        array[index] = node->key;
+        ++ index;
+    }
 
     return array;
 }
@@ -471,3 +915,283 @@ void postorder_print_tree(JAVLTreeNode* node, tree_print_key print) {
     postorder_print_tree(node->children[JAVL_TREE_NODE_RIGHT], print);
     print(node->key);
 }
+
+
+/* 后序遍历计算子树节点数 */
+static unsigned int avl_tree_count_subtree(JAVLTreeNode *node) {
+    if (JRET_PTR_NULL == node) {
+        return 0;
+    }
+
+    node->size = avl_tree_count_subtree(node->children[JAVL_TREE_NODE_LEFT])
+        + avl_tree_count_subtree(node->children[JAVL_TREE_NODE_RIGHT]) + 1;
+
+    return node->size;
+}
+
+void avl_tree_enable_order_statistics(JAVLTree *tree) {
+    if (!tree->orderStatistics) {
+        avl_tree_count_subtree(tree->rootNode);
+        tree->orderStatistics = 1;
+    }
+}
+
+/**
+ *  顺序统计
+ *  开启后每个节点记录子树的节点数, 从根向下一次即可得到排名, O(log n);
+ *  未开启时用游标逐个计数, O(n)
+ */
+unsigned int avl_tree_rank(JAVLTree *tree, JAVLTreeKey key) {
+    JAVLTreeNode *node;
+    unsigned int rank = 0;
+
+    if (!tree->orderStatistics) {
+        for (node = avl_tree_first(tree); node != JRET_PTR_NULL
+                && JRET_SMALLER == avl_tree_compare(tree, node->key, key); node = avl_tree_next(node)) {
+            ++ rank;
+        }
+        return rank;
+    }
+
+    node = tree->rootNode;
+    while (node != JRET_PTR_NULL) {
+        if (JRET_SMALLER == avl_tree_compare(tree, node->key, key)) {                      // 左子树和当前节点都小于 key
+            rank += avl_tree_subtree_size(node->children[JAVL_TREE_NODE_LEFT]) + 1;
+            node = node->children[JAVL_TREE_NODE_RIGHT];
+        } else {
+            node = node->children[JAVL_TREE_NODE_LEFT];
+        }
+    }
+
+    return rank;
+}
+
+JAVLTreeNode *avl_tree_select(JAVLTree *tree, unsigned int index) {
+    JAVLTreeNode *node;
+    unsigned int leftSize;
+
+    if (index >= tree->numNodes) {
+        return JRET_PTR_NULL;
+    }
+
+    if (!tree->orderStatistics) {
+        for (node = avl_tree_first(tree); index > 0; -- index) {
+            node = avl_tree_next(node);
+        }
+        return node;
+    }
+
+    node = tree->rootNode;
+    for (;;) {
+        leftSize = avl_tree_subtree_size(node->children[JAVL_TREE_NODE_LEFT]);
+        if (index < leftSize) {
+            node = node->children[JAVL_TREE_NODE_LEFT];
+        } else if (index == leftSize) {
+            return node;
+        } else {
+            index -= leftSize + 1;
+            node = node->children[JAVL_TREE_NODE_RIGHT];
+        }
+    }
+}
+
+unsigned int avl_tree_count_range(JAVLTree *tree, JAVLTreeKey lo, JAVLTreeKey hi) {
+    unsigned int loRank = avl_tree_rank(tree, lo);
+    unsigned int hiRank = avl_tree_rank(tree, hi);
+
+    return hiRank > loRank ? hiRank - loRank : 0;
+}
+
+
+/*================================ 快照 ================================*/
+#define AVL_TREE_SNAPSHOT_MAGIC     "JAVLTREE"
+#define AVL_TREE_SAVE_BUFFER        (256)
+
+struct _JAVLTreeMapped {
+    JSnapshot               snapshot;
+    const uint64_t*         offsets;                // offsets[k] 是隐式树位置 k(从 1 开始)的记录位置
+    uint64_t                num;
+    JAVLTreeMappedCompareFunc compareFunc;
+};
+
+/* 隐式树中 key 最小的位置, 从根一直向左 */
+static uint64_t avl_tree_implicit_first(uint64_t num) {
+    uint64_t                k = 1;
+
+    while (2 * k <= num) {
+        k *= 2;
+    }
+
+    return num > 0 ? k : 0;
+}
+
+/* 隐式树中序的下一个位置, 没有时返回 0 */
+static uint64_t avl_tree_implicit_next(uint64_t k, uint64_t num) {
+    if (2 * k + 1 <= num) {                                         // 右子树的最左边
+        k = 2 * k + 1;
+        while (2 * k <= num) {
+            k *= 2;
+        }
+        return k;
+    }
+
+    return k >> (__builtin_ctzll(~k) + 1);                          // 向上直到从左孩子返回
+}
+
+/* 序列化位置 1..num 上的节点, 记录位置写入 offsets */
+static int avl_tree_save_records(JSnapshotWriter* writer, JAVLTreeNode** nodes, uint64_t* offsets, uint64_t num, JAVLTreeSaveFunc saveFunc) {
+    uint64_t                k;
+    size_t                  need;
+    void*                   buf;
+
+    for (k = 1; k <= num; ++k) {
+        buf = jsnapshot_writer_buffer(writer, AVL_TREE_SAVE_BUFFER);
+        if (JRET_PTR_NULL == buf) {
+            return JRET_ERROR;
+        }
+
+        need = saveFunc(nodes[k]->key, nodes[k]->value, buf, writer->bufSize);
+        if (need > writer->bufSize) {
+            buf = jsnapshot_writer_buffer(writer, need);
+            if (JRET_PTR_NULL == buf) {
+                return JRET_ERROR;
+            }
+            need = saveFunc(nodes[k]->key, nodes[k]->value, buf, need);
+        }
+
+        if (JRET_OK != jsnapshot_writer_record(writer, buf, need, &offsets[k])) {
+            return JRET_ERROR;
+        }
+    }
+
+    return JRET_OK;
+}
+
+int avl_tree_save(JAVLTree *tree, const char *path, JAVLTreeSaveFunc saveFunc) {
+    JSnapshotWriter         writer;
+    JSnapshotHeader         header;
+    JAVLTreeNode**          nodes = JRET_PTR_NULL;
+    uint64_t*               offsets = JRET_PTR_NULL;
+    JAVLTreeNode*           node;
+    uint64_t                num = tree->numNodes;
+    uint64_t                k;
+    int                     ret = JRET_ERROR;
+
+    nodes = malloc(sizeof (JAVLTreeNode*) * (num + 1));
+    offsets = calloc(num + 1, sizeof (uint64_t));
+    if (JRET_PTR_NULL == nodes || JRET_PTR_NULL == offsets) {
+        free(nodes);
+        free(offsets);
+        return JRET_ERROR;
+    }
+
+    /* 中序遍历树的同时中序遍历隐式树, 得到每个位置上的节点 */
+    for (node = avl_tree_first(tree), k = avl_tree_implicit_first(num); JRET_PTR_NULL != node; node = avl_tree_next(node)) {
+        nodes[k] = node;
+        k = avl_tree_implicit_next(k, num);
+    }
+
+    /* 记录也按隐式树的顺序写, 查找时先访问的记录在文件前面 */
+    if (JRET_OK == jsnapshot_writer_open(&writer, path, JSNAPSHOT_HEADER_SIZE + sizeof (uint64_t) * (num + 1))) {
+        if (JRET_OK == avl_tree_save_records(&writer, nodes, offsets, num, saveFunc)) {
+            memset(&header, 0, sizeof (header));
+            memcpy(header.magic, AVL_TREE_SNAPSHOT_MAGIC, sizeof (header.magic));
+            header.num = num;
+            header.capacity = num + 1;
+            ret = jsnapshot_writer_commit(&writer, &header, offsets, sizeof (uint64_t) * (num + 1));
+        } else {
+            jsnapshot_writer_abort(&writer);
+        }
+    }
+
+    free(nodes);
+    free(offsets);
+
+    return ret;
+}
+
+JAVLTreeMapped *avl_tree_open_mapped(const char *path, JAVLTreeMappedCompareFunc compareFunc) {
+    JAVLTreeMapped*         tree = JRET_PTR_NULL;
+    const JSnapshotHeader*  header;
+
+    tree = malloc(sizeof (JAVLTreeMapped));
+    if (JRET_PTR_NULL == tree) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_OK != jsnapshot_map(&tree->snapshot, path, AVL_TREE_SNAPSHOT_MAGIC)) {
+        free(tree);
+        return JRET_PTR_NULL;
+    }
+
+    header = tree->snapshot.header;
+    if (header->num >= UINT32_MAX || header->capacity != header->num + 1
+            || header->dataOffset - header->indexOffset < sizeof (uint64_t) * header->capacity) {
+        jsnapshot_unmap(&tree->snapshot);
+        free(tree);
+        return JRET_PTR_NULL;
+    }
+
+    tree->offsets = (const uint64_t*) (tree->snapshot.base + header->indexOffset);
+    tree->num = header->num;
+    tree->compareFunc = compareFunc;
+
+    return tree;
+}
+
+void avl_tree_mapped_close(JAVLTreeMapped *tree) {
+    jsnapshot_unmap(&tree->snapshot);
+    free(tree);
+}
+
+const void *avl_tree_mapped_lookup(JAVLTreeMapped *tree, JAVLTreeKey key, size_t *size) {
+    const void*             record;
+    size_t                  len;
+    uint64_t                k = 1;
+    int                     diff;
+
+    while (k <= tree->num) {
+        __builtin_prefetch(tree->offsets + 16 * k);                 // 4 层以后的位置, 一个缓存行放得下 8 个孩子
+        record = jsnapshot_record(&tree->snapshot, tree->offsets[k], &len);
+        if (JRET_PTR_NULL == record) {
+            return JRET_PTR_NULL;
+        }
+
+        diff = tree->compareFunc(key, record, len);
+        if (JRET_EQUAL == diff) {
+            if (JRET_PTR_NULL != size) {
+                *size = len;
+            }
+            return record;
+        }
+
+        k = 2 * k + (JRET_BIGGER == diff);
+    }
+
+    return JRET_PTR_NULL;
+}
+
+unsigned int avl_tree_mapped_foreach(JAVLTreeMapped *tree, JAVLTreeMappedFunc func, void *data) {
+    const void*             record;
+    size_t                  len;
+    unsigned int            count = 0;
+    uint64_t                k;
+
+    for (k = avl_tree_implicit_first(tree->num); k != 0; k = avl_tree_implicit_next(k, tree->num)) {
+        record = jsnapshot_record(&tree->snapshot, tree->offsets[k], &len);
+        if (JRET_PTR_NULL == record) {
+            break;
+        }
+
+        ++ count;
+        if (JRET_OK != func(record, len, data)) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+unsigned int avl_tree_mapped_num(JAVLTreeMapped *tree) {
+    return (unsigned int) tree->num;
+}
@@ -0,0 +1,654 @@
+#ifndef JAVL_TREE_H
+#define JAVL_TREE_H
+#include "jret.h"
+#include "jallocator.h"
+#include "jsnapshot.h"
+
+/**
+ *  平衡二叉树
+ *  AVL 是一种平衡二叉树，
+ *  树的每个节点都有一个 key 和与之对应的 value。
+ *  节点根据 key 的顺序排列。
+ *  即使修改输的节点，树依然保持平衡(树两边节点数量大致相等)
+ *
+ *  用途：
+ *      1. 用作映射 (用于搜索)
+ *      2. 总是有序的 key
+ *
+ *  调用：
+ *      avl_tree_new --- 创建
+ *      avl_tree_destroy --- 销毁
+ *
+ *  嵌入式(intrusive)用法：
+ *      用户把 JAVLTreeNode 放在自己的结构体中, 用 avl_tree_new_intrusive 创建树,
+ *      用 avl_tree_insert_intrusive 把节点链接进树, 插入和删除都不会申请/释放内存,
+ *      用 JAVL_TREE_ENTRY 从节点找回用户结构体。
+ *
+ *      struct session {
+ *          int             id;
+ *          JAVLTreeNode    node;
+ *      };
+ *
+ *      avl_tree_insert_intrusive(tree, &s->node, &s->id, s);
+ *      s = JAVL_TREE_ENTRY(avl_tree_lookup_node(tree, &id), struct session, node);
+ *
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* AVL 平衡二叉树 */
+typedef struct _JAVLTree JAVLTree;
+
+/* AVL 平衡二叉树的 key */
+typedef void* JAVLTreeKey;
+
+/* AVL 平衡二叉树的 value */
+typedef void* JAVLTreeValue;
+
+/* AVL 平衡二叉树 节点 */
+typedef struct _JAVLTreeNode JAVLTreeNode;
+
+/* AVL 平衡二叉树值为空 */
+#define JAVL_TREE_NULL JRET_PTR_NULL
+
+/* 可以有 左孩子 还是 右孩子 */
+typedef enum {
+  JAVL_TREE_NODE_LEFT = 0,
+  JAVL_TREE_NODE_RIGHT = 1
+} JAVLTreeNodeSide;
+
+/**
+ * AVL 平衡二叉树的节点
+ * 嵌入式用法时由用户嵌入自己的结构体中, 字段由树维护, 用户不要修改
+ */
+struct _JAVLTreeNode {
+    JAVLTreeNode*           children[2];
+    JAVLTreeNode*           parent;
+    JAVLTreeKey             key;
+    JAVLTreeValue           value;
+    int                     height;
+    unsigned int            size;                   // 子树节点数, 开启顺序统计后才维护
+};
+
+/* 树的内部计数, 编译时定义 JDS_STATS 才会计数(见 jstats.h) */
+typedef struct _JAVLTreeStats JAVLTreeStats;
+struct _JAVLTreeStats {
+    uint64_t                comparisons;            // 比较函数调用次数
+    uint64_t                rotations;              // 旋转次数, 双旋转算两次
+    uint64_t                rebalances;             // 插入、删除后向上重新平衡的次数
+    uint64_t                rebalanceLevels;        // 重新平衡经过的层数之和, 除以 rebalances 是平均深度
+    uint64_t                maxRebalanceLevels;     // 一次重新平衡经过的最多层数
+};
+
+/* 由嵌入的节点得到用户结构体 */
+#define JAVL_TREE_ENTRY(node, type, member) \
+    ((type*) ((char*) (node) - offsetof(type, member)))
+
+
+/**
+ * 打印树的 key 值 key
+ */
+typedef void (* tree_print_key)(JAVLTreeKey key);
+
+
+/**
+ *  范围遍历时对每个节点调用的函数
+ *
+ *  @param node             当前节点
+ *  @param data             用户数据
+ *
+ *  @return                 继续遍历返回 RET_OK, 返回其它值则停止遍历
+ */
+typedef int (*JAVLTreeRangeFunc)(JAVLTreeNode* node, void* data);
+
+
+/**
+ *  比较 AVL tree 节点 key 值的函数指针
+ *
+ *  @param value1           第一个key
+ *  @param value2           第二个key
+ *
+ *  @return                 value1 < value2     返回： RET_SMALLER
+ *                          value1 > value2     返回： RET_BIGGER
+ *                          value1 == value2    返回:  RET_EQUAL
+ */
+typedef int (*JAVLTreeCompareFunc)(JAVLTreeKey value1, JAVLTreeKey value2);
+
+
+/**
+ *  创建 AVL 树
+ *
+ *  @param tree             树，以便使用完后销毁
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JAVLTree* avl_tree_new(JAVLTreeCompareFunc compare_func);
+
+
+/**
+ *  创建嵌入式 AVL 树, 节点由用户提供
+ *  树不会申请或释放节点, 销毁树和删除节点都只是解除链接
+ *
+ *  @param compare_func     key 比较函数
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JAVLTree* avl_tree_new_intrusive(JAVLTreeCompareFunc compare_func);
+
+
+/**
+ *  使用指定分配器创建 AVL 树, 树结构和节点都从分配器申请
+ *  节点大小固定, 适合配合 JSlab 使用; 分配器是 arena 时销毁树不再逐个释放节点
+ *
+ *  @param compare_func     key 比较函数
+ *  @param allocator        分配器, RET_PTR_NULL 表示默认分配器; 必须比树活得长
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JAVLTree* avl_tree_new_with_allocator(JAVLTreeCompareFunc compare_func, const JAllocator* allocator);
+
+
+/**
+ *  由有序的 key 直接构建完全平衡的 AVL 树, O(n)
+ *  不做逐个插入的比较和旋转, 适合启动时加载大量已排序的数据
+ *
+ *  @param keys             从小到大排好序的 key 数组
+ *  @param values           与 key 一一对应的 value 数组, RET_PTR_NULL 表示 value 都为空
+ *  @param num              key 的数量
+ *  @param compare_func     key 比较函数
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL (内存不足或 key 无序)
+ */
+JAVLTree* avl_tree_new_from_sorted(JAVLTreeKey* keys, JAVLTreeValue* values, unsigned int num, JAVLTreeCompareFunc compare_func);
+
+
+/**
+ *  树的内存统计(树结构和节点), 节点按需申请, wasted 总是 0
+ *
+ *  @param tree             树
+ *  @param stats            统计结果
+ */
+void avl_tree_memory_stats(JAVLTree* tree, JMemoryStats* stats);
+
+
+/**
+ *  树的内部计数, 从创建或上次 avl_tree_reset_stats 开始累计
+ *
+ *  @param tree             树
+ *  @param stats            计数结果, 编译时没有开启计数则全为 0
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (编译时没有定义 JDS_STATS)
+ */
+int avl_tree_get_stats(JAVLTree* tree, JAVLTreeStats* stats);
+
+
+/**
+ *  计数清零
+ *
+ *  @param tree             树
+ */
+void avl_tree_reset_stats(JAVLTree* tree);
+
+
+/**
+ *  销毁 AVL 树
+ *
+ *  @param tree             树，要销毁
+ */
+void avl_tree_free(JAVLTree* tree);
+
+
+/**
+ *  插入一个 key-value 对
+ *
+ *  @param tree             树
+ *  @param key              要插入的 key
+ *  @value                  要插入的 value
+ *  @return                 成功：返回新树的Node
+ *                          失败：RET_PTR_NULL 注意：就算失败也不会内存泄漏
+ *                          嵌入式树请使用 avl_tree_insert_intrusive, 这里会返回 RET_PTR_NULL
+ */
+JAVLTreeNode* avl_tree_insert(JAVLTree* tree, JAVLTreeKey key, JAVLTreeValue value);
+
+
+/**
+ *  把用户提供的节点链接进嵌入式树
+ *
+ *  @param tree             由 avl_tree_new_intrusive 创建的树
+ *  @param node             用户结构体中嵌入的节点, 不能已经在树中
+ *  @param key              节点的 key, 通常指向用户结构体中的字段
+ *  @param value            节点的 value
+ *  @return                 成功：返回 node
+ *                          失败：RET_PTR_NULL (树不是嵌入式树)
+ */
+JAVLTreeNode* avl_tree_insert_intrusive(JAVLTree* tree, JAVLTreeNode* node, JAVLTreeKey key, JAVLTreeValue value);
+
+
+/**
+ *  批量插入一批有序的 key
+ *      整批都大于(或小于)树中已有的 key 时, 把这一批构建成平衡子树后拼接到树上, O(num + log n)
+ *      批量较大时, 与已有节点归并后重新构建整棵树, O(n + num), 不重新申请已有节点
+ *      批量较小时, 逐个链接
+ *      所有节点在链接之前一次申请好, 内存不足时不插入任何 key, 树不变
+ *
+ *  @param tree             树, 不能是嵌入式树
+ *  @param keys             从小到大排好序的 key 数组
+ *  @param values           与 key 一一对应的 value 数组, RET_PTR_NULL 表示 value 都为空
+ *  @param num              key 的数量
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (内存不足、key 无序或嵌入式树), 树不变
+ */
+int avl_tree_insert_sorted(JAVLTree* tree, JAVLTreeKey* keys, JAVLTreeValue* values, unsigned int num);
+
+
+/**
+ *  删除树的一个节点
+ *  嵌入式树只解除节点的链接, 节点内存仍归用户所有
+ *
+ *  @param tree             树
+ *  @param node             要删除的节点
+ */
+void avl_tree_remove_node(JAVLTree* tree, JAVLTreeNode* node);
+
+
+/**
+ *  根据 key 删除一个节点
+ *
+ *  @param tree             树
+ *  @param key              要删除节点的 key
+ *
+ *  @return                 若删除则为   返回 RET_OK
+ *                          没找到则为   返回 RET_NOTFOUND
+ */
+int avl_tree_remove(JAVLTree* tree, JAVLTreeKey key);
+
+
+/**
+ * 根据 key 查询 AVL 树，相当于查询一个映射
+ *
+ * @param tree            树
+ * @param key             要查询的key
+ *
+ * @return                成功：返回找到的节点
+ *                        失败：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_lookup_node(JAVLTree *tree, JAVLTreeKey key);
+
+
+/**
+ *  根据 key 查询 AVL 树， 返回找到的值
+ *
+ * @param tree            树
+ * @param key             要查询的key
+ *
+ * @return                成功：返回找到的值
+ *                        失败：返回 AVL_PTR_NULL
+ */
+JAVLTreeValue avl_tree_lookup(JAVLTree *tree, JAVLTreeKey key);
+
+
+/**
+ * 查找树的根节点
+ *
+ * @param tree            树
+ * @return                成功：返回树的根节点
+ *                        失败：RET_PTR_NULL
+ */
+JAVLTreeNode* avl_tree_root_node(JAVLTree *tree);
+
+
+/**
+ * 检索给定树节点的键
+ *
+ * @param node            树
+ * @return                返回给定节点的键
+ */
+JAVLTreeKey avl_tree_node_key(JAVLTreeNode *node);
+
+
+/**
+ * 检索给定树节点的值
+ *
+ * @param node            树
+ * @return                返回给定节点的值
+ */
+JAVLTreeValue avl_tree_node_value(JAVLTreeNode *node);
+
+
+/**
+ * 查询给定树节点的子节点
+ *
+ * @param node            树节点
+ * @param side            左边或右边
+ * @return                成功：返回子节点
+ *
+ *                        失败：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_node_child(JAVLTreeNode *node, JAVLTreeNodeSide side);
+
+
+/**
+ * 返回树节点的 父节点
+ *
+ * @param node            树节点
+ * @return                成功：返回树节点的父节点
+ *                        失败：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_node_parent(JAVLTreeNode *node);
+
+
+/**
+ * 求字数的高度
+ *
+ * @param node            子树的根节点
+ *
+ * @return                子树的高度
+ */
+int avl_tree_subtree_height(JAVLTreeNode* node);
+
+
+/**
+ * 游标
+ * 借助节点的 parent 指针在树中按 key 的顺序移动, 不递归、不申请内存,
+ * 每步均摊 O(1)。遍历过程中不能修改树(删除当前节点前要先取得下一个节点)。
+ *
+ *      for (node = avl_tree_first(tree); node; node = avl_tree_next(node)) { ... }
+ */
+
+/**
+ * key 最小的节点
+ *
+ * @param tree            树
+ * @return                成功：返回节点
+ *                        空树：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_first(JAVLTree *tree);
+
+
+/**
+ * key 最大的节点
+ *
+ * @param tree            树
+ * @return                成功：返回节点
+ *                        空树：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_last(JAVLTree *tree);
+
+
+/**
+ * 按 key 的顺序的下一个节点
+ *
+ * @param node            当前节点
+ * @return                成功：返回下一个节点
+ *                        已经是最后一个节点：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_next(JAVLTreeNode *node);
+
+
+/**
+ * 按 key 的顺序的上一个节点
+ *
+ * @param node            当前节点
+ * @return                成功：返回上一个节点
+ *                        已经是第一个节点：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_prev(JAVLTreeNode *node);
+
+
+/**
+ * 第一个 key 大于等于给定 key 的节点
+ *
+ * @param tree            树
+ * @param key             要查找的 key
+ * @return                成功：返回节点
+ *                        所有 key 都小于给定 key：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_lower_bound(JAVLTree *tree, JAVLTreeKey key);
+
+
+/**
+ * 第一个 key 大于给定 key 的节点
+ *
+ * @param tree            树
+ * @param key             要查找的 key
+ * @return                成功：返回节点
+ *                        所有 key 都小于等于给定 key：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_upper_bound(JAVLTree *tree, JAVLTreeKey key);
+
+
+/**
+ * 按 key 的顺序遍历 [lo, hi) 内的节点, O(log n + k)
+ *
+ * @param tree            树
+ * @param lo              范围下界(包含)
+ * @param hi              范围上界(不包含)
+ * @param func            对每个节点调用的函数, 返回非 RET_OK 时提前结束
+ * @param data            传给 func 的用户数据
+ *
+ * @return                访问过的节点数
+ */
+unsigned int avl_tree_range(JAVLTree *tree, JAVLTreeKey lo, JAVLTreeKey hi, JAVLTreeRangeFunc func, void *data);
+
+
+/**
+ * 顺序统计
+ * 开启后每个节点额外维护子树节点数(放在节点原有的对齐空隙中, 不增加内存),
+ * 随插入、删除和旋转一起更新, 排名、第 k 小和范围计数都是 O(log n)。
+ * 未开启时这些函数仍然可用, 但需要 O(n) 逐个计数。
+ */
+
+/**
+ * 开启顺序统计, 树非空时会先计算一遍所有子树的节点数 O(n)
+ *
+ * @param tree            树
+ */
+void avl_tree_enable_order_statistics(JAVLTree *tree);
+
+
+/**
+ * key 的排名: 树中小于给定 key 的节点数
+ *
+ * @param tree            树
+ * @param key             key
+ * @return                小于 key 的节点数
+ */
+unsigned int avl_tree_rank(JAVLTree *tree, JAVLTreeKey key);
+
+
+/**
+ * 第 index 小的节点(从 0 开始), 可用来求百分位数
+ *
+ * @param tree            树
+ * @param index           序号
+ * @return                成功：返回节点
+ *                        index 超出节点数：返回 RET_PTR_NULL
+ */
+JAVLTreeNode *avl_tree_select(JAVLTree *tree, unsigned int index);
+
+
+/**
+ * key 在 [lo, hi) 内的节点数
+ *
+ * @param tree            树
+ * @param lo              范围下界(包含)
+ * @param hi              范围上界(不包含)
+ * @return                节点数
+ */
+unsigned int avl_tree_count_range(JAVLTree *tree, JAVLTreeKey lo, JAVLTreeKey hi);
+
+
+/**
+ * 将数的 key 转换为 C 数组，这将数作为有序集合使用
+ *
+ * @param tree            树
+ *
+ * @return                返回由键组成的数组
+ */
+JAVLTreeValue *avl_tree_to_array(JAVLTree *tree);
+
+
+/**
+ * 检索树的节点数
+ *
+ * @param tree            树
+ *
+ * @return                树的节点数
+ */
+unsigned int avl_tree_num_entries(JAVLTree *tree);
+
+/**
+ * 树的前序遍历
+ */
+void before_print_tree(JAVLTreeNode* node, tree_print_key print);
+
+
+/**
+ *  树的中序遍历
+ */
+void middle_print_tree(JAVLTreeNode* node, tree_print_key print);
+
+
+/**
+ *  树的后序遍历
+ */
+void postorder_print_tree(JAVLTreeNode* node, tree_print_key print);
+
+
+/**
+ *  快照(见 jsnapshot.h)
+ *
+ *  avl_tree_save 把树写成不含指针的文件: 记录按 key 排好序后以隐式树(Eytzinger)布局存放,
+ *  位置 k 的孩子是 2k 和 2k + 1, 靠近根的记录集中在文件开头几页。
+ *  avl_tree_open_mapped 只读映射后直接在文件上查找, 不需要重建树, 只读入访问到的页。
+ *  映射的树只读, 查找不需要加锁, 多个线程可以同时使用。
+ *
+ *  用法(key 是字符串, value 是 uint64_t*):
+ *      size_t save(JAVLTreeKey key, JAVLTreeValue value, void* buf, size_t size) {
+ *          size_t len = strlen(key);
+ *          if (size >= 8 + len) {
+ *              memcpy(buf, value, 8);
+ *              memcpy((char*) buf + 8, key, len);
+ *          }
+ *          return 8 + len;
+ *      }
+ *      int compare(JAVLTreeKey key, const void* record, size_t size) {
+ *          // 比较 key 和 record + 8 开始的 size - 8 个字节
+ *      }
+ *
+ *      avl_tree_save(tree, "users.snap", save);
+ *      mapped = avl_tree_open_mapped("users.snap", compare);
+ *      record = avl_tree_mapped_lookup(mapped, "alice", &size);
+ */
+
+/* 映射的只读树 */
+typedef struct _JAVLTreeMapped JAVLTreeMapped;
+
+/**
+ *  把节点序列化到 buf
+ *
+ *  @param key              节点的 key
+ *  @param value            节点的 value
+ *  @param buf              缓冲区, 按 8 字节对齐
+ *  @param size             缓冲区大小
+ *
+ *  @return                 序列化需要的字节数; 大于 size 时不要写入, 会换成足够大的缓冲区再调用一次
+ */
+typedef size_t (*JAVLTreeSaveFunc)(JAVLTreeKey key, JAVLTreeValue value, void* buf, size_t size);
+
+/**
+ *  比较 key 和序列化的记录, 顺序必须与保存时树的比较函数一致
+ *
+ *  @param key              要查找的 key
+ *  @param record           记录, 按 8 字节对齐
+ *  @param size             记录的字节数
+ *
+ *  @return                 key < 记录     返回： RET_SMALLER
+ *                          key > 记录     返回： RET_BIGGER
+ *                          key == 记录    返回:  RET_EQUAL
+ */
+typedef int (*JAVLTreeMappedCompareFunc)(JAVLTreeKey key, const void* record, size_t size);
+
+/**
+ *  遍历映射的树时对每条记录调用的函数
+ *
+ *  @return                 继续遍历返回 RET_OK, 返回其它值则停止遍历
+ */
+typedef int (*JAVLTreeMappedFunc)(const void* record, size_t size, void* data);
+
+
+/**
+ *  把树保存为快照文件, 覆盖已有的文件(先写临时文件再改名, 失败时旧文件不变)
+ *
+ *  @param tree             树
+ *  @param path             文件名
+ *  @param saveFunc         序列化函数
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (内存不足或写文件失败)
+ */
+int avl_tree_save(JAVLTree* tree, const char* path, JAVLTreeSaveFunc saveFunc);
+
+
+/**
+ *  只读映射快照文件
+ *
+ *  @param path             文件名
+ *  @param compareFunc      比较函数
+ *
+ *  @return                 成功：返回映射的树
+ *                          失败：返回 RET_PTR_NULL (文件不存在、不是树的快照或已损坏)
+ */
+JAVLTreeMapped* avl_tree_open_mapped(const char* path, JAVLTreeMappedCompareFunc compareFunc);
+
+
+/**
+ *  解除映射, 之前查找得到的记录都不能再访问
+ *
+ *  @param tree             映射的树
+ */
+void avl_tree_mapped_close(JAVLTreeMapped* tree);
+
+
+/**
+ *  查找 key, O(log n); 有重复的 key 时返回其中一条
+ *
+ *  @param tree             映射的树
+ *  @param key              要查找的 key
+ *  @param size             返回记录的字节数, 可以为 RET_PTR_NULL
+ *
+ *  @return                 找到：返回记录(指向映射的文件, 只读)
+ *                          没找到：返回 RET_PTR_NULL
+ */
+const void* avl_tree_mapped_lookup(JAVLTreeMapped* tree, JAVLTreeKey key, size_t* size);
+
+
+/**
+ *  按 key 从小到大遍历记录
+ *
+ *  @param tree             映射的树
+ *  @param func             对每条记录调用的函数
+ *  @param data             用户数据
+ *
+ *  @return                 访问的记录数
+ */
+unsigned int avl_tree_mapped_foreach(JAVLTreeMapped* tree, JAVLTreeMappedFunc func, void* data);
+
+
+/**
+ *  记录数
+ *
+ *  @param tree             映射的树
+ *
+ *  @return                 记录数
+ */
+unsigned int avl_tree_mapped_num(JAVLTreeMapped* tree);
+#ifdef __cplusplus
+}
+#endif
+#endif // AVL_TREE_H
@@ -0,0 +1,475 @@
+#ifndef JAVL_TREE_HPP
+#define JAVL_TREE_HPP
+
+/**
+ *  AVL 树有序映射的 C++ 模板版本 (C++11, 只有头文件)
+ *
+ *  算法与 javl_tree.c 相同: 节点带父指针和高度, 插入后从插入位置向上逐个重新平衡,
+ *  删除时用较高子树中最靠近的节点替换被删节点; 拷贝时用有序节点数组直接建成完全平衡的树。
+ *  与 C 版本的不同:
+ *      key 和 value 按值存放在节点中, 不需要 void* 和额外的内存;
+ *      比较器是函数对象, 可以内联, 不经过函数指针;
+ *      key 唯一(与 std::map 相同), 插入已存在的 key 不会改变原来的值;
+ *      支持只能移动的类型, emplace/try_emplace 直接在节点中构造。
+ *
+ *  用法:
+ *      jds::avl_map<int, std::string> m;
+ *      m.emplace(1, "one");
+ *      m[2] = "two";
+ *      for (auto& kv : m) { ... }                          // 按 key 从小到大
+ */
+#include <functional>
+#include <utility>
+#include <tuple>
+#include <type_traits>
+#include <iterator>
+#include <vector>
+#include <cstddef>
+
+namespace jds {
+
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class avl_map {
+public:
+    typedef Key                                 key_type;
+    typedef Value                               mapped_type;
+    typedef std::pair<const Key, Value>         value_type;
+    typedef std::size_t                         size_type;
+    typedef Compare                             key_compare;
+
+private:
+    enum { LEFT = 0, RIGHT = 1 };
+
+    struct node {
+        node*                   children[2];
+        node*                   parent;
+        int                     height;
+        value_type              kv;
+
+        template <typename... Args>
+        explicit node(Args&&... args) : parent(nullptr), height(1), kv(std::forward<Args>(args)...) {
+            children[LEFT] = children[RIGHT] = nullptr;
+        }
+    };
+
+    /* 迭代器, end() 的节点为空, 从 end() 后退时需要通过树找到最后一个节点 */
+    template <bool Const>
+    class basic_iterator {
+        friend class avl_map;
+        typedef typename std::conditional<Const, const avl_map, avl_map>::type  map_type;
+
+    public:
+        typedef std::bidirectional_iterator_tag                                 iterator_category;
+        typedef typename avl_map::value_type                                    value_type;
+        typedef std::ptrdiff_t                                                  difference_type;
+        typedef typename std::conditional<Const, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<Const, const value_type&, value_type&>::type reference;
+
+        basic_iterator() : mNode(nullptr), mMap(nullptr) {}
+        basic_iterator(const basic_iterator<false>& other) : mNode(other.mNode), mMap(other.mMap) {}
+
+        reference operator*() const { return mNode->kv;}
+        pointer operator->() const { return &mNode->kv;}
+
+        basic_iterator& operator++() { mNode = step(mNode, RIGHT); return *this;}
+        basic_iterator& operator--() {
+            mNode = nullptr == mNode ? edge(mMap->mRoot, RIGHT) : step(mNode, LEFT);
+            return *this;
+        }
+        basic_iterator operator++(int) { basic_iterator old = *this; ++*this; return old;}
+        basic_iterator operator--(int) { basic_iterator old = *this; --*this; return old;}
+
+        bool operator==(const basic_iterator& other) const { return mNode == other.mNode;}
+        bool operator!=(const basic_iterator& other) const { return mNode != other.mNode;}
+
+    private:
+        basic_iterator(node* n, map_type* m) : mNode(n), mMap(m) {}
+
+        node*                   mNode;
+        map_type*               mMap;
+
+        friend class basic_iterator<!Const>;
+    };
+
+public:
+    typedef basic_iterator<false>               iterator;
+    typedef basic_iterator<true>                const_iterator;
+
+    explicit avl_map(const Compare& compare = Compare()) : mRoot(nullptr), mSize(0), mCompare(compare) {}
+
+    /* 拷贝: 按顺序复制节点后直接建成完全平衡的树, 与 avl_tree_new_from_sorted 相同 */
+    avl_map(const avl_map& other) : mRoot(nullptr), mSize(0), mCompare(other.mCompare) {
+        std::vector<node*>      nodes;
+
+        nodes.reserve(other.mSize);
+        try {
+            for (const_iterator it = other.begin(); it != other.end(); ++it) {
+                nodes.push_back(new node(*it));
+            }
+        } catch (...) {
+            for (size_type i = 0; i < nodes.size(); ++i) {
+                delete nodes[i];
+            }
+            throw;
+        }
+        mRoot = build(nodes, 0, nodes.size(), nullptr);
+        mSize = nodes.size();
+    }
+
+    avl_map(avl_map&& other) : mRoot(other.mRoot), mSize(other.mSize), mCompare(std::move(other.mCompare)) {
+        other.mRoot = nullptr;
+        other.mSize = 0;
+    }
+
+    avl_map& operator=(avl_map other) {
+        swap(other);
+        return *this;
+    }
+
+    ~avl_map() { destroy(mRoot);}
+
+    void swap(avl_map& other) {
+        std::swap(mRoot, other.mRoot);
+        std::swap(mSize, other.mSize);
+        std::swap(mCompare, other.mCompare);
+    }
+
+    bool empty() const { return 0 == mSize;}
+    size_type size() const { return mSize;}
+
+    void clear() {
+        destroy(mRoot);
+        mRoot = nullptr;
+        mSize = 0;
+    }
+
+    iterator begin() { return iterator(edge(mRoot, LEFT), this);}
+    iterator end() { return iterator(nullptr, this);}
+    const_iterator begin() const { return const_iterator(edge(mRoot, LEFT), this);}
+    const_iterator end() const { return const_iterator(nullptr, this);}
+
+    /**
+     *  先构造节点再查找插入位置, key 已存在或比较函数抛出异常时销毁新节点
+     *
+     *  @return                 (指向 key 所在节点的迭代器, 是否插入了新节点)
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        node*                   newNode = new node(std::forward<Args>(args)...);
+        node**                  rover;
+        node*                   previousNode;
+        node*                   existing;
+
+        try {
+            existing = find_link(newNode->kv.first, rover, previousNode);
+        } catch (...) {
+            delete newNode;
+            throw;
+        }
+
+        if (nullptr != existing) {
+            delete newNode;
+            return std::make_pair(iterator(existing, this), false);
+        }
+        attach(rover, previousNode, newNode);
+
+        return std::make_pair(iterator(newNode, this), true);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& kv) { return emplace(kv);}
+    std::pair<iterator, bool> insert(value_type&& kv) { return emplace(std::move(kv));}
+
+    /* key 不存在时才构造节点, value 由 args 构造 */
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        node**                  rover;
+        node*                   previousNode;
+        node*                   n = find_link(key, rover, previousNode);
+
+        if (nullptr != n) {
+            return std::make_pair(iterator(n, this), false);
+        }
+        n = new node(std::piecewise_construct,
+                     std::forward_as_tuple(std::forward<K>(key)),
+                     std::forward_as_tuple(std::forward<Args>(args)...));
+        attach(rover, previousNode, n);
+
+        return std::make_pair(iterator(n, this), true);
+    }
+
+    Value& operator[](const Key& key) { return try_emplace(key).first->second;}
+    Value& operator[](Key&& key) { return try_emplace(std::move(key)).first->second;}
+
+    iterator find(const Key& key) { return iterator(lookup(key), this);}
+    const_iterator find(const Key& key) const { return const_iterator(lookup(key), this);}
+    size_type count(const Key& key) const { return nullptr == lookup(key) ? 0 : 1;}
+
+    /* 第一个不小于 key 的位置 */
+    iterator lower_bound(const Key& key) { return iterator(bound(key, true), this);}
+    const_iterator lower_bound(const Key& key) const { return const_iterator(bound(key, true), this);}
+
+    /* 第一个大于 key 的位置 */
+    iterator upper_bound(const Key& key) { return iterator(bound(key, false), this);}
+    const_iterator upper_bound(const Key& key) const { return const_iterator(bound(key, false), this);}
+
+    /* 删除迭代器指向的节点, 返回下一个位置 */
+    iterator erase(const_iterator pos) {
+        node*                   next = step(pos.mNode, RIGHT);
+
+        remove_node(pos.mNode);
+        return iterator(next, this);
+    }
+
+    size_type erase(const Key& key) {
+        node*                   n = lookup(key);
+
+        if (nullptr == n) {
+            return 0;
+        }
+        remove_node(n);
+
+        return 1;
+    }
+
+private:
+    static int height(const node* n) { return nullptr == n ? 0 : n->height;}
+
+    static void destroy(node* n) {
+        if (nullptr == n) {
+            return;
+        }
+        destroy(n->children[LEFT]);
+        destroy(n->children[RIGHT]);
+        delete n;
+    }
+
+    /* 子树中 key 最小(side 为左)或最大(side 为右)的节点 */
+    static node* edge(node* n, int side) {
+        if (nullptr == n) {
+            return nullptr;
+        }
+        while (nullptr != n->children[side]) {
+            n = n->children[side];
+        }
+
+        return n;
+    }
+
+    /* 中序遍历中 side 方向的相邻节点 */
+    static node* step(node* n, int side) {
+        if (nullptr != n->children[side]) {
+            return edge(n->children[side], 1 - side);
+        }
+        while (nullptr != n->parent && n == n->parent->children[side]) {
+            n = n->parent;
+        }
+
+        return n->parent;
+    }
+
+    static void update_height(node* n) {
+        int                     leftHeight = height(n->children[LEFT]);
+        int                     rightHeight = height(n->children[RIGHT]);
+
+        n->height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+    }
+
+    static int parent_side(const node* n) { return n == n->parent->children[LEFT] ? LEFT : RIGHT;}
+
+    /* 由有序的节点数组 [lo, hi) 构建完全平衡的子树 */
+    static node* build(std::vector<node*>& nodes, size_type lo, size_type hi, node* parent) {
+        node*                   n;
+        size_type               mid;
+
+        if (lo >= hi) {
+            return nullptr;
+        }
+
+        mid = lo + (hi - lo) / 2;
+        n = nodes[mid];
+        n->parent = parent;
+        n->children[LEFT] = build(nodes, lo, mid, n);
+        n->children[RIGHT] = build(nodes, mid + 1, hi, n);
+        update_height(n);
+
+        return n;
+    }
+
+    node* lookup(const Key& key) const {
+        node*                   n = mRoot;
+
+        while (nullptr != n) {
+            if (mCompare(key, n->kv.first)) {
+                n = n->children[LEFT];
+            } else if (mCompare(n->kv.first, key)) {
+                n = n->children[RIGHT];
+            } else {
+                return n;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /* 从根向下查找第一个不在 key 左边的节点, inclusive 为真时 key 相等的节点也算 */
+    node* bound(const Key& key, bool inclusive) const {
+        node*                   n = mRoot;
+        node*                   result = nullptr;
+
+        while (nullptr != n) {
+            if (inclusive ? !mCompare(n->kv.first, key) : mCompare(key, n->kv.first)) {
+                result = n;
+                n = n->children[LEFT];
+            } else {
+                n = n->children[RIGHT];
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     *  从根向下查找 key 的插入位置
+     *  key 已存在返回已有节点; 否则返回空, rover 指向要放新节点的指针, previousNode 是它的父节点
+     */
+    node* find_link(const Key& key, node**& rover, node*& previousNode) {
+        rover = &mRoot;
+        previousNode = nullptr;
+
+        while (nullptr != *rover) {
+            previousNode = *rover;
+            if (mCompare(key, (*rover)->kv.first)) {
+                rover = &(*rover)->children[LEFT];
+            } else if (mCompare((*rover)->kv.first, key)) {
+                rover = &(*rover)->children[RIGHT];
+            } else {
+                return *rover;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /* 把新节点链接到叶子位置, 再从插入位置向上重新平衡 */
+    void attach(node** rover, node* previousNode, node* newNode) {
+        newNode->parent = previousNode;
+        *rover = newNode;
+        balance_to_root(previousNode);
+        ++ mSize;
+    }
+
+    /* 用 node2 替换 node1 在父节点中的位置 */
+    void replace(node* node1, node* node2) {
+        if (nullptr != node2) {
+            node2->parent = node1->parent;
+        }
+
+        if (nullptr == node1->parent) {
+            mRoot = node2;
+        } else {
+            node1->parent->children[parent_side(node1)] = node2;
+            update_height(node1->parent);
+        }
+    }
+
+    /* 以 n 为根向 direction 方向旋转, 返回新的子树根, 图示见 javl_tree.c */
+    node* rotate(node* n, int direction) {
+        node*                   newRoot = n->children[1 - direction];
+
+        replace(n, newRoot);
+        n->children[1 - direction] = newRoot->children[direction];
+        newRoot->children[direction] = n;
+        n->parent = newRoot;
+
+        if (nullptr != n->children[1 - direction]) {
+            n->children[1 - direction]->parent = n;
+        }
+
+        update_height(n);
+        update_height(newRoot);
+
+        return newRoot;
+    }
+
+    node* balance(node* n) {
+        node*                   child;
+        int                     diff = height(n->children[RIGHT]) - height(n->children[LEFT]);
+
+        if (diff >= 2) {                                                    // 右>左, 右左时先右旋孩子
+            child = n->children[RIGHT];
+            if (height(child->children[RIGHT]) < height(child->children[LEFT])) {
+                rotate(child, RIGHT);
+            }
+            n = rotate(n, LEFT);
+        } else if (diff <= -2) {                                            // 左>右, 左右时先左旋孩子
+            child = n->children[LEFT];
+            if (height(child->children[LEFT]) < height(child->children[RIGHT])) {
+                rotate(child, LEFT);
+            }
+            n = rotate(n, RIGHT);
+        }
+
+        update_height(n);
+
+        return n;
+    }
+
+    void balance_to_root(node* n) {
+        while (nullptr != n) {
+            n = balance(n)->parent;
+        }
+    }
+
+    /* 较高子树中离 n 最近的节点, 先把它从原位置摘下; 没有子树返回空 */
+    node* get_replacement(node* n) {
+        node*                   result;
+        int                     side;
+
+        if (nullptr == n->children[LEFT] && nullptr == n->children[RIGHT]) {
+            return nullptr;
+        }
+
+        side = height(n->children[LEFT]) < height(n->children[RIGHT]) ? RIGHT : LEFT;
+        result = n->children[side];
+        while (nullptr != result->children[1 - side]) {
+            result = result->children[1 - side];
+        }
+        replace(result, result->children[side]);
+        update_height(result->parent);
+
+        return result;
+    }
+
+    void remove_node(node* n) {
+        node*                   swapNode = get_replacement(n);
+        node*                   balanceStartpoint;
+        int                     i;
+
+        if (nullptr == swapNode) {
+            replace(n, nullptr);
+            balanceStartpoint = n->parent;
+        } else {
+            balanceStartpoint = swapNode->parent == n ? swapNode : swapNode->parent;
+            for (i = 0; i < 2; ++i) {
+                swapNode->children[i] = n->children[i];
+                if (nullptr != swapNode->children[i]) {
+                    swapNode->children[i]->parent = swapNode;
+                }
+            }
+            swapNode->height = n->height;
+            replace(n, swapNode);
+        }
+
+        delete n;
+        -- mSize;
+        balance_to_root(balanceStartpoint);
+    }
+
+    node*                       mRoot;
+    size_type                   mSize;
+    Compare                     mCompare;
+};
+
+}
+
+#endif // JAVL_TREE_HPP
@@ -0,0 +1,494 @@
+#define _GNU_SOURCE
+#include "javl_tree_rcu.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define JAVL_RCU_READER_SLOTS       (64)                    // 读者计数槽的数量
+#define JAVL_RCU_CACHE_LINE         (64)
+#define JAVL_RCU_RETIRE_BATCH       (1024)                  // 待回收节点达到这个数量时等待宽限期
+#define JAVL_RCU_MAX_HEIGHT         (64)                    // AVL 树高度上限 1.44 * log2(n), 64 足够
+
+/**
+ *  读者计数, 独占一个缓存行
+ *  count[i] 是在奇偶性为 i 的 epoch 下进入读临界区、尚未退出的读者数
+ */
+typedef struct {
+    unsigned long           count[2];
+    char                    pad[JAVL_RCU_CACHE_LINE - 2 * sizeof (unsigned long)];
+} JAVLTreeRCUReader;
+
+struct _JAVLTreeRCU {
+    JAVLTreeRCUReader       readers[JAVL_RCU_READER_SLOTS];
+    JAVLTreeNode*           rootNode;                       // 当前版本, 原子读写
+    unsigned long           epoch;                          // 每次切换加 1, 原子读写
+    unsigned int            numNodes;
+    JAVLTreeCompareFunc     compareFunc;
+    pthread_mutex_t         writeLock;
+
+    /* 以下只在持有写锁时访问 */
+    JAVLTreeNode**          retired;                        // 待回收的旧节点
+    unsigned int            numRetired;
+    unsigned int            retiredCapacity;
+    JAVLTreeNode**          fresh;                          // 当前写操作新建的节点, 失败时释放
+    unsigned int            numFresh;
+    unsigned int            freshCapacity;
+    int                     failed;                         // 当前写操作是否申请内存失败
+};
+
+/* 每个线程固定使用一个读者计数槽 */
+static unsigned int         readerSlotNext;
+static __thread unsigned int readerSlot;                    // 0 表示还没分配, 否则为槽下标 + 1
+
+static JAVLTreeRCUReader* avl_tree_rcu_reader(JAVLTreeRCU* tree) {
+    if (0 == readerSlot) {
+        readerSlot = __atomic_fetch_add(&readerSlotNext, 1, __ATOMIC_RELAXED) % JAVL_RCU_READER_SLOTS + 1;
+    }
+
+    return &tree->readers[readerSlot - 1];
+}
+
+/**
+ *  进入读临界区
+ *  先在当前 epoch 的计数上加 1 再读取根节点, 写者切换 epoch 后看到计数为 0
+ *  就说明之前进入的读者都已经退出
+ *
+ *  @return                 退出时要用的计数下标
+ */
+static unsigned int avl_tree_rcu_read_lock(JAVLTreeRCU* tree, JAVLTreeRCUReader* reader) {
+    unsigned int            index;
+
+    index = __atomic_load_n(&tree->epoch, __ATOMIC_SEQ_CST) & 1;
+    __atomic_fetch_add(&reader->count[index], 1, __ATOMIC_SEQ_CST);
+
+    return index;
+}
+
+static void avl_tree_rcu_read_unlock(JAVLTreeRCUReader* reader, unsigned int index) {
+    __atomic_fetch_sub(&reader->count[index], 1, __ATOMIC_RELEASE);
+}
+
+/* 切换 epoch, 等待旧 epoch 下进入的读者全部退出 */
+static void avl_tree_rcu_flip(JAVLTreeRCU* tree) {
+    unsigned int            index;
+    unsigned int            i;
+
+    index = __atomic_fetch_add(&tree->epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    for (i = 0; i < JAVL_RCU_READER_SLOTS; ++i) {
+        while (0 != __atomic_load_n(&tree->readers[i].count[index], __ATOMIC_SEQ_CST)) {
+            sched_yield();
+        }
+    }
+}
+
+/**
+ *  等待宽限期后释放待回收节点, 调用者持有写锁
+ *  读者读取的 epoch 可能已经过时, 所以要切换两轮, 两种奇偶性的计数都清零一次
+ */
+static void avl_tree_rcu_reclaim(JAVLTreeRCU* tree) {
+    unsigned int            i;
+
+    avl_tree_rcu_flip(tree);
+    avl_tree_rcu_flip(tree);
+
+    for (i = 0; i < tree->numRetired; ++i) {
+        free(tree->retired[i]);
+    }
+    tree->numRetired = 0;
+}
+
+/* 把节点指针放入数组, 数组按需扩容 */
+static int avl_tree_rcu_push(JAVLTreeNode*** array, unsigned int* num, unsigned int* capacity, JAVLTreeNode* node) {
+    JAVLTreeNode**          newArray = JRET_PTR_NULL;
+    unsigned int            newCapacity;
+
+    if (*num == *capacity) {
+        newCapacity = *capacity ? *capacity * 2 : JAVL_RCU_RETIRE_BATCH;
+        newArray = realloc(*array, sizeof (JAVLTreeNode*) * newCapacity);
+        if (JRET_PTR_NULL == newArray) {
+            return JRET_ERROR;
+        }
+        *array = newArray;
+        *capacity = newCapacity;
+    }
+
+    (*array)[*num] = node;
+    ++ *num;
+
+    return JRET_OK;
+}
+
+/* 旧版本中被替换掉的节点 */
+static void avl_tree_rcu_retire(JAVLTreeRCU* tree, JAVLTreeNode* node) {
+    if (JRET_OK != avl_tree_rcu_push(&tree->retired, &tree->numRetired, &tree->retiredCapacity, node)) {
+        tree->failed = 1;
+    }
+}
+
+/**
+ *  新建节点
+ *  写操作只创建新节点, 从不修改已经发布的节点
+ */
+static JAVLTreeNode* avl_tree_rcu_node_new(JAVLTreeRCU* tree, JAVLTreeNode* left, JAVLTreeKey key, JAVLTreeValue value, JAVLTreeNode* right) {
+    JAVLTreeNode*           node = JRET_PTR_NULL;
+    int                     leftHeight = avl_tree_subtree_height(left);
+    int                     rightHeight = avl_tree_subtree_height(right);
+
+    if (tree->failed) {
+        return JRET_PTR_NULL;
+    }
+
+    node = malloc(sizeof (JAVLTreeNode));
+    if (JRET_PTR_NULL == node || JRET_OK != avl_tree_rcu_push(&tree->fresh, &tree->numFresh, &tree->freshCapacity, node)) {
+        free(node);
+        tree->failed = 1;
+        return JRET_PTR_NULL;
+    }
+
+    node->children[JAVL_TREE_NODE_LEFT] = left;
+    node->children[JAVL_TREE_NODE_RIGHT] = right;
+    node->parent = JRET_PTR_NULL;
+    node->key = key;
+    node->value = value;
+    node->height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+    node->size = 0;
+
+    return node;
+}
+
+/**
+ *  由左右子树(高度最多差 2)和一个 key 构建平衡的新子树
+ *  需要旋转时, 被拆开的子树根节点换成新节点, 旧节点回收
+ *
+ *      左边高 2, 左孩子的左子树不低于右子树: 右旋        否则: 先左旋左孩子再右旋
+ *            x                 l                             x                  lr
+ *           / \               / \                           / \               /    \
+ *          l   r    ---->    ll  x                         l   r   ---->     l      x
+ *         / \                   / \                       / \               / \    / \
+ *        ll  lr                lr  r                     ll  lr            ll lrl lrr r
+ */
+static JAVLTreeNode* avl_tree_rcu_balance(JAVLTreeRCU* tree, JAVLTreeNode* left, JAVLTreeKey key, JAVLTreeValue value, JAVLTreeNode* right) {
+    JAVLTreeNode*           heavy;
+    JAVLTreeNode*           outer;
+    JAVLTreeNode*           inner;
+    JAVLTreeNode*           newSide;
+    JAVLTreeNode*           newRoot;
+    int                     leftHeight = avl_tree_subtree_height(left);
+    int                     rightHeight = avl_tree_subtree_height(right);
+
+    if (tree->failed) {
+        return JRET_PTR_NULL;
+    }
+
+    if (leftHeight > rightHeight + 1) {
+        heavy = left;
+        outer = heavy->children[JAVL_TREE_NODE_LEFT];
+        inner = heavy->children[JAVL_TREE_NODE_RIGHT];
+        avl_tree_rcu_retire(tree, heavy);
+        if (avl_tree_subtree_height(outer) >= avl_tree_subtree_height(inner)) {
+            newSide = avl_tree_rcu_node_new(tree, inner, key, value, right);
+            return avl_tree_rcu_node_new(tree, outer, heavy->key, heavy->value, newSide);
+        }
+
+        avl_tree_rcu_retire(tree, inner);
+        newSide = avl_tree_rcu_node_new(tree, outer, heavy->key, heavy->value, inner->children[JAVL_TREE_NODE_LEFT]);
+        newRoot = avl_tree_rcu_node_new(tree, inner->children[JAVL_TREE_NODE_RIGHT], key, value, right);
+        return avl_tree_rcu_node_new(tree, newSide, inner->key, inner->value, newRoot);
+    }
+
+    if (rightHeight > leftHeight + 1) {
+        heavy = right;
+        outer = heavy->children[JAVL_TREE_NODE_RIGHT];
+        inner = heavy->children[JAVL_TREE_NODE_LEFT];
+        avl_tree_rcu_retire(tree, heavy);
+        if (avl_tree_subtree_height(outer) >= avl_tree_subtree_height(inner)) {
+            newSide = avl_tree_rcu_node_new(tree, left, key, value, inner);
+            return avl_tree_rcu_node_new(tree, newSide, heavy->key, heavy->value, outer);
+        }
+
+        avl_tree_rcu_retire(tree, inner);
+        newSide = avl_tree_rcu_node_new(tree, inner->children[JAVL_TREE_NODE_RIGHT], heavy->key, heavy->value, outer);
+        newRoot = avl_tree_rcu_node_new(tree, left, key, value, inner->children[JAVL_TREE_NODE_LEFT]);
+        return avl_tree_rcu_node_new(tree, newRoot, inner->key, inner->value, newSide);
+    }
+
+    return avl_tree_rcu_node_new(tree, left, key, value, right);
+}
+
+/* 路径复制插入, 返回新子树; key 相等时放在右边, 与 JAVLTree 一致 */
+static JAVLTreeNode* avl_tree_rcu_insert_node(JAVLTreeRCU* tree, JAVLTreeNode* node, JAVLTreeKey key, JAVLTreeValue value) {
+    JAVLTreeNode*           child;
+
+    if (JRET_PTR_NULL == node) {
+        return avl_tree_rcu_node_new(tree, JRET_PTR_NULL, key, value, JRET_PTR_NULL);
+    }
+
+    avl_tree_rcu_retire(tree, node);
+    if (JRET_SMALLER == tree->compareFunc(key, node->key)) {
+        child = avl_tree_rcu_insert_node(tree, node->children[JAVL_TREE_NODE_LEFT], key, value);
+        return avl_tree_rcu_balance(tree, child, node->key, node->value, node->children[JAVL_TREE_NODE_RIGHT]);
+    }
+
+    child = avl_tree_rcu_insert_node(tree, node->children[JAVL_TREE_NODE_RIGHT], key, value);
+    return avl_tree_rcu_balance(tree, node->children[JAVL_TREE_NODE_LEFT], node->key, node->value, child);
+}
+
+/* 删除子树中 key 最小的节点, 该节点通过 minNode 返回 */
+static JAVLTreeNode* avl_tree_rcu_remove_min(JAVLTreeRCU* tree, JAVLTreeNode* node, JAVLTreeNode** minNode) {
+    JAVLTreeNode*           child;
+
+    avl_tree_rcu_retire(tree, node);
+    if (JRET_PTR_NULL == node->children[JAVL_TREE_NODE_LEFT]) {
+        *minNode = node;
+        return node->children[JAVL_TREE_NODE_RIGHT];
+    }
+
+    child = avl_tree_rcu_remove_min(tree, node->children[JAVL_TREE_NODE_LEFT], minNode);
+    return avl_tree_rcu_balance(tree, child, node->key, node->value, node->children[JAVL_TREE_NODE_RIGHT]);
+}
+
+/* 路径复制删除, 返回新子树; 没找到时 found 为 0 且返回原子树 */
+static JAVLTreeNode* avl_tree_rcu_remove_node(JAVLTreeRCU* tree, JAVLTreeNode* node, JAVLTreeKey key, int* found) {
+    JAVLTreeNode*           child;
+    JAVLTreeNode*           minNode;
+    int                     diff;
+
+    if (JRET_PTR_NULL == node) {
+        *found = 0;
+        return JRET_PTR_NULL;
+    }
+
+    diff = tree->compareFunc(key, node->key);
+    if (JRET_EQUAL == diff) {
+        *found = 1;
+        avl_tree_rcu_retire(tree, node);
+        if (JRET_PTR_NULL == node->children[JAVL_TREE_NODE_LEFT]) {
+            return node->children[JAVL_TREE_NODE_RIGHT];
+        }
+        if (JRET_PTR_NULL == node->children[JAVL_TREE_NODE_RIGHT]) {
+            return node->children[JAVL_TREE_NODE_LEFT];
+        }
+        child = avl_tree_rcu_remove_min(tree, node->children[JAVL_TREE_NODE_RIGHT], &minNode);
+        return avl_tree_rcu_balance(tree, node->children[JAVL_TREE_NODE_LEFT], minNode->key, minNode->value, child);
+    }
+
+    if (JRET_SMALLER == diff) {
+        child = avl_tree_rcu_remove_node(tree, node->children[JAVL_TREE_NODE_LEFT], key, found);
+        if (!*found) {
+            return node;
+        }
+        avl_tree_rcu_retire(tree, node);
+        return avl_tree_rcu_balance(tree, child, node->key, node->value, node->children[JAVL_TREE_NODE_RIGHT]);
+    }
+
+    child = avl_tree_rcu_remove_node(tree, node->children[JAVL_TREE_NODE_RIGHT], key, found);
+    if (!*found) {
+        return node;
+    }
+    avl_tree_rcu_retire(tree, node);
+    return avl_tree_rcu_balance(tree, node->children[JAVL_TREE_NODE_LEFT], node->key, node->value, child);
+}
+
+/**
+ *  结束一次写操作
+ *  成功时发布新版本; 失败时释放本次新建的节点, 撤销本次的回收记录, 旧版本不变
+ */
+static int avl_tree_rcu_commit(JAVLTreeRCU* tree, JAVLTreeNode* newRoot, unsigned int retiredBefore) {
+    unsigned int            i;
+
+    if (tree->failed) {
+        for (i = 0; i < tree->numFresh; ++i) {
+            free(tree->fresh[i]);
+        }
+        tree->numFresh = 0;
+        tree->numRetired = retiredBefore;
+        tree->failed = 0;
+        return JRET_ERROR;
+    }
+
+    tree->numFresh = 0;
+    __atomic_store_n(&tree->rootNode, newRoot, __ATOMIC_SEQ_CST);
+
+    if (tree->numRetired >= JAVL_RCU_RETIRE_BATCH) {
+        avl_tree_rcu_reclaim(tree);
+    }
+
+    return JRET_OK;
+}
+
+/* 后序遍历释放子树 */
+static void avl_tree_rcu_free_subtree(JAVLTreeNode* node) {
+    if (JRET_PTR_NULL == node) {
+        return;
+    }
+
+    avl_tree_rcu_free_subtree(node->children[JAVL_TREE_NODE_LEFT]);
+    avl_tree_rcu_free_subtree(node->children[JAVL_TREE_NODE_RIGHT]);
+    free(node);
+}
+
+
+JAVLTreeRCU* avl_tree_rcu_new(JAVLTreeCompareFunc compare_func) {
+    JAVLTreeRCU*            tree = JRET_PTR_NULL;
+    unsigned int            i;
+
+    if (0 != posix_memalign((void**) &tree, JAVL_RCU_CACHE_LINE, sizeof (JAVLTreeRCU))) {
+        return JRET_PTR_NULL;
+    }
+
+    for (i = 0; i < JAVL_RCU_READER_SLOTS; ++i) {
+        tree->readers[i].count[0] = 0;
+        tree->readers[i].count[1] = 0;
+    }
+    tree->rootNode = JRET_PTR_NULL;
+    tree->epoch = 0;
+    tree->numNodes = 0;
+    tree->compareFunc = compare_func;
+    pthread_mutex_init(&tree->writeLock, JRET_PTR_NULL);
+    tree->retired = JRET_PTR_NULL;
+    tree->numRetired = 0;
+    tree->retiredCapacity = 0;
+    tree->fresh = JRET_PTR_NULL;
+    tree->numFresh = 0;
+    tree->freshCapacity = 0;
+    tree->failed = 0;
+
+    return tree;
+}
+
+void avl_tree_rcu_free(JAVLTreeRCU* tree) {
+    unsigned int            i;
+
+    avl_tree_rcu_free_subtree(tree->rootNode);
+    for (i = 0; i < tree->numRetired; ++i) {
+        free(tree->retired[i]);
+    }
+
+    pthread_mutex_destroy(&tree->writeLock);
+    free(tree->retired);
+    free(tree->fresh);
+    free(tree);
+}
+
+int avl_tree_rcu_insert(JAVLTreeRCU* tree, JAVLTreeKey key, JAVLTreeValue value) {
+    JAVLTreeNode*           newRoot;
+    int                     ret;
+
+    pthread_mutex_lock(&tree->writeLock);
+    {
+        unsigned int        retiredBefore = tree->numRetired;
+
+        newRoot = avl_tree_rcu_insert_node(tree, tree->rootNode, key, value);
+        ret = avl_tree_rcu_commit(tree, newRoot, retiredBefore);
+        if (JRET_OK == ret) {
+            __atomic_store_n(&tree->numNodes, tree->numNodes + 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&tree->writeLock);
+
+    return ret;
+}
+
+int avl_tree_rcu_remove(JAVLTreeRCU* tree, JAVLTreeKey key) {
+    JAVLTreeNode*           newRoot;
+    int                     found = 0;
+    int                     ret;
+
+    pthread_mutex_lock(&tree->writeLock);
+    {
+        unsigned int        retiredBefore = tree->numRetired;
+
+        newRoot = avl_tree_rcu_remove_node(tree, tree->rootNode, key, &found);
+        if (!found) {
+            ret = JRET_NOTFOUND;
+        } else {
+            ret = avl_tree_rcu_commit(tree, newRoot, retiredBefore);
+            if (JRET_OK == ret) {
+                __atomic_store_n(&tree->numNodes, tree->numNodes - 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    pthread_mutex_unlock(&tree->writeLock);
+
+    return ret;
+}
+
+JAVLTreeValue avl_tree_rcu_lookup(JAVLTreeRCU* tree, JAVLTreeKey key) {
+    JAVLTreeRCUReader*      reader = avl_tree_rcu_reader(tree);
+    JAVLTreeNode*           node;
+    JAVLTreeValue           value = JAVL_TREE_NULL;
+    unsigned int            index;
+    int                     diff;
+
+    index = avl_tree_rcu_read_lock(tree, reader);
+    node = __atomic_load_n(&tree->rootNode, __ATOMIC_SEQ_CST);
+    while (node != JRET_PTR_NULL) {
+        diff = tree->compareFunc(key, node->key);
+        if (diff == JRET_EQUAL) {
+            value = node->value;
+            break;
+        } else if (diff == JRET_SMALLER) {
+            node = node->children[JAVL_TREE_NODE_LEFT];
+        } else {
+            node = node->children[JAVL_TREE_NODE_RIGHT];
+        }
+    }
+    avl_tree_rcu_read_unlock(reader, index);
+
+    return value;
+}
+
+/**
+ *  范围遍历
+ *  节点没有可用的 parent 指针, 用固定大小的栈做中序遍历:
+ *  先从根向下找到下界, 沿途记录向左走过的节点, 之后每弹出一个节点就访问它并进入其右子树
+ */
+unsigned int avl_tree_rcu_range(JAVLTreeRCU* tree, JAVLTreeKey lo, JAVLTreeKey hi, JAVLTreeRangeFunc func, void* data) {
+    JAVLTreeRCUReader*      reader = avl_tree_rcu_reader(tree);
+    JAVLTreeNode*           stack[JAVL_RCU_MAX_HEIGHT];
+    JAVLTreeNode*           node;
+    unsigned int            depth = 0;
+    unsigned int            num = 0;
+    unsigned int            index;
+
+    index = avl_tree_rcu_read_lock(tree, reader);
+    node = __atomic_load_n(&tree->rootNode, __ATOMIC_SEQ_CST);
+    while (node != JRET_PTR_NULL) {
+        if (JRET_SMALLER != tree->compareFunc(node->key, lo)) {
+            stack[depth++] = node;
+            node = node->children[JAVL_TREE_NODE_LEFT];
+        } else {
+            node = node->children[JAVL_TREE_NODE_RIGHT];
+        }
+    }
+
+    while (depth > 0) {
+        node = stack[--depth];
+        if (JRET_SMALLER != tree->compareFunc(node->key, hi)) {
+            break;
+        }
+
+        ++ num;
+        if (JRET_OK != func(node, data)) {
+            break;
+        }
+
+        for (node = node->children[JAVL_TREE_NODE_RIGHT]; node != JRET_PTR_NULL; node = node->children[JAVL_TREE_NODE_LEFT]) {
+            stack[depth++] = node;
+        }
+    }
+    avl_tree_rcu_read_unlock(reader, index);
+
+    return num;
+}
+
+unsigned int avl_tree_rcu_num_entries(JAVLTreeRCU* tree) {
+    return __atomic_load_n(&tree->numNodes, __ATOMIC_RELAXED);
+}
+
+void avl_tree_rcu_synchronize(JAVLTreeRCU* tree) {
+    pthread_mutex_lock(&tree->writeLock);
+    avl_tree_rcu_reclaim(tree);
+    pthread_mutex_unlock(&tree->writeLock);
+}
@@ -0,0 +1,126 @@
+#ifndef JAVL_TREE_RCU_H
+#define JAVL_TREE_RCU_H
+#include "jret.h"
+#include "javl_tree.h"
+
+/**
+ *  并发读的 AVL 平衡二叉树
+ *
+ *  读多写少的场景下代替 "JAVLTree + 全局互斥锁"。
+ *
+ *  实现：
+ *      树的每个版本都是不可变的。写操作持有写锁, 用路径复制(path copying)生成新版本:
+ *      只复制从根到修改位置路径上的 O(log n) 个节点, 其余子树与旧版本共享,
+ *      最后原子地发布新的根节点。
+ *      读操作不加锁, 进入读临界区后取得当前的根节点, 之后看到的始终是同一个一致的版本。
+ *      被替换下来的旧节点先放入待回收列表, 等到所有可能看到它们的读操作结束
+ *      (宽限期, 类似 SRCU 的两轮计数切换)后才释放。
+ *
+ *      读者计数分散在多个缓存行上, 不同核上的读操作互不干扰, 读吞吐随核数接近线性增长。
+ *
+ *  注意：
+ *      节点中只有 key/value/children/height 有效, parent 恒为空, 不能对节点使用游标函数。
+ *      比较函数可能被多个线程同时调用。
+ *
+ *  调用：
+ *      avl_tree_rcu_new --- 创建
+ *      avl_tree_rcu_free --- 销毁
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 并发读 AVL 树 */
+typedef struct _JAVLTreeRCU JAVLTreeRCU;
+
+
+/**
+ *  创建并发读 AVL 树
+ *
+ *  @param compare_func     key 比较函数
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JAVLTreeRCU* avl_tree_rcu_new(JAVLTreeCompareFunc compare_func);
+
+
+/**
+ *  销毁树, 调用时不能再有其它线程访问这棵树
+ *
+ *  @param tree             树
+ */
+void avl_tree_rcu_free(JAVLTreeRCU* tree);
+
+
+/**
+ *  插入 key-value, 多个写线程之间串行执行
+ *
+ *  @param tree             树
+ *  @param key              要插入的 key
+ *  @param value            要插入的 value
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (内存不足, 树不变)
+ */
+int avl_tree_rcu_insert(JAVLTreeRCU* tree, JAVLTreeKey key, JAVLTreeValue value);
+
+
+/**
+ *  根据 key 删除一个节点, 多个写线程之间串行执行
+ *
+ *  @param tree             树
+ *  @param key              要删除节点的 key
+ *  @return                 删除成功：RET_OK
+ *                          没找到：  RET_NOTFOUND
+ *                          失败：    RET_ERROR (内存不足, 树不变)
+ */
+int avl_tree_rcu_remove(JAVLTreeRCU* tree, JAVLTreeKey key);
+
+
+/**
+ *  根据 key 查询, 不加锁
+ *
+ *  @param tree             树
+ *  @param key              要查询的 key
+ *  @return                 成功：返回找到的值
+ *                          失败：返回 AVL_PTR_NULL
+ */
+JAVLTreeValue avl_tree_rcu_lookup(JAVLTreeRCU* tree, JAVLTreeKey key);
+
+
+/**
+ *  按 key 的顺序遍历 [lo, hi) 内的节点, 不加锁
+ *  整个遍历看到的是同一个版本, 遍历不递归, 不申请内存
+ *
+ *  @param tree             树
+ *  @param lo               范围下界(包含)
+ *  @param hi               范围上界(不包含)
+ *  @param func             对每个节点调用的函数, 返回非 RET_OK 时提前结束;
+ *                          节点只在回调期间有效
+ *  @param data             传给 func 的用户数据
+ *  @return                 访问过的节点数
+ */
+unsigned int avl_tree_rcu_range(JAVLTreeRCU* tree, JAVLTreeKey lo, JAVLTreeKey hi, JAVLTreeRangeFunc func, void* data);
+
+
+/**
+ *  树的节点数
+ *
+ *  @param tree             树
+ *  @return                 节点数
+ */
+unsigned int avl_tree_rcu_num_entries(JAVLTreeRCU* tree);
+
+
+/**
+ *  等待宽限期并立即释放所有待回收的旧节点
+ *  写操作会在待回收节点积累到一定数量时自动调用, 一般不需要手动调用
+ *
+ *  @param tree             树
+ */
+void avl_tree_rcu_synchronize(JAVLTreeRCU* tree);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JAVL_TREE_RCU_H
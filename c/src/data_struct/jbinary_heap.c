@@ -1,139 +1,884 @@
+#define _GNU_SOURCE
 #include "jbinary_heap.h"
+#include "jstats.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #define BINARY_HEAP_CAPACITY   (1024)
+#define BINARY_HEAP_CACHE_LINE (64)
+#define BINARY_HEAP_GROWTH     (50)                // 默认每次扩容增加当前容量的百分比
 
+/**
+ * d 叉堆, 元素 i 的孩子是 d * i + 1 ... d * i + d
+ * 元素 i 存放在 memory[i + d - 1], 这样每组孩子都从 memory 中 d 的整数倍处开始,
+ * memory 按缓存行对齐, 8 叉堆的一组孩子正好占一个缓存行
+ */
 struct _JBinaryHeap {
     JBinaryHeapType          heapType;
-    JBinaryHeapValue*        values;
+    JBinaryHeapValue*        values;                // 指向 memory + arity - 1
+    JBinaryHeapValue*        memory;
     unsigned int            size;
     unsigned int            capacity;
+    unsigned int            arity;
+    unsigned int            arityShift;             // arity = 1 << arityShift
     binary_heap_compare_cb  compareFunc;
-};
+    int                     worse;                 // compareFunc 返回它时第一个值应排在后面, 创建时按堆类型确定
 
-static unsigned int left(unsigned int i) { return 2 * i + 1;}
+    /* 内联模式: 元素是 int64 排序键 + payloadSize 字节的数据, 都存在堆自己的数组里 */
+    int                     inlineMode;
+    JBinaryHeapKeyType       keyType;
+    unsigned int            payloadSize;
+    int64_t                 keyFlip;               // 最大堆为全 1, 排序键取反后统一按最小堆处理
+    int64_t*                keys;                  // 与 values 相同的 d 叉堆布局, 指向 keyMemory + arity - 1
+    int64_t*                keyMemory;
+    unsigned char*          payloads;
 
-static unsigned int right(unsigned int i) { return 2 * i + 2;}
+    /* 句柄, 第一次使用 binary_heap_insert_with_handle 时才开启 */
+    JBinaryHeapHandle*       handles;               // handles[i] 是位置 i 上元素的句柄
+    unsigned int*           positions;             // positions[h] 是句柄 h 的位置; 空闲句柄为下一个空闲句柄
+    JBinaryHeapHandle        freeHandle;            // 空闲句柄链表头
+    unsigned int            numHandles;            // 用过的句柄数, 句柄都小于它
 
-static unsigned int parent(unsigned int i) { return (i - 1) / 2;}
+    /* 内存 */
+    const JAllocator*       allocator;
+    JMemoryStats            memStats;
+    unsigned int            growthPercent;         // 扩容时增加当前容量的百分比
+    unsigned int            growthMin;             // 扩容时至少增加的元素数
+#ifdef JDS_STATS
+    JBinaryHeapStats         stats;
+#endif
+};
 
-static void swap(JBinaryHeapValue* x, JBinaryHeapValue* y) { JBinaryHeapValue tmp = *x; *x = *y; *y = tmp;}
+static unsigned int first_child(JBinaryHeap* heap, unsigned int i) { return (i << heap->arityShift) + 1;}
 
+static unsigned int parent(JBinaryHeap* heap, unsigned int i) { return (i - 1) >> heap->arityShift;}
+
+/* v1 应排在 v2 之后返回 RET_BIGGER, 否则返回 RET_SMALLER */
 static int value_compare(JBinaryHeap* heap, JBinaryHeapValue v1, JBinaryHeapValue v2) {
-    if (heap->heapType == JBINARY_HEAP_TYPE_MIN) {
-        return heap->compareFunc(v1, v2) == JRET_BIGGER ? JRET_BIGGER : JRET_SMALLER;
+    JSTATS_INC(heap->stats.comparisons);
+    return heap->compareFunc(v1, v2) == heap->worse ? JRET_BIGGER : JRET_SMALLER;
+}
+
+/* 一次上浮或下沉移动了 levels 层 */
+static void heap_count_sift(JBinaryHeap* heap, unsigned int levels) {
+    JSTATS_INC(heap->stats.sifts);
+    JSTATS_ADD(heap->stats.siftLevels, levels);
+    JSTATS_MAX(heap->stats.maxSiftLevels, levels);
+}
+
+static void* heap_alloc(JBinaryHeap* heap, size_t size, size_t align) {
+    return jallocator_alloc(heap->allocator, &heap->memStats, size, align);
+}
+
+static void heap_free(JBinaryHeap* heap, void* ptr, size_t size, size_t align) {
+    jallocator_free(heap->allocator, &heap->memStats, ptr, size, align);
+}
+
+/* 对齐数组的字节数: capacity 个元素加上前面补齐的 arity - 1 个 */
+static size_t heap_aligned_bytes(JBinaryHeap* heap, size_t elementSize, unsigned int capacity) {
+    return elementSize * (capacity + heap->arity - 1);
+}
+
+/* 内联模式下 payload 数组是普通数组, 排序键数组与 values 一样对齐 */
+static int heap_reserve_inline(JBinaryHeap* heap, unsigned int capacity) {
+    int64_t*                keyMemory = JRET_PTR_NULL;
+    unsigned char*          payloads = JRET_PTR_NULL;
+
+    keyMemory = heap_alloc(heap, heap_aligned_bytes(heap, sizeof (int64_t), capacity), BINARY_HEAP_CACHE_LINE);
+    if (JRET_PTR_NULL == keyMemory) {
+        return JRET_ERROR;
+    }
+
+    payloads = jallocator_realloc(heap->allocator, &heap->memStats, heap->payloads,
+                                  (size_t) heap->payloadSize * heap->capacity + 1, (size_t) heap->payloadSize * capacity + 1, 1);
+    if (JRET_PTR_NULL == payloads) {
+        heap_free(heap, keyMemory, heap_aligned_bytes(heap, sizeof (int64_t), capacity), BINARY_HEAP_CACHE_LINE);
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL != heap->keyMemory) {
+        JSTATS_INC(heap->stats.reallocs);
+        memcpy(keyMemory + heap->arity - 1, heap->keys, sizeof (int64_t) * heap->size);
+        heap_free(heap, heap->keyMemory, heap_aligned_bytes(heap, sizeof (int64_t), heap->capacity), BINARY_HEAP_CACHE_LINE);
+    }
+
+    heap->keyMemory = keyMemory;
+    heap->keys = keyMemory + heap->arity - 1;
+    heap->payloads = payloads;
+    heap->capacity = capacity;
+
+    return JRET_OK;
+}
+
+/* 申请对齐的空间, 放得下 capacity 个元素, 并把已有元素复制过去 */
+static int heap_reserve(JBinaryHeap* heap, unsigned int capacity) {
+    JBinaryHeapValue*        memory = JRET_PTR_NULL;
+    JBinaryHeapHandle*       handles = JRET_PTR_NULL;
+    unsigned int*           positions = JRET_PTR_NULL;
+
+    if (heap->inlineMode) {
+        return heap_reserve_inline(heap, capacity);
+    }
+
+    memory = heap_alloc(heap, heap_aligned_bytes(heap, sizeof (JBinaryHeapValue), capacity), BINARY_HEAP_CACHE_LINE);
+    if (JRET_PTR_NULL == memory) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL != heap->handles) {                                  // 句柄数不超过元素数, 和元素一起扩容
+        handles = heap_alloc(heap, sizeof (JBinaryHeapHandle) * capacity, sizeof (JBinaryHeapHandle));
+        positions = heap_alloc(heap, sizeof (unsigned int) * capacity, sizeof (unsigned int));
+        if (JRET_PTR_NULL == handles || JRET_PTR_NULL == positions) {
+            heap_free(heap, handles, sizeof (JBinaryHeapHandle) * capacity, sizeof (JBinaryHeapHandle));
+            heap_free(heap, positions, sizeof (unsigned int) * capacity, sizeof (unsigned int));
+            heap_free(heap, memory, heap_aligned_bytes(heap, sizeof (JBinaryHeapValue), capacity), BINARY_HEAP_CACHE_LINE);
+            return JRET_ERROR;
+        }
+        memcpy(handles, heap->handles, sizeof (JBinaryHeapHandle) * heap->size);
+        memcpy(positions, heap->positions, sizeof (unsigned int) * heap->numHandles);
+        heap_free(heap, heap->handles, sizeof (JBinaryHeapHandle) * heap->capacity, sizeof (JBinaryHeapHandle));
+        heap_free(heap, heap->positions, sizeof (unsigned int) * heap->capacity, sizeof (unsigned int));
+        heap->handles = handles;
+        heap->positions = positions;
+    }
+
+    if (JRET_PTR_NULL != heap->memory) {
+        JSTATS_INC(heap->stats.reallocs);
+        memcpy(memory + heap->arity - 1, heap->values, sizeof (JBinaryHeapValue) * heap->size);
+        heap_free(heap, heap->memory, heap_aligned_bytes(heap, sizeof (JBinaryHeapValue), heap->capacity), BINARY_HEAP_CACHE_LINE);
+    }
+
+    heap->memory = memory;
+    heap->values = memory + heap->arity - 1;
+    heap->capacity = capacity;
+
+    return JRET_OK;
+}
+
+/**
+ * 确保还能放下 num 个元素
+ * 对齐的空间不能原地扩展, 按容量的百分比扩容避免反复复制, 策略由 binary_heap_set_growth 设置
+ */
+static int heap_grow(JBinaryHeap* heap, unsigned int num) {
+    unsigned long long  growth;
+    unsigned long long  newSize;
+
+    if (heap->capacity - heap->size >= num) {
+        return JRET_OK;
+    }
+
+    growth = (unsigned long long) heap->capacity * heap->growthPercent / 100;
+    if (growth < heap->growthMin) {
+        growth = heap->growthMin;
+    }
+    newSize = heap->capacity + growth;
+    if (newSize < (unsigned long long) heap->size + num) {
+        newSize = (unsigned long long) heap->size + num;
+    }
+    if (newSize > UINT_MAX) {
+        return JRET_ERROR;
+    }
+
+    return heap_reserve(heap, (unsigned int) newSize);
+}
+
+/* 开启句柄, 已有元素按位置分配句柄 */
+static int heap_enable_handles(JBinaryHeap* heap) {
+    unsigned int            i;
+
+    heap->handles = heap_alloc(heap, sizeof (JBinaryHeapHandle) * heap->capacity, sizeof (JBinaryHeapHandle));
+    heap->positions = heap_alloc(heap, sizeof (unsigned int) * heap->capacity, sizeof (unsigned int));
+    if (JRET_PTR_NULL == heap->handles || JRET_PTR_NULL == heap->positions) {
+        heap_free(heap, heap->handles, sizeof (JBinaryHeapHandle) * heap->capacity, sizeof (JBinaryHeapHandle));
+        heap_free(heap, heap->positions, sizeof (unsigned int) * heap->capacity, sizeof (unsigned int));
+        heap->handles = JRET_PTR_NULL;
+        heap->positions = JRET_PTR_NULL;
+        return JRET_ERROR;
+    }
+
+    for (i = 0; i < heap->size; ++i) {
+        heap->handles[i] = i;
+        heap->positions[i] = i;
+    }
+    heap->numHandles = heap->size;
+
+    return JRET_OK;
+}
+
+/* 分配句柄, 堆中已经有位置放新元素, 所以不会超出数组 */
+static JBinaryHeapHandle heap_handle_alloc(JBinaryHeap* heap) {
+    JBinaryHeapHandle        handle = heap->freeHandle;
+
+    if (JBINARY_HEAP_HANDLE_INVALID != handle) {
+        heap->freeHandle = heap->positions[handle];
+        return handle;
+    }
+
+    return heap->numHandles ++;
+}
+
+static void heap_handle_free(JBinaryHeap* heap, JBinaryHeapHandle handle) {
+    heap->positions[handle] = heap->freeHandle;
+    heap->freeHandle = handle;
+}
+
+/* 句柄对应的位置, 句柄无效时返回 heap->size */
+static unsigned int heap_handle_position(JBinaryHeap* heap, JBinaryHeapHandle handle) {
+    unsigned int            pos;
+
+    if (JRET_PTR_NULL == heap->handles || handle >= heap->numHandles) {
+        return heap->size;
+    }
+
+    pos = heap->positions[handle];
+    if (pos >= heap->size || heap->handles[pos] != handle) {             // 空闲句柄不会出现在 handles 中
+        return heap->size;
+    }
+
+    return pos;
+}
+
+/* 把元素放到位置 i, 同时维护句柄 */
+static void heap_place(JBinaryHeap* heap, unsigned int i, JBinaryHeapValue value, JBinaryHeapHandle handle) {
+    heap->values[i] = value;
+    if (JRET_PTR_NULL != heap->handles) {
+        heap->handles[i] = handle;
+        heap->positions[handle] = i;
+    }
+}
+
+static JBinaryHeapHandle heap_handle_at(JBinaryHeap* heap, unsigned int i) {
+    return JRET_PTR_NULL != heap->handles ? heap->handles[i] : JBINARY_HEAP_HANDLE_INVALID;
+}
+
+/* 上浮: 从空位 i 开始, 比父节点靠前就把父节点下移 */
+static void heap_sift_up(JBinaryHeap* heap, unsigned int i, JBinaryHeapValue value, JBinaryHeapHandle handle) {
+    unsigned int            levels = 0;
+
+    while (i > 0 && (JRET_BIGGER == value_compare(heap, heap->values[parent(heap, i)], value))) {
+        heap_place(heap, i, heap->values[parent(heap, i)], heap_handle_at(heap, parent(heap, i)));
+        i = parent(heap, i);
+        ++ levels;
     }
 
-    return heap->compareFunc(v1, v2) == JRET_BIGGER ? JRET_SMALLER : JRET_BIGGER;
+    heap_place(heap, i, value, handle);
+    heap_count_sift(heap, levels);
+}
+
+/* 下沉: 从空位 i 开始, 在所有孩子中找最值, 比要放的值更靠前就上移, 直到叶子 */
+static void heap_sift_down(JBinaryHeap* heap, unsigned int i, JBinaryHeapValue value, JBinaryHeapHandle handle) {
+    unsigned int            child;
+    unsigned int            last;
+    unsigned int            st;
+    unsigned int            levels = 0;
+
+    for (;;) {
+        child = first_child(heap, i);
+        if (child >= heap->size) {
+            break;
+        }
+
+        last = child + heap->arity;
+        if (last > heap->size) {
+            last = heap->size;
+        }
+
+        for (st = child ++; child < last; ++ child) {                                                  // 孩子中找最值
+            if (JRET_SMALLER == value_compare(heap, heap->values[child], heap->values[st])) {
+                st = child;
+            }
+        }
+
+        if (JRET_BIGGER != value_compare(heap, value, heap->values[st])) {                             // 不需要调整
+            break;
+        }
+
+        heap_place(heap, i, heap->values[st], heap_handle_at(heap, st));
+        i = st;
+        ++ levels;
+    }
+
+    heap_place(heap, i, value, handle);
+    heap_count_sift(heap, levels);
 }
 
 static void heap_adjust(JBinaryHeap* heap, unsigned int i) {
-    unsigned int l = left(i);
-    unsigned int r = right(i);
-    unsigned int st = i;
+    heap_sift_down(heap, i, heap->values[i], heap_handle_at(heap, i));
+}
+
+/* 删除位置 i 的元素, 用最后一个元素填补后上浮或下沉 */
+static JBinaryHeapValue heap_remove_at(JBinaryHeap* heap, unsigned int i) {
+    JBinaryHeapValue         value = heap->values[i];
+    JBinaryHeapValue         lastValue;
+    JBinaryHeapHandle        lastHandle;
 
-    if(l < heap->size &&\
-            (JRET_SMALLER == value_compare(heap, *(heap->values + l), *(heap->values + st)))) {          // 节点和左孩子比较找最值
-        st = l;
+    if (JRET_PTR_NULL != heap->handles) {
+        heap_handle_free(heap, heap->handles[i]);
     }
 
-    if(r < heap->size &&\
-            (JRET_SMALLER == value_compare(heap, *(heap->values + r), *(heap->values + st)))) {          // 节点根右孩子比较找最值
-        st = r;
+    -- heap->size;
+    if (i == heap->size) {
+        return value;
     }
 
-    if (i != st) {                                                                                      // 需要调整
-        swap(heap->values + i, heap->values + st);
-        heap_adjust(heap, st);
+    lastValue = heap->values[heap->size];
+    lastHandle = heap_handle_at(heap, heap->size);
+    if (i > 0 && JRET_BIGGER == value_compare(heap, heap->values[parent(heap, i)], lastValue)) {
+        heap_sift_up(heap, i, lastValue, lastHandle);
+    } else {
+        heap_sift_down(heap, i, lastValue, lastHandle);
     }
+
+    return value;
 }
 
 
-JBinaryHeap *binary_heap_new(JBinaryHeapType type, binary_heap_compare_cb compareFunction) {
+/**
+ * 内联模式
+ * int64 和 double 优先级都转成 int64 排序键: double 的位模式在符号位为 1 时翻转其余位,
+ * 按有符号整数比较的结果就与 double 的大小顺序相同; 最大堆再把排序键按位取反。
+ * 这样所有内联堆都是 int64 最小堆, 比较不调用函数也不判断堆类型。
+ * 两种变换都是自身的逆变换, 弹出时再变换一次就得到原来的优先级。
+ */
+static int64_t heap_sort_key(JBinaryHeap* heap, int64_t bits) {
+    if (JBINARY_HEAP_KEY_DOUBLE == heap->keyType) {
+        bits ^= (bits >> 63) & INT64_MAX;
+    }
+
+    return bits ^ heap->keyFlip;
+}
+
+static int64_t heap_key_bits(JBinaryHeap* heap, int64_t key) {
+    key ^= heap->keyFlip;
+    if (JBINARY_HEAP_KEY_DOUBLE == heap->keyType) {
+        key ^= (key >> 63) & INT64_MAX;
+    }
+
+    return key;
+}
+
+static unsigned char* heap_payload(JBinaryHeap* heap, unsigned int i) {
+    return heap->payloads + (size_t) heap->payloadSize * i;
+}
+
+/**
+ * 一组完整的孩子中排序键最小的下标
+ * 每组孩子都按 arity * 8 字节对齐, AVX2 下一次比较 4 个: 两两交换比较得到最小值并广播, 再找出它的位置
+ */
+#if defined(__AVX2__)
+static __m256i heap_min_epi64(__m256i a, __m256i b) {
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+static unsigned int heap_min_child(JBinaryHeap* heap, unsigned int child) {
+    const int64_t*          keys = heap->keys + child;
+    __m256i                 lo;
+    __m256i                 hi;
+    __m256i                 m;
+    unsigned int            mask;
+
+    if (2 == heap->arity) {
+        return child + (keys[1] < keys[0]);
+    }
+
+    lo = _mm256_load_si256((const __m256i*) keys);
+    hi = 8 == heap->arity ? _mm256_load_si256((const __m256i*) (keys + 4)) : lo;
+    m = heap_min_epi64(lo, hi);
+    m = heap_min_epi64(m, _mm256_permute4x64_epi64(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    m = heap_min_epi64(m, _mm256_permute4x64_epi64(m, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(lo, m)));
+    if (8 == heap->arity) {
+        mask |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(hi, m))) << 4;
+    }
+
+    return child + __builtin_ctz(mask);
+}
+#else
+static unsigned int heap_min_child(JBinaryHeap* heap, unsigned int child) {
+    const int64_t*          keys = heap->keys + child;
+    unsigned int            st = 0;
+    unsigned int            i;
+
+    for (i = 1; i < heap->arity; ++i) {
+        st = keys[i] < keys[st] ? i : st;
+    }
+
+    return child + st;
+}
+#endif
+
+static void heap_inline_place(JBinaryHeap* heap, unsigned int i, int64_t key, const void* payload) {
+    heap->keys[i] = key;
+    if (JRET_PTR_NULL != payload) {
+        memcpy(heap_payload(heap, i), payload, heap->payloadSize);
+    } else {
+        memset(heap_payload(heap, i), 0, heap->payloadSize);
+    }
+}
+
+static void heap_inline_sift_up(JBinaryHeap* heap, unsigned int i, int64_t key, const void* payload) {
+    unsigned int            levels = 0;
+
+    while (i > 0 && heap->keys[parent(heap, i)] > key) {
+        heap_inline_place(heap, i, heap->keys[parent(heap, i)], heap_payload(heap, parent(heap, i)));
+        i = parent(heap, i);
+        ++ levels;
+    }
+
+    heap_inline_place(heap, i, key, payload);
+    heap_count_sift(heap, levels);
+}
+
+/* payload 不能位于 [0, size) 之内, 下沉过程中会覆盖这些位置 */
+static void heap_inline_sift_down(JBinaryHeap* heap, unsigned int i, int64_t key, const void* payload) {
+    unsigned int            child;
+    unsigned int            st;
+    unsigned int            levels = 0;
+
+    for (;;) {
+        child = first_child(heap, i);
+        if (child >= heap->size) {
+            break;
+        }
+
+        if (child + heap->arity <= heap->size) {
+            st = heap_min_child(heap, child);
+        } else {                                                                                       // 最后一组孩子不完整
+            for (st = child ++; child < heap->size; ++ child) {
+                st = heap->keys[child] < heap->keys[st] ? child : st;
+            }
+        }
+
+        if (heap->keys[st] >= key) {
+            break;
+        }
+
+        heap_inline_place(heap, i, heap->keys[st], heap_payload(heap, st));
+        i = st;
+        ++ levels;
+    }
+
+    heap_inline_place(heap, i, key, payload);
+    heap_count_sift(heap, levels);
+}
+
+static int heap_inline_insert(JBinaryHeap* heap, JBinaryHeapKeyType keyType, int64_t bits, const void* payload) {
+    if (!heap->inlineMode || keyType != heap->keyType) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_OK != heap_grow(heap, 1)) {
+        return JRET_ERROR;
+    }
+
+    ++ heap->size;
+    heap_inline_sift_up(heap, heap->size - 1, heap_sort_key(heap, bits), payload);
+
+    return JRET_OK;
+}
+
+static int heap_inline_peek(JBinaryHeap* heap, JBinaryHeapKeyType keyType, int64_t* bits, void* payload) {
+    if (!heap->inlineMode || keyType != heap->keyType || 0 == heap->size) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL != bits) {
+        *bits = heap_key_bits(heap, heap->keys[0]);
+    }
+    if (JRET_PTR_NULL != payload) {
+        memcpy(payload, heap_payload(heap, 0), heap->payloadSize);
+    }
+
+    return JRET_OK;
+}
+
+static int heap_inline_pop(JBinaryHeap* heap, JBinaryHeapKeyType keyType, int64_t* bits, void* payload) {
+    if (JRET_OK != heap_inline_peek(heap, keyType, bits, payload)) {
+        return JRET_ERROR;
+    }
+
+    -- heap->size;
+    if (heap->size > 0) {
+        heap_inline_sift_down(heap, 0, heap->keys[heap->size], heap_payload(heap, heap->size));
+    }
+
+    return JRET_OK;
+}
+
+
+static JBinaryHeap* heap_create(JBinaryHeapType type, unsigned int arity, binary_heap_compare_cb compareFunction,
+                                int inlineMode, JBinaryHeapKeyType keyType, unsigned int payloadSize, const JAllocator* allocator) {
     JBinaryHeap*             heap = JRET_PTR_NULL;
+    JMemoryStats             memStats = { 0, 0, 0 };
+
+    if (2 != arity && 4 != arity && 8 != arity) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_PTR_NULL == allocator) {
+        allocator = jallocator_default();
+    }
 
-    heap = malloc(sizeof (JBinaryHeap));
+    heap = jallocator_alloc(allocator, &memStats, sizeof (JBinaryHeap), sizeof (void*));
     if(JRET_PTR_NULL == heap) {
         return JRET_PTR_NULL;
     }
 
+    heap->allocator = allocator;
+    heap->memStats = memStats;
+    heap->growthPercent = BINARY_HEAP_GROWTH;
+    heap->growthMin = BINARY_HEAP_CAPACITY;
+    heap->capacity = 0;
+
     heap->heapType = type;
     heap->compareFunc = compareFunction;
+    heap->worse = JBINARY_HEAP_TYPE_MIN == type ? JRET_BIGGER : JRET_SMALLER;
+    heap->inlineMode = inlineMode;
+    heap->payloadSize = payloadSize;
+    heap->keyType = keyType;
+    heap->keyFlip = JBINARY_HEAP_TYPE_MIN == type ? 0 : -1;
+    heap->keys = JRET_PTR_NULL;
+    heap->keyMemory = JRET_PTR_NULL;
+    heap->payloads = JRET_PTR_NULL;
     heap->size = 0;
-    /* 初始化 128 个堆空间 */
-    heap->capacity = BINARY_HEAP_CAPACITY;
-    heap->values = malloc(sizeof(JBinaryHeapValue) * heap->capacity);
-    if (JRET_PTR_NULL == heap->values) {
-        free(heap);
+    heap->arity = arity;
+    heap->arityShift = __builtin_ctz(arity);
+    heap->memory = JRET_PTR_NULL;
+    heap->handles = JRET_PTR_NULL;
+    heap->positions = JRET_PTR_NULL;
+    heap->freeHandle = JBINARY_HEAP_HANDLE_INVALID;
+    heap->numHandles = 0;
+    binary_heap_reset_stats(heap);
+    /* 初始化 BINARY_HEAP_CAPACITY 个堆空间 */
+    if (JRET_OK != heap_reserve(heap, BINARY_HEAP_CAPACITY)) {
+        jallocator_free(allocator, JRET_PTR_NULL, heap, sizeof (JBinaryHeap), sizeof (void*));
         return JRET_PTR_NULL;
     }
-    memset(heap->values, 0, heap->capacity);
 
     return heap;
 }
 
+
+JBinaryHeap *binary_heap_new(JBinaryHeapType type, binary_heap_compare_cb compareFunction) {
+    return binary_heap_new_with_arity(type, 2, compareFunction);
+}
+
+JBinaryHeap *binary_heap_new_with_arity(JBinaryHeapType type, unsigned int arity, binary_heap_compare_cb compareFunction) {
+    return heap_create(type, arity, compareFunction, 0, JBINARY_HEAP_KEY_INT64, 0, JRET_PTR_NULL);
+}
+
+JBinaryHeap *binary_heap_new_with_allocator(JBinaryHeapType type, unsigned int arity, binary_heap_compare_cb compareFunction, const JAllocator *allocator) {
+    return heap_create(type, arity, compareFunction, 0, JBINARY_HEAP_KEY_INT64, 0, allocator);
+}
+
+JBinaryHeap *binary_heap_new_inline(JBinaryHeapType type, JBinaryHeapKeyType keyType, unsigned int payloadSize, unsigned int arity) {
+    return binary_heap_new_inline_with_allocator(type, keyType, payloadSize, arity, JRET_PTR_NULL);
+}
+
+JBinaryHeap *binary_heap_new_inline_with_allocator(JBinaryHeapType type, JBinaryHeapKeyType keyType, unsigned int payloadSize, unsigned int arity,
+                                                   const JAllocator *allocator) {
+    if (JBINARY_HEAP_KEY_INT64 != keyType && JBINARY_HEAP_KEY_DOUBLE != keyType) {
+        return JRET_PTR_NULL;
+    }
+
+    return heap_create(type, arity, JRET_PTR_NULL, 1, keyType, payloadSize, allocator);
+}
+
 int binary_heap_insert(JBinaryHeap *heap, JBinaryHeapValue value) {
-    JBinaryHeapValue*    newValue = JRET_PTR_NULL;
-    unsigned int        index;
-    unsigned int        newSize;
-    static unsigned int heapTms;                // 最大 10 倍
-    heapTms = heapTms > 10 ? 10 : heapTms + 1;
+    return binary_heap_insert_with_handle(heap, value, JRET_PTR_NULL);
+}
+
+int binary_heap_insert_with_handle(JBinaryHeap *heap, JBinaryHeapValue value, JBinaryHeapHandle *handle) {
+    JBinaryHeapHandle    newHandle = JBINARY_HEAP_HANDLE_INVALID;
+
+    if (heap->inlineMode) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL != handle && JRET_PTR_NULL == heap->handles && JRET_OK != heap_enable_handles(heap)) {
+        return JRET_ERROR;
+    }
 
     /* 检查是否需要重新分配内存 */
-    if(heap->size >= heap->capacity) {
-        newSize = heap->capacity + BINARY_HEAP_CAPACITY * heapTms;
-        newValue = realloc(heap->values, sizeof (JBinaryHeapValue) * newSize);
-        if(JRET_PTR_NULL == newValue) {
-            return JRET_ERROR;
-        }
-        heap->capacity = newSize;
-        heap->values = newValue;
+    if(JRET_OK != heap_grow(heap, 1)) {
+        return JRET_ERROR;
     }
 
     /* 添加新值 */
-    index = heap->size;
-    *(heap->values + index) = value;
+    if (JRET_PTR_NULL != heap->handles) {
+        newHandle = heap_handle_alloc(heap);
+    }
     ++ heap->size;
-    while (index > 0 && (JRET_BIGGER == value_compare(heap, *(heap->values + parent(index)), *(heap->values + index)))) {
-        swap(heap->values + index, heap->values + parent(index));
-        index = parent(index);
+    heap_sift_up(heap, heap->size - 1, value, newHandle);
+
+    if (JRET_PTR_NULL != handle) {
+        *handle = newHandle;
     }
 
     return JRET_OK;
 }
 
 JBinaryHeapValue binary_heap_pop(JBinaryHeap *heap) {
-    JBinaryHeapValue     popValue;
-
     /* 是否为空堆 */
-    if(0 == heap->size) {
+    if(0 == heap->size || heap->inlineMode) {
         return JBINARY_HEAP_NULL;
     }
 
-    if(1 == heap->size) {
-        -- heap->size;
-        return *heap->values;
+    /* 从堆顶取元素并删除 */
+    return heap_remove_at(heap, 0);
+}
+
+JBinaryHeapValue binary_heap_peek(JBinaryHeap *heap) {
+    if(0 == heap->size || heap->inlineMode) {
+        return JBINARY_HEAP_NULL;
     }
 
-    /* 从堆顶取元素 */
-    popValue = *heap->values;
+    return heap->values[0];
+}
 
-    /* 删除堆顶元素 */
-    -- heap->size;
-    *heap->values = *(heap->values + heap->size);
+JBinaryHeapValue binary_heap_replace_top(JBinaryHeap *heap, JBinaryHeapValue value) {
+    JBinaryHeapValue    top;
+
+    if(0 == heap->size || heap->inlineMode) {
+        return JBINARY_HEAP_NULL;
+    }
+
+    top = heap->values[0];
+    heap_sift_down(heap, 0, value, heap_handle_at(heap, 0));
+
+    return top;
+}
+
+int binary_heap_update(JBinaryHeap *heap, JBinaryHeapHandle handle) {
+    unsigned int        pos = heap_handle_position(heap, handle);
+
+    if (pos >= heap->size) {
+        return JRET_NOTFOUND;
+    }
+
+    if (pos > 0 && JRET_BIGGER == value_compare(heap, heap->values[parent(heap, pos)], heap->values[pos])) {
+        heap_sift_up(heap, pos, heap->values[pos], handle);
+    } else {
+        heap_sift_down(heap, pos, heap->values[pos], handle);
+    }
+
+    return JRET_OK;
+}
+
+JBinaryHeapValue binary_heap_remove(JBinaryHeap *heap, JBinaryHeapHandle handle) {
+    unsigned int        pos = heap_handle_position(heap, handle);
 
-    heap_adjust(heap, 0);
+    if (pos >= heap->size) {
+        return JBINARY_HEAP_NULL;
+    }
 
-    return popValue;
+    return heap_remove_at(heap, pos);
+}
+
+JBinaryHeapValue binary_heap_handle_value(JBinaryHeap *heap, JBinaryHeapHandle handle) {
+    unsigned int        pos = heap_handle_position(heap, handle);
+
+    if (pos >= heap->size) {
+        return JBINARY_HEAP_NULL;
+    }
+
+    return heap->values[pos];
+}
+
+JBinaryHeap *binary_heap_new_from_array(JBinaryHeapType type, binary_heap_compare_cb compareFunction, JBinaryHeapValue *values, unsigned int num) {
+    JBinaryHeap*             heap = JRET_PTR_NULL;
+
+    heap = binary_heap_new(type, compareFunction);
+    if (JRET_PTR_NULL == heap) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_OK != binary_heap_insert_batch(heap, values, num)) {
+        binary_heap_free(heap);
+        return JRET_PTR_NULL;
+    }
+
+    return heap;
+}
+
+int binary_heap_insert_batch(JBinaryHeap *heap, JBinaryHeapValue *values, unsigned int num) {
+    unsigned int        lo;
+    unsigned int        hi;
+    unsigned int        i;
+
+    if (heap->inlineMode) {
+        return JRET_ERROR;
+    }
+
+    if (0 == num) {
+        return JRET_OK;
+    }
+
+    if (JRET_OK != heap_grow(heap, num)) {
+        return JRET_ERROR;
+    }
+
+    memcpy(heap->values + heap->size, values, sizeof (JBinaryHeapValue) * num);
+    if (JRET_PTR_NULL != heap->handles) {
+        for (i = heap->size; i < heap->size + num; ++i) {
+            heap_place(heap, i, heap->values[i], heap_handle_alloc(heap));
+        }
+    }
+    lo = heap->size > 0 ? heap->size : 1;                      // 空堆时根也是新值, 从它的孩子开始
+    heap->size += num;
+    hi = heap->size - 1;
+
+    /**
+     * [lo, hi] 的祖先在上一层也是连续的一段, 逐层向上对这一段下沉,
+     * 调整某个节点时它的孩子都已经是堆, 到根为止
+     */
+    while (lo <= hi && lo > 0) {
+        lo = parent(heap, lo);
+        hi = parent(heap, hi);
+        for (i = hi + 1; i > lo; --i) {
+            heap_adjust(heap, i - 1);
+        }
+    }
+
+    return JRET_OK;
+}
+
+unsigned int binary_heap_pop_n(JBinaryHeap *heap, JBinaryHeapValue *values, unsigned int num) {
+    unsigned int        i;
+
+    if (num > heap->size) {
+        num = heap->size;
+    }
+
+    if (heap->inlineMode) {
+        return 0;
+    }
+
+    for (i = 0; i < num; ++i) {
+        values[i] = heap_remove_at(heap, 0);
+    }
+
+    return num;
+}
+
+int binary_heap_insert_int64(JBinaryHeap *heap, int64_t priority, const void *payload) {
+    return heap_inline_insert(heap, JBINARY_HEAP_KEY_INT64, priority, payload);
+}
+
+int binary_heap_insert_double(JBinaryHeap *heap, double priority, const void *payload) {
+    int64_t             bits;
+
+    memcpy(&bits, &priority, sizeof (bits));
+
+    return heap_inline_insert(heap, JBINARY_HEAP_KEY_DOUBLE, bits, payload);
+}
+
+int binary_heap_peek_int64(JBinaryHeap *heap, int64_t *priority, void *payload) {
+    return heap_inline_peek(heap, JBINARY_HEAP_KEY_INT64, priority, payload);
+}
+
+int binary_heap_peek_double(JBinaryHeap *heap, double *priority, void *payload) {
+    int64_t             bits;
+
+    if (JRET_OK != heap_inline_peek(heap, JBINARY_HEAP_KEY_DOUBLE, &bits, payload)) {
+        return JRET_ERROR;
+    }
+    if (JRET_PTR_NULL != priority) {
+        memcpy(priority, &bits, sizeof (bits));
+    }
+
+    return JRET_OK;
+}
+
+int binary_heap_pop_int64(JBinaryHeap *heap, int64_t *priority, void *payload) {
+    return heap_inline_pop(heap, JBINARY_HEAP_KEY_INT64, priority, payload);
+}
+
+int binary_heap_pop_double(JBinaryHeap *heap, double *priority, void *payload) {
+    int64_t             bits;
+
+    if (JRET_OK != heap_inline_pop(heap, JBINARY_HEAP_KEY_DOUBLE, &bits, payload)) {
+        return JRET_ERROR;
+    }
+    if (JRET_PTR_NULL != priority) {
+        memcpy(priority, &bits, sizeof (bits));
+    }
+
+    return JRET_OK;
 }
 
 unsigned int binary_heap_num(JBinaryHeap *heap) {
     return heap->size;
 }
 
+int binary_heap_set_growth(JBinaryHeap *heap, unsigned int growthPercent, unsigned int minGrowth) {
+    if (0 == growthPercent && 0 == minGrowth) {
+        return JRET_ERROR;
+    }
+
+    heap->growthPercent = growthPercent;
+    heap->growthMin = minGrowth;
+
+    return JRET_OK;
+}
+
+int binary_heap_reserve(JBinaryHeap *heap, unsigned int capacity) {
+    if (capacity <= heap->capacity) {
+        return JRET_OK;
+    }
+
+    return heap_reserve(heap, capacity);
+}
+
+void binary_heap_memory_stats(JBinaryHeap *heap, JMemoryStats *stats) {
+    size_t              elementSize = sizeof (JBinaryHeapValue);
+
+    if (heap->inlineMode) {
+        elementSize = sizeof (int64_t) + heap->payloadSize;
+    } else if (JRET_PTR_NULL != heap->handles) {
+        elementSize += sizeof (JBinaryHeapHandle) + sizeof (unsigned int);
+    }
+
+    *stats = heap->memStats;
+    stats->wasted = heap->memStats.live - sizeof (JBinaryHeap) - elementSize * heap->size;
+}
+
+int binary_heap_get_stats(JBinaryHeap *heap, JBinaryHeapStats *stats) {
+#ifdef JDS_STATS
+    *stats = heap->stats;
+    return JRET_OK;
+#else
+    (void) heap;
+    memset(stats, 0, sizeof (JBinaryHeapStats));
+    return JRET_ERROR;
+#endif
+}
+
+void binary_heap_reset_stats(JBinaryHeap *heap) {
+#ifdef JDS_STATS
+    memset(&heap->stats, 0, sizeof (JBinaryHeapStats));
+#else
+    (void) heap;
+#endif
+}
+
 void binary_heap_free(JBinaryHeap *heap) {
-    free(heap->values);
-    free(heap);
+    if (JRET_PTR_NULL != heap->handles) {
+        heap_free(heap, heap->handles, sizeof (JBinaryHeapHandle) * heap->capacity, sizeof (JBinaryHeapHandle));
+        heap_free(heap, heap->positions, sizeof (unsigned int) * heap->capacity, sizeof (unsigned int));
+    }
+    if (heap->inlineMode) {
+        heap_free(heap, heap->keyMemory, heap_aligned_bytes(heap, sizeof (int64_t), heap->capacity), BINARY_HEAP_CACHE_LINE);
+        heap_free(heap, heap->payloads, (size_t) heap->payloadSize * heap->capacity + 1, 1);
+    } else {
+        heap_free(heap, heap->memory, heap_aligned_bytes(heap, sizeof (JBinaryHeapValue), heap->capacity), BINARY_HEAP_CACHE_LINE);
+    }
+    jallocator_free(heap->allocator, JRET_PTR_NULL, heap, sizeof (JBinaryHeap), sizeof (void*));
 }
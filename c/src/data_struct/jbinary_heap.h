@@ -1,6 +1,9 @@
 #ifndef BINARY_HEAP_H
 #define BINARY_HEAP_H
 #include "jret.h"
+#include "jallocator.h"
+
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,12 +18,37 @@ typedef enum {
     JBINARY_HEAP_TYPE_MAX
 } JBinaryHeapType;
 
+/* 内联模式的优先级类型 */
+typedef enum {
+    JBINARY_HEAP_KEY_INT64,
+    JBINARY_HEAP_KEY_DOUBLE
+} JBinaryHeapKeyType;
+
 /* 堆结构 */
 typedef struct _JBinaryHeap JBinaryHeap;
 
 /* 堆中存储的值 */
 typedef void* JBinaryHeapValue;
 
+/**
+ * 堆中元素的句柄
+ * 元素在堆中移动时句柄不变, 用来修改优先级或删除任意元素; 元素出堆后句柄失效, 之后可能被复用
+ */
+typedef unsigned int JBinaryHeapHandle;
+
+/* 堆的内部计数, 编译时定义 JDS_STATS 才会计数(见 jstats.h) */
+typedef struct _JBinaryHeapStats JBinaryHeapStats;
+struct _JBinaryHeapStats {
+    uint64_t                comparisons;            // 比较函数调用次数, 内联模式直接比较排序键, 不计
+    uint64_t                sifts;                  // 上浮、下沉(包括批量建堆时的调整)的次数
+    uint64_t                siftLevels;             // 上浮、下沉移动的层数之和
+    uint64_t                maxSiftLevels;          // 一次上浮或下沉移动的最多层数
+    uint64_t                reallocs;               // 扩容时重新申请数组并复制元素的次数
+};
+
+/* 无效句柄 */
+#define JBINARY_HEAP_HANDLE_INVALID ((JBinaryHeapHandle) -1)
+
 /**
  * 堆中用来比较大小的函数指针类型
  *
@@ -41,6 +69,69 @@ typedef int (* binary_heap_compare_cb) (JBinaryHeapValue value1, JBinaryHeapValu
 JBinaryHeap* binary_heap_new(JBinaryHeapType type, binary_heap_compare_cb compareFunction);
 
 
+/**
+ * 创建 d 叉堆
+ * 每个节点有 arity 个孩子, 同一节点的孩子在内存中连续并按缓存行对齐,
+ * 下沉时一次缓存未命中就能比较完所有孩子, 树高也只有二叉堆的 1/2 (4 叉) 或 1/3 (8 叉),
+ * 元素很多时弹出明显更快。binary_heap_new 等价于 arity 为 2。
+ *
+ * @param type:                     堆类型
+ * @param arity:                    每个节点的孩子数, 只能是 2、4 或 8
+ * @param compareFunction:          值比较函数
+ *
+ * @return 成功：  返回新的堆
+ *         失败： 返回 RET_PTR_NULL (arity 不支持或内存不足)
+ */
+JBinaryHeap* binary_heap_new_with_arity(JBinaryHeapType type, unsigned int arity, binary_heap_compare_cb compareFunction);
+
+
+/**
+ * 创建内联堆
+ * 元素是一个 int64 或 double 优先级加上 payloadSize 字节的数据, 直接复制到堆自己的数组中,
+ * 不需要比较函数, 比较时不解引用用户指针、不调用函数; 4 叉和 8 叉堆用 SIMD 在一组孩子中找最值。
+ * 内联堆只能使用 binary_heap_*_int64 / binary_heap_*_double 和 binary_heap_num,
+ * 其它以 JBinaryHeapValue 为参数的函数会返回失败。
+ *
+ * @param type:                     堆类型
+ * @param keyType:                  优先级类型
+ * @param payloadSize:              每个元素数据的字节数, 可以为 0
+ * @param arity:                    每个节点的孩子数, 只能是 2、4 或 8
+ *
+ * @return 成功：  返回新的堆
+ *         失败： 返回 RET_PTR_NULL
+ */
+JBinaryHeap* binary_heap_new_inline(JBinaryHeapType type, JBinaryHeapKeyType keyType, unsigned int payloadSize, unsigned int arity);
+
+
+/**
+ * 使用指定分配器创建 d 叉堆 / 内联堆, 堆结构和元素数组都从分配器申请
+ * 分配器是 arena 时, 扩容后旧数组的空间要等 arena 销毁时才释放
+ *
+ * @param allocator:                分配器, RET_PTR_NULL 表示默认分配器; 必须比堆活得长
+ *
+ * @return 成功：  返回新的堆
+ *         失败： 返回 RET_PTR_NULL
+ */
+JBinaryHeap* binary_heap_new_with_allocator(JBinaryHeapType type, unsigned int arity, binary_heap_compare_cb compareFunction, const JAllocator* allocator);
+JBinaryHeap* binary_heap_new_inline_with_allocator(JBinaryHeapType type, JBinaryHeapKeyType keyType, unsigned int payloadSize, unsigned int arity,
+                                                   const JAllocator* allocator);
+
+
+/**
+ * 由数组创建二叉堆, 用 Floyd 建堆算法, O(n)
+ * 需要 d 叉堆时先用 binary_heap_new_with_arity 创建, 再用 binary_heap_insert_batch 插入
+ *
+ * @param type:                     堆类型
+ * @param compareFunction:          值比较函数
+ * @param values:                   要放入堆中的值, 数组本身不会被堆引用
+ * @param num:                      值的数量
+ *
+ * @return 成功：  返回新的堆
+ *         失败： 返回 RET_PTR_NULL
+ */
+JBinaryHeap* binary_heap_new_from_array(JBinaryHeapType type, binary_heap_compare_cb compareFunction, JBinaryHeapValue* values, unsigned int num);
+
+
 /**
  * 释放堆
  * @param heap:                     要是放的堆指针
@@ -60,6 +151,73 @@ void binary_heap_free(JBinaryHeap* heap);
 int binary_heap_insert(JBinaryHeap* heap, JBinaryHeapValue value);
 
 
+/**
+ * 插入值并返回句柄
+ * 第一次调用时堆开始为每个元素维护句柄和位置, 之后所有插入的元素都有句柄,
+ * 每次移动元素多更新一个位置; 不使用句柄的堆没有这部分开销
+ *
+ * @param heap:                     堆
+ * @param value:                    要插入的值
+ * @param handle:                   返回新元素的句柄, 可以为 RET_PTR_NULL
+ *
+ * @return                          成功： RET_OK
+ *                                  失败： RET_ERROR
+ */
+int binary_heap_insert_with_handle(JBinaryHeap* heap, JBinaryHeapValue value, JBinaryHeapHandle* handle);
+
+
+/**
+ * 元素的优先级被用户修改后, 调整它在堆中的位置, O(log n)
+ * 优先级变大变小都可以(decrease-key / increase-key)
+ *
+ * @param heap:                     堆
+ * @param handle:                   元素的句柄
+ *
+ * @return                          成功： RET_OK
+ *                                  句柄无效： RET_NOTFOUND
+ */
+int binary_heap_update(JBinaryHeap* heap, JBinaryHeapHandle handle);
+
+
+/**
+ * 删除句柄对应的元素, O(log n)
+ *
+ * @param heap:                     堆
+ * @param handle:                   元素的句柄
+ *
+ * @return                          成功: 返回删除的元素
+ *                                  句柄无效: 返回 RET_PTR_NULL
+ */
+JBinaryHeapValue binary_heap_remove(JBinaryHeap* heap, JBinaryHeapHandle handle);
+
+
+/**
+ * 句柄对应的元素
+ *
+ * @param heap:                     堆
+ * @param handle:                   元素的句柄
+ *
+ * @return                          成功: 返回元素
+ *                                  句柄无效: 返回 RET_PTR_NULL
+ */
+JBinaryHeapValue binary_heap_handle_value(JBinaryHeap* heap, JBinaryHeapHandle handle);
+
+
+/**
+ * 批量插入值
+ * 一次申请好空间, 把值全部追加到末尾后自底向上逐层修复:
+ * 只调整新值的祖先, 批量越大越接近 O(k), 空堆时就是 Floyd 建堆
+ *
+ * @param heap:                     堆
+ * @param values:                   要插入的值
+ * @param num:                      值的数量
+ *
+ * @return                          成功： RET_OK
+ *                                  失败： RET_ERROR (内存不足, 堆不变)
+ */
+int binary_heap_insert_batch(JBinaryHeap* heap, JBinaryHeapValue* values, unsigned int num);
+
+
 /**
  * 弹出堆顶元素
  * @param heap:                     堆
@@ -70,6 +228,81 @@ int binary_heap_insert(JBinaryHeap* heap, JBinaryHeapValue value);
 JBinaryHeapValue binary_heap_pop(JBinaryHeap* heap);
 
 
+/**
+ * 查看堆顶元素, 不弹出
+ * @param heap:                     堆
+ *
+ * @return                          成功: 返回堆顶元素
+ *                                  失败: 返回 RET_PTR_NULL (空堆或内联堆)
+ */
+JBinaryHeapValue binary_heap_peek(JBinaryHeap* heap);
+
+
+/**
+ * 用 value 替换堆顶元素, 只下沉一次
+ * 相当于 binary_heap_pop 之后 binary_heap_insert, 但省掉了一次上浮和把末尾元素挪到堆顶,
+ * 适合多路归并这类"取出最小值, 再放回同一路的下一个值"的场景;
+ * value 可以就是堆顶元素本身(优先级被修改后重新下沉)。有句柄时 value 沿用原堆顶的句柄
+ *
+ * @param heap:                     堆
+ * @param value:                    新值
+ *
+ * @return                          成功: 返回原来的堆顶元素
+ *                                  失败: 返回 RET_PTR_NULL (空堆或内联堆, 堆不变)
+ */
+JBinaryHeapValue binary_heap_replace_top(JBinaryHeap* heap, JBinaryHeapValue value);
+
+
+/**
+ * 依次弹出最多 num 个堆顶元素
+ * @param heap:                     堆
+ * @param values:                   存放弹出元素的数组, 按弹出顺序存放
+ * @param num:                      最多弹出的数量
+ *
+ * @return                          实际弹出的数量
+ */
+unsigned int binary_heap_pop_n(JBinaryHeap* heap, JBinaryHeapValue* values, unsigned int num);
+
+
+/**
+ * 内联堆插入元素, 优先级类型要与创建时一致
+ * @param heap:                     内联堆
+ * @param priority:                 优先级
+ * @param payload:                  元素数据, 复制 payloadSize 字节; 为 RET_PTR_NULL 时填 0
+ *
+ * @return                          成功： RET_OK
+ *                                  失败： RET_ERROR
+ */
+int binary_heap_insert_int64(JBinaryHeap* heap, int64_t priority, const void* payload);
+int binary_heap_insert_double(JBinaryHeap* heap, double priority, const void* payload);
+
+
+/**
+ * 内联堆查看堆顶元素, 不弹出
+ * @param heap:                     内联堆
+ * @param priority:                 返回优先级, 可以为 RET_PTR_NULL
+ * @param payload:                  返回元素数据, 可以为 RET_PTR_NULL
+ *
+ * @return                          成功： RET_OK
+ *                                  空堆： RET_ERROR
+ */
+int binary_heap_peek_int64(JBinaryHeap* heap, int64_t* priority, void* payload);
+int binary_heap_peek_double(JBinaryHeap* heap, double* priority, void* payload);
+
+
+/**
+ * 内联堆弹出堆顶元素
+ * @param heap:                     内联堆
+ * @param priority:                 返回优先级, 可以为 RET_PTR_NULL
+ * @param payload:                  返回元素数据, 可以为 RET_PTR_NULL
+ *
+ * @return                          成功： RET_OK
+ *                                  空堆： RET_ERROR
+ */
+int binary_heap_pop_int64(JBinaryHeap* heap, int64_t* priority, void* payload);
+int binary_heap_pop_double(JBinaryHeap* heap, double* priority, void* payload);
+
+
 /**
  * 堆中值得数量
  * @param heap:                     堆
@@ -78,6 +311,61 @@ JBinaryHeapValue binary_heap_pop(JBinaryHeap* heap);
  */
 unsigned int binary_heap_num(JBinaryHeap* heap);
 
+
+/**
+ * 设置扩容策略: 空间不够时容量增加 max(当前容量 * growthPercent / 100, minGrowth),
+ * 且至少能放下要插入的元素。默认 growthPercent 为 50, minGrowth 为 1024
+ *
+ * @param heap:                     堆
+ * @param growthPercent:            按当前容量增加的百分比
+ * @param minGrowth:                每次至少增加的元素数
+ *
+ * @return                          成功： RET_OK
+ *                                  失败： RET_ERROR (两个参数都为 0)
+ */
+int binary_heap_set_growth(JBinaryHeap* heap, unsigned int growthPercent, unsigned int minGrowth);
+
+
+/**
+ * 预留空间, 之后插入到 capacity 个元素之前不会再扩容
+ *
+ * @param heap:                     堆
+ * @param capacity:                 容量, 不大于当前容量时什么也不做
+ *
+ * @return                          成功： RET_OK
+ *                                  失败： RET_ERROR (内存不足, 堆不变)
+ */
+int binary_heap_reserve(JBinaryHeap* heap, unsigned int capacity);
+
+
+/**
+ * 堆的内存统计, wasted 是预留但没有存放元素的空间
+ *
+ * @param heap:                     堆
+ * @param stats:                    统计结果
+ */
+void binary_heap_memory_stats(JBinaryHeap* heap, JMemoryStats* stats);
+
+
+/**
+ * 堆的内部计数, 从创建或上次 binary_heap_reset_stats 开始累计
+ *
+ * @param heap:                     堆
+ * @param stats:                    计数结果, 编译时没有开启计数则全为 0
+ *
+ * @return                          成功： RET_OK
+ *                                  失败： RET_ERROR (编译时没有定义 JDS_STATS)
+ */
+int binary_heap_get_stats(JBinaryHeap* heap, JBinaryHeapStats* stats);
+
+
+/**
+ * 计数清零
+ *
+ * @param heap:                     堆
+ */
+void binary_heap_reset_stats(JBinaryHeap* heap);
+
 #ifdef __cplusplus
 }
 #endif
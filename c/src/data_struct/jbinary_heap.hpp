@@ -0,0 +1,190 @@
+#ifndef JBINARY_HEAP_HPP
+#define JBINARY_HEAP_HPP
+
+/**
+ *  d 叉堆的 C++ 模板版本 (C++11, 只有头文件)
+ *
+ *  算法与 jbinary_heap.c 相同: 叉数为 2/4/8, 上浮和下沉都是"挖空位"的方式,
+ *  值只在最终位置写一次; 批量插入按层向上修复新值的祖先。
+ *  与 C 版本的不同:
+ *      元素按值存放在连续数组中, 不需要为每个元素单独申请内存;
+ *      比较器是函数对象, 可以内联, 不经过函数指针;
+ *      支持只能移动的类型, emplace 直接在堆中构造元素。
+ *
+ *  Compare(a, b) 为真表示 a 应该先于 b 出堆, 默认 std::less 是最小堆,
+ *  与 std::priority_queue 相反(它的 std::less 是最大堆)。
+ *
+ *  用法:
+ *      jds::heap<int> h;                                   // 4 叉最小堆
+ *      jds::heap<Job, JobLater, 8> jobs;                   // 8 叉, 自定义比较
+ *      h.push(3); h.emplace(1);
+ *      int x = h.take();                                   // 取出并删除堆顶
+ */
+#include <vector>
+#include <functional>
+#include <utility>
+#include <iterator>
+#include <cstddef>
+
+namespace jds {
+
+template <typename T, typename Compare = std::less<T>, unsigned int Arity = 4>
+class heap {
+    static_assert(Arity == 2 || Arity == 4 || Arity == 8, "jds::heap arity must be 2, 4 or 8");
+
+public:
+    typedef T                   value_type;
+    typedef std::size_t         size_type;
+    typedef Compare             value_compare;
+
+    explicit heap(const Compare& compare = Compare()) : mCompare(compare) {}
+
+    /* 由一组值建堆, 等价于 binary_heap_new_from_array */
+    template <typename InputIt>
+    heap(InputIt first, InputIt last, const Compare& compare = Compare()) : mCompare(compare) {
+        insert(first, last);
+    }
+
+    bool empty() const { return mValues.empty(); }
+    size_type size() const { return mValues.size(); }
+    void reserve(size_type capacity) { mValues.reserve(capacity); }
+    void clear() { mValues.clear(); }
+
+    /* 堆顶, 调用者保证堆不为空 */
+    const T& top() const { return mValues.front(); }
+
+    void push(const T& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+
+    /* 在堆尾直接构造, 再上浮 */
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        mValues.emplace_back(std::forward<Args>(args)...);
+        sift_up(mValues.size() - 1);
+    }
+
+    /**
+     *  批量插入, 与 binary_heap_insert_batch 相同:
+     *  新值放到末尾, [lo, hi] 的祖先在上一层也是连续的一段, 逐层向上对这一段下沉
+     */
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        size_type       lo = mValues.size() > 0 ? mValues.size() : 1;     // 空堆时根也是新值, 从它的孩子开始
+        size_type       hi;
+        size_type       i;
+
+        mValues.insert(mValues.end(), first, last);
+        if (mValues.size() < lo + 1) {
+            return;
+        }
+
+        hi = mValues.size() - 1;
+        while (lo <= hi && lo > 0) {
+            lo = parent(lo);
+            hi = parent(hi);
+            for (i = hi + 1; i > lo; --i) {
+                sift_down(i - 1, std::move(mValues[i - 1]));
+            }
+        }
+    }
+
+    /* 删除堆顶, 调用者保证堆不为空 */
+    void pop() {
+        T               last = std::move(mValues.back());
+
+        mValues.pop_back();
+        if (!mValues.empty()) {
+            sift_down(0, std::move(last));
+        }
+    }
+
+    /* 取出并删除堆顶, 只能移动的类型用它代替 top() + pop() */
+    T take() {
+        T               value = std::move(mValues.front());
+
+        pop();
+        return value;
+    }
+
+    /* 用 value 替换堆顶并下沉一次, 返回原来的堆顶, 比 take() + push() 少一次上浮; 调用者保证堆不为空 */
+    T replace_top(T value) {
+        T               top = std::move(mValues.front());
+
+        sift_down(0, std::move(value));
+        return top;
+    }
+
+    /* 按出堆顺序取出最多 num 个值写入 out, 返回取出的个数 */
+    template <typename OutputIt>
+    size_type pop_n(OutputIt out, size_type num) {
+        size_type       i;
+
+        if (num > mValues.size()) {
+            num = mValues.size();
+        }
+
+        for (i = 0; i < num; ++i) {
+            *out++ = take();
+        }
+
+        return num;
+    }
+
+private:
+    static size_type first_child(size_type i) { return i * Arity + 1;}
+    static size_type parent(size_type i) { return (i - 1) / Arity;}
+
+    /* 上浮: 位置 i 挖空, 父节点比它靠后就下移, 最后把值放入空位 */
+    void sift_up(size_type i) {
+        T               value = std::move(mValues[i]);
+
+        while (i > 0 && mCompare(value, mValues[parent(i)])) {
+            mValues[i] = std::move(mValues[parent(i)]);
+            i = parent(i);
+        }
+
+        mValues[i] = std::move(value);
+    }
+
+    /* 下沉: 位置 i 的值已经移入 value, 从空位 i 开始, 在所有孩子中找最靠前的, 比要放的值更靠前就上移, 直到叶子 */
+    void sift_down(size_type i, T value) {
+        size_type       size = mValues.size();
+        size_type       child;
+        size_type       last;
+        size_type       st;
+
+        for (;;) {
+            child = first_child(i);
+            if (child >= size) {
+                break;
+            }
+
+            last = child + Arity;
+            if (last > size) {
+                last = size;
+            }
+
+            for (st = child ++; child < last; ++ child) {                   // 孩子中找最值
+                if (mCompare(mValues[child], mValues[st])) {
+                    st = child;
+                }
+            }
+
+            if (!mCompare(mValues[st], value)) {                            // 不需要调整
+                break;
+            }
+
+            mValues[i] = std::move(mValues[st]);
+            i = st;
+        }
+
+        mValues[i] = std::move(value);
+    }
+
+    std::vector<T>              mValues;
+    Compare                     mCompare;
+};
+
+}
+
+#endif // JBINARY_HEAP_HPP
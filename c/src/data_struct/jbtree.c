@@ -0,0 +1,572 @@
+#define _GNU_SOURCE
+#include "jbtree.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#if JBTREE_MAX_KEYS < 16 || JBTREE_MAX_KEYS > 64 || JBTREE_MAX_KEYS % 4 != 0
+#error "JBTREE_MAX_KEYS must be a multiple of 4 between 16 and 64"
+#endif
+
+#define JBTREE_MIN_KEYS             (JBTREE_MAX_KEYS / 2)   // 非根节点最少的 key 数
+#define JBTREE_CACHE_LINE           (64)
+#define JBTREE_MAX_DEPTH            (32)                    // 每层至少 JBTREE_MIN_KEYS 个分支, 32 层足够
+
+typedef struct _JBTreeNode JBTreeNode;
+
+/**
+ *  B+ 树节点
+ *  keys 放在最前面, 与缓存行对齐, 节点内查找只访问 keys
+ *
+ *  叶子节点: slots[i] 是 keys[i] 的 value
+ *  内部节点: slots[i] 是子节点, 子树 slots[i] 中的 key 都在 [keys[i - 1], keys[i]) 内
+ */
+struct _JBTreeNode {
+    JBTreeKey               keys[JBTREE_MAX_KEYS];
+    unsigned int            numKeys;
+    unsigned int            isLeaf;
+    JBTreeNode*             next;                           // 叶子节点: 按 key 顺序的下一个叶子
+    void*                   slots[JBTREE_MAX_KEYS + 1];
+};
+
+struct _JBTree {
+    JBTreeNode*             rootNode;
+    JBTreeCompareFunc       compareFunc;                    // 整数 key 模式下为空
+    unsigned int            numEntries;
+    const JAllocator*       allocator;
+    JMemoryStats            memStats;
+};
+
+/**
+ *  整数模式: 节点中小于 key 的 key 数
+ *  key 有序, 所以结果就是 key 应在的位置; 不分支, 一次比较 4 个(AVX2) 或 2 个(SSE4.2) key
+ */
+static unsigned int jbtree_int_count_less(JBTreeKey* keys, unsigned int num, intptr_t key) {
+#if defined(__AVX2__) && INTPTR_MAX == INT64_MAX
+    const __m256i           target = _mm256_set1_epi64x(key);
+    uint64_t                mask = 0;
+    unsigned int            i;
+
+    for (i = 0; i < num; i += 4) {
+        __m256i v = _mm256_load_si256((const __m256i*) (keys + i));
+        mask |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(target, v))) << i;
+    }
+    if (num < 64) {
+        mask &= ((uint64_t) 1 << num) - 1;                  // 去掉 num 之后的无效 key
+    }
+
+    return __builtin_popcountll(mask);
+#elif defined(__SSE4_2__) && INTPTR_MAX == INT64_MAX
+    const __m128i           target = _mm_set1_epi64x(key);
+    uint64_t                mask = 0;
+    unsigned int            i;
+
+    for (i = 0; i < num; i += 2) {
+        __m128i v = _mm_load_si128((const __m128i*) (keys + i));
+        mask |= (uint64_t) _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(target, v))) << i;
+    }
+    if (num < 64) {
+        mask &= ((uint64_t) 1 << num) - 1;
+    }
+
+    return __builtin_popcountll(mask);
+#else
+    unsigned int            count = 0;
+    unsigned int            i;
+
+    for (i = 0; i < num; ++i) {
+        count += (intptr_t) keys[i] < key;
+    }
+
+    return count;
+#endif
+}
+
+/* 节点中小于 key 的 key 数 */
+static unsigned int jbtree_node_lower(JBTree* tree, JBTreeNode* node, JBTreeKey key) {
+    unsigned int            lo = 0;
+    unsigned int            hi = node->numKeys;
+    unsigned int            mid;
+
+    if (JRET_PTR_NULL == tree->compareFunc) {
+        return jbtree_int_count_less(node->keys, node->numKeys, JBTREE_KEY_INT(key));
+    }
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (JRET_SMALLER == tree->compareFunc(node->keys[mid], key)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* 节点中小于等于 key 的 key 数, 内部节点用它选择子树 */
+static unsigned int jbtree_node_upper(JBTree* tree, JBTreeNode* node, JBTreeKey key) {
+    unsigned int            lo = 0;
+    unsigned int            hi = node->numKeys;
+    unsigned int            mid;
+
+    if (JRET_PTR_NULL == tree->compareFunc) {
+        if (INTPTR_MAX == JBTREE_KEY_INT(key)) {
+            return node->numKeys;
+        }
+        return jbtree_int_count_less(node->keys, node->numKeys, JBTREE_KEY_INT(key) + 1);
+    }
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (JRET_BIGGER == tree->compareFunc(node->keys[mid], key)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
+static int jbtree_key_equal(JBTree* tree, JBTreeKey key1, JBTreeKey key2) {
+    if (JRET_PTR_NULL == tree->compareFunc) {
+        return key1 == key2;
+    }
+
+    return JRET_EQUAL == tree->compareFunc(key1, key2);
+}
+
+static JBTreeNode* jbtree_node_new(JBTree* tree) {
+    JBTreeNode*             node = JRET_PTR_NULL;
+
+    node = jallocator_alloc(tree->allocator, &tree->memStats, sizeof (JBTreeNode), JBTREE_CACHE_LINE);
+    if (JRET_PTR_NULL == node) {
+        return JRET_PTR_NULL;
+    }
+
+    memset(node->keys, 0, sizeof (node->keys));             // SIMD 查找会读到 numKeys 之后的 key
+    node->numKeys = 0;
+    node->isLeaf = 1;
+    node->next = JRET_PTR_NULL;
+
+    return node;
+}
+
+static void jbtree_node_release(JBTree* tree, JBTreeNode* node) {
+    jallocator_free(tree->allocator, &tree->memStats, node, sizeof (JBTreeNode), JBTREE_CACHE_LINE);
+}
+
+static void jbtree_node_free(JBTree* tree, JBTreeNode* node) {
+    unsigned int            i;
+
+    if (!node->isLeaf) {
+        for (i = 0; i <= node->numKeys; ++i) {
+            jbtree_node_free(tree, node->slots[i]);
+        }
+    }
+
+    jbtree_node_release(tree, node);
+}
+
+/**
+ *  从根下降到 key 所在的叶子
+ *  经过的内部节点和选择的子树下标记录在 path/indexes 中, 插入删除时自底向上调整
+ */
+static JBTreeNode* jbtree_descend(JBTree* tree, JBTreeKey key, JBTreeNode** path, unsigned int* indexes, unsigned int* depth) {
+    JBTreeNode*             node = tree->rootNode;
+    unsigned int            index;
+
+    *depth = 0;
+    while (!node->isLeaf) {
+        index = jbtree_node_upper(tree, node, key);
+        path[*depth] = node;
+        indexes[*depth] = index;
+        ++ *depth;
+        node = node->slots[index];
+    }
+
+    return node;
+}
+
+/* 在未满的节点中 pos 处插入 key 和 slot(叶子为 value, 内部节点为 key 右边的子节点) */
+static void jbtree_node_insert_at(JBTreeNode* node, unsigned int pos, JBTreeKey key, void* slot) {
+    unsigned int            slotPos = node->isLeaf ? pos : pos + 1;
+
+    memmove(&node->keys[pos + 1], &node->keys[pos], sizeof (JBTreeKey) * (node->numKeys - pos));
+    memmove(&node->slots[slotPos + 1], &node->slots[slotPos], sizeof (void*) * (node->numKeys + !node->isLeaf - slotPos));
+    node->keys[pos] = key;
+    node->slots[slotPos] = slot;
+    ++ node->numKeys;
+}
+
+/* 删除节点中 pos 处的 key 和 slot(叶子为 value, 内部节点为 key 右边的子节点) */
+static void jbtree_node_remove_at(JBTreeNode* node, unsigned int pos) {
+    unsigned int            slotPos = node->isLeaf ? pos : pos + 1;
+
+    memmove(&node->keys[pos], &node->keys[pos + 1], sizeof (JBTreeKey) * (node->numKeys - pos - 1));
+    memmove(&node->slots[slotPos], &node->slots[slotPos + 1], sizeof (void*) * (node->numKeys + !node->isLeaf - slotPos - 1));
+    -- node->numKeys;
+}
+
+/**
+ *  满节点插入时分裂
+ *  把插入后的 JBTREE_MAX_KEYS + 1 个 key 分到 node 和 right 两个节点中,
+ *  返回要插入父节点的分隔 key: 叶子为 right 的第一个 key, 内部节点为中间 key(上移, 不再留在子节点)
+ */
+static JBTreeKey jbtree_node_split(JBTreeNode* node, JBTreeNode* right, unsigned int pos, JBTreeKey key, void* slot) {
+    JBTreeKey               keys[JBTREE_MAX_KEYS + 1];
+    void*                   slots[JBTREE_MAX_KEYS + 2];
+    unsigned int            numSlots = node->numKeys + !node->isLeaf;
+    unsigned int            slotPos = node->isLeaf ? pos : pos + 1;
+    unsigned int            half = (JBTREE_MAX_KEYS + 1) / 2;
+    unsigned int            rightStart = node->isLeaf ? half : half + 1;
+
+    memcpy(keys, node->keys, sizeof (JBTreeKey) * pos);
+    keys[pos] = key;
+    memcpy(&keys[pos + 1], &node->keys[pos], sizeof (JBTreeKey) * (node->numKeys - pos));
+    memcpy(slots, node->slots, sizeof (void*) * slotPos);
+    slots[slotPos] = slot;
+    memcpy(&slots[slotPos + 1], &node->slots[slotPos], sizeof (void*) * (numSlots - slotPos));
+
+    right->isLeaf = node->isLeaf;
+    right->numKeys = JBTREE_MAX_KEYS + 1 - rightStart;
+    memcpy(right->keys, &keys[rightStart], sizeof (JBTreeKey) * right->numKeys);
+    memcpy(right->slots, &slots[rightStart], sizeof (void*) * (right->numKeys + !right->isLeaf));
+
+    node->numKeys = half;
+    memcpy(node->keys, keys, sizeof (JBTreeKey) * half);
+    memcpy(node->slots, slots, sizeof (void*) * (half + !node->isLeaf));
+
+    if (node->isLeaf) {
+        right->next = node->next;
+        node->next = right;
+    }
+
+    return keys[half];
+}
+
+/**
+ *  子节点 parent->slots[index] 的 key 数不足时, 从相邻兄弟借一个 key, 兄弟也不够时与兄弟合并
+ *  内部节点借 key 要经过父节点中的分隔 key 旋转
+ */
+static void jbtree_rebalance(JBTree* tree, JBTreeNode* parent, unsigned int index) {
+    JBTreeNode*             child = parent->slots[index];
+    JBTreeNode*             left = index > 0 ? parent->slots[index - 1] : JRET_PTR_NULL;
+    JBTreeNode*             right = index < parent->numKeys ? parent->slots[index + 1] : JRET_PTR_NULL;
+
+    if (JRET_PTR_NULL != left && left->numKeys > JBTREE_MIN_KEYS) {
+        memmove(&child->keys[1], &child->keys[0], sizeof (JBTreeKey) * child->numKeys);
+        memmove(&child->slots[1], &child->slots[0], sizeof (void*) * (child->numKeys + !child->isLeaf));
+        if (child->isLeaf) {
+            child->keys[0] = left->keys[left->numKeys - 1];
+            child->slots[0] = left->slots[left->numKeys - 1];
+            parent->keys[index - 1] = child->keys[0];
+        } else {
+            child->keys[0] = parent->keys[index - 1];
+            child->slots[0] = left->slots[left->numKeys];
+            parent->keys[index - 1] = left->keys[left->numKeys - 1];
+        }
+        -- left->numKeys;
+        ++ child->numKeys;
+        return;
+    }
+
+    if (JRET_PTR_NULL != right && right->numKeys > JBTREE_MIN_KEYS) {
+        if (child->isLeaf) {
+            child->keys[child->numKeys] = right->keys[0];
+            child->slots[child->numKeys] = right->slots[0];
+            parent->keys[index] = right->keys[1];
+        } else {
+            child->keys[child->numKeys] = parent->keys[index];
+            child->slots[child->numKeys + 1] = right->slots[0];
+            parent->keys[index] = right->keys[0];
+        }
+        memmove(&right->keys[0], &right->keys[1], sizeof (JBTreeKey) * (right->numKeys - 1));
+        memmove(&right->slots[0], &right->slots[1], sizeof (void*) * (right->numKeys - 1 + !right->isLeaf));
+        -- right->numKeys;
+        ++ child->numKeys;
+        return;
+    }
+
+    if (JRET_PTR_NULL == left) {                            // 统一成把 index 合并到 index - 1
+        left = child;
+        child = right;
+        ++ index;
+    }
+
+    if (left->isLeaf) {
+        memcpy(&left->keys[left->numKeys], child->keys, sizeof (JBTreeKey) * child->numKeys);
+        memcpy(&left->slots[left->numKeys], child->slots, sizeof (void*) * child->numKeys);
+        left->numKeys += child->numKeys;
+        left->next = child->next;
+    } else {
+        left->keys[left->numKeys] = parent->keys[index - 1];
+        memcpy(&left->keys[left->numKeys + 1], child->keys, sizeof (JBTreeKey) * child->numKeys);
+        memcpy(&left->slots[left->numKeys + 1], child->slots, sizeof (void*) * (child->numKeys + 1));
+        left->numKeys += child->numKeys + 1;
+    }
+
+    jbtree_node_remove_at(parent, index - 1);
+    jbtree_node_release(tree, child);
+}
+
+
+JBTree* jbtree_new(JBTreeCompareFunc compare_func) {
+    return jbtree_new_with_allocator(compare_func, JRET_PTR_NULL);
+}
+
+JBTree* jbtree_new_with_allocator(JBTreeCompareFunc compare_func, const JAllocator* allocator) {
+    JBTree*                 tree = JRET_PTR_NULL;
+    JMemoryStats            memStats = { 0, 0, 0 };
+
+    if (JRET_PTR_NULL == allocator) {
+        allocator = jallocator_default();
+    }
+
+    tree = jallocator_alloc(allocator, &memStats, sizeof (JBTree), sizeof (void*));
+    if (JRET_PTR_NULL == tree) {
+        return JRET_PTR_NULL;
+    }
+
+    tree->allocator = allocator;
+    tree->memStats = memStats;
+
+    tree->rootNode = JRET_PTR_NULL;
+    tree->compareFunc = compare_func;
+    tree->numEntries = 0;
+
+    return tree;
+}
+
+JBTree* jbtree_new_integer(void) {
+    return jbtree_new(JRET_PTR_NULL);
+}
+
+/* 分配器只能整体释放(arena)时不需要逐个释放节点 */
+void jbtree_free(JBTree* tree) {
+    if (JRET_PTR_NULL != tree->rootNode && JRET_PTR_NULL != tree->allocator->free) {
+        jbtree_node_free(tree, tree->rootNode);
+    }
+
+    jallocator_free(tree->allocator, JRET_PTR_NULL, tree, sizeof (JBTree), sizeof (void*));
+}
+
+int jbtree_insert(JBTree* tree, JBTreeKey key, JBTreeValue value) {
+    JBTreeNode*             path[JBTREE_MAX_DEPTH];
+    unsigned int            indexes[JBTREE_MAX_DEPTH];
+    JBTreeNode*             spare[JBTREE_MAX_DEPTH + 1];
+    JBTreeNode*             node;
+    JBTreeNode*             newNode;
+    unsigned int            numSpare = 0;
+    unsigned int            depth;
+    unsigned int            pos;
+    unsigned int            i;
+
+    if (JRET_PTR_NULL == tree->rootNode) {
+        tree->rootNode = jbtree_node_new(tree);
+        if (JRET_PTR_NULL == tree->rootNode) {
+            return JRET_ERROR;
+        }
+    }
+
+    node = jbtree_descend(tree, key, path, indexes, &depth);
+    pos = jbtree_node_lower(tree, node, key);
+    if (pos < node->numKeys && jbtree_key_equal(tree, node->keys[pos], key)) {
+        node->slots[pos] = value;
+        return JRET_OK;
+    }
+
+    if (node->numKeys < JBTREE_MAX_KEYS) {
+        jbtree_node_insert_at(node, pos, key, value);
+        ++ tree->numEntries;
+        return JRET_OK;
+    }
+
+    /* 从叶子向上连续的满节点都要分裂, 根也满时还要一个新根; 先申请好, 申请失败时树不变 */
+    for (numSpare = 1, i = depth; i > 0 && path[i - 1]->numKeys == JBTREE_MAX_KEYS; --i) {
+        ++ numSpare;
+    }
+    if (0 == i) {
+        ++ numSpare;
+    }
+    for (i = 0; i < numSpare; ++i) {
+        spare[i] = jbtree_node_new(tree);
+        if (JRET_PTR_NULL == spare[i]) {
+            while (i > 0) {
+                jbtree_node_release(tree, spare[-- i]);
+            }
+            return JRET_ERROR;
+        }
+    }
+
+    newNode = spare[-- numSpare];
+    key = jbtree_node_split(node, newNode, pos, key, value);
+    while (depth > 0) {
+        -- depth;
+        node = path[depth];
+        if (node->numKeys < JBTREE_MAX_KEYS) {
+            jbtree_node_insert_at(node, indexes[depth], key, newNode);
+            newNode = JRET_PTR_NULL;
+            break;
+        }
+        value = newNode;
+        newNode = spare[-- numSpare];
+        key = jbtree_node_split(node, newNode, indexes[depth], key, value);
+    }
+
+    if (JRET_PTR_NULL != newNode) {                         // 根节点分裂, 树长高一层
+        node = spare[-- numSpare];
+        node->isLeaf = 0;
+        node->numKeys = 1;
+        node->keys[0] = key;
+        node->slots[0] = tree->rootNode;
+        node->slots[1] = newNode;
+        tree->rootNode = node;
+    }
+
+    ++ tree->numEntries;
+
+    return JRET_OK;
+}
+
+int jbtree_remove(JBTree* tree, JBTreeKey key) {
+    JBTreeNode*             path[JBTREE_MAX_DEPTH];
+    unsigned int            indexes[JBTREE_MAX_DEPTH];
+    JBTreeNode*             node;
+    unsigned int            depth;
+    unsigned int            pos;
+
+    if (JRET_PTR_NULL == tree->rootNode) {
+        return JRET_NOTFOUND;
+    }
+
+    node = jbtree_descend(tree, key, path, indexes, &depth);
+    pos = jbtree_node_lower(tree, node, key);
+    if (pos >= node->numKeys || !jbtree_key_equal(tree, node->keys[pos], key)) {
+        return JRET_NOTFOUND;
+    }
+
+    /* 删除叶子中的 key 后, 父节点中等于它的分隔 key 可以保留, 仍然能正确划分左右子树 */
+    jbtree_node_remove_at(node, pos);
+    -- tree->numEntries;
+
+    while (depth > 0 && node->numKeys < JBTREE_MIN_KEYS) {
+        -- depth;
+        jbtree_rebalance(tree, path[depth], indexes[depth]);
+        node = path[depth];
+    }
+
+    node = tree->rootNode;
+    if (0 == node->numKeys) {                               // 根只剩一个子树时树变矮一层, 树空时释放根
+        tree->rootNode = node->isLeaf ? JRET_PTR_NULL : node->slots[0];
+        jbtree_node_release(tree, node);
+    }
+
+    return JRET_OK;
+}
+
+JBTreeValue jbtree_lookup(JBTree* tree, JBTreeKey key) {
+    JBTreeNode*             node = tree->rootNode;
+    unsigned int            pos;
+
+    if (JRET_PTR_NULL == node) {
+        return JBTREE_NULL;
+    }
+
+    while (!node->isLeaf) {
+        node = node->slots[jbtree_node_upper(tree, node, key)];
+    }
+
+    pos = jbtree_node_lower(tree, node, key);
+    if (pos < node->numKeys && jbtree_key_equal(tree, node->keys[pos], key)) {
+        return node->slots[pos];
+    }
+
+    return JBTREE_NULL;
+}
+
+unsigned int jbtree_range(JBTree* tree, JBTreeKey lo, JBTreeKey hi, JBTreeRangeFunc func, void* data) {
+    JBTreeNode*             node = tree->rootNode;
+    unsigned int            num = 0;
+    unsigned int            pos;
+
+    if (JRET_PTR_NULL == node) {
+        return 0;
+    }
+
+    while (!node->isLeaf) {
+        node = node->slots[jbtree_node_upper(tree, node, lo)];
+    }
+
+    for (pos = jbtree_node_lower(tree, node, lo); JRET_PTR_NULL != node; node = node->next, pos = 0) {
+        for (; pos < node->numKeys; ++pos) {
+            if (JRET_PTR_NULL == tree->compareFunc
+                    ? JBTREE_KEY_INT(node->keys[pos]) >= JBTREE_KEY_INT(hi)
+                    : JRET_SMALLER != tree->compareFunc(node->keys[pos], hi)) {
+                return num;
+            }
+
+            ++ num;
+            if (JRET_OK != func(node->keys[pos], node->slots[pos], data)) {
+                return num;
+            }
+        }
+    }
+
+    return num;
+}
+
+JBTreeKey* jbtree_to_array(JBTree* tree) {
+    JBTreeKey*              array;
+    JBTreeNode*             node = tree->rootNode;
+    unsigned int            index = 0;
+
+    array = malloc(sizeof (JBTreeKey) * tree->numEntries);
+    if (JRET_PTR_NULL == array) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_PTR_NULL == node) {
+        return array;
+    }
+
+    while (!node->isLeaf) {
+        node = node->slots[0];
+    }
+
+    for (; JRET_PTR_NULL != node; node = node->next) {
+        memcpy(&array[index], node->keys, sizeof (JBTreeKey) * node->numKeys);
+        index += node->numKeys;
+    }
+
+    return array;
+}
+
+unsigned int jbtree_num_entries(JBTree* tree) {
+    return tree->numEntries;
+}
+
+/* 子树中没有使用的 key 和 slot 占用的字节; 叶子最后一个 slot 不存 value, 也算没有使用 */
+static size_t jbtree_node_unused(JBTreeNode* node) {
+    unsigned int            numSlots = node->isLeaf ? node->numKeys : node->numKeys + 1;
+    size_t                  unused = sizeof (JBTreeKey) * (JBTREE_MAX_KEYS - node->numKeys) + sizeof (void*) * (JBTREE_MAX_KEYS + 1 - numSlots);
+    unsigned int            i;
+
+    if (!node->isLeaf) {
+        for (i = 0; i < numSlots; ++i) {
+            unused += jbtree_node_unused(node->slots[i]);
+        }
+    }
+
+    return unused;
+}
+
+void jbtree_memory_stats(JBTree* tree, JMemoryStats* stats) {
+    *stats = tree->memStats;
+    stats->wasted = JRET_PTR_NULL == tree->rootNode ? 0 : jbtree_node_unused(tree->rootNode);
+}
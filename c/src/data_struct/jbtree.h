@@ -0,0 +1,201 @@
+#ifndef JBTREE_H
+#define JBTREE_H
+#include "jret.h"
+#include "jallocator.h"
+
+/**
+ *  B+ 树有序映射
+ *
+ *  用法和 JAVLTree 相同(new/insert/lookup/remove/to_array/num_entries),
+ *  但每个节点保存多个 key, 适合数据量很大的场景。
+ *
+ *  AVL 树每个节点约 48 字节只存一个 key, 查找时每下降一层就是一次缓存未命中;
+ *  B+ 树每个节点按缓存行对齐, 最多存放 JBTREE_MAX_KEYS 个 key,
+ *  key 连续存放, 树高只有 AVL 的 1/4 左右, 节点内顺序查找只访问少数几个缓存行。
+ *
+ *  value 只存放在叶子节点中, 叶子节点按 key 的顺序链接, 范围遍历和导出数组不需要回溯。
+ *
+ *  key 的两种模式:
+ *      1. jbtree_new(compare_func) --- key 是任意指针, 用比较函数比较, 节点内二分查找
+ *      2. jbtree_new_integer()     --- key 本身就是整数(用 JBTREE_INT_KEY 转换),
+ *                                      不需要比较函数, 节点内用 SIMD 并行比较
+ *
+ *  与 JAVLTree 的不同:
+ *      key 唯一, 插入已存在的 key 时替换它的 value;
+ *      插入删除会在节点间移动 key/value, 所以不返回节点指针。
+ *
+ *  调用：
+ *      jbtree_new --- 创建
+ *      jbtree_free --- 销毁
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 每个节点最多的 key 数, 16 ~ 64 之间 */
+#ifndef JBTREE_MAX_KEYS
+#define JBTREE_MAX_KEYS     32
+#endif
+
+/* B+ 树 */
+typedef struct _JBTree JBTree;
+
+/* B+ 树的 key */
+typedef void* JBTreeKey;
+
+/* B+ 树的 value */
+typedef void* JBTreeValue;
+
+/* B+ 树值为空 */
+#define JBTREE_NULL JRET_PTR_NULL
+
+/* 整数 key 模式下整数与 key 的转换 */
+#define JBTREE_INT_KEY(i)   ((JBTreeKey) (intptr_t) (i))
+#define JBTREE_KEY_INT(k)   ((intptr_t) (k))
+
+
+/**
+ *  比较 key 的函数指针, 与 JAVLTreeCompareFunc 相同
+ *
+ *  @param value1           第一个key
+ *  @param value2           第二个key
+ *
+ *  @return                 value1 < value2     返回： RET_SMALLER
+ *                          value1 > value2     返回： RET_BIGGER
+ *                          value1 == value2    返回:  RET_EQUAL
+ */
+typedef int (*JBTreeCompareFunc)(JBTreeKey value1, JBTreeKey value2);
+
+
+/**
+ *  范围遍历时对每个 key-value 调用的函数
+ *
+ *  @param key              当前 key
+ *  @param value            当前 value
+ *  @param data             用户数据
+ *
+ *  @return                 继续遍历返回 RET_OK, 返回其它值则停止遍历
+ */
+typedef int (*JBTreeRangeFunc)(JBTreeKey key, JBTreeValue value, void* data);
+
+
+/**
+ *  创建 B+ 树
+ *
+ *  @param compare_func     key 比较函数
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JBTree* jbtree_new(JBTreeCompareFunc compare_func);
+
+
+/**
+ *  创建整数 key 的 B+ 树, key 按 intptr_t 有符号比较
+ *
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JBTree* jbtree_new_integer(void);
+
+
+/**
+ *  使用指定分配器创建 B+ 树, 树结构和节点都从分配器申请(节点按缓存行对齐)
+ *  节点大小固定, 适合配合 JSlab 使用; 分配器是 arena 时销毁树不再逐个释放节点
+ *
+ *  @param compare_func     key 比较函数, RET_PTR_NULL 表示整数 key 模式
+ *  @param allocator        分配器, RET_PTR_NULL 表示默认分配器; 必须比树活得长
+ *  @return                 成功: 返回树
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JBTree* jbtree_new_with_allocator(JBTreeCompareFunc compare_func, const JAllocator* allocator);
+
+
+/**
+ *  销毁 B+ 树
+ *
+ *  @param tree             树，要销毁
+ */
+void jbtree_free(JBTree* tree);
+
+
+/**
+ *  插入一个 key-value 对, key 已存在时替换 value
+ *
+ *  @param tree             树
+ *  @param key              要插入的 key
+ *  @param value            要插入的 value
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (内存不足, 树不变)
+ */
+int jbtree_insert(JBTree* tree, JBTreeKey key, JBTreeValue value);
+
+
+/**
+ *  根据 key 删除
+ *
+ *  @param tree             树
+ *  @param key              要删除的 key
+ *  @return                 删除成功：RET_OK
+ *                          没找到：  RET_NOTFOUND
+ */
+int jbtree_remove(JBTree* tree, JBTreeKey key);
+
+
+/**
+ *  根据 key 查询
+ *
+ *  @param tree             树
+ *  @param key              要查询的 key
+ *  @return                 成功：返回找到的值
+ *                          失败：返回 JBTREE_NULL
+ */
+JBTreeValue jbtree_lookup(JBTree* tree, JBTreeKey key);
+
+
+/**
+ *  按 key 的顺序遍历 [lo, hi) 内的 key-value
+ *
+ *  @param tree             树
+ *  @param lo               范围下界(包含)
+ *  @param hi               范围上界(不包含)
+ *  @param func             对每个 key-value 调用的函数, 返回非 RET_OK 时提前结束
+ *  @param data             传给 func 的用户数据
+ *  @return                 访问过的 key 数
+ */
+unsigned int jbtree_range(JBTree* tree, JBTreeKey lo, JBTreeKey hi, JBTreeRangeFunc func, void* data);
+
+
+/**
+ *  所有 key 按顺序转为数组
+ *
+ *  @param tree             树
+ *  @return                 成功：返回数组, 长度为 jbtree_num_entries, 用完后调用 free
+ *                          失败：RET_PTR_NULL
+ */
+JBTreeKey* jbtree_to_array(JBTree* tree);
+
+
+/**
+ *  树中 key 的数量
+ *
+ *  @param tree             树
+ *  @return                 key 的数量
+ */
+unsigned int jbtree_num_entries(JBTree* tree);
+
+
+/**
+ *  树的内存统计, wasted 是节点中没有使用的 key 和 slot(value 或子节点)槽位;
+ *  内部节点中在用的 key 和子节点指针是索引开销, 不算 wasted。需要遍历所有节点
+ *
+ *  @param tree             树
+ *  @param stats            统计结果
+ */
+void jbtree_memory_stats(JBTree* tree, JMemoryStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JBTREE_H
@@ -0,0 +1,830 @@
+#define _GNU_SOURCE
+#include "jextsort.h"
+#include "jbinary_heap.h"
+#include "jallocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#define JEXTSORT_PAD            (0xFFFFFFFFU)       // 变长记录的块尾填充标记
+#define JEXTSORT_ITEM_OVERHEAD  (16)                // 每条记录在预算中另计的字节: 堆数组中的指针和分配对齐
+#define JEXTSORT_ITEM_ALIGN     (16)
+#define JEXTSORT_HEAP_ARITY     (4)                 // 第一阶段的堆很大, 4 叉堆层数减半, 下沉时缓存缺失更少
+
+#define JEXTSORT_IO_IDLE        (0)                 // 没有请求, 或结果已被取走
+#define JEXTSORT_IO_PENDING     (1)
+#define JEXTSORT_IO_DONE        (2)
+
+/* 内存中的一条记录, 在第一阶段的堆中按 (run, 记录) 排序 */
+typedef struct _JExtSortItem JExtSortItem;
+struct _JExtSortItem {
+    JExtSort*               sort;                   // 堆的比较函数没有用户数据参数, 每条记录带上所属的排序
+    unsigned int            run;                    // 所属顺串
+    unsigned int            size;
+    unsigned char           data[];
+};
+
+/* 一次块读写, 由后台 I/O 线程完成 */
+typedef struct _JExtSortIo JExtSortIo;
+struct _JExtSortIo {
+    JExtSortIo*             next;                   // 请求队列
+    unsigned char*          buffer;
+    size_t                  size;
+    uint64_t                offset;
+    int                     fd;
+    int                     write;
+    int                     state;                  // JEXTSORT_IO_*, 改动时持有 sort->lock
+    int                     failed;
+};
+
+/* 临时文件中的一个顺串 */
+typedef struct {
+    uint64_t                offset;
+    uint64_t                size;
+} JExtSortRun;
+
+/* 顺串写出: 两块缓冲区轮流填写和提交 */
+typedef struct {
+    JExtSortIo              io[2];
+    unsigned int            cur;                    // 正在填写的块
+    size_t                  pos;                    // 当前块已填写的字节
+    int                     fd;
+    uint64_t                offset;                 // 当前块在文件中的位置
+} JExtSortWriter;
+
+/* 顺串读取: 两块缓冲区, 读一块时预读下一块 */
+typedef struct {
+    JExtSort*               sort;
+    JExtSortIo              io[2];
+    unsigned int            cur;                    // 正在读的块
+    size_t                  pos;                    // 当前记录在块中的位置
+    size_t                  len;                    // 当前块的有效字节
+    uint64_t                next;                   // 下一块在文件中的位置
+    uint64_t                end;                    // 顺串结束的位置
+    const unsigned char*    record;                 // 当前记录
+    size_t                  size;
+} JExtSortReader;
+
+struct _JExtSort {
+    size_t                  recordSize;             // 0 表示变长
+    JExtSortCompareFunc     compareFunc;
+    size_t                  memoryBudget;
+    size_t                  heapBudget;             // 第一阶段堆中记录可用的内存, 预算减去写出的两块
+    size_t                  used;                   // 堆中记录和 last 占用的预算
+    char*                   tempDir;
+
+    JBinaryHeap*            heap;                   // 第一阶段的记录
+    JSlab*                  slab;                   // 定长记录从 slab 分配
+    const JAllocator*       allocator;
+    JMemoryStats            memStats;
+    JExtSortItem*           last;                   // 最近写出的记录, 新记录和它比较决定放进哪个顺串
+
+    int                     fd;                     // 当前的顺串文件, 没有写过时为 -1
+    JExtSortRun*            runs;
+    unsigned int            numRuns;
+    unsigned int            capacity;
+    JExtSortWriter          writer;
+    unsigned char*          writeBuffer;            // 写出的两块
+
+    int                     finished;
+    int                     failed;                 // 读写临时文件失败
+    JExtSortStats           stats;
+
+    pthread_t               thread;                 // 后台 I/O 线程, 第一次写顺串时创建
+    int                     threadStarted;
+    int                     stop;
+    pthread_mutex_t         lock;
+    pthread_cond_t          request;                // 通知 I/O 线程有新请求
+    pthread_cond_t          done;                   // 通知排序线程有请求完成
+    JExtSortIo*             head;
+    JExtSortIo*             tail;
+};
+
+
+static int extsort_item_compare(JBinaryHeapValue value1, JBinaryHeapValue value2) {
+    JExtSortItem*           item1 = value1;
+    JExtSortItem*           item2 = value2;
+
+    if (item1->run != item2->run) {
+        return item1->run < item2->run ? JRET_SMALLER : JRET_BIGGER;
+    }
+
+    return item1->sort->compareFunc(item1->data, item1->size, item2->data, item2->size);
+}
+
+static int extsort_reader_compare(JBinaryHeapValue value1, JBinaryHeapValue value2) {
+    JExtSortReader*         reader1 = value1;
+    JExtSortReader*         reader2 = value2;
+
+    return reader1->sort->compareFunc(reader1->record, reader1->size, reader2->record, reader2->size);
+}
+
+/* 记录在预算中占用的字节 */
+static size_t extsort_item_cost(size_t size) {
+    return ((sizeof (JExtSortItem) + size + JEXTSORT_ITEM_ALIGN - 1) & ~(size_t) (JEXTSORT_ITEM_ALIGN - 1)) + JEXTSORT_ITEM_OVERHEAD;
+}
+
+static void extsort_item_free(JExtSort* sort, JExtSortItem* item) {
+    if (JRET_PTR_NULL == item) {
+        return;
+    }
+
+    sort->used -= extsort_item_cost(item->size);
+    jallocator_free(sort->allocator, &sort->memStats, item, sizeof (JExtSortItem) + item->size, JEXTSORT_ITEM_ALIGN);
+}
+
+
+/**
+ * I/O 线程
+ * 请求按提交的顺序完成; 每个缓冲区同一时间最多一个请求, 提交方在复用缓冲区前等待它完成
+ */
+static int extsort_io_do(JExtSortIo* io) {
+    size_t                  done = 0;
+    ssize_t                 n;
+
+    while (done < io->size) {
+        if (io->write) {
+            n = pwrite(io->fd, io->buffer + done, io->size - done, (off_t) (io->offset + done));
+        } else {
+            n = pread(io->fd, io->buffer + done, io->size - done, (off_t) (io->offset + done));
+        }
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n <= 0) {
+            return JRET_ERROR;
+        }
+        done += (size_t) n;
+    }
+
+    return JRET_OK;
+}
+
+static void* extsort_io_thread(void* data) {
+    JExtSort*               sort = data;
+    JExtSortIo*             io;
+    int                     failed;
+
+    pthread_mutex_lock(&sort->lock);
+    for (;;) {
+        while (JRET_PTR_NULL == sort->head && !sort->stop) {
+            pthread_cond_wait(&sort->request, &sort->lock);
+        }
+        if (JRET_PTR_NULL == sort->head) {
+            break;
+        }
+
+        io = sort->head;
+        sort->head = io->next;
+        if (JRET_PTR_NULL == sort->head) {
+            sort->tail = JRET_PTR_NULL;
+        }
+        pthread_mutex_unlock(&sort->lock);
+
+        failed = JRET_OK != extsort_io_do(io);
+
+        pthread_mutex_lock(&sort->lock);
+        io->failed = failed;
+        __atomic_store_n(&io->state, JEXTSORT_IO_DONE, __ATOMIC_RELAXED);
+        pthread_cond_broadcast(&sort->done);
+    }
+    pthread_mutex_unlock(&sort->lock);
+
+    return JRET_PTR_NULL;
+}
+
+static void extsort_io_submit(JExtSort* sort, JExtSortIo* io, int write, int fd, size_t size, uint64_t offset) {
+    io->next = JRET_PTR_NULL;
+    io->write = write;
+    io->fd = fd;
+    io->size = size;
+    io->offset = offset;
+    io->failed = 0;
+
+    if (write) {
+        sort->stats.bytesWritten += size;
+    } else {
+        sort->stats.bytesRead += size;
+    }
+
+    pthread_mutex_lock(&sort->lock);
+    io->state = JEXTSORT_IO_PENDING;
+    if (JRET_PTR_NULL == sort->tail) {
+        sort->head = io;
+    } else {
+        sort->tail->next = io;
+    }
+    sort->tail = io;
+    pthread_cond_signal(&sort->request);
+    pthread_mutex_unlock(&sort->lock);
+}
+
+/* 只有提交方会把状态改成或改出 IDLE, 不加锁也能判断有没有请求; 原子读只是避免和 I/O 线程写 DONE 冲突 */
+static int extsort_io_idle(JExtSortIo* io) {
+    return JEXTSORT_IO_IDLE == __atomic_load_n(&io->state, __ATOMIC_RELAXED);
+}
+
+/* 等待请求完成并取走结果; 没有请求时直接返回 */
+static int extsort_io_wait(JExtSort* sort, JExtSortIo* io) {
+    if (extsort_io_idle(io)) {
+        return JRET_OK;
+    }
+
+    pthread_mutex_lock(&sort->lock);
+    while (JEXTSORT_IO_PENDING == io->state) {
+        pthread_cond_wait(&sort->done, &sort->lock);
+    }
+    io->state = JEXTSORT_IO_IDLE;
+    pthread_mutex_unlock(&sort->lock);
+
+    if (io->failed) {
+        sort->failed = 1;
+        return JRET_ERROR;
+    }
+
+    return JRET_OK;
+}
+
+/* 在临时目录中创建文件并立即删除, 只留下打开的描述符 */
+static int extsort_temp_file(JExtSort* sort) {
+    size_t                  len = strlen(sort->tempDir);
+    char*                   path = malloc(len + sizeof ("/jextsort.XXXXXX"));
+    int                     fd;
+
+    if (JRET_PTR_NULL == path) {
+        return -1;
+    }
+
+    memcpy(path, sort->tempDir, len);
+    memcpy(path + len, "/jextsort.XXXXXX", sizeof ("/jextsort.XXXXXX"));
+    fd = mkstemp(path);
+    if (fd >= 0) {
+        unlink(path);
+    }
+    free(path);
+
+    return fd;
+}
+
+
+/**
+ * 顺串写出
+ * 记录不跨块; 一块写不下时把这一块整块提交(变长记录在块尾写填充标记), 换另一块继续填写,
+ * 换过去之前等待这一块上次提交的写完成
+ */
+static void extsort_writer_open(JExtSort* sort, JExtSortWriter* writer, int fd) {
+    memset(writer, 0, sizeof (JExtSortWriter));
+    writer->io[0].buffer = sort->writeBuffer;
+    writer->io[1].buffer = sort->writeBuffer + JEXTSORT_BLOCK_SIZE;
+    writer->fd = fd;
+}
+
+static int extsort_writer_submit(JExtSort* sort, JExtSortWriter* writer, size_t size) {
+    extsort_io_submit(sort, &writer->io[writer->cur], 1, writer->fd, size, writer->offset);
+    writer->offset += size;
+    writer->cur ^= 1;
+    writer->pos = 0;
+
+    return extsort_io_wait(sort, &writer->io[writer->cur]);
+}
+
+static int extsort_writer_put(JExtSort* sort, JExtSortWriter* writer, const void* record, size_t size) {
+    uint32_t                len = (uint32_t) size;
+    uint32_t                pad = JEXTSORT_PAD;
+    size_t                  need = 0 == sort->recordSize ? sizeof (uint32_t) + size : size;
+    unsigned char*          buffer = writer->io[writer->cur].buffer;
+
+    if (writer->pos + need > JEXTSORT_BLOCK_SIZE) {
+        if (0 == sort->recordSize && writer->pos + sizeof (uint32_t) <= JEXTSORT_BLOCK_SIZE) {
+            memcpy(buffer + writer->pos, &pad, sizeof (uint32_t));
+        }
+        if (JRET_OK != extsort_writer_submit(sort, writer, JEXTSORT_BLOCK_SIZE)) {
+            return JRET_ERROR;
+        }
+        buffer = writer->io[writer->cur].buffer;
+    }
+
+    if (0 == sort->recordSize) {
+        memcpy(buffer + writer->pos, &len, sizeof (uint32_t));
+        writer->pos += sizeof (uint32_t);
+    }
+    memcpy(buffer + writer->pos, record, size);
+    writer->pos += size;
+
+    return JRET_OK;
+}
+
+/* 顺串结束: 最后一块只写有效部分, 等两块都写完 */
+static int extsort_writer_flush(JExtSort* sort, JExtSortWriter* writer) {
+    int                     ret = JRET_OK;
+
+    if (writer->pos > 0) {
+        ret = extsort_writer_submit(sort, writer, writer->pos);
+    }
+    if (JRET_OK != extsort_io_wait(sort, &writer->io[writer->cur ^ 1])) {
+        ret = JRET_ERROR;
+    }
+
+    return ret;
+}
+
+/* 用作中间一趟归并的输出函数 */
+static int extsort_writer_output(void* data, const void* record, size_t size) {
+    JExtSort*               sort = data;
+
+    return extsort_writer_put(sort, &sort->writer, record, size);
+}
+
+static int extsort_run_begin(JExtSort* sort, JExtSortRun** runs, unsigned int* numRuns, unsigned int* capacity) {
+    JExtSortRun*            newRuns;
+
+    if (*numRuns == *capacity) {
+        newRuns = realloc(*runs, sizeof (JExtSortRun) * (*capacity + *capacity / 2 + 8));
+        if (JRET_PTR_NULL == newRuns) {
+            return JRET_ERROR;
+        }
+        *runs = newRuns;
+        *capacity += *capacity / 2 + 8;
+    }
+
+    (*runs)[*numRuns].offset = sort->writer.offset;
+    (*runs)[*numRuns].size = 0;
+    ++ *numRuns;
+
+    return JRET_OK;
+}
+
+static int extsort_run_end(JExtSort* sort, JExtSortRun* run) {
+    int                     ret = extsort_writer_flush(sort, &sort->writer);
+
+    run->size = sort->writer.offset - run->offset;
+
+    return ret;
+}
+
+/* 第一次写顺串: 创建临时文件、写缓冲区和 I/O 线程 */
+static int extsort_spill_start(JExtSort* sort) {
+    sort->writeBuffer = calloc(2, JEXTSORT_BLOCK_SIZE);                     // 定长记录的块尾不写, 清零免得写出未初始化的内存
+    if (JRET_PTR_NULL == sort->writeBuffer) {
+        return JRET_ERROR;
+    }
+
+    sort->fd = extsort_temp_file(sort);
+    if (sort->fd < 0) {
+        return JRET_ERROR;
+    }
+
+    if (0 != pthread_create(&sort->thread, JRET_PTR_NULL, extsort_io_thread, sort)) {
+        return JRET_ERROR;
+    }
+    sort->threadStarted = 1;
+
+    extsort_writer_open(sort, &sort->writer, sort->fd);
+
+    return extsort_run_begin(sort, &sort->runs, &sort->numRuns, &sort->capacity);
+}
+
+/* 把堆顶的记录写进它所属的顺串, 属于下一个顺串时先结束当前顺串 */
+static int extsort_spill(JExtSort* sort, JExtSortItem* item) {
+    if (JRET_PTR_NULL == sort->writeBuffer) {
+        if (JRET_OK != extsort_spill_start(sort)) {
+            return JRET_ERROR;
+        }
+    } else if (item->run != sort->numRuns - 1) {
+        if (JRET_OK != extsort_run_end(sort, &sort->runs[sort->numRuns - 1])
+            || JRET_OK != extsort_run_begin(sort, &sort->runs, &sort->numRuns, &sort->capacity)) {
+            return JRET_ERROR;
+        }
+    }
+
+    return extsort_writer_put(sort, &sort->writer, item->data, item->size);
+}
+
+
+/**
+ * 顺串读取
+ * 打开时提交前两块的读; 当前块读完后等另一块, 并在读完的这一块上提交再下一块的读
+ */
+static void extsort_reader_fetch(JExtSort* sort, JExtSortReader* reader, unsigned int i) {
+    size_t                  size = JEXTSORT_BLOCK_SIZE;
+
+    if (reader->next >= reader->end) {
+        return;
+    }
+
+    if (reader->end - reader->next < size) {
+        size = (size_t) (reader->end - reader->next);
+    }
+    extsort_io_submit(sort, &reader->io[i], 0, sort->fd, size, reader->next);
+    reader->next += size;
+}
+
+static void extsort_reader_open(JExtSort* sort, JExtSortReader* reader, unsigned char* buffer, const JExtSortRun* run) {
+    memset(reader, 0, sizeof (JExtSortReader));
+    reader->sort = sort;
+    reader->io[0].buffer = buffer;
+    reader->io[1].buffer = buffer + JEXTSORT_BLOCK_SIZE;
+    reader->next = run->offset;
+    reader->end = run->offset + run->size;
+
+    extsort_reader_fetch(sort, reader, 0);
+    extsort_reader_fetch(sort, reader, 1);
+}
+
+/* 从当前位置找下一条记录, 当前块没有了就换块; 顺串结束或读失败返回 JRET_ERROR */
+static int extsort_reader_load(JExtSort* sort, JExtSortReader* reader) {
+    const unsigned char*    p;
+    size_t                  avail;
+    uint32_t                len;
+    unsigned int            other;
+
+    for (;;) {
+        p = reader->io[reader->cur].buffer + reader->pos;
+        avail = reader->len - reader->pos;
+        if (0 != sort->recordSize) {
+            if (avail >= sort->recordSize) {
+                reader->record = p;
+                reader->size = sort->recordSize;
+                return JRET_OK;
+            }
+        } else if (avail >= sizeof (uint32_t)) {
+            memcpy(&len, p, sizeof (uint32_t));
+            if (JEXTSORT_PAD != len && avail - sizeof (uint32_t) >= len) {
+                reader->record = p + sizeof (uint32_t);
+                reader->size = len;
+                return JRET_OK;
+            }
+        }
+
+        other = reader->cur ^ 1;
+        if (extsort_io_idle(&reader->io[other]) || JRET_OK != extsort_io_wait(sort, &reader->io[other])) {
+            return JRET_ERROR;
+        }
+        extsort_reader_fetch(sort, reader, reader->cur);
+        reader->cur = other;
+        reader->pos = 0;
+        reader->len = reader->io[other].size;
+    }
+}
+
+static int extsort_reader_first(JExtSort* sort, JExtSortReader* reader) {
+    if (extsort_io_idle(&reader->io[0]) || JRET_OK != extsort_io_wait(sort, &reader->io[0])) {
+        return JRET_ERROR;
+    }
+
+    reader->cur = 0;
+    reader->pos = 0;
+    reader->len = reader->io[0].size;
+
+    return extsort_reader_load(sort, reader);
+}
+
+static int extsort_reader_next(JExtSort* sort, JExtSortReader* reader) {
+    reader->pos += 0 == sort->recordSize ? sizeof (uint32_t) + reader->size : reader->size;
+
+    return extsort_reader_load(sort, reader);
+}
+
+
+/* 归并 num 个顺串, 每条记录交给 outputFunc; 输出函数要求停止时也返回 JRET_OK */
+static int extsort_merge(JExtSort* sort, JBinaryHeap* heap, JExtSortReader* readers, unsigned char* buffers,
+                         const JExtSortRun* runs, unsigned int num, JExtSortOutputFunc outputFunc, void* data) {
+    JExtSortReader*         reader;
+    unsigned int            i;
+
+    for (i = 0; i < num; ++i) {
+        extsort_reader_open(sort, &readers[i], buffers + (size_t) i * 2 * JEXTSORT_BLOCK_SIZE, &runs[i]);
+    }
+    for (i = 0; i < num && !sort->failed; ++i) {
+        if (JRET_OK == extsort_reader_first(sort, &readers[i]) && JRET_OK != binary_heap_insert(heap, &readers[i])) {
+            sort->failed = 1;                       // 少归并一个顺串输出就不完整, 只能报错
+        }
+    }
+
+    while (!sort->failed && JRET_PTR_NULL != (reader = binary_heap_peek(heap))) {
+        if (JRET_OK != outputFunc(data, reader->record, reader->size)) {
+            break;
+        }
+        if (JRET_OK == extsort_reader_next(sort, reader)) {
+            binary_heap_replace_top(heap, reader);
+        } else {
+            binary_heap_pop(heap);
+        }
+    }
+
+    /* 停止或失败时堆中可能还有读取器, 缓冲区也可能还在预读, 都清理掉再复用 */
+    while (JRET_PTR_NULL != binary_heap_pop(heap)) {
+    }
+    for (i = 0; i < num; ++i) {
+        extsort_io_wait(sort, &readers[i].io[0]);
+        extsort_io_wait(sort, &readers[i].io[1]);
+    }
+
+    return sort->failed ? JRET_ERROR : JRET_OK;
+}
+
+/**
+ * 第一阶段结束, 记录都已写出: slab 的页和堆数组不随记录释放而归还,
+ * 换成空的, 第二阶段的读写缓冲区才不会叠加在它们之上超出预算
+ */
+static int extsort_release_records(JExtSort* sort) {
+    JBinaryHeap*            heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, JEXTSORT_HEAP_ARITY, extsort_item_compare);
+
+    if (JRET_PTR_NULL == heap) {
+        return JRET_ERROR;
+    }
+
+    binary_heap_free(sort->heap);
+    sort->heap = heap;
+    if (JRET_PTR_NULL != sort->slab) {
+        jslab_free(sort->slab);
+        sort->slab = JRET_PTR_NULL;
+        sort->allocator = jallocator_default();
+    }
+#ifdef __GLIBC__
+    malloc_trim(0);                                 // 释放大数组会调高 glibc 的归还阈值, 空出来的页要主动还给系统
+#endif
+
+    return JRET_OK;
+}
+
+/**
+ * 第二阶段
+ * 同时归并的路数受预算限制(每路两块, 另外两块写出); 顺串多于这个数时,
+ * 每 fanIn 个顺串归并成一个写进新的临时文件, 直到不超过 fanIn, 最后一趟交给用户的输出函数
+ */
+static int extsort_merge_all(JExtSort* sort, JExtSortOutputFunc outputFunc, void* data) {
+    unsigned int            fanIn = (unsigned int) (sort->memoryBudget / JEXTSORT_BLOCK_SIZE / 2 - 1);
+    unsigned int            numReaders = sort->numRuns < fanIn ? sort->numRuns : fanIn;    // 顺串少时不按预算申请
+    JBinaryHeap*            heap = binary_heap_new(JBINARY_HEAP_TYPE_MIN, extsort_reader_compare);
+    JExtSortReader*         readers = malloc(sizeof (JExtSortReader) * numReaders);
+    unsigned char*          buffers = malloc((size_t) numReaders * 2 * JEXTSORT_BLOCK_SIZE);
+    JExtSortRun*            newRuns = JRET_PTR_NULL;
+    unsigned int            numNewRuns = 0;
+    unsigned int            capacity = 0;
+    unsigned int            num;
+    unsigned int            i;
+    int                     fd;
+    int                     ret = JRET_OK;
+
+    /* 堆预留好所有读取器的位置, 归并时插入不再申请内存 */
+    if (JRET_PTR_NULL == heap || JRET_PTR_NULL == readers || JRET_PTR_NULL == buffers
+        || JRET_OK != binary_heap_reserve(heap, numReaders)) {
+        ret = JRET_ERROR;
+    }
+
+    while (JRET_OK == ret && sort->numRuns > fanIn) {
+        fd = extsort_temp_file(sort);
+        if (fd < 0) {
+            ret = JRET_ERROR;
+            break;
+        }
+
+        extsort_writer_open(sort, &sort->writer, fd);
+        numNewRuns = 0;
+        for (i = 0; JRET_OK == ret && i < sort->numRuns; i += num) {
+            num = sort->numRuns - i < fanIn ? sort->numRuns - i : fanIn;
+            if (JRET_OK != extsort_run_begin(sort, &newRuns, &numNewRuns, &capacity)
+                || JRET_OK != extsort_merge(sort, heap, readers, buffers, sort->runs + i, num, extsort_writer_output, sort)
+                || JRET_OK != extsort_run_end(sort, &newRuns[numNewRuns - 1])) {
+                ret = JRET_ERROR;
+            }
+        }
+
+        /* 中途失败时丢弃写了一半的新文件, 旧文件和顺串保持不变 */
+        if (JRET_OK != ret) {
+            extsort_io_wait(sort, &sort->writer.io[0]);
+            extsort_io_wait(sort, &sort->writer.io[1]);
+            close(fd);
+            break;
+        }
+
+        /* 新文件替换旧文件, 旧的顺串所占的磁盘空间随关闭释放 */
+        close(sort->fd);
+        sort->fd = fd;
+        free(sort->runs);
+        sort->runs = newRuns;
+        sort->numRuns = numNewRuns;
+        sort->capacity = capacity;
+        newRuns = JRET_PTR_NULL;
+        capacity = 0;
+        ++ sort->stats.passes;
+    }
+
+    if (JRET_OK == ret) {
+        ret = extsort_merge(sort, heap, readers, buffers, sort->runs, sort->numRuns, outputFunc, data);
+        ++ sort->stats.passes;
+    }
+
+    binary_heap_free(heap);
+    free(newRuns);
+    free(readers);
+    free(buffers);
+
+    return ret;
+}
+
+
+JExtSort* jextsort_new(size_t recordSize, JExtSortCompareFunc compareFunc, size_t memoryBudget, const char* tempDir) {
+    JExtSort*               sort = JRET_PTR_NULL;
+    size_t                  len;
+
+    if (JRET_PTR_NULL == compareFunc || recordSize > JEXTSORT_BLOCK_SIZE) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_PTR_NULL == tempDir) {
+        tempDir = getenv("TMPDIR");
+    }
+    if (JRET_PTR_NULL == tempDir || '\0' == tempDir[0]) {
+        tempDir = "/tmp";
+    }
+
+    sort = calloc(1, sizeof (JExtSort));
+    if (JRET_PTR_NULL == sort) {
+        return JRET_PTR_NULL;
+    }
+
+    len = strlen(tempDir);
+    sort->tempDir = malloc(len + 1);
+    sort->heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, JEXTSORT_HEAP_ARITY, extsort_item_compare);
+    if (0 != recordSize) {
+        sort->slab = jslab_new(sizeof (JExtSortItem) + recordSize);
+    }
+    if (JRET_PTR_NULL == sort->tempDir || JRET_PTR_NULL == sort->heap || (0 != recordSize && JRET_PTR_NULL == sort->slab)) {
+        free(sort->tempDir);
+        binary_heap_free(sort->heap);
+        if (JRET_PTR_NULL != sort->slab) {
+            jslab_free(sort->slab);
+        }
+        free(sort);
+        return JRET_PTR_NULL;
+    }
+    memcpy(sort->tempDir, tempDir, len + 1);
+
+    sort->recordSize = recordSize;
+    sort->compareFunc = compareFunc;
+    sort->memoryBudget = memoryBudget < JEXTSORT_MIN_MEMORY ? JEXTSORT_MIN_MEMORY : memoryBudget;
+    sort->heapBudget = sort->memoryBudget - 2 * (size_t) JEXTSORT_BLOCK_SIZE;
+    sort->allocator = 0 != recordSize ? jslab_allocator(sort->slab) : jallocator_default();
+    sort->fd = -1;
+    pthread_mutex_init(&sort->lock, JRET_PTR_NULL);
+    pthread_cond_init(&sort->request, JRET_PTR_NULL);
+    pthread_cond_init(&sort->done, JRET_PTR_NULL);
+
+    return sort;
+}
+
+
+void jextsort_free(JExtSort* sort) {
+    JExtSortItem*           item;
+
+    if (JRET_PTR_NULL == sort) {
+        return;
+    }
+
+    if (sort->threadStarted) {
+        pthread_mutex_lock(&sort->lock);
+        sort->stop = 1;
+        pthread_cond_signal(&sort->request);
+        pthread_mutex_unlock(&sort->lock);
+        pthread_join(sort->thread, JRET_PTR_NULL);
+    }
+    if (sort->fd >= 0) {
+        close(sort->fd);
+    }
+
+    while (JRET_PTR_NULL != (item = binary_heap_pop(sort->heap))) {
+        extsort_item_free(sort, item);
+    }
+    extsort_item_free(sort, sort->last);
+    binary_heap_free(sort->heap);
+    if (JRET_PTR_NULL != sort->slab) {
+        jslab_free(sort->slab);
+    }
+
+    pthread_cond_destroy(&sort->done);
+    pthread_cond_destroy(&sort->request);
+    pthread_mutex_destroy(&sort->lock);
+    free(sort->writeBuffer);
+    free(sort->runs);
+    free(sort->tempDir);
+    free(sort);
+}
+
+
+/**
+ * 内存够时直接放进堆; 不够时写出堆顶, 直到放得下新记录。
+ * 写出的堆顶暂时留在堆中(replace = 1), 只需要写出一条时新记录用 binary_heap_replace_top 换掉它,
+ * 要写出多条(变长记录)时才真正弹出。
+ */
+int jextsort_add(JExtSort* sort, const void* record, size_t size) {
+    JExtSortItem*           item;
+    JExtSortItem*           top;
+    size_t                  cost = extsort_item_cost(size);
+    unsigned int            replace = 0;
+
+    if (sort->finished || sort->failed
+        || (0 != sort->recordSize ? size != sort->recordSize : size > JEXTSORT_BLOCK_SIZE - sizeof (uint32_t))) {
+        return JRET_ERROR;
+    }
+
+    while (sort->used + cost > sort->heapBudget && binary_heap_num(sort->heap) > replace) {
+        if (replace) {
+            binary_heap_pop(sort->heap);
+        }
+        top = binary_heap_peek(sort->heap);
+        if (JRET_OK != extsort_spill(sort, top)) {
+            sort->failed = 1;
+            return JRET_ERROR;
+        }
+        extsort_item_free(sort, sort->last);
+        sort->last = top;
+        replace = 1;
+    }
+
+    item = jallocator_alloc(sort->allocator, &sort->memStats, sizeof (JExtSortItem) + size, JEXTSORT_ITEM_ALIGN);
+    if (JRET_PTR_NULL == item) {
+        if (replace) {
+            binary_heap_pop(sort->heap);
+        }
+        return JRET_ERROR;
+    }
+
+    item->sort = sort;
+    item->size = (unsigned int) size;
+    item->run = 0;
+    memcpy(item->data, record, size);
+    if (JRET_PTR_NULL != sort->last) {
+        item->run = sort->last->run;
+        if (JRET_SMALLER == sort->compareFunc(item->data, size, sort->last->data, sort->last->size)) {
+            ++ item->run;
+        }
+    }
+
+    if (replace) {
+        binary_heap_replace_top(sort->heap, item);
+    } else if (JRET_OK != binary_heap_insert(sort->heap, item)) {
+        jallocator_free(sort->allocator, &sort->memStats, item, sizeof (JExtSortItem) + size, JEXTSORT_ITEM_ALIGN);
+        return JRET_ERROR;
+    }
+
+    sort->used += cost;
+    ++ sort->stats.records;
+
+    return JRET_OK;
+}
+
+
+int jextsort_finish(JExtSort* sort, JExtSortOutputFunc outputFunc, void* data) {
+    JExtSortItem*           item;
+    int                     stopped = 0;
+
+    if (sort->finished || sort->failed) {
+        return JRET_ERROR;
+    }
+    sort->finished = 1;
+
+    /* 没有写过顺串, 所有记录都在堆中且属于同一个顺串 */
+    if (0 == sort->numRuns) {
+        while (JRET_PTR_NULL != (item = binary_heap_pop(sort->heap))) {
+            if (!stopped && JRET_OK != outputFunc(data, item->data, item->size)) {
+                stopped = 1;
+            }
+            extsort_item_free(sort, item);
+        }
+        return JRET_OK;
+    }
+
+    extsort_item_free(sort, sort->last);
+    sort->last = JRET_PTR_NULL;
+    while (JRET_PTR_NULL != (item = binary_heap_pop(sort->heap))) {
+        if (JRET_OK != extsort_spill(sort, item)) {
+            extsort_item_free(sort, item);
+            sort->failed = 1;
+            return JRET_ERROR;
+        }
+        extsort_item_free(sort, item);
+    }
+    if (JRET_OK != extsort_run_end(sort, &sort->runs[sort->numRuns - 1]) || JRET_OK != extsort_release_records(sort)) {
+        return JRET_ERROR;
+    }
+    sort->stats.runs = sort->numRuns;
+
+    return extsort_merge_all(sort, outputFunc, data);
+}
+
+
+void jextsort_get_stats(JExtSort* sort, JExtSortStats* stats) {
+    *stats = sort->stats;
+    if (0 == stats->runs) {
+        stats->runs = sort->numRuns;
+    }
+}
@@ -0,0 +1,158 @@
+#ifndef JEXTSORT_H
+#define JEXTSORT_H
+#include "jret.h"
+
+/**
+ *  外部排序, 数据量可以远大于内存
+ *
+ *  第一阶段(jextsort_add): 置换选择生成顺串
+ *      记录放进一个最小堆(JBinaryHeap), 堆按 (顺串号, 记录) 排序, 内存用到预算后每来一条记录就把堆顶写出,
+ *      新记录比刚写出的记录小时只能放进下一个顺串, 否则仍属于当前顺串, 用 binary_heap_replace_top 替换堆顶。
+ *      输入随机时顺串的平均长度约为内存能放下的记录数的两倍, 输入基本有序时只有一个顺串。
+ *      所有顺串顺序写进同一个临时文件(创建后立即 unlink, 进程退出时自动删除),
+ *      按 JEXTSORT_BLOCK_SIZE 大小的块写, 两个块缓冲区轮流使用, 后台 I/O 线程写一块时继续填另一块。
+ *  第二阶段(jextsort_finish): K 路归并
+ *      每个顺串一个读取器, 两个块缓冲区: 归并一块时后台线程预读下一块(双缓冲);
+ *      读取器按当前记录放进最小堆, 取出堆顶输出后用 binary_heap_replace_top 下沉一次。
+ *      顺串数超过内存能同时打开的路数(预算 / 两个块)时, 先分组归并成更长的顺串写进新的临时文件, 再归并。
+ *      没有写过顺串(数据都在内存中)时直接从堆中依次输出, 不读写磁盘。
+ *
+ *  记录格式:
+ *      定长    --- recordSize 大于 0, 每条记录 recordSize 字节
+ *      变长    --- recordSize 为 0, 每条记录单独给出长度; 顺串文件中每条记录前加 4 字节长度
+ *  一条记录不能跨块, 变长记录最长 JEXTSORT_BLOCK_SIZE - 4 字节。
+ *
+ *  用法:
+ *      JExtSort* sort = jextsort_new(100, compare, 256 << 20, "/data/tmp");
+ *      while (...) {
+ *          jextsort_add(sort, record, 100);
+ *      }
+ *      jextsort_finish(sort, write_record, file);      // 按顺序对每条记录调用 write_record
+ *      jextsort_free(sort);
+ *
+ *  注意：
+ *      不是稳定排序。
+ *      内存预算包括堆中的记录(每条另加约 32 字节的记录头、堆数组和分配开销)和读写块缓冲区, 不包括堆数组扩容时的临时占用;
+ *      第一阶段的记录、堆数组和 slab 在归并前全部释放, 归并的读缓冲区按顺串数申请, 不超过预算。
+ *      不是线程安全的。
+ *
+ *  调用：
+ *      jextsort_new --- 创建
+ *      jextsort_free --- 销毁, 同时删除临时文件
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 顺串文件读写的块大小, 也是一次 I/O 的大小 */
+#ifndef JEXTSORT_BLOCK_SIZE
+#define JEXTSORT_BLOCK_SIZE (1 << 20)
+#endif
+
+/* 内存预算的下限: 至少能同时归并 3 路(每路两块)并双缓冲写出 */
+#define JEXTSORT_MIN_MEMORY (8 * (size_t) JEXTSORT_BLOCK_SIZE)
+
+/* 外部排序 */
+typedef struct _JExtSort JExtSort;
+
+/* 排序统计 */
+typedef struct _JExtSortStats JExtSortStats;
+struct _JExtSortStats {
+    uint64_t                records;                // 添加的记录数
+    unsigned int            runs;                   // 第一阶段生成的顺串数
+    unsigned int            passes;                 // 归并的趟数(包括最后输出的一趟), 没有写过顺串时为 0
+    uint64_t                bytesWritten;           // 写入临时文件的字节数
+    uint64_t                bytesRead;              // 从临时文件读出的字节数
+};
+
+
+/**
+ *  比较函数
+ *
+ *  @param record1          记录 1
+ *  @param size1            记录 1 的字节数
+ *  @param record2          记录 2
+ *  @param size2            记录 2 的字节数
+ *
+ *  @return                 record1 < record2     返回： RET_SMALLER
+ *                          record1 > record2     返回： RET_BIGGER
+ *                          record1 == record2    返回:  RET_EQUAL
+ */
+typedef int (*JExtSortCompareFunc) (const void* record1, size_t size1, const void* record2, size_t size2);
+
+
+/**
+ *  输出函数, 按顺序对每条记录调用一次; record 只在调用期间有效
+ *
+ *  @param data             jextsort_finish 传入的用户数据
+ *  @param record           记录
+ *  @param size             记录的字节数
+ *
+ *  @return                 继续输出返回 RET_OK, 返回其它值则停止
+ */
+typedef int (*JExtSortOutputFunc) (void* data, const void* record, size_t size);
+
+
+/**
+ *  创建外部排序
+ *
+ *  @param recordSize       定长记录的字节数, 0 表示变长记录
+ *  @param compareFunc      比较函数
+ *  @param memoryBudget     内存预算(字节), 小于 JEXTSORT_MIN_MEMORY 时按 JEXTSORT_MIN_MEMORY
+ *  @param tempDir          临时文件目录, RET_PTR_NULL 表示环境变量 TMPDIR, 没有设置时为 /tmp
+ *
+ *  @return                 成功: 返回外部排序
+ *                          失败: 返回 RET_PTR_NULL (参数错误或内存不足)
+ */
+JExtSort* jextsort_new(size_t recordSize, JExtSortCompareFunc compareFunc, size_t memoryBudget, const char* tempDir);
+
+
+/**
+ *  销毁外部排序, 关闭并删除临时文件
+ *
+ *  @param sort             外部排序
+ */
+void jextsort_free(JExtSort* sort);
+
+
+/**
+ *  添加一条记录, 内存不够时把堆顶的记录写进顺串
+ *
+ *  @param sort             外部排序
+ *  @param record           记录, 复制后就可以修改
+ *  @param size             记录的字节数, 定长记录必须等于 recordSize
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (长度不对、已经 finish、内存不足或写临时文件失败)
+ */
+int jextsort_add(JExtSort* sort, const void* record, size_t size);
+
+
+/**
+ *  结束输入, 归并所有顺串, 按顺序输出所有记录; 之后不能再添加记录
+ *
+ *  @param sort             外部排序
+ *  @param outputFunc       输出函数
+ *  @param data             传给输出函数的用户数据
+ *
+ *  @return                 成功: RET_OK (包括输出函数要求停止)
+ *                          失败: RET_ERROR (已经 finish、内存不足或读写临时文件失败)
+ */
+int jextsort_finish(JExtSort* sort, JExtSortOutputFunc outputFunc, void* data);
+
+
+/**
+ *  排序统计
+ *
+ *  @param sort             外部排序
+ *  @param stats            统计结果
+ */
+void jextsort_get_stats(JExtSort* sort, JExtSortStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JEXTSORT_H
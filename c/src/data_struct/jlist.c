@@ -0,0 +1,758 @@
+#include "jlist.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+
+#define JLIST_CACHE_LINE        (64)
+#define JLIST_MIN_ELEMENTS      (4)                 // 每个节点至少放的元素数
+#define JLIST_MERGE_PERCENT     (75)                // 相邻节点的元素合计不超过容量的这个百分比才合并, 合并后不会马上又分裂
+
+typedef struct _JListNode JListNode;
+struct _JListNode {
+    JListNode*              prev;
+    JListNode*              next;
+    unsigned int            start;                  // 第一个元素在块中的位置
+    unsigned int            num;
+    unsigned char           data[] __attribute__((aligned(16)));
+};
+
+struct _JList {
+    JListNode*              head;
+    JListNode*              tail;
+    unsigned int            num;
+    unsigned int            numNodes;
+    unsigned int            elementSize;
+    unsigned int            capacity;               // 每个节点的元素数
+    size_t                  nodeSize;               // 节点字节数, 缓存行的整数倍
+
+    /* 内存 */
+    const JAllocator*       allocator;
+    JMemoryStats            memStats;
+};
+
+static unsigned char* node_at(JList* list, JListNode* node, unsigned int offset) {
+    return node->data + (size_t) list->elementSize * (node->start + offset);
+}
+
+static JListNode* list_node_new(JList* list) {
+    JListNode*              node = jallocator_alloc(list->allocator, &list->memStats, list->nodeSize, JLIST_CACHE_LINE);
+
+    if (JRET_PTR_NULL == node) {
+        return JRET_PTR_NULL;
+    }
+
+    node->prev = JRET_PTR_NULL;
+    node->next = JRET_PTR_NULL;
+    node->start = 0;
+    node->num = 0;
+    ++ list->numNodes;
+
+    return node;
+}
+
+static void list_node_free(JList* list, JListNode* node) {
+    -- list->numNodes;
+    jallocator_free(list->allocator, &list->memStats, node, list->nodeSize, JLIST_CACHE_LINE);
+}
+
+/* 把 node 链接到 prev 之后, prev 为 RET_PTR_NULL 时作为头节点 */
+static void list_link(JList* list, JListNode* prev, JListNode* node) {
+    JListNode*              next = JRET_PTR_NULL == prev ? list->head : prev->next;
+
+    node->prev = prev;
+    node->next = next;
+    if (JRET_PTR_NULL == prev) {
+        list->head = node;
+    } else {
+        prev->next = node;
+    }
+    if (JRET_PTR_NULL == next) {
+        list->tail = node;
+    } else {
+        next->prev = node;
+    }
+}
+
+static void list_unlink(JList* list, JListNode* node) {
+    if (JRET_PTR_NULL == node->prev) {
+        list->head = node->next;
+    } else {
+        node->prev->next = node->next;
+    }
+    if (JRET_PTR_NULL == node->next) {
+        list->tail = node->prev;
+    } else {
+        node->next->prev = node->prev;
+    }
+}
+
+/* 把节点的元素整体移到块中从 start 开始的位置 */
+static void node_move(JList* list, JListNode* node, unsigned int start) {
+    memmove(node->data + (size_t) list->elementSize * start, node_at(list, node, 0), (size_t) list->elementSize * node->num);
+    node->start = start;
+}
+
+/* 在没满的节点的 offset 处空出一个槽, 移动较短的一侧, 返回槽的地址 */
+static unsigned char* node_open(JList* list, JListNode* node, unsigned int offset) {
+    size_t                  elementSize = list->elementSize;
+    int                     left = 0 != node->start;
+    int                     right = node->start + node->num < list->capacity;
+    unsigned char*          p = node_at(list, node, 0);
+
+    if (left && (!right || offset < node->num - offset)) {
+        memmove(p - elementSize, p, elementSize * offset);
+        -- node->start;
+    } else {
+        p += elementSize * offset;
+        memmove(p + elementSize, p, elementSize * (node->num - offset));
+    }
+    ++ node->num;
+
+    return node_at(list, node, offset);
+}
+
+/* 删除节点中 offset 处的元素, 移动较短的一侧 */
+static void node_close(JList* list, JListNode* node, unsigned int offset) {
+    size_t                  elementSize = list->elementSize;
+    unsigned char*          p = node_at(list, node, 0);
+
+    -- node->num;
+    if (offset < node->num - offset) {
+        memmove(p + elementSize, p, elementSize * offset);
+        ++ node->start;
+    } else {
+        p += elementSize * offset;
+        memmove(p, p + elementSize, elementSize * (node->num - offset));
+    }
+}
+
+/* 把 node 中 offset 及之后的元素移到一个新节点, 新节点链接在 node 之后 */
+static int node_split(JList* list, JListNode* node, unsigned int offset) {
+    JListNode*              newNode = list_node_new(list);
+
+    if (JRET_PTR_NULL == newNode) {
+        return JRET_ERROR;
+    }
+
+    memcpy(newNode->data, node_at(list, node, offset), (size_t) list->elementSize * (node->num - offset));
+    newNode->num = node->num - offset;
+    node->num = offset;
+    list_link(list, node, newNode);
+
+    return JRET_OK;
+}
+
+/* 把 next 的元素接到 node 的元素之后, 释放 next */
+static void node_merge(JList* list, JListNode* node, JListNode* next) {
+    if (node->start + node->num + next->num > list->capacity) {
+        node_move(list, node, 0);
+    }
+
+    memcpy(node_at(list, node, node->num), node_at(list, next, 0), (size_t) list->elementSize * next->num);
+    node->num += next->num;
+    list_unlink(list, next);
+    list_node_free(list, next);
+}
+
+/* 第 index 个元素所在的节点和节点内的位置, 从较近的一端查找; index 必须小于元素数 */
+static JListNode* list_locate(JList* list, unsigned int index, unsigned int* offset) {
+    JListNode*              node;
+    unsigned int            end;
+
+    if (index < list->num / 2) {
+        for (node = list->head; index >= node->num; node = node->next) {
+            index -= node->num;
+        }
+        *offset = index;
+    } else {
+        end = list->num;
+        for (node = list->tail; end - node->num > index; node = node->prev) {
+            end -= node->num;
+        }
+        *offset = index - (end - node->num);
+    }
+
+    return node;
+}
+
+/**
+ * 在 *node 的 *offset 处插入元素, *node 为 RET_PTR_NULL 时追加到末尾
+ * 节点满时先看能否放进前一个节点的末尾, 不能就把节点分成两半; 成功后 *node、*offset 为新元素的位置
+ */
+static int list_insert_at(JList* list, JListNode** node, unsigned int* offset, const void* element) {
+    JListNode*              n = *node;
+    unsigned int            o = *offset;
+    unsigned int            half;
+
+    if (JRET_PTR_NULL == n || (n == list->tail && o == n->num)) {
+        if (JRET_OK != jlist_push_back(list, element)) {
+            return JRET_ERROR;
+        }
+        *node = list->tail;
+        *offset = list->tail->num - 1;
+        return JRET_OK;
+    }
+    if (n == list->head && 0 == o) {
+        if (JRET_OK != jlist_push_front(list, element)) {
+            return JRET_ERROR;
+        }
+        *node = list->head;
+        *offset = 0;
+        return JRET_OK;
+    }
+    if (UINT_MAX == list->num) {
+        return JRET_ERROR;
+    }
+
+    if (list->capacity == n->num) {
+        if (0 == o && n->prev->num < list->capacity) {
+            n = n->prev;
+            o = n->num;
+        } else {
+            half = n->num / 2;
+            if (JRET_OK != node_split(list, n, half)) {
+                return JRET_ERROR;
+            }
+            if (o > half) {
+                n = n->next;
+                o -= half;
+            }
+        }
+    }
+
+    memcpy(node_open(list, n, o), element, list->elementSize);
+    ++ list->num;
+    *node = n;
+    *offset = o;
+
+    return JRET_OK;
+}
+
+/**
+ * 删除 *node 的 *offset 处的元素, 节点少于 1/4 满时与相邻节点合并, 空节点释放
+ * 之后 *node、*offset 为下一个元素的位置, 没有下一个元素时 *node 为 RET_PTR_NULL
+ */
+static void list_erase(JList* list, JListNode** node, unsigned int* offset) {
+    JListNode*              n = *node;
+    JListNode*              nextNode;
+    unsigned int            nextOffset;
+    unsigned int            limit = list->capacity * JLIST_MERGE_PERCENT / 100;
+
+    node_close(list, n, *offset);
+    -- list->num;
+
+    if (0 == n->num) {
+        *node = n->next;
+        *offset = 0;
+        list_unlink(list, n);
+        list_node_free(list, n);
+        return;
+    }
+
+    nextNode = *offset < n->num ? n : n->next;
+    nextOffset = *offset < n->num ? *offset : 0;
+
+    if (n->num * 4 < list->capacity) {
+        if (JRET_PTR_NULL != n->prev && n->prev->num + n->num <= limit) {
+            if (nextNode == n) {
+                nextNode = n->prev;
+                nextOffset += n->prev->num;
+            }
+            node_merge(list, n->prev, n);
+        } else if (JRET_PTR_NULL != n->next && n->num + n->next->num <= limit) {
+            if (nextNode == n->next) {
+                nextNode = n;
+                nextOffset += n->num;
+            }
+            node_merge(list, n, n->next);
+        }
+    }
+
+    *node = nextNode;
+    *offset = nextOffset;
+}
+
+
+JList* jlist_new(unsigned int elementSize) {
+    return jlist_new_with_allocator(elementSize, JRET_PTR_NULL);
+}
+
+
+JList* jlist_new_with_allocator(unsigned int elementSize, const JAllocator* allocator) {
+    JList*                  list = JRET_PTR_NULL;
+    JMemoryStats            memStats = { 0, 0, 0 };
+    size_t                  header = offsetof(JListNode, data);
+    size_t                  capacity;
+
+    if (0 == elementSize || elementSize > (SIZE_MAX / 2 - header) / JLIST_MIN_ELEMENTS) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_PTR_NULL == allocator) {
+        allocator = jallocator_default();
+    }
+
+    list = jallocator_alloc(allocator, &memStats, sizeof (JList), sizeof (void*));
+    if (JRET_PTR_NULL == list) {
+        return JRET_PTR_NULL;
+    }
+
+    /* 按目标大小算出元素数, 节点大小取整到缓存行后把多出来的空间也用上 */
+    capacity = JLIST_NODE_SIZE > header ? (JLIST_NODE_SIZE - header) / elementSize : 0;
+    if (capacity < JLIST_MIN_ELEMENTS) {
+        capacity = JLIST_MIN_ELEMENTS;
+    }
+
+    list->head = JRET_PTR_NULL;
+    list->tail = JRET_PTR_NULL;
+    list->num = 0;
+    list->numNodes = 0;
+    list->elementSize = elementSize;
+    list->nodeSize = (header + capacity * elementSize + JLIST_CACHE_LINE - 1) & ~((size_t) JLIST_CACHE_LINE - 1);
+    list->capacity = (unsigned int) ((list->nodeSize - header) / elementSize);
+    list->allocator = allocator;
+    list->memStats = memStats;
+
+    return list;
+}
+
+
+void jlist_free(JList* list) {
+    if (JRET_PTR_NULL == list) {
+        return;
+    }
+
+    if (JRET_PTR_NULL != list->allocator->free) {
+        jlist_clear(list);
+    }
+
+    jallocator_free(list->allocator, JRET_PTR_NULL, list, sizeof (JList), sizeof (void*));
+}
+
+
+int jlist_push_front(JList* list, const void* element) {
+    JListNode*              node = list->head;
+
+    if (UINT_MAX == list->num) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL == node || list->capacity == node->num) {
+        node = list_node_new(list);
+        if (JRET_PTR_NULL == node) {
+            return JRET_ERROR;
+        }
+        node->start = list->capacity;
+        list_link(list, JRET_PTR_NULL, node);
+    } else if (0 == node->start) {
+        node_move(list, node, list->capacity - node->num);
+    }
+
+    -- node->start;
+    ++ node->num;
+    ++ list->num;
+    memcpy(node_at(list, node, 0), element, list->elementSize);
+
+    return JRET_OK;
+}
+
+
+int jlist_push_back(JList* list, const void* element) {
+    JListNode*              node = list->tail;
+
+    if (UINT_MAX == list->num) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL == node || list->capacity == node->num) {
+        node = list_node_new(list);
+        if (JRET_PTR_NULL == node) {
+            return JRET_ERROR;
+        }
+        list_link(list, list->tail, node);
+    } else if (node->start + node->num == list->capacity) {
+        node_move(list, node, 0);
+    }
+
+    memcpy(node_at(list, node, node->num), element, list->elementSize);
+    ++ node->num;
+    ++ list->num;
+
+    return JRET_OK;
+}
+
+
+int jlist_pop_front(JList* list, void* element) {
+    JListNode*              node = list->head;
+
+    if (JRET_PTR_NULL == node) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL != element) {
+        memcpy(element, node_at(list, node, 0), list->elementSize);
+    }
+    ++ node->start;
+    -- node->num;
+    -- list->num;
+
+    if (0 == node->num) {
+        list_unlink(list, node);
+        list_node_free(list, node);
+    }
+
+    return JRET_OK;
+}
+
+
+int jlist_pop_back(JList* list, void* element) {
+    JListNode*              node = list->tail;
+
+    if (JRET_PTR_NULL == node) {
+        return JRET_ERROR;
+    }
+
+    -- node->num;
+    -- list->num;
+    if (JRET_PTR_NULL != element) {
+        memcpy(element, node_at(list, node, node->num), list->elementSize);
+    }
+
+    if (0 == node->num) {
+        list_unlink(list, node);
+        list_node_free(list, node);
+    }
+
+    return JRET_OK;
+}
+
+
+int jlist_insert(JList* list, unsigned int index, const void* element) {
+    JListNode*              node = JRET_PTR_NULL;
+    unsigned int            offset = 0;
+
+    if (index > list->num) {
+        return JRET_ERROR;
+    }
+
+    if (index < list->num) {
+        node = list_locate(list, index, &offset);
+    }
+
+    return list_insert_at(list, &node, &offset, element);
+}
+
+
+int jlist_remove(JList* list, unsigned int index, void* element) {
+    JListNode*              node;
+    unsigned int            offset;
+
+    if (index >= list->num) {
+        return JRET_ERROR;
+    }
+
+    node = list_locate(list, index, &offset);
+    if (JRET_PTR_NULL != element) {
+        memcpy(element, node_at(list, node, offset), list->elementSize);
+    }
+    list_erase(list, &node, &offset);
+
+    return JRET_OK;
+}
+
+
+void jlist_clear(JList* list) {
+    JListNode*              node = list->head;
+    JListNode*              next;
+
+    for (; JRET_PTR_NULL != node; node = next) {
+        next = node->next;
+        list_node_free(list, node);
+    }
+
+    list->head = JRET_PTR_NULL;
+    list->tail = JRET_PTR_NULL;
+    list->num = 0;
+}
+
+
+void* jlist_get(JList* list, unsigned int index) {
+    JListNode*              node;
+    unsigned int            offset;
+
+    if (index >= list->num) {
+        return JRET_PTR_NULL;
+    }
+
+    node = list_locate(list, index, &offset);
+
+    return node_at(list, node, offset);
+}
+
+
+void* jlist_front(JList* list) {
+    if (JRET_PTR_NULL == list->head) {
+        return JRET_PTR_NULL;
+    }
+
+    return node_at(list, list->head, 0);
+}
+
+
+void* jlist_back(JList* list) {
+    if (JRET_PTR_NULL == list->tail) {
+        return JRET_PTR_NULL;
+    }
+
+    return node_at(list, list->tail, list->tail->num - 1);
+}
+
+
+unsigned int jlist_num(JList* list) {
+    return list->num;
+}
+
+
+int jlist_splice(JList* list, unsigned int index, JList* other) {
+    JListNode*              prev = list->tail;
+    JListNode*              next;
+    JListNode*              node;
+    unsigned int            offset;
+    size_t                  moved;
+
+    if (list == other || list->elementSize != other->elementSize || list->allocator != other->allocator
+        || index > list->num || (unsigned long long) list->num + other->num > UINT_MAX) {
+        return JRET_ERROR;
+    }
+
+    if (0 == other->num) {
+        return JRET_OK;
+    }
+
+    if (index < list->num) {
+        node = list_locate(list, index, &offset);
+        prev = node->prev;
+        if (0 != offset) {
+            if (JRET_OK != node_split(list, node, offset)) {
+                return JRET_ERROR;
+            }
+            prev = node;
+        }
+    }
+
+    next = JRET_PTR_NULL == prev ? list->head : prev->next;
+    other->head->prev = prev;
+    other->tail->next = next;
+    if (JRET_PTR_NULL == prev) {
+        list->head = other->head;
+    } else {
+        prev->next = other->head;
+    }
+    if (JRET_PTR_NULL == next) {
+        list->tail = other->tail;
+    } else {
+        next->prev = other->tail;
+    }
+
+    /* 节点的内存改记到 list 名下 */
+    moved = list->nodeSize * other->numNodes;
+    other->memStats.live -= moved;
+    list->memStats.live += moved;
+    if (list->memStats.peak < list->memStats.live) {
+        list->memStats.peak = list->memStats.live;
+    }
+
+    list->num += other->num;
+    list->numNodes += other->numNodes;
+    other->head = JRET_PTR_NULL;
+    other->tail = JRET_PTR_NULL;
+    other->num = 0;
+    other->numNodes = 0;
+
+    return JRET_OK;
+}
+
+
+JList* jlist_split(JList* list, unsigned int index) {
+    JList*                  other;
+    JListNode*              node;
+    unsigned int            offset;
+    size_t                  moved;
+
+    if (index > list->num) {
+        return JRET_PTR_NULL;
+    }
+
+    other = jlist_new_with_allocator(list->elementSize, list->allocator);
+    if (JRET_PTR_NULL == other || index == list->num) {
+        return other;
+    }
+
+    node = list_locate(list, index, &offset);
+    if (0 != offset) {
+        if (JRET_OK != node_split(list, node, offset)) {
+            jlist_free(other);
+            return JRET_PTR_NULL;
+        }
+        node = node->next;
+    }
+
+    other->head = node;
+    other->tail = list->tail;
+    list->tail = node->prev;
+    if (JRET_PTR_NULL == list->tail) {
+        list->head = JRET_PTR_NULL;
+    } else {
+        list->tail->next = JRET_PTR_NULL;
+    }
+    node->prev = JRET_PTR_NULL;
+
+    for (; JRET_PTR_NULL != node; node = node->next) {
+        ++ other->numNodes;
+    }
+    other->num = list->num - index;
+    list->num = index;
+    list->numNodes -= other->numNodes;
+
+    moved = list->nodeSize * other->numNodes;
+    list->memStats.live -= moved;
+    other->memStats.live += moved;
+    if (other->memStats.peak < other->memStats.live) {
+        other->memStats.peak = other->memStats.live;
+    }
+
+    return other;
+}
+
+
+void jlist_memory_stats(JList* list, JMemoryStats* stats) {
+    if (JRET_PTR_NULL == stats) {
+        return;
+    }
+
+    *stats = list->memStats;
+    stats->wasted = list->memStats.live - sizeof (JList) - (size_t) list->elementSize * list->num;
+}
+
+
+int jlist_cursor_first(JList* list, JListCursor* cursor) {
+    cursor->list = list;
+    cursor->node = list->head;
+    cursor->offset = 0;
+
+    return JRET_PTR_NULL == cursor->node ? JRET_ERROR : JRET_OK;
+}
+
+
+int jlist_cursor_last(JList* list, JListCursor* cursor) {
+    cursor->list = list;
+    cursor->node = list->tail;
+    cursor->offset = JRET_PTR_NULL == list->tail ? 0 : list->tail->num - 1;
+
+    return JRET_PTR_NULL == cursor->node ? JRET_ERROR : JRET_OK;
+}
+
+
+int jlist_cursor_at(JList* list, JListCursor* cursor, unsigned int index) {
+    cursor->list = list;
+    cursor->node = JRET_PTR_NULL;
+    cursor->offset = 0;
+
+    if (index >= list->num) {
+        return JRET_ERROR;
+    }
+
+    cursor->node = list_locate(list, index, &cursor->offset);
+
+    return JRET_OK;
+}
+
+
+int jlist_cursor_valid(const JListCursor* cursor) {
+    return JRET_PTR_NULL != cursor->node;
+}
+
+
+void* jlist_cursor_get(JListCursor* cursor) {
+    if (JRET_PTR_NULL == cursor->node) {
+        return JRET_PTR_NULL;
+    }
+
+    return node_at(cursor->list, cursor->node, cursor->offset);
+}
+
+
+int jlist_cursor_next(JListCursor* cursor) {
+    if (JRET_PTR_NULL == cursor->node) {
+        return JRET_ERROR;
+    }
+
+    if (++ cursor->offset < cursor->node->num) {
+        return JRET_OK;
+    }
+
+    return jlist_cursor_next_block(cursor);
+}
+
+
+int jlist_cursor_prev(JListCursor* cursor) {
+    if (JRET_PTR_NULL == cursor->node) {
+        return JRET_ERROR;
+    }
+
+    if (0 != cursor->offset) {
+        -- cursor->offset;
+        return JRET_OK;
+    }
+
+    cursor->node = cursor->node->prev;
+    cursor->offset = JRET_PTR_NULL == cursor->node ? 0 : cursor->node->num - 1;
+
+    return JRET_PTR_NULL == cursor->node ? JRET_ERROR : JRET_OK;
+}
+
+
+void* jlist_cursor_block(JListCursor* cursor, unsigned int* num) {
+    if (JRET_PTR_NULL == cursor->node) {
+        *num = 0;
+        return JRET_PTR_NULL;
+    }
+
+    *num = cursor->node->num - cursor->offset;
+
+    return node_at(cursor->list, cursor->node, cursor->offset);
+}
+
+
+int jlist_cursor_next_block(JListCursor* cursor) {
+    if (JRET_PTR_NULL == cursor->node) {
+        return JRET_ERROR;
+    }
+
+    cursor->node = cursor->node->next;
+    cursor->offset = 0;
+
+    return JRET_PTR_NULL == cursor->node ? JRET_ERROR : JRET_OK;
+}
+
+
+int jlist_cursor_insert(JListCursor* cursor, const void* element) {
+    return list_insert_at(cursor->list, &cursor->node, &cursor->offset, element);
+}
+
+
+int jlist_cursor_remove(JListCursor* cursor, void* element) {
+    if (JRET_PTR_NULL == cursor->node) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_PTR_NULL != element) {
+        memcpy(element, node_at(cursor->list, cursor->node, cursor->offset), cursor->list->elementSize);
+    }
+    list_erase(cursor->list, &cursor->node, &cursor->offset);
+
+    return JRET_OK;
+}
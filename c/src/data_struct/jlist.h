@@ -0,0 +1,316 @@
+#ifndef JLIST_H
+#define JLIST_H
+#include "jret.h"
+#include "jallocator.h"
+
+/**
+ *  展开链表 (unrolled linked list)
+ *
+ *  普通双向链表每个元素一个节点: 每次插入一次 malloc, 每个元素多两个指针加 malloc 的头部(约 32 字节),
+ *  遍历时每个元素都是一次指针跳转, 和 JAVLTreeNode 的问题一样。
+ *  展开链表的每个节点按缓存行对齐, 存放一段连续的定长元素(节点约 JLIST_NODE_SIZE 字节),
+ *  节点之间才用指针连接: 遍历基本是顺序读内存, 额外空间只有每个节点的头部和没用满的槽。
+ *
+ *  节点内的元素占用 [start, start + num) 这一段, 两头都可以留空:
+ *      头尾插入、弹出 O(1), 节点满了才申请新节点;
+ *      中间插入: 节点没满时移动较短的一侧, 满了就分裂成两个半满的节点;
+ *      中间删除: 节点少于 1/4 满时与相邻节点合并, 空节点立即释放。
+ *  按下标访问从较近的一端逐个节点跳过, O(n / 每个节点的元素数)。
+ *
+ *  游标(JListCursor)指向一个元素, 可以前后移动, 在游标处插入、删除;
+ *  jlist_cursor_block 返回游标所在节点中连续的一段元素, 按段遍历和遍历数组一样快。
+ *
+ *  jlist_splice / jlist_split 整段移动节点, 不复制元素, 只有断开处的一个节点要分成两个。
+ *
+ *  用法:
+ *      JList* list = jlist_new(sizeof (int));
+ *      JListCursor cursor;
+ *      unsigned int n;
+ *      int v = 42;
+ *      jlist_push_back(list, &v);
+ *      for (ret = jlist_cursor_first(list, &cursor); JRET_OK == ret; ret = jlist_cursor_next_block(&cursor)) {
+ *          int* p = jlist_cursor_block(&cursor, &n);
+ *          ...                                         // p[0] .. p[n - 1]
+ *      }
+ *
+ *  注意：
+ *      不是线程安全的。
+ *      元素地址在插入、删除后可能改变(节点内移动、分裂、合并), 不要保存元素指针;
+ *      除了用同一个游标插入、删除, 修改链表后其它游标都失效, 需要重新定位。
+ *
+ *  调用：
+ *      jlist_new --- 创建
+ *      jlist_free --- 销毁
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 节点的目标字节数(含头部), 按缓存行向上取整; 元素很大时每个节点至少放 4 个元素 */
+#ifndef JLIST_NODE_SIZE
+#define JLIST_NODE_SIZE     512
+#endif
+
+/* 展开链表 */
+typedef struct _JList JList;
+
+/* 游标 */
+typedef struct _JListCursor JListCursor;
+
+/* 游标, 记录当前元素所在的节点和节点内的位置, node 为 RET_PTR_NULL 表示已经移出链表 */
+struct _JListCursor {
+    JList*                  list;
+    struct _JListNode*      node;
+    unsigned int            offset;
+};
+
+
+/**
+ *  创建链表
+ *
+ *  @param elementSize      元素字节数
+ *
+ *  @return                 成功: 返回链表
+ *                          失败: 返回 RET_PTR_NULL (元素大小为 0 或太大, 内存不足)
+ */
+JList* jlist_new(unsigned int elementSize);
+
+
+/**
+ *  使用指定的分配器创建链表, 节点通过它申请和释放
+ *
+ *  @param elementSize      元素字节数
+ *  @param allocator        分配器, RET_PTR_NULL 表示默认分配器
+ *
+ *  @return                 成功: 返回链表
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JList* jlist_new_with_allocator(unsigned int elementSize, const JAllocator* allocator);
+
+
+/**
+ *  销毁链表
+ *
+ *  @param list             链表
+ */
+void jlist_free(JList* list);
+
+
+/**
+ *  在头部、尾部插入元素
+ *
+ *  @param list             链表
+ *  @param element          元素, 复制 elementSize 字节
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足)
+ */
+int jlist_push_front(JList* list, const void* element);
+int jlist_push_back(JList* list, const void* element);
+
+
+/**
+ *  弹出头部、尾部的元素
+ *
+ *  @param list             链表
+ *  @param element          返回弹出的元素, 可以为 RET_PTR_NULL
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (链表为空)
+ */
+int jlist_pop_front(JList* list, void* element);
+int jlist_pop_back(JList* list, void* element);
+
+
+/**
+ *  在 index 处插入元素, 原来 index 及之后的元素后移
+ *
+ *  @param list             链表
+ *  @param index            位置, 等于元素数时追加到末尾
+ *  @param element          元素
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (位置越界或内存不足)
+ */
+int jlist_insert(JList* list, unsigned int index, const void* element);
+
+
+/**
+ *  删除 index 处的元素
+ *
+ *  @param list             链表
+ *  @param index            位置
+ *  @param element          返回删除的元素, 可以为 RET_PTR_NULL
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (位置越界)
+ */
+int jlist_remove(JList* list, unsigned int index, void* element);
+
+
+/**
+ *  删除所有元素, 释放所有节点
+ *
+ *  @param list             链表
+ */
+void jlist_clear(JList* list);
+
+
+/**
+ *  第 index 个元素
+ *
+ *  @param list             链表
+ *  @param index            位置
+ *
+ *  @return                 成功: 返回元素的地址, 修改链表后失效
+ *                          失败: 返回 RET_PTR_NULL (位置越界)
+ */
+void* jlist_get(JList* list, unsigned int index);
+
+
+/**
+ *  头部、尾部的元素
+ *
+ *  @return                 成功: 返回元素的地址
+ *                          失败: 返回 RET_PTR_NULL (链表为空)
+ */
+void* jlist_front(JList* list);
+void* jlist_back(JList* list);
+
+
+/**
+ *  元素数
+ */
+unsigned int jlist_num(JList* list);
+
+
+/**
+ *  把 other 的所有元素移动到 list 的 index 处, other 变为空链表
+ *  整个节点链接过去, 不复制元素; index 在节点中间时把这个节点分成两个
+ *
+ *  @param list             链表
+ *  @param index            位置, 等于元素数时追加到末尾
+ *  @param other            另一个链表, 元素大小和分配器必须与 list 相同
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (位置越界, 两个链表不兼容或是同一个, 内存不足; 两个链表都不变)
+ */
+int jlist_splice(JList* list, unsigned int index, JList* other);
+
+
+/**
+ *  把 index 及之后的元素移动到一个新链表中, 与 jlist_splice 相反
+ *
+ *  @param list             链表
+ *  @param index            位置, 等于元素数时返回空链表
+ *
+ *  @return                 成功: 返回新链表, 使用同一个分配器
+ *                          失败: 返回 RET_PTR_NULL (位置越界或内存不足, 链表不变)
+ */
+JList* jlist_split(JList* list, unsigned int index);
+
+
+/**
+ *  链表的内存统计, wasted 是节点头部和没有存放元素的槽
+ *
+ *  @param list             链表
+ *  @param stats            统计结果
+ */
+void jlist_memory_stats(JList* list, JMemoryStats* stats);
+
+
+/**
+ *  游标定位到第一个、最后一个、第 index 个元素
+ *
+ *  @param list             链表
+ *  @param cursor           游标
+ *  @param index            位置
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (链表为空或位置越界, 游标移出链表)
+ */
+int jlist_cursor_first(JList* list, JListCursor* cursor);
+int jlist_cursor_last(JList* list, JListCursor* cursor);
+int jlist_cursor_at(JList* list, JListCursor* cursor, unsigned int index);
+
+
+/**
+ *  游标是否指向元素
+ *
+ *  @return                 指向元素返回 1, 已经移出链表返回 0
+ */
+int jlist_cursor_valid(const JListCursor* cursor);
+
+
+/**
+ *  游标指向的元素
+ *
+ *  @return                 成功: 返回元素的地址
+ *                          失败: 返回 RET_PTR_NULL (游标已经移出链表)
+ */
+void* jlist_cursor_get(JListCursor* cursor);
+
+
+/**
+ *  游标移到下一个、上一个元素
+ *
+ *  @param cursor           游标
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (已经是最后一个、第一个元素, 或游标已经移出链表; 游标移出链表)
+ */
+int jlist_cursor_next(JListCursor* cursor);
+int jlist_cursor_prev(JListCursor* cursor);
+
+
+/**
+ *  从游标开始、在同一个节点中连续存放的元素
+ *
+ *  @param cursor           游标
+ *  @param num              返回元素数
+ *
+ *  @return                 成功: 返回第一个元素(即游标指向的元素)的地址
+ *                          失败: 返回 RET_PTR_NULL, num 为 0 (游标已经移出链表)
+ */
+void* jlist_cursor_block(JListCursor* cursor, unsigned int* num);
+
+
+/**
+ *  游标移到下一个节点的第一个元素, 与 jlist_cursor_block 一起按段遍历
+ *
+ *  @param cursor           游标
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (已经是最后一个节点, 游标移出链表)
+ */
+int jlist_cursor_next_block(JListCursor* cursor);
+
+
+/**
+ *  在游标指向的元素之前插入元素, 游标移出链表时插入到末尾; 之后游标指向新插入的元素
+ *
+ *  @param cursor           游标
+ *  @param element          元素
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足, 游标不变)
+ */
+int jlist_cursor_insert(JListCursor* cursor, const void* element);
+
+
+/**
+ *  删除游标指向的元素, 之后游标指向下一个元素(删除的是最后一个元素时移出链表)
+ *
+ *  @param cursor           游标
+ *  @param element          返回删除的元素, 可以为 RET_PTR_NULL
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (游标已经移出链表)
+ */
+int jlist_cursor_remove(JListCursor* cursor, void* element);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JLIST_H
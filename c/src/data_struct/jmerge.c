@@ -0,0 +1,389 @@
+#include "jmerge.h"
+#include "jbinary_heap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JMERGE_SAMPLES          (64)                // 并行归并时平均每个区间取样的个数
+#define JMERGE_TASKS_PER_THREAD (4)                 // 并行归并时每个线程分到的区间数, 多分几段让线程之间均衡
+#define JMERGE_MIN_PARALLEL     (1 << 16)           // 总数少于它时不切分
+
+/* 一路输入, 在堆中按当前值排序 */
+typedef struct _JMergeInput JMergeInput;
+struct _JMergeInput {
+    JMerge*                 merge;
+    const JMergeValue*      next;                   // 当前值
+    const JMergeValue*      end;
+    JMergeReadFunc          read;                   // 数组输入为 RET_PTR_NULL
+    void*                   data;
+    unsigned int            index;                  // 添加的顺序, 值相等时按它排序
+    JMergeValue             buffer[];               // 回调输入的缓冲区, JMERGE_BUFFER_SIZE 个值
+};
+
+struct _JMerge {
+    JMergeCompareFunc       compareFunc;
+    JBinaryHeap*            heap;                   // 没读完的输入, 堆顶是当前值最小的一路
+    JMergeInput**           inputs;                 // 添加过的所有输入, 销毁时释放
+    unsigned int            numInputs;
+    unsigned int            capacity;
+    int                     started;
+};
+
+/* 并行归并: 第 r 个区间是每一路的 [bounds[r * k + j], bounds[(r + 1) * k + j]), 输出到 out + offsets[r] */
+typedef struct {
+    JMergeCompareFunc       compareFunc;
+    const JMergeValue* const* arrays;
+    unsigned int            k;
+    size_t*                 bounds;
+    size_t*                 offsets;
+    JMergeValue*            out;
+    int                     failed;
+} JMergeParallel;
+
+/* 比较两路的当前值, 相等时先添加的一路在前, 保证稳定 */
+static int merge_input_compare(JBinaryHeapValue value1, JBinaryHeapValue value2) {
+    JMergeInput*            input1 = value1;
+    JMergeInput*            input2 = value2;
+    int                     ret = input1->merge->compareFunc(*input1->next, *input2->next);
+
+    if (JRET_EQUAL != ret) {
+        return ret;
+    }
+
+    return input1->index < input2->index ? JRET_SMALLER : JRET_BIGGER;
+}
+
+/* 新建一路输入并记录下来, bufferSize 是回调输入缓冲区的大小 */
+static JMergeInput* merge_input_new(JMerge* merge, unsigned int bufferSize) {
+    JMergeInput**           inputs;
+    JMergeInput*            input;
+
+    if (merge->started) {
+        return JRET_PTR_NULL;
+    }
+
+    if (merge->numInputs == merge->capacity) {
+        inputs = realloc(merge->inputs, sizeof (JMergeInput*) * (merge->capacity + merge->capacity / 2 + 8));
+        if (JRET_PTR_NULL == inputs) {
+            return JRET_PTR_NULL;
+        }
+        merge->inputs = inputs;
+        merge->capacity += merge->capacity / 2 + 8;
+    }
+
+    input = malloc(sizeof (JMergeInput) + sizeof (JMergeValue) * bufferSize);
+    if (JRET_PTR_NULL == input) {
+        return JRET_PTR_NULL;
+    }
+
+    input->merge = merge;
+    input->next = JRET_PTR_NULL;
+    input->end = JRET_PTR_NULL;
+    input->read = JRET_PTR_NULL;
+    input->data = JRET_PTR_NULL;
+    input->index = merge->numInputs;
+    merge->inputs[merge->numInputs ++] = input;
+
+    return input;
+}
+
+/* 有值的输入放进堆, 空输入只留在 inputs 中; 放不进堆时撤销这一路 */
+static int merge_input_start(JMerge* merge, JMergeInput* input) {
+    if (input->next == input->end || JRET_OK == binary_heap_insert(merge->heap, input)) {
+        return JRET_OK;
+    }
+
+    -- merge->numInputs;
+    free(input);
+
+    return JRET_ERROR;
+}
+
+/* 回调输入的缓冲区读完后再取一段, 这一路结束时返回 JRET_ERROR */
+static int merge_input_fill(JMergeInput* input) {
+    unsigned int            num;
+
+    if (JRET_PTR_NULL == input->read) {
+        return JRET_ERROR;
+    }
+
+    num = input->read(input->data, input->buffer, JMERGE_BUFFER_SIZE);
+    input->next = input->buffer;
+    input->end = input->buffer + num;
+
+    return 0 == num ? JRET_ERROR : JRET_OK;
+}
+
+/* 第一个不小于 value 的位置 */
+static size_t merge_lower_bound(JMergeCompareFunc compareFunc, const JMergeValue* values, size_t num, JMergeValue value) {
+    size_t                  lo = 0;
+    size_t                  hi = num;
+    size_t                  mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (JRET_SMALLER == compareFunc(values[mid], value)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * 取分割值: 每一路按长度比例等距取样, 共约 numRanges * JMERGE_SAMPLES 个,
+ * 每个样本代表差不多同样多的值, 排序后的 numRanges - 1 个分位点把总数大致等分
+ */
+static int merge_splitters(JMergeCompareFunc compareFunc, const JMergeValue* const* arrays, const size_t* nums, unsigned int k,
+                           size_t total, unsigned int numRanges, JMergeValue* splitters) {
+    size_t                  target = (size_t) numRanges * JMERGE_SAMPLES;
+    JMergeValue*            samples = malloc(sizeof (JMergeValue) * (target + k));
+    JBinaryHeap*            heap = JRET_PTR_NULL;
+    size_t                  numSamples = 0;
+    size_t                  count;
+    size_t                  i;
+    unsigned int            j;
+    unsigned int            r;
+
+    if (JRET_PTR_NULL == samples) {
+        return JRET_ERROR;
+    }
+
+    for (j = 0; j < k; ++j) {
+        count = (size_t) ((double) target * nums[j] / total) + (0 != nums[j]);
+        for (i = 0; i < count; ++i) {
+            samples[numSamples ++] = arrays[j][(size_t) ((i + 0.5) * nums[j] / count)];
+        }
+    }
+
+    /* 比较函数没有用户数据参数, 不能用 qsort, 用堆排序 */
+    heap = binary_heap_new_from_array(JBINARY_HEAP_TYPE_MIN, compareFunc, samples, (unsigned int) numSamples);
+    if (JRET_PTR_NULL == heap) {
+        free(samples);
+        return JRET_ERROR;
+    }
+    binary_heap_pop_n(heap, samples, (unsigned int) numSamples);
+
+    for (r = 1; r < numRanges; ++r) {
+        splitters[r - 1] = samples[(size_t) r * numSamples / numRanges];
+    }
+
+    binary_heap_free(heap);
+    free(samples);
+
+    return JRET_OK;
+}
+
+/* 线程池任务: 归并第 task 个区间 */
+static void merge_range(unsigned int task, void* data) {
+    JMergeParallel*         parallel = data;
+    const size_t*           lo = parallel->bounds + (size_t) task * parallel->k;
+    const size_t*           hi = lo + parallel->k;
+    JMerge*                 merge = jmerge_new(parallel->compareFunc);
+    size_t                  num = 0;
+    unsigned int            j;
+
+    if (JRET_PTR_NULL == merge) {
+        __atomic_store_n(&parallel->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    for (j = 0; j < parallel->k; ++j) {
+        if (JRET_OK != jmerge_add_array(merge, parallel->arrays[j] + lo[j], hi[j] - lo[j])) {
+            __atomic_store_n(&parallel->failed, 1, __ATOMIC_RELAXED);
+            jmerge_free(merge);
+            return;
+        }
+        num += hi[j] - lo[j];
+    }
+
+    jmerge_read(merge, parallel->out + parallel->offsets[task], num);
+    jmerge_free(merge);
+}
+
+
+JMerge* jmerge_new(JMergeCompareFunc compareFunc) {
+    JMerge*                 merge = JRET_PTR_NULL;
+
+    if (JRET_PTR_NULL == compareFunc) {
+        return JRET_PTR_NULL;
+    }
+
+    merge = malloc(sizeof (JMerge));
+    if (JRET_PTR_NULL == merge) {
+        return JRET_PTR_NULL;
+    }
+
+    merge->heap = binary_heap_new(JBINARY_HEAP_TYPE_MIN, merge_input_compare);
+    if (JRET_PTR_NULL == merge->heap) {
+        free(merge);
+        return JRET_PTR_NULL;
+    }
+
+    merge->compareFunc = compareFunc;
+    merge->inputs = JRET_PTR_NULL;
+    merge->numInputs = 0;
+    merge->capacity = 0;
+    merge->started = 0;
+
+    return merge;
+}
+
+
+void jmerge_free(JMerge* merge) {
+    unsigned int            i;
+
+    if (JRET_PTR_NULL == merge) {
+        return;
+    }
+
+    for (i = 0; i < merge->numInputs; ++i) {
+        free(merge->inputs[i]);
+    }
+
+    binary_heap_free(merge->heap);
+    free(merge->inputs);
+    free(merge);
+}
+
+
+int jmerge_add_array(JMerge* merge, const JMergeValue* values, size_t num) {
+    JMergeInput*            input = merge_input_new(merge, 0);
+
+    if (JRET_PTR_NULL == input) {
+        return JRET_ERROR;
+    }
+
+    input->next = values;
+    input->end = values + num;
+
+    return merge_input_start(merge, input);
+}
+
+
+int jmerge_add_stream(JMerge* merge, JMergeReadFunc read, void* data) {
+    JMergeInput*            input = merge_input_new(merge, JMERGE_BUFFER_SIZE);
+
+    if (JRET_PTR_NULL == input) {
+        return JRET_ERROR;
+    }
+
+    input->read = read;
+    input->data = data;
+    merge_input_fill(input);
+
+    return merge_input_start(merge, input);
+}
+
+
+size_t jmerge_read(JMerge* merge, JMergeValue* values, size_t num) {
+    JMergeInput*            input;
+    size_t                  count = 0;
+    size_t                  n;
+    int                     last;
+
+    merge->started = 1;
+
+    while (count < num) {
+        input = binary_heap_peek(merge->heap);
+        if (JRET_PTR_NULL == input) {
+            break;
+        }
+
+        /* 只剩一路时不需要比较, 整段复制 */
+        last = 1 == binary_heap_num(merge->heap);
+        if (last) {
+            n = input->end - input->next;
+            if (n > num - count) {
+                n = num - count;
+            }
+            memcpy(values + count, input->next, sizeof (JMergeValue) * n);
+            input->next += n;
+            count += n;
+        } else {
+            values[count ++] = *input->next ++;
+        }
+
+        if (input->next == input->end && JRET_OK != merge_input_fill(input)) {
+            binary_heap_pop(merge->heap);
+        } else if (!last) {
+            binary_heap_replace_top(merge->heap, input);
+        }
+    }
+
+    return count;
+}
+
+
+unsigned int jmerge_num_inputs(JMerge* merge) {
+    return binary_heap_num(merge->heap);
+}
+
+
+int jmerge_parallel(JMergeCompareFunc compareFunc, const JMergeValue* const* arrays, const size_t* nums, unsigned int k,
+                    JMergeValue* out, JThreadPool* pool) {
+    JMergeParallel          parallel;
+    JMergeValue*            splitters = JRET_PTR_NULL;
+    unsigned int            numRanges = 1;
+    size_t                  total = 0;
+    size_t                  offset = 0;
+    unsigned int            j;
+    unsigned int            r;
+
+    for (j = 0; j < k; ++j) {
+        total += nums[j];
+    }
+
+    if (JRET_PTR_NULL != pool && total >= JMERGE_MIN_PARALLEL) {
+        numRanges = thread_pool_num_threads(pool) * JMERGE_TASKS_PER_THREAD;
+    }
+
+    parallel.compareFunc = compareFunc;
+    parallel.arrays = arrays;
+    parallel.k = k;
+    parallel.out = out;
+    parallel.failed = 0;
+    parallel.bounds = malloc(sizeof (size_t) * ((size_t) (numRanges + 1) * k + 1));        // k 为 0 时也申请一个, 不用区分 malloc(0)
+    parallel.offsets = malloc(sizeof (size_t) * numRanges);
+    splitters = malloc(sizeof (JMergeValue) * numRanges);
+    if (JRET_PTR_NULL == parallel.bounds || JRET_PTR_NULL == parallel.offsets || JRET_PTR_NULL == splitters
+        || (numRanges > 1 && JRET_OK != merge_splitters(compareFunc, arrays, nums, k, total, numRanges, splitters))) {
+        free(parallel.bounds);
+        free(parallel.offsets);
+        free(splitters);
+        return JRET_ERROR;
+    }
+
+    /* 分割值有序, 每一路的切分点也有序; 等于分割值的都分到右边, 相等的值在同一个区间里按输入顺序归并 */
+    for (r = 0; r <= numRanges; ++r) {
+        for (j = 0; j < k; ++j) {
+            if (0 == r) {
+                parallel.bounds[j] = 0;
+            } else if (numRanges == r) {
+                parallel.bounds[(size_t) r * k + j] = nums[j];
+            } else {
+                parallel.bounds[(size_t) r * k + j] = merge_lower_bound(compareFunc, arrays[j], nums[j], splitters[r - 1]);
+            }
+        }
+    }
+    for (r = 0; r < numRanges; ++r) {
+        parallel.offsets[r] = offset;
+        for (j = 0; j < k; ++j) {
+            offset += parallel.bounds[(size_t) (r + 1) * k + j] - parallel.bounds[(size_t) r * k + j];
+        }
+    }
+
+    if (1 == numRanges) {
+        merge_range(0, &parallel);
+    } else {
+        thread_pool_run(pool, numRanges, merge_range, &parallel);
+    }
+
+    free(parallel.bounds);
+    free(parallel.offsets);
+    free(splitters);
+
+    return parallel.failed ? JRET_ERROR : JRET_OK;
+}
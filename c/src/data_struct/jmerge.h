@@ -0,0 +1,164 @@
+#ifndef JMERGE_H
+#define JMERGE_H
+#include "jret.h"
+#include "jthread_pool.h"
+
+/**
+ *  多路归并
+ *
+ *  把 K 路各自有序的输入(分片的查询结果、日志段、外部排序的顺串)合并成一路有序输出。
+ *  输入有两种:
+ *      数组    --- jmerge_add_array, 直接在用户的数组上读, 不复制
+ *      回调    --- jmerge_add_stream, 每次调用回调批量取一段值放进这一路自己的缓冲区
+ *  每一路在一个最小堆(JBinaryHeap)中, 按这一路当前的值排序; 取出堆顶那一路的值后,
+ *  这一路前进一个值, 用 binary_heap_replace_top 原地下沉一次,
+ *  而不是 binary_heap_pop + binary_heap_insert(一次下沉加一次上浮)。
+ *  相等的值按输入添加的顺序输出(稳定)。
+ *  jmerge_read 一次输出一批值到调用者的缓冲区, 只剩一路时直接整段复制。
+ *
+ *  并行归并(jmerge_parallel, 输入都是数组):
+ *      从各路数组中等距取样, 排序后取分位点作为分割值, 每一路用二分查找切成若干个区间;
+ *      第 i 个区间是各路中位于第 i - 1 和第 i 个分割值之间的值, 在输出中的位置可以直接算出,
+ *      各区间在线程池的线程上分别归并, 互不依赖。
+ *
+ *  用法:
+ *      JMerge* merge = jmerge_new(compare);
+ *      jmerge_add_array(merge, run1, num1);
+ *      jmerge_add_stream(merge, read_segment, file);
+ *      while ((n = jmerge_read(merge, buffer, 1024)) > 0) {
+ *          ...                                         // buffer[0] .. buffer[n - 1]
+ *      }
+ *      jmerge_free(merge);
+ *
+ *  注意：
+ *      输入必须各自有序(按同一个比较函数), 否则输出无序, 不做检查。
+ *      值由用户管理, 归并只传递指针。
+ *      不是线程安全的。
+ *
+ *  调用：
+ *      jmerge_new --- 创建
+ *      jmerge_free --- 销毁
+ */
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 每一路回调输入的缓冲区大小(值的个数) */
+#ifndef JMERGE_BUFFER_SIZE
+#define JMERGE_BUFFER_SIZE  256
+#endif
+
+/* 多路归并 */
+typedef struct _JMerge JMerge;
+
+/* 归并的值 */
+typedef void* JMergeValue;
+
+
+/**
+ *  比较函数, 与 JBinaryHeap 相同
+ *
+ *  @return                 value1 < value2     返回： RET_SMALLER
+ *                          value1 > value2     返回： RET_BIGGER
+ *                          value1 == value2    返回:  RET_EQUAL
+ */
+typedef int (*JMergeCompareFunc) (JMergeValue value1, JMergeValue value2);
+
+
+/**
+ *  回调输入: 按顺序取这一路接下来的最多 num 个值
+ *
+ *  @param data             jmerge_add_stream 传入的用户数据
+ *  @param values           存放取到的值
+ *  @param num              最多取的个数
+ *
+ *  @return                 取到的个数, 0 表示这一路结束
+ */
+typedef unsigned int (*JMergeReadFunc) (void* data, JMergeValue* values, unsigned int num);
+
+
+/**
+ *  创建归并
+ *
+ *  @param compareFunc      比较函数
+ *
+ *  @return                 成功: 返回归并
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JMerge* jmerge_new(JMergeCompareFunc compareFunc);
+
+
+/**
+ *  销毁归并, 不释放输入
+ *
+ *  @param merge            归并
+ */
+void jmerge_free(JMerge* merge);
+
+
+/**
+ *  添加一路数组输入, 归并结束前数组不能修改或释放
+ *
+ *  @param merge            归并
+ *  @param values           有序的值
+ *  @param num              值的个数, 可以为 0
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (已经开始读或内存不足)
+ */
+int jmerge_add_array(JMerge* merge, const JMergeValue* values, size_t num);
+
+
+/**
+ *  添加一路回调输入, 立即调用一次 read 取第一段
+ *
+ *  @param merge            归并
+ *  @param read             回调
+ *  @param data             传给回调的用户数据
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (已经开始读或内存不足)
+ */
+int jmerge_add_stream(JMerge* merge, JMergeReadFunc read, void* data);
+
+
+/**
+ *  读出接下来最多 num 个归并后的值; 第一次读之后不能再添加输入
+ *
+ *  @param merge            归并
+ *  @param values           存放输出的值
+ *  @param num              最多输出的个数
+ *
+ *  @return                 输出的个数, 小于 num 表示所有输入都已读完
+ */
+size_t jmerge_read(JMerge* merge, JMergeValue* values, size_t num);
+
+
+/**
+ *  还没有读完的输入路数
+ */
+unsigned int jmerge_num_inputs(JMerge* merge);
+
+
+/**
+ *  并行归并 k 个有序数组, 结果写入 out
+ *
+ *  @param compareFunc      比较函数, 需要是线程安全的
+ *  @param arrays           k 个有序数组
+ *  @param nums             每个数组的值的个数
+ *  @param k                数组个数
+ *  @param out              输出, 能放下所有数组的值的总数, 不能与输入重叠
+ *  @param pool             线程池, RET_PTR_NULL 表示在调用线程上归并
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足)
+ */
+int jmerge_parallel(JMergeCompareFunc compareFunc, const JMergeValue* const* arrays, const size_t* nums, unsigned int k,
+                    JMergeValue* out, JThreadPool* pool);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JMERGE_H
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include "jmulti_queue.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+
+#define JMULTI_QUEUE_CACHE_LINE     (64)
+#define JMULTI_QUEUE_ARITY          (4)                     // 分片堆的叉数
+#define JMULTI_QUEUE_POP_TRIES      (8)                     // 随机选分片失败这么多次后按顺序扫描
+#define JMULTI_QUEUE_SPINS          (64)                    // 加锁自旋这么多次后让出 CPU
+
+/**
+ *  分片, 独占一个缓存行
+ *  size 在持有锁时更新, 不加锁也可以读, 用来跳过空分片
+ */
+typedef struct {
+    int                     lock;                           // 0 空闲, 1 被占用
+    unsigned int            size;
+    JBinaryHeap*            heap;
+    char                    pad[JMULTI_QUEUE_CACHE_LINE - 2 * sizeof (int) - sizeof (JBinaryHeap*)];
+} JMultiQueueShard;
+
+struct _JMultiQueue {
+    JMultiQueueShard*       shards;
+    unsigned int            numShards;
+    JBinaryHeapType         type;
+    binary_heap_compare_cb  compareFunc;
+};
+
+/* 每个线程一个编号和随机数状态, 编号决定本地分片 */
+static unsigned int         threadNext;
+static __thread unsigned int threadIndex;                   // 0 表示还没分配, 否则为编号 + 1
+static __thread uint64_t    threadRandom;
+
+static unsigned int multi_queue_thread_index(void) {
+    if (0 == threadIndex) {
+        threadIndex = __atomic_fetch_add(&threadNext, 1, __ATOMIC_RELAXED) + 1;
+        threadRandom = 0x9E3779B97F4A7C15ULL * threadIndex;
+    }
+
+    return threadIndex - 1;
+}
+
+static unsigned int multi_queue_random(JMultiQueue* queue) {
+    multi_queue_thread_index();
+    threadRandom ^= threadRandom << 13;
+    threadRandom ^= threadRandom >> 7;
+    threadRandom ^= threadRandom << 17;
+
+    return (unsigned int) (threadRandom >> 32) % queue->numShards;
+}
+
+static int shard_try_lock(JMultiQueueShard* shard) {
+    return 0 == __atomic_load_n(&shard->lock, __ATOMIC_RELAXED)
+        && 0 == __atomic_exchange_n(&shard->lock, 1, __ATOMIC_ACQUIRE);
+}
+
+static void shard_lock(JMultiQueueShard* shard) {
+    unsigned int            spins = 0;
+
+    while (!shard_try_lock(shard)) {
+        if (++ spins % JMULTI_QUEUE_SPINS == 0) {
+            sched_yield();
+        }
+    }
+}
+
+static void shard_unlock(JMultiQueueShard* shard) {
+    __atomic_store_n(&shard->size, binary_heap_num(shard->heap), __ATOMIC_RELAXED);
+    __atomic_store_n(&shard->lock, 0, __ATOMIC_RELEASE);
+}
+
+static unsigned int shard_size(JMultiQueueShard* shard) {
+    return __atomic_load_n(&shard->size, __ATOMIC_RELAXED);
+}
+
+/* 两个已加锁的分片中堆顶更优先的一个, 都为空时返回 RET_PTR_NULL */
+static JMultiQueueShard* multi_queue_better(JMultiQueue* queue, JMultiQueueShard* s1, JMultiQueueShard* s2) {
+    JBinaryHeapValue        v1 = binary_heap_peek(s1->heap);
+    JBinaryHeapValue        v2 = binary_heap_peek(s2->heap);
+    int                     ret;
+
+    if (JBINARY_HEAP_NULL == v1) {
+        return JBINARY_HEAP_NULL == v2 ? JRET_PTR_NULL : s2;
+    }
+    if (JBINARY_HEAP_NULL == v2) {
+        return s1;
+    }
+
+    ret = queue->compareFunc(v1, v2);
+    if (JBINARY_HEAP_TYPE_MIN == queue->type) {
+        return JRET_BIGGER == ret ? s2 : s1;
+    }
+
+    return JRET_SMALLER == ret ? s2 : s1;
+}
+
+/* 从随机位置开始按顺序找一个非空分片弹出 */
+static JBinaryHeapValue multi_queue_pop_scan(JMultiQueue* queue) {
+    unsigned int            start = multi_queue_random(queue);
+    JMultiQueueShard*       shard;
+    JBinaryHeapValue        value;
+    unsigned int            i;
+
+    for (i = 0; i < queue->numShards; ++i) {
+        shard = &queue->shards[(start + i) % queue->numShards];
+        if (0 == shard_size(shard)) {
+            continue;
+        }
+
+        shard_lock(shard);
+        value = binary_heap_pop(shard->heap);
+        shard_unlock(shard);
+        if (JBINARY_HEAP_NULL != value) {
+            return value;
+        }
+    }
+
+    return JBINARY_HEAP_NULL;
+}
+
+JMultiQueue* multi_queue_new(JBinaryHeapType type, binary_heap_compare_cb compareFunction, unsigned int numShards) {
+    JMultiQueue*            queue = JRET_PTR_NULL;
+    unsigned int            i;
+    long                    cpus;
+
+    if (JRET_PTR_NULL == compareFunction) {
+        return JRET_PTR_NULL;
+    }
+
+    if (0 == numShards) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numShards = cpus > 0 ? (unsigned int) cpus * 2 : 2;
+    }
+
+    queue = malloc(sizeof (JMultiQueue));
+    if (JRET_PTR_NULL == queue) {
+        return JRET_PTR_NULL;
+    }
+
+    if (0 != posix_memalign((void**) &queue->shards, JMULTI_QUEUE_CACHE_LINE, sizeof (JMultiQueueShard) * numShards)) {
+        free(queue);
+        return JRET_PTR_NULL;
+    }
+
+    queue->numShards = numShards;
+    queue->type = type;
+    queue->compareFunc = compareFunction;
+    for (i = 0; i < numShards; ++i) {
+        queue->shards[i].lock = 0;
+        queue->shards[i].size = 0;
+        queue->shards[i].heap = binary_heap_new_with_arity(type, JMULTI_QUEUE_ARITY, compareFunction);
+        if (JRET_PTR_NULL == queue->shards[i].heap) {
+            queue->numShards = i;
+            multi_queue_free(queue);
+            return JRET_PTR_NULL;
+        }
+    }
+
+    return queue;
+}
+
+void multi_queue_free(JMultiQueue* queue) {
+    unsigned int            i;
+
+    if (JRET_PTR_NULL == queue) {
+        return;
+    }
+
+    for (i = 0; i < queue->numShards; ++i) {
+        binary_heap_free(queue->shards[i].heap);
+    }
+    free(queue->shards);
+    free(queue);
+}
+
+int multi_queue_push(JMultiQueue* queue, JBinaryHeapValue value) {
+    JMultiQueueShard*       shard = &queue->shards[multi_queue_thread_index() % queue->numShards];
+    unsigned int            tries = 0;
+    int                     ret;
+
+    /* 本地分片被弹出操作占用时换随机分片, 一直抢不到再阻塞等待 */
+    while (!shard_try_lock(shard)) {
+        shard = &queue->shards[multi_queue_random(queue)];
+        if (++ tries >= JMULTI_QUEUE_POP_TRIES) {
+            shard_lock(shard);
+            break;
+        }
+    }
+
+    ret = binary_heap_insert(shard->heap, value);
+    shard_unlock(shard);
+
+    return ret;
+}
+
+JBinaryHeapValue multi_queue_pop(JMultiQueue* queue) {
+    JMultiQueueShard*       s1;
+    JMultiQueueShard*       s2;
+    JMultiQueueShard*       best;
+    JBinaryHeapValue        value;
+    unsigned int            i;
+
+    for (i = 0; i < JMULTI_QUEUE_POP_TRIES; ++i) {
+        s1 = &queue->shards[multi_queue_random(queue)];
+        s2 = &queue->shards[multi_queue_random(queue)];
+        if (0 == shard_size(s1) && 0 == shard_size(s2)) {
+            continue;
+        }
+
+        /* 只尝试加锁, 不会与其它线程死锁 */
+        if (!shard_try_lock(s1)) {
+            continue;
+        }
+        if (s2 != s1 && !shard_try_lock(s2)) {
+            shard_unlock(s1);
+            continue;
+        }
+
+        best = multi_queue_better(queue, s1, s2);
+        value = JRET_PTR_NULL == best ? JBINARY_HEAP_NULL : binary_heap_pop(best->heap);
+
+        if (s2 != s1) {
+            shard_unlock(s2);
+        }
+        shard_unlock(s1);
+
+        if (JBINARY_HEAP_NULL != value) {
+            return value;
+        }
+    }
+
+    return multi_queue_pop_scan(queue);
+}
+
+JBinaryHeapValue multi_queue_pop_strict(JMultiQueue* queue) {
+    JMultiQueueShard*       best = JRET_PTR_NULL;
+    JBinaryHeapValue        value = JBINARY_HEAP_NULL;
+    unsigned int            i;
+
+    /* 按下标顺序加锁, 多个严格弹出之间不会死锁 */
+    for (i = 0; i < queue->numShards; ++i) {
+        shard_lock(&queue->shards[i]);
+        if (JRET_PTR_NULL == best) {
+            best = 0 == binary_heap_num(queue->shards[i].heap) ? JRET_PTR_NULL : &queue->shards[i];
+        } else {
+            best = multi_queue_better(queue, best, &queue->shards[i]);
+        }
+    }
+
+    if (JRET_PTR_NULL != best) {
+        value = binary_heap_pop(best->heap);
+    }
+
+    for (i = 0; i < queue->numShards; ++i) {
+        shard_unlock(&queue->shards[i]);
+    }
+
+    return value;
+}
+
+unsigned int multi_queue_num(JMultiQueue* queue) {
+    unsigned int            num = 0;
+    unsigned int            i;
+
+    for (i = 0; i < queue->numShards; ++i) {
+        num += shard_size(&queue->shards[i]);
+    }
+
+    return num;
+}
+
+unsigned int multi_queue_num_shards(JMultiQueue* queue) {
+    return queue->numShards;
+}
@@ -0,0 +1,116 @@
+#ifndef JMULTI_QUEUE_H
+#define JMULTI_QUEUE_H
+#include "jret.h"
+#include "jbinary_heap.h"
+
+/**
+ *  并发优先级队列 (MultiQueue)
+ *
+ *  多个生产者、消费者线程共用一个优先级队列时, 代替 "JBinaryHeap + 全局互斥锁"。
+ *
+ *  实现：
+ *      队列由多个分片组成, 每个分片是一个带自旋锁的 JBinaryHeap, 各自独占缓存行。
+ *      插入: 每个线程固定对应一个本地分片, 本地分片被占用时换随机分片, 线程之间基本不争用。
+ *      弹出(宽松): 随机选两个分片, 取两个堆顶中更优先的那个;
+ *          弹出的不一定是全局最优先的元素, 但期望上只差 O(分片数) 个名次, 吞吐随线程数增长。
+ *          两个分片都空或者被占用时重新选, 多次不成功再按顺序扫描所有分片。
+ *      弹出(严格): 锁住所有分片, 比较所有堆顶, 弹出的一定是全局最优先的元素,
+ *          代价是 O(分片数) 次加锁, 只在需要严格顺序时使用。
+ *
+ *  注意：
+ *      比较函数可能被多个线程同时调用。
+ *      元素由用户管理, 队列只保存指针。
+ *
+ *  调用：
+ *      multi_queue_new --- 创建
+ *      multi_queue_free --- 销毁
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 并发优先级队列 */
+typedef struct _JMultiQueue JMultiQueue;
+
+
+/**
+ *  创建并发优先级队列
+ *
+ *  @param type             堆类型, 最小堆先弹出小的值
+ *  @param compareFunction  值比较函数
+ *  @param numShards        分片数, 0 表示 CPU 核数的 2 倍; 一般取线程数的 2 倍左右
+ *
+ *  @return                 成功: 返回队列
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JMultiQueue* multi_queue_new(JBinaryHeapType type, binary_heap_compare_cb compareFunction, unsigned int numShards);
+
+
+/**
+ *  销毁队列, 调用时不能再有其它线程访问这个队列
+ *  只释放队列自己的内存, 队列中的值由用户释放
+ *
+ *  @param queue            队列
+ */
+void multi_queue_free(JMultiQueue* queue);
+
+
+/**
+ *  插入值, 优先放入当前线程的本地分片
+ *
+ *  @param queue            队列
+ *  @param value            值
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (内存不足)
+ */
+int multi_queue_push(JMultiQueue* queue, JBinaryHeapValue value);
+
+
+/**
+ *  宽松弹出: 弹出两个随机分片中更优先的堆顶
+ *
+ *  @param queue            队列
+ *
+ *  @return                 成功: 返回弹出的值
+ *                          队列为空: 返回 RET_PTR_NULL (与之并发的插入可能看不到)
+ */
+JBinaryHeapValue multi_queue_pop(JMultiQueue* queue);
+
+
+/**
+ *  严格弹出: 锁住所有分片, 弹出全局最优先的值
+ *  与 multi_queue_pop 可以混用
+ *
+ *  @param queue            队列
+ *
+ *  @return                 成功: 返回弹出的值
+ *                          队列为空: 返回 RET_PTR_NULL
+ */
+JBinaryHeapValue multi_queue_pop_strict(JMultiQueue* queue);
+
+
+/**
+ *  队列中值的数量, 有并发修改时只是近似值
+ *
+ *  @param queue            队列
+ *
+ *  @return                 值的数量
+ */
+unsigned int multi_queue_num(JMultiQueue* queue);
+
+
+/**
+ *  分片数
+ *
+ *  @param queue            队列
+ *
+ *  @return                 分片数
+ */
+unsigned int multi_queue_num_shards(JMultiQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JMULTI_QUEUE_H
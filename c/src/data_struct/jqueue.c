@@ -0,0 +1,421 @@
+#define _GNU_SOURCE
+#include "jqueue.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define JQUEUE_CACHE_LINE           (64)
+#define JQUEUE_MAX_CAPACITY         (1u << 31)
+#define JQUEUE_ALIGNED              __attribute__((aligned(JQUEUE_CACHE_LINE)))
+
+/* MPMC 队列的槽, sequence 等于位置时可以插入, 等于位置 + 1 时可以弹出 */
+typedef struct _JQueueCell JQueueCell;
+struct _JQueueCell {
+    size_t                  sequence;
+    JQueueValue             value;
+};
+
+/**
+ * 等待队列状态改变(eventcount)
+ * 等待者先读 sequence, 登记后再检查一次队列, 仍然不满足才在 sequence 上睡眠;
+ * 修改队列的一方有等待者时把 sequence 加一再唤醒, 等待者登记之后的修改都不会错过
+ */
+typedef struct _JQueueWaiter JQueueWaiter;
+struct _JQueueWaiter {
+    unsigned int            sequence;               // futex
+    unsigned int            waiters;                // 正在等待的线程数
+};
+
+struct _JQueue {
+    /* 消费者修改 */
+    size_t                  head JQUEUE_ALIGNED;    // 下一个弹出的位置
+    size_t                  tailCache;              // SPSC: 消费者上次读到的 tail
+
+    /* 生产者修改 */
+    size_t                  tail JQUEUE_ALIGNED;    // 下一个插入的位置
+    size_t                  headCache;              // SPSC: 生产者上次读到的 head
+
+    /* 创建后只读 */
+    JQueueType              type JQUEUE_ALIGNED;
+    unsigned int            capacity;
+    size_t                  mask;
+    JQueueValue*            slots;                  // SPSC
+    JQueueCell*             cells;                  // MPMC
+    int                     blocking;
+    int                     closed;                 // 只在 jqueue_close 中修改一次
+
+    JQueueWaiter            notEmpty JQUEUE_ALIGNED;// 消费者等待
+    JQueueWaiter            notFull JQUEUE_ALIGNED; // 生产者等待
+};
+
+static long queue_futex(unsigned int* addr, int op, unsigned int value, const struct timespec* timeout) {
+    return syscall(SYS_futex, addr, op, value, timeout, JRET_PTR_NULL, 0);
+}
+
+/* 修改队列后唤醒最多 num 个等待者, 没有等待者时只有一个屏障和一次读 */
+static void queue_wake(JQueueWaiter* waiter, unsigned int num) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (0 != __atomic_load_n(&waiter->waiters, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&waiter->sequence, 1, __ATOMIC_RELEASE);
+        queue_futex(&waiter->sequence, FUTEX_WAKE_PRIVATE, num > INT_MAX ? INT_MAX : num, JRET_PTR_NULL);
+    }
+}
+
+static int queue_not_empty(JQueue* queue) {
+    return __atomic_load_n(&queue->closed, __ATOMIC_SEQ_CST)
+        || __atomic_load_n(&queue->tail, __ATOMIC_SEQ_CST) != __atomic_load_n(&queue->head, __ATOMIC_SEQ_CST);
+}
+
+static int queue_not_full(JQueue* queue) {
+    return __atomic_load_n(&queue->closed, __ATOMIC_SEQ_CST)
+        || __atomic_load_n(&queue->tail, __ATOMIC_SEQ_CST) - __atomic_load_n(&queue->head, __ATOMIC_SEQ_CST) < queue->capacity;
+}
+
+/* 计算截止时间, timeoutMs 为负数时返回 RET_PTR_NULL 表示一直等待 */
+static const struct timespec* queue_deadline(int timeoutMs, struct timespec* deadline) {
+    if (timeoutMs < 0) {
+        return JRET_PTR_NULL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (long) (timeoutMs % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec += 1;
+        deadline->tv_nsec -= 1000000000;
+    }
+
+    return deadline;
+}
+
+/**
+ * 等到 ready 返回真或者被唤醒, 被唤醒不代表条件满足, 调用者需要重试
+ *
+ * @return 成功：RET_OK
+ *         失败：RET_ERROR (已经超过截止时间)
+ */
+static int queue_wait(JQueue* queue, JQueueWaiter* waiter, int (*ready) (JQueue*), const struct timespec* deadline) {
+    unsigned int            sequence = __atomic_load_n(&waiter->sequence, __ATOMIC_ACQUIRE);
+    struct timespec         now;
+    struct timespec         remain;
+    int                     ret = JRET_OK;
+
+    __atomic_fetch_add(&waiter->waiters, 1, __ATOMIC_SEQ_CST);
+    if (!ready(queue)) {
+        if (JRET_PTR_NULL == deadline) {
+            queue_futex(&waiter->sequence, FUTEX_WAIT_PRIVATE, sequence, JRET_PTR_NULL);
+        } else {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            remain.tv_sec = deadline->tv_sec - now.tv_sec;
+            remain.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+            if (remain.tv_nsec < 0) {
+                remain.tv_sec -= 1;
+                remain.tv_nsec += 1000000000;
+            }
+            if (remain.tv_sec < 0) {
+                ret = JRET_ERROR;
+            } else {
+                queue_futex(&waiter->sequence, FUTEX_WAIT_PRIVATE, sequence, &remain);
+            }
+        }
+    }
+    __atomic_fetch_sub(&waiter->waiters, 1, __ATOMIC_RELAXED);
+
+    return ret;
+}
+
+/******************************** SPSC ********************************/
+
+/* 只有生产者写 tail, 空间够时不读 head 所在的缓存行 */
+static unsigned int spsc_push_n(JQueue* queue, const JQueueValue* values, unsigned int num) {
+    size_t                  tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    size_t                  space = queue->capacity - (tail - queue->headCache);
+    unsigned int            i;
+
+    if (space < num) {
+        queue->headCache = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        space = queue->capacity - (tail - queue->headCache);
+        if (space < num) {
+            num = (unsigned int) space;
+        }
+    }
+
+    for (i = 0; i < num; ++i) {
+        queue->slots[(tail + i) & queue->mask] = values[i];
+    }
+    __atomic_store_n(&queue->tail, tail + num, __ATOMIC_RELEASE);
+
+    return num;
+}
+
+static unsigned int spsc_pop_n(JQueue* queue, JQueueValue* values, unsigned int num) {
+    size_t                  head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    size_t                  available = queue->tailCache - head;
+    unsigned int            i;
+
+    if (available < num) {
+        queue->tailCache = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        available = queue->tailCache - head;
+        if (available < num) {
+            num = (unsigned int) available;
+        }
+    }
+
+    for (i = 0; i < num; ++i) {
+        values[i] = queue->slots[(head + i) & queue->mask];
+    }
+    __atomic_store_n(&queue->head, head + num, __ATOMIC_RELEASE);
+
+    return num;
+}
+
+/******************************** MPMC ********************************/
+
+/**
+ * 从 *index 开始占用最多 num 个连续的槽, 槽的 sequence 等于 位置 + offset 时可以占用
+ * (插入 offset 为 0, 弹出为 1), 一次 CAS 占用全部; 检查过的槽只有占用它的线程才能改变, CAS 成功后仍然可用
+ *
+ * @return 占用的个数, 第一个位置写入 start; 队列满(插入)或空(弹出)时返回 0
+ */
+static unsigned int mpmc_claim(JQueue* queue, size_t* index, unsigned int num, size_t offset, size_t* start) {
+    size_t                  pos = __atomic_load_n(index, __ATOMIC_RELAXED);
+    intptr_t                diff = 0;
+    unsigned int            n;
+
+    for (;;) {
+        for (n = 0; n < num; ++n) {
+            diff = (intptr_t) (__atomic_load_n(&queue->cells[(pos + n) & queue->mask].sequence, __ATOMIC_ACQUIRE) - (pos + n + offset));
+            if (0 != diff) {
+                break;
+            }
+        }
+
+        if (0 != n) {
+            if (__atomic_compare_exchange_n(index, &pos, pos + n, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *start = pos;
+                return n;
+            }
+            continue;                               // 失败时 pos 已经更新
+        }
+
+        if (diff < 0) {
+            return 0;
+        }
+        pos = __atomic_load_n(index, __ATOMIC_RELAXED);     // 被其它线程抢先
+    }
+}
+
+static unsigned int mpmc_push_n(JQueue* queue, const JQueueValue* values, unsigned int num) {
+    size_t                  start;
+    JQueueCell*             cell;
+    unsigned int            n = mpmc_claim(queue, &queue->tail, num, 0, &start);
+    unsigned int            i;
+
+    for (i = 0; i < n; ++i) {
+        cell = &queue->cells[(start + i) & queue->mask];
+        cell->value = values[i];
+        __atomic_store_n(&cell->sequence, start + i + 1, __ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+static unsigned int mpmc_pop_n(JQueue* queue, JQueueValue* values, unsigned int num) {
+    size_t                  start;
+    JQueueCell*             cell;
+    unsigned int            n = mpmc_claim(queue, &queue->head, num, 1, &start);
+    unsigned int            i;
+
+    for (i = 0; i < n; ++i) {
+        cell = &queue->cells[(start + i) & queue->mask];
+        values[i] = cell->value;
+        __atomic_store_n(&cell->sequence, start + i + queue->capacity, __ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+
+JQueue* jqueue_new(JQueueType type, unsigned int capacity, int blocking) {
+    JQueue*                 queue = JRET_PTR_NULL;
+    unsigned int            size = 1;
+    unsigned int            i;
+
+    if (0 == capacity || capacity > JQUEUE_MAX_CAPACITY) {
+        return JRET_PTR_NULL;
+    }
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    if (0 != posix_memalign((void**) &queue, JQUEUE_CACHE_LINE, sizeof (JQueue))) {
+        return JRET_PTR_NULL;
+    }
+
+    queue->head = 0;
+    queue->tailCache = 0;
+    queue->tail = 0;
+    queue->headCache = 0;
+    queue->type = type;
+    queue->capacity = size;
+    queue->mask = size - 1;
+    queue->slots = JRET_PTR_NULL;
+    queue->cells = JRET_PTR_NULL;
+    queue->blocking = blocking ? 1 : 0;
+    queue->closed = 0;
+    queue->notEmpty.sequence = 0;
+    queue->notEmpty.waiters = 0;
+    queue->notFull.sequence = 0;
+    queue->notFull.waiters = 0;
+
+    if (JQUEUE_TYPE_SPSC == type) {
+        if (0 != posix_memalign((void**) &queue->slots, JQUEUE_CACHE_LINE, sizeof (JQueueValue) * size)) {
+            free(queue);
+            return JRET_PTR_NULL;
+        }
+    } else {
+        if (0 != posix_memalign((void**) &queue->cells, JQUEUE_CACHE_LINE, sizeof (JQueueCell) * size)) {
+            free(queue);
+            return JRET_PTR_NULL;
+        }
+        for (i = 0; i < size; ++i) {
+            queue->cells[i].sequence = i;
+            queue->cells[i].value = JRET_PTR_NULL;
+        }
+    }
+
+    return queue;
+}
+
+
+void jqueue_free(JQueue* queue) {
+    if (JRET_PTR_NULL == queue) {
+        return;
+    }
+
+    free(queue->slots);
+    free(queue->cells);
+    free(queue);
+}
+
+
+unsigned int jqueue_push_n(JQueue* queue, const JQueueValue* values, unsigned int num) {
+    unsigned int            n;
+
+    if (0 == num || __atomic_load_n(&queue->closed, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    n = JQUEUE_TYPE_SPSC == queue->type ? spsc_push_n(queue, values, num) : mpmc_push_n(queue, values, num);
+    if (0 != n && queue->blocking) {
+        queue_wake(&queue->notEmpty, n);
+    }
+
+    return n;
+}
+
+
+unsigned int jqueue_pop_n(JQueue* queue, JQueueValue* values, unsigned int num) {
+    unsigned int            n;
+
+    if (0 == num) {
+        return 0;
+    }
+
+    n = JQUEUE_TYPE_SPSC == queue->type ? spsc_pop_n(queue, values, num) : mpmc_pop_n(queue, values, num);
+    if (0 != n && queue->blocking) {
+        queue_wake(&queue->notFull, n);
+    }
+
+    return n;
+}
+
+
+int jqueue_push(JQueue* queue, JQueueValue value) {
+    return 1 == jqueue_push_n(queue, &value, 1) ? JRET_OK : JRET_ERROR;
+}
+
+
+int jqueue_pop(JQueue* queue, JQueueValue* value) {
+    return 1 == jqueue_pop_n(queue, value, 1) ? JRET_OK : JRET_ERROR;
+}
+
+
+int jqueue_push_wait(JQueue* queue, JQueueValue value, int timeoutMs) {
+    struct timespec         buf;
+    const struct timespec*  deadline = queue_deadline(timeoutMs, &buf);
+
+    if (!queue->blocking) {
+        return JRET_ERROR;
+    }
+
+    for (;;) {
+        if (jqueue_closed(queue)) {
+            return JRET_ERROR;
+        }
+        if (JRET_OK == jqueue_push(queue, value)) {
+            return JRET_OK;
+        }
+        if (JRET_OK != queue_wait(queue, &queue->notFull, queue_not_full, deadline)) {
+            return JRET_ERROR;
+        }
+    }
+}
+
+
+int jqueue_pop_wait(JQueue* queue, JQueueValue* value, int timeoutMs) {
+    struct timespec         buf;
+    const struct timespec*  deadline = queue_deadline(timeoutMs, &buf);
+
+    if (!queue->blocking) {
+        return JRET_ERROR;
+    }
+
+    for (;;) {
+        if (JRET_OK == jqueue_pop(queue, value)) {
+            return JRET_OK;
+        }
+        if (jqueue_closed(queue)) {
+            return jqueue_pop(queue, value);        // 关闭之前插入的值
+        }
+        if (JRET_OK != queue_wait(queue, &queue->notEmpty, queue_not_empty, deadline)) {
+            return JRET_ERROR;
+        }
+    }
+}
+
+
+void jqueue_close(JQueue* queue) {
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_SEQ_CST);
+    if (queue->blocking) {
+        queue_wake(&queue->notEmpty, INT_MAX);
+        queue_wake(&queue->notFull, INT_MAX);
+    }
+}
+
+
+int jqueue_closed(JQueue* queue) {
+    return __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+}
+
+
+unsigned int jqueue_num(JQueue* queue) {
+    size_t                  head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    size_t                  tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+    if (tail <= head) {
+        return 0;
+    }
+
+    return tail - head > queue->capacity ? queue->capacity : (unsigned int) (tail - head);
+}
+
+
+unsigned int jqueue_capacity(JQueue* queue) {
+    return queue->capacity;
+}
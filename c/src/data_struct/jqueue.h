@@ -0,0 +1,179 @@
+#ifndef JQUEUE_H
+#define JQUEUE_H
+#include "jret.h"
+
+/**
+ *  有界无锁队列 (环形缓冲区)
+ *
+ *  线程之间传递任务, 代替 "链表 + 互斥锁"。容量在创建时固定(向上取 2 的幂), 满了插入失败。
+ *
+ *  类型：
+ *      JQUEUE_TYPE_SPSC    一个生产者线程、一个消费者线程; 插入和弹出都是 wait-free 的,
+ *                          各自只写自己的下标, 并缓存对方的下标, 大多数操作不读对方的缓存行。
+ *      JQUEUE_TYPE_MPMC    任意多个生产者、消费者线程; Vyukov 的有界队列, 每个槽带序号,
+ *                          生产者、消费者各用一次 CAS 占位, 不需要锁。
+ *  生产者的下标、消费者的下标、只读字段各占一个缓存行, 生产者和消费者不会互相使对方的缓存行失效。
+ *
+ *  批量：
+ *      jqueue_push_n / jqueue_pop_n 一次占用多个连续的槽, SPSC 只更新一次下标, MPMC 只做一次 CAS。
+ *
+ *  阻塞等待(可选)：
+ *      创建时 blocking 为 1 才能使用 jqueue_push_wait / jqueue_pop_wait, 在队列满、空时用 futex 睡眠;
+ *      代价是每次插入、弹出多一个内存屏障和一次读, 没有线程在等待时不会进入内核。
+ *      jqueue_close 关闭队列, 唤醒所有等待的线程, 用于结束流水线。
+ *
+ *  注意：
+ *      值由用户管理, 队列只保存指针, 可以放 RET_PTR_NULL。
+ *      SPSC 队列同时只能有一个线程插入、一个线程弹出, 否则结果未定义。
+ *      只支持 Linux (futex)。
+ *
+ *  调用：
+ *      jqueue_new --- 创建
+ *      jqueue_free --- 销毁
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 队列 */
+typedef struct _JQueue JQueue;
+
+/* 队列中的值 */
+typedef void* JQueueValue;
+
+/* 队列类型 */
+typedef enum {
+    JQUEUE_TYPE_SPSC,                               // 单生产者单消费者
+    JQUEUE_TYPE_MPMC,                               // 多生产者多消费者
+} JQueueType;
+
+
+/**
+ *  创建队列
+ *
+ *  @param type             队列类型
+ *  @param capacity         容量, 向上取 2 的幂, 不超过 2^31
+ *  @param blocking         为 1 时支持阻塞等待
+ *
+ *  @return                 成功: 返回队列
+ *                          失败: 返回 RET_PTR_NULL (容量为 0 或太大, 内存不足)
+ */
+JQueue* jqueue_new(JQueueType type, unsigned int capacity, int blocking);
+
+
+/**
+ *  销毁队列, 调用时不能再有其它线程访问这个队列
+ *  只释放队列自己的内存, 队列中的值由用户释放
+ *
+ *  @param queue            队列
+ */
+void jqueue_free(JQueue* queue);
+
+
+/**
+ *  插入值, 不等待
+ *
+ *  @param queue            队列
+ *  @param value            值
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (队列满或已关闭)
+ */
+int jqueue_push(JQueue* queue, JQueueValue value);
+
+
+/**
+ *  弹出值, 不等待
+ *
+ *  @param queue            队列
+ *  @param value            返回弹出的值
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (队列空)
+ */
+int jqueue_pop(JQueue* queue, JQueueValue* value);
+
+
+/**
+ *  批量插入, 按顺序插入尽可能多的值, 不等待
+ *
+ *  @param queue            队列
+ *  @param values           值
+ *  @param num              值的个数
+ *
+ *  @return                 插入的个数, 是 values 的前若干个; 队列满或已关闭时为 0
+ */
+unsigned int jqueue_push_n(JQueue* queue, const JQueueValue* values, unsigned int num);
+
+
+/**
+ *  批量弹出, 不等待
+ *
+ *  @param queue            队列
+ *  @param values           返回弹出的值
+ *  @param num              最多弹出的个数
+ *
+ *  @return                 弹出的个数, 队列空时为 0
+ */
+unsigned int jqueue_pop_n(JQueue* queue, JQueueValue* values, unsigned int num);
+
+
+/**
+ *  插入值, 队列满时等待
+ *
+ *  @param queue            队列, 创建时 blocking 为 1
+ *  @param value            值
+ *  @param timeoutMs        最多等待的毫秒数, -1 表示一直等待
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (超时、队列已关闭或不支持阻塞)
+ */
+int jqueue_push_wait(JQueue* queue, JQueueValue value, int timeoutMs);
+
+
+/**
+ *  弹出值, 队列空时等待
+ *
+ *  @param queue            队列, 创建时 blocking 为 1
+ *  @param value            返回弹出的值
+ *  @param timeoutMs        最多等待的毫秒数, -1 表示一直等待
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (超时、队列已关闭且为空或不支持阻塞)
+ */
+int jqueue_pop_wait(JQueue* queue, JQueueValue* value, int timeoutMs);
+
+
+/**
+ *  关闭队列: 之后插入都失败, 队列中剩下的值仍然可以弹出, 唤醒所有等待的线程
+ *  应在所有生产者都不再插入之后调用, 与插入同时进行时那个值可能留在队列中
+ *
+ *  @param queue            队列
+ */
+void jqueue_close(JQueue* queue);
+
+
+/**
+ *  队列是否已关闭
+ *
+ *  @return                 已关闭返回 1, 否则返回 0
+ */
+int jqueue_closed(JQueue* queue);
+
+
+/**
+ *  元素数, 有其它线程同时修改时只是近似值
+ */
+unsigned int jqueue_num(JQueue* queue);
+
+
+/**
+ *  容量
+ */
+unsigned int jqueue_capacity(JQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JQUEUE_H
@@ -0,0 +1,961 @@
+#include "jset.h"
+#include "jthread_pool.h"
+#include "jset_group.h"
+#include "jstats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define JSET_MIN_CAPACITY       (64)                            // 必须是组宽度的整数倍且为 2 的幂
+
+/* 负载因子 7/8 */
+#define JSET_MAX_LOAD(cap)      ((cap) - (cap) / 8)
+
+/* 遍历的集合小于这个值时集合运算不使用多线程 */
+#define JSET_PARALLEL_MIN       (1 << 16)
+
+/* 每个线程分到的任务数, 任务多一些可以均衡负载 */
+#define JSET_TASKS_PER_THREAD   (4)
+
+struct _JSet {
+    signed char*            ctrl;                               // 控制字节数组
+    JSetValue*              slots;                              // 槽数组, 和 ctrl 在同一块内存中
+    unsigned int            capacity;                           // 槽的数量
+    unsigned int            numEntries;                         // 值的数量
+    unsigned int            growthLeft;                         // 还能占用多少个空槽才需要扩容
+    JSetHashFunc            hashFunc;
+    JSetEqualFunc           equalFunc;
+    JSetFreeFunc*           freeFunc;
+    JThreadPool*            pool;                               // 集合运算使用的线程池, 可以为空
+    const JAllocator*       allocator;
+    JMemoryStats            memStats;
+#ifdef JDS_STATS
+    JSetStats               stats;
+#endif
+};
+
+static unsigned int hash_group(JSet* set, uint32_t h) { return h & (set->capacity / JSET_GROUP_WIDTH - 1);}
+
+static size_t jset_table_bytes(unsigned int capacity) { return capacity + sizeof (JSetValue) * capacity;}
+
+static void jset_free_table(JSet* set, signed char* ctrl, unsigned int capacity) {
+    jallocator_free(set->allocator, &set->memStats, ctrl, jset_table_bytes(capacity), JSET_GROUP_WIDTH);
+}
+
+/* 申请 capacity 个槽, 控制字节和槽放在同一块内存 */
+static int jset_alloc_table(JSet* set, unsigned int capacity) {
+    char*                   block = JRET_PTR_NULL;
+
+    block = jallocator_alloc(set->allocator, &set->memStats, jset_table_bytes(capacity), JSET_GROUP_WIDTH);
+    if (JRET_PTR_NULL == block) {
+        return JRET_ERROR;
+    }
+
+    set->ctrl = (signed char*) block;
+    set->slots = (JSetValue*) (block + capacity);
+    set->capacity = capacity;
+    set->growthLeft = JSET_MAX_LOAD(capacity);
+    memset(set->ctrl, JSET_CTRL_EMPTY, capacity);
+
+    return JRET_OK;
+}
+
+/* 一次查找探测了 groups 个组, 调用了 compares 次 equal 函数 */
+static void jset_count_find(JSet* set, unsigned int groups, unsigned int compares) {
+    JSTATS_INC(set->stats.lookups);
+    JSTATS_ADD(set->stats.probedGroups, groups);
+    JSTATS_MAX(set->stats.maxProbeGroups, groups);
+    JSTATS_ADD(set->stats.comparisons, compares);
+}
+
+/**
+ *  查找值所在的槽
+ *  按组做三角探测(组数是 2 的幂, 能访问到所有组), 遇到含空槽的组即可停止
+ *  集合运算中多个线程同时在一个集合中查找, 这时 count 为 0, 不修改计数
+ *
+ *  @return                 找到：返回槽下标
+ *                          没找到：返回 capacity
+ */
+static unsigned int jset_find(JSet* set, JSetValue data, uint32_t h, int count) {
+    unsigned int            groupMask = set->capacity / JSET_GROUP_WIDTH - 1;
+    unsigned int            group = hash_group(set, h);
+    unsigned int            step = 0;
+    unsigned int            compares = 0;
+    signed char             h2 = jset_hash_h2(h);
+    const signed char*      ctrl;
+    JSetGroupMask           match;
+    unsigned int            slot = 0;
+
+    for (;;) {
+        ctrl = set->ctrl + group * JSET_GROUP_WIDTH;
+        for (match = jset_group_match(ctrl, h2); match; match &= match - 1) {
+            slot = group * JSET_GROUP_WIDTH + jset_group_mask_first(match);
+            ++ compares;
+            if (set->equalFunc(set->slots[slot], data)) {
+                break;
+            }
+        }
+
+        if (match || jset_group_match_empty(ctrl)) {            // 找到, 或者遇到空槽
+            break;
+        }
+
+        ++ step;
+        group = (group + step) & groupMask;
+        if (step > groupMask) {                                 // 表中没有空槽(只在全是删除标记时出现)
+            break;
+        }
+    }
+
+    if (count) {
+        jset_count_find(set, step + 1, compares);
+    }
+
+    return match ? slot : set->capacity;
+}
+
+/* 找到第一个可以放值的槽(空或已删除) */
+static unsigned int jset_find_free_slot(JSet* set, uint32_t h) {
+    unsigned int            groupMask = set->capacity / JSET_GROUP_WIDTH - 1;
+    unsigned int            group = hash_group(set, h);
+    unsigned int            step = 0;
+    JSetGroupMask           match;
+
+    for (;;) {
+        match = jset_group_match_empty_or_deleted(set->ctrl + group * JSET_GROUP_WIDTH);
+        if (match) {
+            return group * JSET_GROUP_WIDTH + jset_group_mask_first(match);
+        }
+
+        ++ step;
+        group = (group + step) & groupMask;
+    }
+}
+
+/* 把值放入槽中, 调用者保证值不在集合中且有空间 */
+static void jset_place(JSet* set, JSetValue data, uint32_t h) {
+    unsigned int            slot;
+
+    slot = jset_find_free_slot(set, h);
+    if (JSET_CTRL_EMPTY == set->ctrl[slot]) {
+        -- set->growthLeft;
+    }
+
+    set->ctrl[slot] = jset_hash_h2(h);
+    set->slots[slot] = data;
+}
+
+/**
+ *  清除槽的控制字节
+ *  组内还有空槽说明没有其它值的探测经过这一组, 可以直接置空;
+ *  否则只能标记为已删除, 保证后面的探测不会中断
+ *
+ *  @return                 置空返回 1, 标记为已删除返回 0
+ */
+static int jset_erase(JSet* set, unsigned int slot) {
+    if (jset_group_match_empty(set->ctrl + (slot - slot % JSET_GROUP_WIDTH))) {
+        set->ctrl[slot] = JSET_CTRL_EMPTY;
+        return 1;
+    }
+
+    set->ctrl[slot] = JSET_CTRL_DELETED;
+    return 0;
+}
+
+/* 按新容量重新建表 */
+static int jset_resize(JSet* set, unsigned int newCapacity) {
+    signed char*            oldCtrl = set->ctrl;
+    JSetValue*              oldSlots = set->slots;
+    unsigned int            oldCapacity = set->capacity;
+    unsigned int            i;
+
+    if (JRET_OK != jset_alloc_table(set, newCapacity)) {
+        return JRET_ERROR;
+    }
+    JSTATS_INC(set->stats.rehashes);
+
+    for (i = 0; i < oldCapacity; ++i) {
+        if (oldCtrl[i] >= 0) {
+            jset_place(set, oldSlots[i], jset_hash_mix(set->hashFunc(oldSlots[i])));
+        }
+    }
+    jset_free_table(set, oldCtrl, oldCapacity);
+
+    return JRET_OK;
+}
+
+/**
+ *  重新建表
+ *  删除标记较多时按原大小重建(清理删除标记), 否则容量翻倍
+ */
+static int jset_rehash(JSet* set) {
+    unsigned int            newCapacity = set->capacity;
+
+    if (set->numEntries >= JSET_MAX_LOAD(set->capacity) / 2) {
+        newCapacity = set->capacity * 2;
+        if (newCapacity < set->capacity) {
+            return JRET_ERROR;
+        }
+    }
+
+    return jset_resize(set, newCapacity);
+}
+
+/* 保证还能再放入 num 个值而不需要扩容 */
+static int jset_reserve(JSet* set, unsigned int num) {
+    unsigned int            newCapacity = set->capacity;
+
+    if (set->growthLeft >= num) {
+        return JRET_OK;
+    }
+
+    while (JSET_MAX_LOAD(newCapacity) < set->numEntries + num) {
+        newCapacity *= 2;
+        if (newCapacity < set->capacity) {
+            return JRET_ERROR;
+        }
+    }
+
+    return jset_resize(set, newCapacity);
+}
+
+
+JSet* jset_new(JSetHashFunc hashFunc, JSetEqualFunc equalFunc) {
+    return jset_new_with_allocator(hashFunc, equalFunc, JRET_PTR_NULL);
+}
+
+JSet* jset_new_with_allocator(JSetHashFunc hashFunc, JSetEqualFunc equalFunc, const JAllocator* allocator) {
+    JSet*                   set = JRET_PTR_NULL;
+    JMemoryStats            memStats = { 0, 0, 0 };
+
+    if (JRET_PTR_NULL == allocator) {
+        allocator = jallocator_default();
+    }
+
+    set = jallocator_alloc(allocator, &memStats, sizeof (JSet), sizeof (void*));
+    if (JRET_PTR_NULL == set) {
+        return JRET_PTR_NULL;
+    }
+
+    set->allocator = allocator;
+    set->memStats = memStats;
+
+    set->hashFunc = hashFunc;
+    set->equalFunc = equalFunc;
+    set->freeFunc = JRET_PTR_NULL;
+    set->pool = JRET_PTR_NULL;
+    set->numEntries = 0;
+    jset_reset_stats(set);
+    if (JRET_OK != jset_alloc_table(set, JSET_MIN_CAPACITY)) {
+        jallocator_free(allocator, JRET_PTR_NULL, set, sizeof (JSet), sizeof (void*));
+        return JRET_PTR_NULL;
+    }
+
+    return set;
+}
+
+void jset_free(JSet* set) {
+    unsigned int            i;
+
+    if (JRET_PTR_NULL != set->freeFunc) {
+        for (i = 0; i < set->capacity; ++i) {
+            if (set->ctrl[i] >= 0) {
+                set->freeFunc(set->slots[i]);
+            }
+        }
+    }
+
+    jset_free_table(set, set->ctrl, set->capacity);
+    jallocator_free(set->allocator, JRET_PTR_NULL, set, sizeof (JSet), sizeof (void*));
+}
+
+void jset_register_free_function(JSet* set, JSetFreeFunc freeFunc) {
+    set->freeFunc = freeFunc;
+}
+
+int jset_insert(JSet* set, JSetValue data) {
+    uint32_t                h = jset_hash_mix(set->hashFunc(data));
+
+    if (jset_find(set, data, h, 1) != set->capacity) {             // 已经存在
+        return JSET_FALSE;
+    }
+
+    if (0 == set->growthLeft && JRET_OK != jset_rehash(set)) {
+        return JSET_FALSE;
+    }
+
+    jset_place(set, data, h);
+    ++ set->numEntries;
+
+    return JSET_TRUE;
+}
+
+int jset_remove(JSet* set, JSetValue data) {
+    unsigned int            slot;
+
+    slot = jset_find(set, data, jset_hash_mix(set->hashFunc(data)), 1);
+    if (slot == set->capacity) {
+        return JSET_FALSE;
+    }
+
+    if (jset_erase(set, slot)) {
+        ++ set->growthLeft;
+    }
+    -- set->numEntries;
+
+    if (JRET_PTR_NULL != set->freeFunc) {
+        set->freeFunc(set->slots[slot]);
+    }
+
+    return JSET_TRUE;
+}
+
+int jset_query(JSet* set, JSetValue data) {
+    if (jset_find(set, data, jset_hash_mix(set->hashFunc(data)), 1) == set->capacity) {
+        return JSET_NOT_HAVE;
+    }
+
+    return JSET_HAVE;
+}
+
+unsigned int jset_num_entries(JSet* set) {
+    return set->numEntries;
+}
+
+void jset_memory_stats(JSet* set, JMemoryStats* stats) {
+    *stats = set->memStats;
+    stats->wasted = set->memStats.live - sizeof (JSet) - sizeof (JSetValue) * set->numEntries;   // 控制字节、空槽和已删除的槽
+}
+
+int jset_get_stats(JSet* set, JSetStats* stats) {
+#ifdef JDS_STATS
+    *stats = set->stats;
+    return JRET_OK;
+#else
+    (void) set;
+    memset(stats, 0, sizeof (JSetStats));
+    return JRET_ERROR;
+#endif
+}
+
+void jset_reset_stats(JSet* set) {
+#ifdef JDS_STATS
+    memset(&set->stats, 0, sizeof (JSetStats));
+#else
+    (void) set;
+#endif
+}
+
+JSetValue* jset_to_array(JSet* set) {
+    JSetValue*              array = JRET_PTR_NULL;
+    unsigned int            i;
+    unsigned int            index = 0;
+
+    array = malloc(sizeof (JSetValue) * set->numEntries);
+    if (JRET_PTR_NULL == array) {
+        return JRET_PTR_NULL;
+    }
+
+    for (i = 0; i < set->capacity; ++i) {
+        if (set->ctrl[i] >= 0) {
+            array[index] = set->slots[i];
+            ++ index;
+        }
+    }
+
+    return array;
+}
+
+void jset_iterate(JSet* set, JSetIterator* iter) {
+    iter->set = set;
+    iter->nextSlot = 0;
+
+    while (iter->nextSlot < set->capacity && set->ctrl[iter->nextSlot] < 0) {
+        ++ iter->nextSlot;
+    }
+}
+
+int jset_iter_has_more(JSetIterator* iter) {
+    return iter->nextSlot < iter->set->capacity ? JSET_TRUE : JSET_FALSE;
+}
+
+JSetValue jset_iter_next(JSetIterator* iter) {
+    JSet*                   set = iter->set;
+    JSetValue               value;
+
+    if (iter->nextSlot >= set->capacity) {
+        return JRET_PTR_NULL;
+    }
+
+    value = set->slots[iter->nextSlot];
+    do {
+        ++ iter->nextSlot;
+    } while (iter->nextSlot < set->capacity && set->ctrl[iter->nextSlot] < 0);
+
+    return value;
+}
+
+void jset_set_thread_pool(JSet* set, JThreadPool* pool) {
+    set->pool = pool;
+}
+
+
+/**
+ *  集合运算
+ *  总是遍历较小的集合、在较大的集合中查询。遍历的集合按组切分成若干段,
+ *  集合较大且设置了线程池时各段并行处理, 查询只读不写, 可以安全并发。
+ *  每段把结果连同 hash 值收集到自己的缓冲区, 最后由调用线程一次性放入结果集合。
+ */
+
+/* 扫描方式 */
+typedef enum {
+    JSET_SCAN_PRESENT,                                          // 收集在 probe 中存在的值
+    JSET_SCAN_MATCH,                                            // 收集 probe 中与之相等的值(probe 自己的指针)
+    JSET_SCAN_ABSENT,                                           // 收集在 probe 中不存在的值
+    JSET_SCAN_SUBSET,                                           // 遇到在 probe 中不存在的值就停止
+    JSET_SCAN_RETAIN                                            // 从遍历的集合中删除在 probe 中不存在的值
+} JSetScanMode;
+
+/* 收集到的值, 连同 hash 一起保存, 放入结果集合时不需要重新计算 */
+typedef struct {
+    JSetValue               value;
+    uint32_t                hash;
+} JSetHashedValue;
+
+/* 每段扫描的结果 */
+typedef struct {
+    JSetHashedValue*        values;
+    unsigned int            num;
+    unsigned int            capacity;
+    unsigned int            removed;                            // JSET_SCAN_RETAIN 删除的值
+    unsigned int            emptied;                            // JSET_SCAN_RETAIN 置空的槽
+} JSetScanPart;
+
+typedef struct {
+    JSet*                   iter;                               // 遍历的集合
+    JSet*                   probe;                              // 查询的集合
+    JSetScanMode            mode;
+    unsigned int            numTasks;
+    JSetScanPart*           parts;
+    int                     stop;                               // JSET_SCAN_SUBSET 提前结束, 原子操作
+    int                     error;
+} JSetScan;
+
+static void jset_scan_push(JSetScan* scan, JSetScanPart* part, JSetValue value, uint32_t h) {
+    JSetHashedValue*        newValues = JRET_PTR_NULL;
+    unsigned int            newCapacity;
+
+    if (part->num == part->capacity) {
+        newCapacity = part->capacity ? part->capacity * 2 : 1024;
+        newValues = realloc(part->values, sizeof (JSetHashedValue) * newCapacity);
+        if (JRET_PTR_NULL == newValues) {
+            scan->error = 1;
+            return;
+        }
+        part->values = newValues;
+        part->capacity = newCapacity;
+    }
+
+    part->values[part->num].value = value;
+    part->values[part->num].hash = h;
+    ++ part->num;
+}
+
+static void jset_scan_task(unsigned int task, void* data) {
+    JSetScan*               scan = data;
+    JSet*                   iter = scan->iter;
+    JSet*                   probe = scan->probe;
+    JSetScanPart*           part = &scan->parts[task];
+    unsigned long long      numGroups = iter->capacity / JSET_GROUP_WIDTH;
+    unsigned int            begin = (unsigned int) (numGroups * task / scan->numTasks) * JSET_GROUP_WIDTH;
+    unsigned int            end = (unsigned int) (numGroups * (task + 1) / scan->numTasks) * JSET_GROUP_WIDTH;
+    unsigned int            slot;
+    unsigned int            pos;
+    JSetValue               value;
+    uint32_t                h;
+    int                     found;
+
+    for (slot = begin; slot < end; ++slot) {
+        if (iter->ctrl[slot] < 0) {
+            continue;
+        }
+
+        value = iter->slots[slot];
+        h = jset_hash_mix(iter->hashFunc(value));
+        pos = jset_find(probe, value, h, 0);
+        found = pos != probe->capacity;
+
+        switch (scan->mode) {
+        case JSET_SCAN_PRESENT:
+            if (found) {
+                jset_scan_push(scan, part, value, h);
+            }
+            break;
+        case JSET_SCAN_MATCH:
+            if (found) {
+                jset_scan_push(scan, part, probe->slots[pos], h);
+            }
+            break;
+        case JSET_SCAN_ABSENT:
+            if (!found) {
+                jset_scan_push(scan, part, value, h);
+            }
+            break;
+        case JSET_SCAN_SUBSET:
+            if (!found) {
+                __atomic_store_n(&scan->stop, 1, __ATOMIC_RELAXED);
+                return;
+            }
+            if ((slot & 0xFF) == 0 && __atomic_load_n(&scan->stop, __ATOMIC_RELAXED)) {
+                return;
+            }
+            break;
+        case JSET_SCAN_RETAIN:
+            if (!found) {                                       // 各段只改自己的组, 不需要加锁
+                part->emptied += jset_erase(iter, slot);
+                ++ part->removed;
+                if (JRET_PTR_NULL != iter->freeFunc) {
+                    iter->freeFunc(value);
+                }
+            }
+            break;
+        }
+    }
+}
+
+/* 遍历 iter, 在 probe 中查询; 线程池取自 pool 集合 */
+static int jset_scan(JSetScan* scan, JSet* iter, JSet* probe, JSetScanMode mode, JThreadPool* pool) {
+    unsigned int            numGroups = iter->capacity / JSET_GROUP_WIDTH;
+
+    scan->iter = iter;
+    scan->probe = probe;
+    scan->mode = mode;
+    scan->stop = 0;
+    scan->error = 0;
+    scan->numTasks = 1;
+    if (JRET_PTR_NULL != pool && iter->numEntries >= JSET_PARALLEL_MIN) {
+        scan->numTasks = thread_pool_num_threads(pool) * JSET_TASKS_PER_THREAD;
+        if (scan->numTasks > numGroups) {
+            scan->numTasks = numGroups;
+        }
+    }
+
+    scan->parts = calloc(scan->numTasks, sizeof (JSetScanPart));
+    if (JRET_PTR_NULL == scan->parts) {
+        scan->numTasks = 0;
+        return JRET_ERROR;
+    }
+
+    if (scan->numTasks > 1) {
+        thread_pool_run(pool, scan->numTasks, jset_scan_task, scan);
+    } else {
+        jset_scan_task(0, scan);
+    }
+
+    return scan->error ? JRET_ERROR : JRET_OK;
+}
+
+static void jset_scan_release(JSetScan* scan) {
+    unsigned int            i;
+
+    for (i = 0; i < scan->numTasks; ++i) {
+        free(scan->parts[i].values);
+    }
+    free(scan->parts);
+}
+
+/* 把扫描收集到的值放入集合, 调用者保证这些值都不在集合中 */
+static int jset_scan_collect(JSetScan* scan, JSet* set) {
+    unsigned int            total = 0;
+    unsigned int            i, j;
+    JSetScanPart*           part;
+
+    for (i = 0; i < scan->numTasks; ++i) {
+        total += scan->parts[i].num;
+    }
+
+    if (JRET_OK != jset_reserve(set, total)) {
+        return JRET_ERROR;
+    }
+
+    for (i = 0; i < scan->numTasks; ++i) {
+        part = &scan->parts[i];
+        for (j = 0; j < part->num; ++j) {
+            jset_place(set, part->values[j].value, part->values[j].hash);
+        }
+    }
+    set->numEntries += total;
+
+    return JRET_OK;
+}
+
+/* 创建和 like 使用相同函数和线程池的空集合 */
+static JSet* jset_new_like(JSet* like) {
+    JSet*                   set = JRET_PTR_NULL;
+
+    set = jset_new_with_allocator(like->hashFunc, like->equalFunc, like->allocator);
+    if (JRET_PTR_NULL != set) {
+        set->pool = like->pool;
+    }
+
+    return set;
+}
+
+/* 复制 set 的表, 函数和线程池取自 like */
+static JSet* jset_clone(JSet* set, JSet* like) {
+    JSet*                   newSet = JRET_PTR_NULL;
+
+    newSet = jset_new_like(like);
+    if (JRET_PTR_NULL == newSet) {
+        return JRET_PTR_NULL;
+    }
+
+    if (set->capacity != newSet->capacity) {
+        jset_free_table(newSet, newSet->ctrl, newSet->capacity);
+        if (JRET_OK != jset_alloc_table(newSet, set->capacity)) {
+            jallocator_free(newSet->allocator, JRET_PTR_NULL, newSet, sizeof (JSet), sizeof (void*));
+            return JRET_PTR_NULL;
+        }
+    }
+
+    memcpy(newSet->ctrl, set->ctrl, set->capacity + sizeof (JSetValue) * set->capacity);
+    newSet->numEntries = set->numEntries;
+    newSet->growthLeft = set->growthLeft;
+
+    return newSet;
+}
+
+/* 扫描并把结果放入 result, 失败时释放 result */
+static JSet* jset_scan_into(JSet* result, JSet* iter, JSet* probe, JSetScanMode mode) {
+    JSetScan                scan;
+    int                     ret;
+
+    if (JRET_PTR_NULL == result) {
+        return JRET_PTR_NULL;
+    }
+
+    ret = jset_scan(&scan, iter, probe, mode, result->pool);
+    if (JRET_OK == ret) {
+        ret = jset_scan_collect(&scan, result);
+    }
+    jset_scan_release(&scan);
+
+    if (JRET_OK != ret) {
+        jset_free(result);
+        return JRET_PTR_NULL;
+    }
+
+    return result;
+}
+
+JSet* jset_union(JSet* s1, JSet* s2) {
+    JSet*                   big = s1->numEntries >= s2->numEntries ? s1 : s2;
+    JSet*                   small = big == s1 ? s2 : s1;
+
+    return jset_scan_into(jset_clone(big, s1), small, big, JSET_SCAN_ABSENT);
+}
+
+JSet* jset_intersection(JSet* s1, JSet* s2) {
+    JSet*                   big = s1->numEntries >= s2->numEntries ? s1 : s2;
+    JSet*                   small = big == s1 ? s2 : s1;
+
+    return jset_scan_into(jset_new_like(s1), small, big, JSET_SCAN_PRESENT);
+}
+
+JSet* jset_difference(JSet* s1, JSet* s2) {
+    JSet*                   result = JRET_PTR_NULL;
+    JSetScan                scan;
+    JSetScanPart*           part;
+    unsigned int            i, j;
+    unsigned int            slot;
+
+    if (s1->numEntries <= s2->numEntries) {
+        return jset_scan_into(jset_new_like(s1), s1, s2, JSET_SCAN_ABSENT);
+    }
+
+    /* s2 较小: 复制 s1, 再删除 s1 和 s2 共有的值 */
+    result = jset_clone(s1, s1);
+    if (JRET_PTR_NULL == result) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_OK != jset_scan(&scan, s2, s1, JSET_SCAN_PRESENT, s1->pool)) {
+        jset_scan_release(&scan);
+        jset_free(result);
+        return JRET_PTR_NULL;
+    }
+
+    for (i = 0; i < scan.numTasks; ++i) {
+        part = &scan.parts[i];
+        for (j = 0; j < part->num; ++j) {
+            slot = jset_find(result, part->values[j].value, part->values[j].hash, 0);
+            result->growthLeft += jset_erase(result, slot);
+            -- result->numEntries;
+        }
+    }
+    jset_scan_release(&scan);
+
+    return result;
+}
+
+JSet* jset_symmetric_difference(JSet* s1, JSet* s2) {
+    JSet*                   result = JRET_PTR_NULL;
+
+    result = jset_difference(s1, s2);
+    if (JRET_PTR_NULL == result) {
+        return JRET_PTR_NULL;
+    }
+
+    return jset_scan_into(result, s2, s1, JSET_SCAN_ABSENT);
+}
+
+int jset_is_subset(JSet* s1, JSet* s2) {
+    JSetScan                scan;
+    int                     ret;
+
+    if (s1->numEntries > s2->numEntries) {
+        return JSET_FALSE;
+    }
+
+    ret = jset_scan(&scan, s1, s2, JSET_SCAN_SUBSET, s1->pool);
+    jset_scan_release(&scan);
+    if (JRET_OK != ret || scan.stop) {
+        return JSET_FALSE;
+    }
+
+    return JSET_TRUE;
+}
+
+int jset_intersect_inplace(JSet* s1, JSet* s2) {
+    JSetScan                scan;
+    JSet                    rebuilt;
+    unsigned int            i;
+    int                     ret;
+
+    /* s2 小很多且不需要释放值: 遍历 s2, 取出 s1 中相等的值(仍是 s1 自己的指针)重建 s1 的表 */
+    if (JRET_PTR_NULL == s1->freeFunc && s2->numEntries < s1->numEntries / 4) {
+        rebuilt = *s1;
+        ret = jset_scan(&scan, s2, s1, JSET_SCAN_MATCH, s1->pool);
+        if (JRET_OK == ret) {
+            ret = jset_alloc_table(&rebuilt, JSET_MIN_CAPACITY);
+            if (JRET_OK == ret) {
+                rebuilt.numEntries = 0;
+                ret = jset_scan_collect(&scan, &rebuilt);
+                if (JRET_OK != ret) {
+                    jset_free_table(&rebuilt, rebuilt.ctrl, rebuilt.capacity);
+                }
+            }
+        }
+        jset_scan_release(&scan);
+
+        if (JRET_OK != ret) {
+            return JSET_FALSE;
+        }
+
+        jset_free_table(&rebuilt, s1->ctrl, s1->capacity);
+        *s1 = rebuilt;
+
+        return JSET_TRUE;
+    }
+
+    ret = jset_scan(&scan, s1, s2, JSET_SCAN_RETAIN, s1->pool);
+    for (i = 0; i < scan.numTasks; ++i) {
+        s1->numEntries -= scan.parts[i].removed;
+        s1->growthLeft += scan.parts[i].emptied;
+    }
+    jset_scan_release(&scan);
+
+    return JRET_OK == ret ? JSET_TRUE : JSET_FALSE;
+}
+
+
+/*================================ 快照 ================================*/
+#define JSET_SNAPSHOT_MAGIC         "JSETHASH"
+#define JSET_SNAPSHOT_MIN_CAPACITY  (8)
+#define JSET_SAVE_BUFFER            (256)
+
+struct _JSetMapped {
+    JSnapshot               snapshot;
+    const uint32_t*         tags;                               // hash | 1, 0 表示空槽
+    const uint64_t*         offsets;                            // 记录的位置
+    uint64_t                mask;                               // 槽数 - 1
+    uint64_t                num;
+    JSetHashFunc            hashFunc;
+    JSetMappedEqualFunc     equalFunc;
+};
+
+/* 序列化值并追加到文件 */
+static int jset_save_record(JSnapshotWriter* writer, JSetValue value, JSetSaveFunc saveFunc, uint64_t* offset) {
+    size_t                  need;
+    void*                   buf;
+
+    buf = jsnapshot_writer_buffer(writer, JSET_SAVE_BUFFER);
+    if (JRET_PTR_NULL == buf) {
+        return JRET_ERROR;
+    }
+
+    need = saveFunc(value, buf, writer->bufSize);
+    if (need > writer->bufSize) {
+        buf = jsnapshot_writer_buffer(writer, need);
+        if (JRET_PTR_NULL == buf) {
+            return JRET_ERROR;
+        }
+        need = saveFunc(value, buf, need);
+    }
+
+    return jsnapshot_writer_record(writer, buf, need, offset);
+}
+
+/* 写入所有记录, 同时建好线性探测的索引 */
+static int jset_save_records(JSet* set, JSnapshotWriter* writer, uint32_t* tags, uint64_t* offsets, uint64_t mask, JSetSaveFunc saveFunc) {
+    unsigned int            i;
+    uint32_t                h;
+    uint64_t                pos;
+
+    for (i = 0; i < set->capacity; ++i) {
+        if (set->ctrl[i] < 0) {
+            continue;
+        }
+
+        h = jset_hash_mix(set->hashFunc(set->slots[i]));
+        for (pos = h & mask; 0 != tags[pos]; pos = (pos + 1) & mask);
+        tags[pos] = h | 1;
+        if (JRET_OK != jset_save_record(writer, set->slots[i], saveFunc, &offsets[pos])) {
+            return JRET_ERROR;
+        }
+    }
+
+    return JRET_OK;
+}
+
+int jset_save(JSet* set, const char* path, JSetSaveFunc saveFunc) {
+    JSnapshotWriter         writer;
+    JSnapshotHeader         header;
+    unsigned char*          index = JRET_PTR_NULL;
+    uint64_t                capacity = JSET_SNAPSHOT_MIN_CAPACITY;
+    size_t                  indexSize;
+    int                     ret = JRET_ERROR;
+
+    while (JSET_MAX_LOAD(capacity) < set->numEntries) {
+        capacity *= 2;
+    }
+
+    /* 索引是 capacity 个 tag 后面接 capacity 个位置, capacity 至少为 8, 位置数组按 8 字节对齐 */
+    indexSize = (sizeof (uint32_t) + sizeof (uint64_t)) * capacity;
+    index = calloc(1, indexSize);
+    if (JRET_PTR_NULL == index) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_OK == jsnapshot_writer_open(&writer, path, JSNAPSHOT_HEADER_SIZE + indexSize)) {
+        if (JRET_OK == jset_save_records(set, &writer, (uint32_t*) index, (uint64_t*) (index + sizeof (uint32_t) * capacity),
+                                         capacity - 1, saveFunc)) {
+            memset(&header, 0, sizeof (header));
+            memcpy(header.magic, JSET_SNAPSHOT_MAGIC, sizeof (header.magic));
+            header.num = set->numEntries;
+            header.capacity = capacity;
+            ret = jsnapshot_writer_commit(&writer, &header, index, indexSize);
+        } else {
+            jsnapshot_writer_abort(&writer);
+        }
+    }
+
+    free(index);
+
+    return ret;
+}
+
+JSetMapped* jset_open_mapped(const char* path, JSetHashFunc hashFunc, JSetMappedEqualFunc equalFunc) {
+    JSetMapped*             set = JRET_PTR_NULL;
+    const JSnapshotHeader*  header;
+    uint64_t                capacity;
+
+    set = malloc(sizeof (JSetMapped));
+    if (JRET_PTR_NULL == set) {
+        return JRET_PTR_NULL;
+    }
+
+    if (JRET_OK != jsnapshot_map(&set->snapshot, path, JSET_SNAPSHOT_MAGIC)) {
+        free(set);
+        return JRET_PTR_NULL;
+    }
+
+    header = set->snapshot.header;
+    capacity = header->capacity;
+    if (capacity < JSET_SNAPSHOT_MIN_CAPACITY || 0 != (capacity & (capacity - 1)) || header->num >= capacity
+            || header->num >= UINT32_MAX
+            || (header->dataOffset - header->indexOffset) / (sizeof (uint32_t) + sizeof (uint64_t)) < capacity) {
+        jsnapshot_unmap(&set->snapshot);
+        free(set);
+        return JRET_PTR_NULL;
+    }
+
+    set->tags = (const uint32_t*) (set->snapshot.base + header->indexOffset);
+    set->offsets = (const uint64_t*) (set->snapshot.base + header->indexOffset + sizeof (uint32_t) * capacity);
+    set->mask = capacity - 1;
+    set->num = header->num;
+    set->hashFunc = hashFunc;
+    set->equalFunc = equalFunc;
+
+    return set;
+}
+
+void jset_mapped_close(JSetMapped* set) {
+    jsnapshot_unmap(&set->snapshot);
+    free(set);
+}
+
+const void* jset_mapped_lookup(JSetMapped* set, JSetValue value, size_t* size) {
+    uint32_t                h = jset_hash_mix(set->hashFunc(value));
+    uint32_t                tag = h | 1;
+    uint64_t                pos = h & set->mask;
+    uint64_t                step;
+    const void*             record;
+    size_t                  len;
+
+    for (step = 0; step <= set->mask && 0 != set->tags[pos]; ++step, pos = (pos + 1) & set->mask) {
+        if (tag != set->tags[pos]) {
+            continue;
+        }
+
+        record = jsnapshot_record(&set->snapshot, set->offsets[pos], &len);
+        if (JRET_PTR_NULL != record && set->equalFunc(value, record, len)) {
+            if (JRET_PTR_NULL != size) {
+                *size = len;
+            }
+            return record;
+        }
+    }
+
+    return JRET_PTR_NULL;
+}
+
+unsigned int jset_mapped_foreach(JSetMapped* set, JSetMappedFunc func, void* data) {
+    const void*             record;
+    size_t                  len;
+    unsigned int            count = 0;
+    uint64_t                pos;
+
+    for (pos = 0; pos <= set->mask; ++pos) {
+        if (0 == set->tags[pos]) {
+            continue;
+        }
+
+        record = jsnapshot_record(&set->snapshot, set->offsets[pos], &len);
+        if (JRET_PTR_NULL == record) {
+            break;
+        }
+
+        ++ count;
+        if (JRET_OK != func(record, len, data)) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+unsigned int jset_mapped_num(JSetMapped* set) {
+    return (unsigned int) set->num;
+}
@@ -1,6 +1,28 @@
 #ifndef JSET_H
 #define JSET_H
 #include "jret.h"
+#include "jthread_pool.h"
+#include "jallocator.h"
+#include "jsnapshot.h"
+
+#include <stdint.h>
+
+/**
+ *  集合
+ *  set 是一个无序、不重复的值的集合。
+ *
+ *  实现：
+ *      开放寻址的 hash 表(Swiss table)，所有值直接存放在连续的槽数组中,
+ *      另有一个控制字节数组记录每个槽的状态(空/已删除/hash 的高 7 位)。
+ *      查找时按组(SSE2 为 16 个, AVX2 为 32 个)一次比较整组控制字节,
+ *      只有控制字节匹配的槽才调用 equal 函数。
+ *      插入不会为每个值申请内存，只在扩容时整体重新分配。
+ *
+ *  调用：
+ *      jset_new --- 创建
+ *      jset_free --- 销毁
+ */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -14,13 +36,12 @@ enum {
 
 typedef struct _JSet JSet;
 typedef struct _JSetIterator JSetIterator;
-typedef struct _JSetEntry JSetEntry;
 typedef void* JSetValue;
 
+/* 迭代器, 记录下一个要访问的槽 */
 struct _JSetIterator {
     JSet* set;
-    JSetEntry* nextEntry;
-    unsigned int nextChain;
+    unsigned int nextSlot;
 };
 
 /**
@@ -30,6 +51,8 @@ typedef unsigned int (*JSetHashFunc) (JSetValue value);
 
 /**
  *  比较函数, 比较两个值是否相等
+ *
+ *  @return                 相等返回非 0, 不相等返回 0
  */
 typedef int (*JSetEqualFunc) (JSetValue v1, JSetValue v2);
 
@@ -38,6 +61,16 @@ typedef int (*JSetEqualFunc) (JSetValue v1, JSetValue v2);
  */
 typedef void (JSetFreeFunc) (JSetValue v);
 
+/* 集合的内部计数, 编译时定义 JDS_STATS 才会计数(见 jstats.h) */
+typedef struct _JSetStats JSetStats;
+struct _JSetStats {
+    uint64_t                lookups;                // 插入、删除、查询时的查找次数, 集合运算中的查找不计
+    uint64_t                probedGroups;           // 查找探测的组数之和, 除以 lookups 是平均探测长度
+    uint64_t                maxProbeGroups;         // 一次查找探测的最多组数
+    uint64_t                comparisons;            // 查找时 equal 函数的调用次数(控制字节匹配后才调用)
+    uint64_t                rehashes;               // 扩容或清理删除标记时重新建表的次数
+};
+
 
 /**
  *  创建一个新集合
@@ -50,6 +83,20 @@ typedef void (JSetFreeFunc) (JSetValue v);
  */
 JSet* jset_new(JSetHashFunc hashFunc, JSetEqualFunc equalFunc);
 
+
+/**
+ *  使用指定分配器创建集合, 集合结构和槽数组都从分配器申请;
+ *  集合运算的结果使用第一个集合的分配器
+ *
+ *  @param hashFunc         生成hash值的函数
+ *  @param equalFunc        检查值是否在set集合中的函数
+ *  @param allocator        分配器, RET_PTR_NULL 表示默认分配器; 必须比集合活得长
+ *
+ *  @param return           成功: 返回新集合
+ *                          失败: 返回NULL
+ */
+JSet* jset_new_with_allocator(JSetHashFunc hashFunc, JSetEqualFunc equalFunc, const JAllocator* allocator);
+
 /**
  *  销毁集合
  *
@@ -73,7 +120,7 @@ void jset_register_free_function(JSet* set, JSetFreeFunc freeFunc);
  *  @param data             要插入集合的值
  *
  *  @return                 成功: 返回 JSET_TRUE
- *                          失败：返回 JSET_FALSE
+ *                          失败：返回 JSET_FALSE (值已存在或内存不足)
  */
 int jset_insert(JSet* set, JSetValue data);
 
@@ -112,6 +159,35 @@ int jset_query(JSet* set, JSetValue data);
 unsigned int jset_num_entries(JSet* set);
 
 
+/**
+ *  集合的内存统计, wasted 是控制字节、空槽和已删除的槽占用的空间, live - wasted 就是存放值的槽
+ *
+ *  @param set              集合
+ *  @param stats            统计结果
+ */
+void jset_memory_stats(JSet* set, JMemoryStats* stats);
+
+
+/**
+ *  集合的内部计数, 从创建或上次 jset_reset_stats 开始累计
+ *
+ *  @param set              集合
+ *  @param stats            计数结果, 编译时没有开启计数则全为 0
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (编译时没有定义 JDS_STATS)
+ */
+int jset_get_stats(JSet* set, JSetStats* stats);
+
+
+/**
+ *  计数清零
+ *
+ *  @param set              集合
+ */
+void jset_reset_stats(JSet* set);
+
+
 /**
  *  将set中的值都存放到数组中
  *
@@ -123,6 +199,55 @@ unsigned int jset_num_entries(JSet* set);
 JSetValue* jset_to_array(JSet* set);
 
 
+/**
+ *  初始化迭代器, 用来遍历集合中所有的值
+ *  注意: 遍历过程中不能插入值, 否则迭代器失效
+ *
+ *  @param set              集合
+ *  @param iter             要初始化的迭代器
+ */
+void jset_iterate(JSet* set, JSetIterator* iter);
+
+
+/**
+ *  迭代器是否还有值
+ *
+ *  @param iter             迭代器
+ *
+ *  @return                 还有值:   JSET_TRUE
+ *                          没有值:   JSET_FALSE
+ */
+int jset_iter_has_more(JSetIterator* iter);
+
+
+/**
+ *  返回迭代器的下一个值
+ *
+ *  @param iter             迭代器
+ *
+ *  @return                 成功: 返回下一个值
+ *                          没有值: 返回 RET_PTR_NULL
+ */
+JSetValue jset_iter_next(JSetIterator* iter);
+
+
+/**
+ *  设置集合运算使用的线程池
+ *  集合较大时, 以此集合为第一个参数的集合运算会把表切分成多段并行处理,
+ *  运算结果继承这个线程池。hash 和 equal 函数需要是线程安全的。
+ *
+ *  @param set              集合
+ *  @param pool             线程池, RET_PTR_NULL 表示单线程(默认)
+ */
+void jset_set_thread_pool(JSet* set, JThreadPool* pool);
+
+
+/**
+ *  集合运算
+ *  两个集合必须使用相同的 hash 和 equal 函数。运算总是遍历较小的集合、在较大的集合中查询。
+ *  新集合只保存值的指针, 不注册释放函数, 值仍然归原集合所有。
+ */
+
 /**
  *  计算两个集合的并集
  *
@@ -147,6 +272,178 @@ JSet* jset_union(JSet* s1, JSet* s2);
 JSet* jset_intersection(JSet* s1, JSet* s2);
 
 
+/**
+ *  计算两个集合的差集 s1 - s2
+ *
+ *  @param s1               集合1
+ *  @param s2               集合2
+ *
+ *  @return                 成功： 返回在集合1中但不在集合2中的值
+ *                          失败： NULL
+ */
+JSet* jset_difference(JSet* s1, JSet* s2);
+
+
+/**
+ *  计算两个集合的对称差
+ *
+ *  @param s1               集合1
+ *  @param s2               集合2
+ *
+ *  @return                 成功： 返回只在其中一个集合中的值
+ *                          失败： NULL
+ */
+JSet* jset_symmetric_difference(JSet* s1, JSet* s2);
+
+
+/**
+ *  检查集合1是否是集合2的子集
+ *
+ *  @param s1               集合1
+ *  @param s2               集合2
+ *
+ *  @return                 是子集:   JSET_TRUE
+ *                          不是子集: JSET_FALSE
+ */
+int jset_is_subset(JSet* s1, JSet* s2);
+
+
+/**
+ *  原地求交集, 集合1中只保留也在集合2中的值
+ *  保留的是集合1自己的值(指针), 不会换成集合2中相等的值; 被删除的值会调用集合1注册的释放函数
+ *
+ *  @param s1               集合1, 保存结果
+ *  @param s2               集合2
+ *
+ *  @return                 成功：返回 JSET_TRUE
+ *                          失败：返回 JSET_FALSE, 集合1不变
+ */
+int jset_intersect_inplace(JSet* s1, JSet* s2);
+
+
+/**
+ *  快照(见 jsnapshot.h)
+ *
+ *  jset_save 把集合写成不含指针的 hash 表文件: 线性探测, 每个槽是 32 位 hash(0 表示空)
+ *  和记录的位置, 负载不超过 7/8。jset_open_mapped 只读映射后直接查找, 不需要重新插入,
+ *  只读入访问到的页; 映射的集合只读, 多个线程可以同时查找。
+ *  hash 函数必须与进程无关(不能用指针地址), 保存和打开时使用同一个。
+ *
+ *  用法(值是字符串):
+ *      size_t save(JSetValue value, void* buf, size_t size) {
+ *          size_t len = strlen(value);
+ *          if (size >= len) {
+ *              memcpy(buf, value, len);
+ *          }
+ *          return len;
+ *      }
+ *      int equal(JSetValue value, const void* record, size_t size) {
+ *          return strlen(value) == size && 0 == memcmp(value, record, size);
+ *      }
+ *
+ *      jset_save(set, "names.snap", save);
+ *      mapped = jset_open_mapped("names.snap", string_hash, equal);
+ *      if (JRET_PTR_NULL != jset_mapped_lookup(mapped, "alice", JRET_PTR_NULL)) ...
+ */
+
+/* 映射的只读集合 */
+typedef struct _JSetMapped JSetMapped;
+
+/**
+ *  把值序列化到 buf
+ *
+ *  @param value            值
+ *  @param buf              缓冲区, 按 8 字节对齐
+ *  @param size             缓冲区大小
+ *
+ *  @return                 序列化需要的字节数; 大于 size 时不要写入, 会换成足够大的缓冲区再调用一次
+ */
+typedef size_t (*JSetSaveFunc) (JSetValue value, void* buf, size_t size);
+
+/**
+ *  比较值和序列化的记录是否相等
+ *
+ *  @return                 相等返回非 0, 不相等返回 0
+ */
+typedef int (*JSetMappedEqualFunc) (JSetValue value, const void* record, size_t size);
+
+/**
+ *  遍历映射的集合时对每条记录调用的函数
+ *
+ *  @return                 继续遍历返回 RET_OK, 返回其它值则停止遍历
+ */
+typedef int (*JSetMappedFunc) (const void* record, size_t size, void* data);
+
+
+/**
+ *  把集合保存为快照文件, 覆盖已有的文件(先写临时文件再改名, 失败时旧文件不变)
+ *
+ *  @param set              集合
+ *  @param path             文件名
+ *  @param saveFunc         序列化函数
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (内存不足或写文件失败)
+ */
+int jset_save(JSet* set, const char* path, JSetSaveFunc saveFunc);
+
+
+/**
+ *  只读映射快照文件
+ *
+ *  @param path             文件名
+ *  @param hashFunc         hash 函数, 与保存时集合的 hash 函数相同
+ *  @param equalFunc        比较函数
+ *
+ *  @return                 成功：返回映射的集合
+ *                          失败：返回 RET_PTR_NULL (文件不存在、不是集合的快照或已损坏)
+ */
+JSetMapped* jset_open_mapped(const char* path, JSetHashFunc hashFunc, JSetMappedEqualFunc equalFunc);
+
+
+/**
+ *  解除映射, 之前查找得到的记录都不能再访问
+ *
+ *  @param set              映射的集合
+ */
+void jset_mapped_close(JSetMapped* set);
+
+
+/**
+ *  查找值
+ *
+ *  @param set              映射的集合
+ *  @param value            要查找的值
+ *  @param size             返回记录的字节数, 可以为 RET_PTR_NULL
+ *
+ *  @return                 找到：返回记录(指向映射的文件, 只读)
+ *                          没找到：返回 RET_PTR_NULL
+ */
+const void* jset_mapped_lookup(JSetMapped* set, JSetValue value, size_t* size);
+
+
+/**
+ *  遍历所有记录, 顺序不固定
+ *
+ *  @param set              映射的集合
+ *  @param func             对每条记录调用的函数
+ *  @param data             用户数据
+ *
+ *  @return                 访问的记录数
+ */
+unsigned int jset_mapped_foreach(JSetMapped* set, JSetMappedFunc func, void* data);
+
+
+/**
+ *  记录数
+ *
+ *  @param set              映射的集合
+ *
+ *  @return                 记录数
+ */
+unsigned int jset_mapped_num(JSetMapped* set);
+
+
 
 #ifdef __cplusplus
 }
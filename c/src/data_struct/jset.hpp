@@ -0,0 +1,359 @@
+#ifndef JSET_HPP
+#define JSET_HPP
+
+/**
+ *  开放寻址 hash 集合的 C++ 模板版本 (C++11, 只有头文件)
+ *
+ *  算法与 jset.c 相同(组匹配的代码直接共用 jset_group.h):
+ *      控制字节数组记录每个槽的状态, 按组(SSE2 为 16 个, AVX2 为 32 个)一次比较整组,
+ *      按组三角探测, 负载因子 7/8, 删除时组内还有空槽就直接置空, 否则标记为已删除,
+ *      没有空槽可用时删除标记多就按原大小重建, 否则容量翻倍。
+ *  与 C 版本的不同:
+ *      值按值存放在槽中, 不需要 void* 和额外的内存;
+ *      hash 和 equal 是函数对象, 可以内联, 不经过函数指针;
+ *      支持只能移动的类型, emplace 直接构造。
+ *
+ *  用户的 hash 值先折叠到 32 位再用 jset_hash_mix 打散, std::hash 对整数是恒等函数也能均匀分布。
+ *  插入和扩容会让迭代器失效, 删除不会。
+ *
+ *  用法:
+ *      jds::hash_set<std::string> s;
+ *      s.insert("a");
+ *      if (s.count("a")) { ... }
+ */
+#include "jset_group.h"
+
+#include <functional>
+#include <utility>
+#include <iterator>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+namespace jds {
+
+template <typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T> >
+class hash_set {
+public:
+    typedef T                   key_type;
+    typedef T                   value_type;
+    typedef std::size_t         size_type;
+    typedef Hash                hasher;
+    typedef Equal               key_equal;
+
+    /* 只读的前向迭代器, 按槽的顺序跳过空槽和已删除的槽 */
+    class const_iterator {
+        friend class hash_set;
+
+    public:
+        typedef std::forward_iterator_tag       iterator_category;
+        typedef T                               value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef const T*                        pointer;
+        typedef const T&                        reference;
+
+        const_iterator() : mSet(nullptr), mSlot(0) {}
+
+        reference operator*() const { return mSet->mSlots[mSlot];}
+        pointer operator->() const { return &mSet->mSlots[mSlot];}
+
+        const_iterator& operator++() { mSlot = mSet->next_full(mSlot + 1); return *this;}
+        const_iterator operator++(int) { const_iterator old = *this; ++*this; return old;}
+
+        bool operator==(const const_iterator& other) const { return mSlot == other.mSlot;}
+        bool operator!=(const const_iterator& other) const { return mSlot != other.mSlot;}
+
+    private:
+        const_iterator(const hash_set* set, size_type slot) : mSet(set), mSlot(slot) {}
+
+        const hash_set*         mSet;
+        size_type               mSlot;
+    };
+
+    typedef const_iterator      iterator;
+
+    explicit hash_set(const Hash& hash = Hash(), const Equal& equal = Equal())
+        : mCtrl(nullptr), mSlots(nullptr), mCapacity(0), mSize(0), mGrowthLeft(0), mHash(hash), mEqual(equal) {}
+
+    hash_set(const hash_set& other)
+        : mCtrl(nullptr), mSlots(nullptr), mCapacity(0), mSize(0), mGrowthLeft(0), mHash(other.mHash), mEqual(other.mEqual) {
+        reserve(other.mSize);
+        for (const_iterator it = other.begin(); it != other.end(); ++it) {
+            place(*it, mix(*it));
+            ++ mSize;
+        }
+    }
+
+    hash_set(hash_set&& other)
+        : mCtrl(other.mCtrl), mSlots(other.mSlots), mCapacity(other.mCapacity), mSize(other.mSize),
+          mGrowthLeft(other.mGrowthLeft), mHash(std::move(other.mHash)), mEqual(std::move(other.mEqual)) {
+        other.mCtrl = nullptr;
+        other.mSlots = nullptr;
+        other.mCapacity = 0;
+        other.mSize = 0;
+        other.mGrowthLeft = 0;
+    }
+
+    hash_set& operator=(hash_set other) {
+        swap(other);
+        return *this;
+    }
+
+    ~hash_set() {
+        destroy_all();
+        ::operator delete(mCtrl);
+    }
+
+    void swap(hash_set& other) {
+        std::swap(mCtrl, other.mCtrl);
+        std::swap(mSlots, other.mSlots);
+        std::swap(mCapacity, other.mCapacity);
+        std::swap(mSize, other.mSize);
+        std::swap(mGrowthLeft, other.mGrowthLeft);
+        std::swap(mHash, other.mHash);
+        std::swap(mEqual, other.mEqual);
+    }
+
+    bool empty() const { return 0 == mSize;}
+    size_type size() const { return mSize;}
+    size_type capacity() const { return mCapacity;}
+
+    const_iterator begin() const { return const_iterator(this, next_full(0));}
+    const_iterator end() const { return const_iterator(this, mCapacity);}
+
+    /* 删除所有值, 保留槽数组 */
+    void clear() {
+        destroy_all();
+        if (nullptr != mCtrl) {
+            memset(mCtrl, JSET_CTRL_EMPTY, mCapacity);
+        }
+        mSize = 0;
+        mGrowthLeft = max_load(mCapacity);
+    }
+
+    /* 保证还能再放入 num 个值而不需要扩容 */
+    void reserve(size_type num) {
+        size_type               newCapacity = mCapacity > 0 ? mCapacity : (size_type) JSET_MIN_CAPACITY;
+
+        if (mCapacity > 0 && mGrowthLeft >= num) {
+            return;
+        }
+
+        while (max_load(newCapacity) < mSize + num) {
+            newCapacity *= 2;
+        }
+
+        resize(newCapacity);
+    }
+
+    /**
+     *  先构造值再查找, 值已存在时销毁它
+     *
+     *  @return                 (指向值所在槽的迭代器, 是否插入了新值)
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        T                       value(std::forward<Args>(args)...);
+
+        return insert(std::move(value));
+    }
+
+    std::pair<iterator, bool> insert(const T& value) { return insert_value(value);}
+    std::pair<iterator, bool> insert(T&& value) { return insert_value(std::move(value));}
+
+    const_iterator find(const T& value) const { return const_iterator(this, find_slot(value, mix(value)));}
+    size_type count(const T& value) const { return find_slot(value, mix(value)) == mCapacity ? 0 : 1;}
+
+    size_type erase(const T& value) {
+        size_type               slot = find_slot(value, mix(value));
+
+        if (slot == mCapacity) {
+            return 0;
+        }
+        erase_slot(slot);
+
+        return 1;
+    }
+
+    /* 删除迭代器指向的值, 返回下一个位置 */
+    const_iterator erase(const_iterator pos) {
+        erase_slot(pos.mSlot);
+        return const_iterator(this, next_full(pos.mSlot + 1));
+    }
+
+private:
+    enum { JSET_MIN_CAPACITY = 64 };                                        // 必须是组宽度的整数倍且为 2 的幂
+
+    /* 负载因子 7/8 */
+    static size_type max_load(size_type capacity) { return capacity - capacity / 8;}
+
+    /* 用户 hash 值折叠到 32 位再打散, 与 jset.c 一样高 7 位存入控制字节, 低位决定起始组 */
+    uint32_t mix(const T& value) const {
+        uint64_t                h = (uint64_t) mHash(value);
+
+        return jset_hash_mix((uint32_t) (h ^ (h >> 32)));
+    }
+
+    size_type next_full(size_type slot) const {
+        while (slot < mCapacity && mCtrl[slot] < 0) {
+            ++ slot;
+        }
+
+        return slot;
+    }
+
+    void destroy_all() {
+        size_type               i;
+
+        for (i = 0; i < mCapacity; ++i) {
+            if (mCtrl[i] >= 0) {
+                mSlots[i].~T();
+            }
+        }
+    }
+
+    /* 按组三角探测, 遇到含空槽的组即可停止; 没找到返回 capacity */
+    size_type find_slot(const T& value, uint32_t h) const {
+        size_type               groupMask = mCapacity / JSET_GROUP_WIDTH - 1;
+        size_type               group = h & groupMask;
+        size_type               step = 0;
+        signed char             h2 = jset_hash_h2(h);
+        const signed char*      ctrl;
+        JSetGroupMask           match;
+        size_type               slot;
+
+        if (0 == mCapacity) {
+            return 0;
+        }
+
+        for (;;) {
+            ctrl = mCtrl + group * JSET_GROUP_WIDTH;
+            for (match = jset_group_match(ctrl, h2); match; match &= match - 1) {
+                slot = group * JSET_GROUP_WIDTH + jset_group_mask_first(match);
+                if (mEqual(mSlots[slot], value)) {
+                    return slot;
+                }
+            }
+
+            if (jset_group_match_empty(ctrl)) {
+                return mCapacity;
+            }
+
+            ++ step;
+            group = (group + step) & groupMask;
+            if (step > groupMask) {                                         // 表中没有空槽(只在全是删除标记时出现)
+                return mCapacity;
+            }
+        }
+    }
+
+    /* 找到第一个可以放值的槽(空或已删除) */
+    size_type find_free_slot(uint32_t h) const {
+        size_type               groupMask = mCapacity / JSET_GROUP_WIDTH - 1;
+        size_type               group = h & groupMask;
+        size_type               step = 0;
+        JSetGroupMask           match;
+
+        for (;;) {
+            match = jset_group_match_empty_or_deleted(mCtrl + group * JSET_GROUP_WIDTH);
+            if (match) {
+                return group * JSET_GROUP_WIDTH + jset_group_mask_first(match);
+            }
+
+            ++ step;
+            group = (group + step) & groupMask;
+        }
+    }
+
+    /* 把值放入槽中, 调用者保证值不在集合中且有空间 */
+    template <typename V>
+    size_type place(V&& value, uint32_t h) {
+        size_type               slot = find_free_slot(h);
+
+        ::new (static_cast<void*>(mSlots + slot)) T(std::forward<V>(value));
+        if (JSET_CTRL_EMPTY == mCtrl[slot]) {
+            -- mGrowthLeft;
+        }
+        mCtrl[slot] = jset_hash_h2(h);
+
+        return slot;
+    }
+
+    template <typename V>
+    std::pair<iterator, bool> insert_value(V&& value) {
+        uint32_t                h = mix(value);
+        size_type               slot = find_slot(value, h);
+
+        if (slot != mCapacity) {                                            // 已经存在
+            return std::make_pair(const_iterator(this, slot), false);
+        }
+
+        if (0 == mGrowthLeft) {
+            rehash();
+        }
+
+        slot = place(std::forward<V>(value), h);
+        ++ mSize;
+
+        return std::make_pair(const_iterator(this, slot), true);
+    }
+
+    /* 组内还有空槽可以直接置空, 否则只能标记为已删除, 保证后面的探测不会中断 */
+    void erase_slot(size_type slot) {
+        mSlots[slot].~T();
+        if (jset_group_match_empty(mCtrl + (slot - slot % JSET_GROUP_WIDTH))) {
+            mCtrl[slot] = JSET_CTRL_EMPTY;
+            ++ mGrowthLeft;
+        } else {
+            mCtrl[slot] = JSET_CTRL_DELETED;
+        }
+        -- mSize;
+    }
+
+    /* 按新容量重新建表, 控制字节和槽放在同一块内存, 已有的值移动到新表 */
+    void resize(size_type newCapacity) {
+        signed char*            oldCtrl = mCtrl;
+        T*                      oldSlots = mSlots;
+        size_type               oldCapacity = mCapacity;
+        size_type               ctrlBytes = (newCapacity + alignof(T) - 1) / alignof(T) * alignof(T);
+        char*                   block = static_cast<char*>(::operator new(ctrlBytes + sizeof (T) * newCapacity));
+        size_type               i;
+
+        mCtrl = reinterpret_cast<signed char*>(block);
+        mSlots = reinterpret_cast<T*>(block + ctrlBytes);
+        mCapacity = newCapacity;
+        mGrowthLeft = max_load(newCapacity);
+        memset(mCtrl, JSET_CTRL_EMPTY, newCapacity);
+
+        for (i = 0; i < oldCapacity; ++i) {
+            if (oldCtrl[i] >= 0) {
+                place(std::move(oldSlots[i]), mix(oldSlots[i]));
+                oldSlots[i].~T();
+            }
+        }
+        ::operator delete(oldCtrl);
+    }
+
+    /* 删除标记较多时按原大小重建(清理删除标记), 否则容量翻倍 */
+    void rehash() {
+        if (0 == mCapacity) {
+            resize(JSET_MIN_CAPACITY);
+        } else if (mSize >= max_load(mCapacity) / 2) {
+            resize(mCapacity * 2);
+        } else {
+            resize(mCapacity);
+        }
+    }
+
+    signed char*                mCtrl;
+    T*                          mSlots;
+    size_type                   mCapacity;
+    size_type                   mSize;
+    size_type                   mGrowthLeft;
+    Hash                        mHash;
+    Equal                       mEqual;
+};
+
+}
+
+#endif // JSET_HPP
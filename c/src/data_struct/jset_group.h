@@ -0,0 +1,117 @@
+#ifndef JSET_GROUP_H
+#define JSET_GROUP_H
+
+/**
+ *  Swiss table 控制字节的组匹配, JSet 和 C++ 的 jds::hash_set 共用
+ *
+ *  控制字节：
+ *      空槽        1000 0000
+ *      已删除      1111 1110
+ *      有值        0xxx xxxx   (hash 的高 7 位)
+ *
+ *  槽按组对齐, 一组控制字节可以用一条 SIMD 指令比较完
+ *  组匹配的结果是一个位掩码，每个匹配的槽对应一位
+ *  SIMD 实现每个槽占 1 位, 纯 C 实现(SWAR)每个槽占 8 位
+ */
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSET_GROUP_WIDTH        (32)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define JSET_GROUP_WIDTH        (16)
+#else
+#define JSET_GROUP_WIDTH        (8)
+#endif
+
+#define JSET_CTRL_EMPTY         ((signed char) -128)
+#define JSET_CTRL_DELETED       ((signed char) -2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint64_t JSetGroupMask;
+
+#if defined(__AVX2__)
+#define JSET_MASK_SHIFT         (0)
+
+static inline JSetGroupMask jset_group_match(const signed char* ctrl, signed char h2) {
+    __m256i g = _mm256_loadu_si256((const __m256i*) ctrl);
+    return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(h2), g));
+}
+
+static inline JSetGroupMask jset_group_match_empty(const signed char* ctrl) {
+    return jset_group_match(ctrl, JSET_CTRL_EMPTY);
+}
+
+static inline JSetGroupMask jset_group_match_empty_or_deleted(const signed char* ctrl) {
+    __m256i g = _mm256_loadu_si256((const __m256i*) ctrl);
+    return (uint32_t) _mm256_movemask_epi8(g);
+}
+#elif defined(__SSE2__)
+#define JSET_MASK_SHIFT         (0)
+
+static inline JSetGroupMask jset_group_match(const signed char* ctrl, signed char h2) {
+    __m128i g = _mm_loadu_si128((const __m128i*) ctrl);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), g));
+}
+
+static inline JSetGroupMask jset_group_match_empty(const signed char* ctrl) {
+    return jset_group_match(ctrl, JSET_CTRL_EMPTY);
+}
+
+static inline JSetGroupMask jset_group_match_empty_or_deleted(const signed char* ctrl) {
+    __m128i g = _mm_loadu_si128((const __m128i*) ctrl);
+    return (uint32_t) _mm_movemask_epi8(g);
+}
+#else
+#define JSET_MASK_SHIFT         (3)
+#define JSET_LSBS               (0x0101010101010101ULL)
+#define JSET_MSBS               (0x8080808080808080ULL)
+
+static inline uint64_t jset_group_load(const signed char* ctrl) {
+    uint64_t g;
+    memcpy(&g, ctrl, sizeof (g));
+    return g;
+}
+
+/* 可能有误报, 调用者总会再用 equal 函数确认 */
+static inline JSetGroupMask jset_group_match(const signed char* ctrl, signed char h2) {
+    uint64_t x = jset_group_load(ctrl) ^ (JSET_LSBS * (unsigned char) h2);
+    return (x - JSET_LSBS) & ~x & JSET_MSBS;
+}
+
+static inline JSetGroupMask jset_group_match_empty(const signed char* ctrl) {
+    uint64_t g = jset_group_load(ctrl);
+    return g & ~(g << 6) & JSET_MSBS;
+}
+
+static inline JSetGroupMask jset_group_match_empty_or_deleted(const signed char* ctrl) {
+    uint64_t g = jset_group_load(ctrl);
+    return g & ~(g << 7) & JSET_MSBS;
+}
+#endif
+
+/* 掩码中最低位匹配的槽在组内的下标 */
+static inline unsigned int jset_group_mask_first(JSetGroupMask mask) { return (unsigned int) __builtin_ctzll(mask) >> JSET_MASK_SHIFT;}
+
+/* 打散用户的 hash 值(murmur3 fmix32), 用户 hash 函数质量不高时也能均匀分布 */
+static inline uint32_t jset_hash_mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h;
+}
+
+/* 高 7 位存入控制字节, 其余位决定从哪一组开始探测 */
+static inline signed char jset_hash_h2(uint32_t h) { return (signed char) (h >> 25);}
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JSET_GROUP_H
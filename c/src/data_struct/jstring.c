@@ -0,0 +1,1025 @@
+#include "jstring.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define JSTRING_X86
+#define JSTRING_TARGET_SSE2     __attribute__((target("sse2")))
+#define JSTRING_TARGET_AVX2     __attribute__((target("avx2")))
+#endif
+
+#define JSTRING_ASCII_MASK      (0x8080808080808080ull)
+
+struct _JString {
+    char*                   data;                   // 指向 small 或另外申请的空间
+    size_t                  size;
+    size_t                  capacity;               // 不含末尾的 0
+    unsigned int            hash;
+    int                     hashValid;              // 修改内容后清零
+    char                    small[JSTRING_SMALL_SIZE + 1];
+};
+
+/**
+ * 一种 SIMD 实现
+ * 转码只有 ASCII 部分按块处理, 其它字符逐个解码; 每个 ascii* 函数处理开头全部连续的 ASCII,
+ * 返回处理的个数, 所以第一个是 ASCII 时至少返回 1
+ */
+typedef struct _JStringImpl JStringImpl;
+struct _JStringImpl {
+    JStringSimd             simd;
+    size_t                  (*asciiPrefix)      (const unsigned char* data, size_t size);
+    size_t                  (*asciiToUtf16)     (const unsigned char* data, size_t size, uint16_t* out);
+    size_t                  (*asciiToUtf32)     (const unsigned char* data, size_t size, uint32_t* out);
+    size_t                  (*utf16ToAscii)     (const uint16_t* data, size_t num, unsigned char* out);
+    int                     (*utf8Valid)        (const unsigned char* data, size_t size);
+    size_t                  (*utf8Length)       (const unsigned char* data, size_t size);
+    size_t                  (*memchr)           (const unsigned char* data, size_t size, unsigned char c);
+    size_t                  (*memmem)           (const unsigned char* data, size_t size, const unsigned char* needle, size_t needleSize);
+};
+
+static const JStringImpl*   jstring_impl_current = JRET_PTR_NULL;
+
+/**
+ * 解码一个 UTF-8 字符
+ *
+ * @return 成功返回字节数, 不合法(被截断、过长编码、代理区、超出 U+10FFFF)返回 0
+ */
+static size_t utf8_decode(const unsigned char* p, size_t size, uint32_t* cp) {
+    unsigned char           c = p[0];
+
+    if (c < 0x80) {
+        *cp = c;
+        return 1;
+    }
+
+    if (c < 0xC2) {                                 // 后续字节或 2 字节的过长编码
+        return 0;
+    }
+
+    if (c < 0xE0) {
+        if (size < 2 || 0x80 != (p[1] & 0xC0)) {
+            return 0;
+        }
+        *cp = ((uint32_t) (c & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+
+    if (c < 0xF0) {
+        if (size < 3 || 0x80 != (p[1] & 0xC0) || 0x80 != (p[2] & 0xC0)) {
+            return 0;
+        }
+        *cp = ((uint32_t) (c & 0x0F) << 12) | ((uint32_t) (p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return (*cp < 0x800 || (*cp >= 0xD800 && *cp <= 0xDFFF)) ? 0 : 3;
+    }
+
+    if (c < 0xF5) {
+        if (size < 4 || 0x80 != (p[1] & 0xC0) || 0x80 != (p[2] & 0xC0) || 0x80 != (p[3] & 0xC0)) {
+            return 0;
+        }
+        *cp = ((uint32_t) (c & 0x07) << 18) | ((uint32_t) (p[1] & 0x3F) << 12) | ((uint32_t) (p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+        return (*cp < 0x10000 || *cp > 0x10FFFF) ? 0 : 4;
+    }
+
+    return 0;
+}
+
+/* 编码一个码点, 调用者保证码点合法, 返回字节数 */
+static size_t utf8_encode(uint32_t cp, unsigned char* out) {
+    if (cp < 0x80) {
+        out[0] = (unsigned char) cp;
+        return 1;
+    }
+
+    if (cp < 0x800) {
+        out[0] = (unsigned char) (0xC0 | (cp >> 6));
+        out[1] = (unsigned char) (0x80 | (cp & 0x3F));
+        return 2;
+    }
+
+    if (cp < 0x10000) {
+        out[0] = (unsigned char) (0xE0 | (cp >> 12));
+        out[1] = (unsigned char) (0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (unsigned char) (0x80 | (cp & 0x3F));
+        return 3;
+    }
+
+    out[0] = (unsigned char) (0xF0 | (cp >> 18));
+    out[1] = (unsigned char) (0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (unsigned char) (0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (unsigned char) (0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/* 用 asciiPrefix 成块跳过 ASCII, 其它字符逐个解码, 没有专门校验实现时使用 */
+static int utf8_valid_generic(size_t (*asciiPrefix) (const unsigned char*, size_t), const unsigned char* data, size_t size) {
+    size_t                  i = 0;
+    size_t                  len;
+    uint32_t                cp;
+
+    while (i < size) {
+        if (data[i] < 0x80) {
+            i += asciiPrefix(data + i, size - i);
+            continue;
+        }
+        len = utf8_decode(data + i, size - i, &cp);
+        if (0 == len) {
+            return 0;
+        }
+        i += len;
+    }
+
+    return 1;
+}
+
+/*************************************** 纯 C ***************************************/
+
+/* 一次检查 8 个字节的最高位 */
+static size_t scalar_ascii_prefix(const unsigned char* data, size_t size) {
+    size_t                  i = 0;
+    uint64_t                block;
+
+    for (; i + 8 <= size; i += 8) {
+        memcpy(&block, data + i, 8);
+        if (0 != (block & JSTRING_ASCII_MASK)) {
+            break;
+        }
+    }
+
+    while (i < size && data[i] < 0x80) {
+        ++ i;
+    }
+
+    return i;
+}
+
+static size_t scalar_ascii_to_utf16(const unsigned char* data, size_t size, uint16_t* out) {
+    size_t                  i;
+
+    for (i = 0; i < size && data[i] < 0x80; ++i) {
+        out[i] = data[i];
+    }
+
+    return i;
+}
+
+static size_t scalar_ascii_to_utf32(const unsigned char* data, size_t size, uint32_t* out) {
+    size_t                  i;
+
+    for (i = 0; i < size && data[i] < 0x80; ++i) {
+        out[i] = data[i];
+    }
+
+    return i;
+}
+
+static size_t scalar_utf16_to_ascii(const uint16_t* data, size_t num, unsigned char* out) {
+    size_t                  i;
+
+    for (i = 0; i < num && data[i] < 0x80; ++i) {
+        out[i] = (unsigned char) data[i];
+    }
+
+    return i;
+}
+
+static int scalar_utf8_valid(const unsigned char* data, size_t size) {
+    return utf8_valid_generic(scalar_ascii_prefix, data, size);
+}
+
+static size_t scalar_utf8_length(const unsigned char* data, size_t size) {
+    size_t                  num = 0;
+    size_t                  i;
+
+    for (i = 0; i < size; ++i) {
+        num += (signed char) data[i] > -65;         // 不是 10xxxxxx
+    }
+
+    return num;
+}
+
+static size_t scalar_memchr(const unsigned char* data, size_t size, unsigned char c) {
+    size_t                  i;
+
+    for (i = 0; i < size; ++i) {
+        if (data[i] == c) {
+            return i;
+        }
+    }
+
+    return JSTRING_NPOS;
+}
+
+/* 先找第一个字节再比较其余部分, needleSize 不为 0 */
+static size_t scalar_memmem(const unsigned char* data, size_t size, const unsigned char* needle, size_t needleSize) {
+    size_t                  i = 0;
+    size_t                  pos;
+
+    while (needleSize <= size - i) {
+        pos = scalar_memchr(data + i, size - i - needleSize + 1, needle[0]);
+        if (JSTRING_NPOS == pos) {
+            break;
+        }
+        i += pos;
+        if (0 == memcmp(data + i + 1, needle + 1, needleSize - 1)) {
+            return i;
+        }
+        ++ i;
+    }
+
+    return JSTRING_NPOS;
+}
+
+static const JStringImpl jstring_impl_scalar = {
+    JSTRING_SIMD_NONE,
+    scalar_ascii_prefix,
+    scalar_ascii_to_utf16,
+    scalar_ascii_to_utf32,
+    scalar_utf16_to_ascii,
+    scalar_utf8_valid,
+    scalar_utf8_length,
+    scalar_memchr,
+    scalar_memmem,
+};
+
+#ifdef JSTRING_X86
+/*************************************** SSE2 ***************************************/
+
+JSTRING_TARGET_SSE2 static size_t sse2_ascii_prefix(const unsigned char* data, size_t size) {
+    size_t                  i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        if (0 != _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) (data + i)))) {
+            break;
+        }
+    }
+
+    return i + scalar_ascii_prefix(data + i, size - i);
+}
+
+JSTRING_TARGET_SSE2 static size_t sse2_ascii_to_utf16(const unsigned char* data, size_t size, uint16_t* out) {
+    const __m128i           zero = _mm_setzero_si128();
+    __m128i                 block;
+    size_t                  i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        block = _mm_loadu_si128((const __m128i*) (data + i));
+        if (0 != _mm_movemask_epi8(block)) {
+            break;
+        }
+        _mm_storeu_si128((__m128i*) (out + i), _mm_unpacklo_epi8(block, zero));
+        _mm_storeu_si128((__m128i*) (out + i + 8), _mm_unpackhi_epi8(block, zero));
+    }
+
+    return i + scalar_ascii_to_utf16(data + i, size - i, out + i);
+}
+
+JSTRING_TARGET_SSE2 static size_t sse2_ascii_to_utf32(const unsigned char* data, size_t size, uint32_t* out) {
+    const __m128i           zero = _mm_setzero_si128();
+    __m128i                 block;
+    __m128i                 lo;
+    __m128i                 hi;
+    size_t                  i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        block = _mm_loadu_si128((const __m128i*) (data + i));
+        if (0 != _mm_movemask_epi8(block)) {
+            break;
+        }
+        lo = _mm_unpacklo_epi8(block, zero);
+        hi = _mm_unpackhi_epi8(block, zero);
+        _mm_storeu_si128((__m128i*) (out + i), _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128((__m128i*) (out + i + 4), _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128((__m128i*) (out + i + 8), _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128((__m128i*) (out + i + 12), _mm_unpackhi_epi16(hi, zero));
+    }
+
+    return i + scalar_ascii_to_utf32(data + i, size - i, out + i);
+}
+
+/* 16 个单元都小于 0x80 时压缩成 16 个字节 */
+JSTRING_TARGET_SSE2 static size_t sse2_utf16_to_ascii(const uint16_t* data, size_t num, unsigned char* out) {
+    const __m128i           high = _mm_set1_epi16((short) 0xFF80);
+    __m128i                 lo;
+    __m128i                 hi;
+    size_t                  i = 0;
+
+    for (; i + 16 <= num; i += 16) {
+        lo = _mm_loadu_si128((const __m128i*) (data + i));
+        hi = _mm_loadu_si128((const __m128i*) (data + i + 8));
+        if (0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(lo, hi), high), _mm_setzero_si128()))) {
+            break;
+        }
+        _mm_storeu_si128((__m128i*) (out + i), _mm_packus_epi16(lo, hi));
+    }
+
+    return i + scalar_utf16_to_ascii(data + i, num - i, out + i);
+}
+
+static int sse2_utf8_valid(const unsigned char* data, size_t size) {
+    return utf8_valid_generic(sse2_ascii_prefix, data, size);
+}
+
+JSTRING_TARGET_SSE2 static size_t sse2_utf8_length(const unsigned char* data, size_t size) {
+    const __m128i           limit = _mm_set1_epi8(-65);
+    size_t                  num = 0;
+    size_t                  i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        num += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*) (data + i)), limit)));
+    }
+
+    return num + scalar_utf8_length(data + i, size - i);
+}
+
+JSTRING_TARGET_SSE2 static size_t sse2_memchr(const unsigned char* data, size_t size, unsigned char c) {
+    const __m128i           key = _mm_set1_epi8((char) c);
+    unsigned int            mask;
+    size_t                  i = 0;
+    size_t                  pos;
+
+    for (; i + 16 <= size; i += 16) {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (data + i)), key));
+        if (0 != mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    pos = scalar_memchr(data + i, size - i, c);
+
+    return JSTRING_NPOS == pos ? JSTRING_NPOS : i + pos;
+}
+
+/**
+ * 同时比较子串的第一个和最后一个字节, 两个都相等的位置才比较中间部分,
+ * 一次筛选 16 个候选位置, needleSize 不为 0
+ */
+JSTRING_TARGET_SSE2 static size_t sse2_memmem(const unsigned char* data, size_t size, const unsigned char* needle, size_t needleSize) {
+    const __m128i           first = _mm_set1_epi8((char) needle[0]);
+    const __m128i           last = _mm_set1_epi8((char) needle[needleSize - 1]);
+    unsigned int            mask;
+    unsigned int            bit;
+    size_t                  i = 0;
+    size_t                  pos;
+
+    if (needleSize > size) {
+        return JSTRING_NPOS;
+    }
+
+    for (; i + needleSize - 1 + 16 <= size; i += 16) {
+        mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (data + i)), first),
+                                               _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (data + i + needleSize - 1)), last)));
+        for (; 0 != mask; mask &= mask - 1) {
+            bit = __builtin_ctz(mask);
+            if (0 == memcmp(data + i + bit + 1, needle + 1, needleSize - 1)) {
+                return i + bit;
+            }
+        }
+    }
+
+    pos = scalar_memmem(data + i, size - i, needle, needleSize);
+
+    return JSTRING_NPOS == pos ? JSTRING_NPOS : i + pos;
+}
+
+static const JStringImpl jstring_impl_sse2 = {
+    JSTRING_SIMD_SSE2,
+    sse2_ascii_prefix,
+    sse2_ascii_to_utf16,
+    sse2_ascii_to_utf32,
+    sse2_utf16_to_ascii,
+    sse2_utf8_valid,
+    sse2_utf8_length,
+    sse2_memchr,
+    sse2_memmem,
+};
+
+/*************************************** AVX2 ***************************************/
+
+/* UTF-8 校验中按字节高低 4 位查表得到的错误类型, 一个字节与它前一个字节的错误类型相与不为 0 即不合法 */
+#define UTF8_TOO_SHORT          (0x01)              // 11______ 后面不是 10______
+#define UTF8_TOO_LONG           (0x02)              // 0_______ 后面是 10______
+#define UTF8_OVERLONG_3         (0x04)              // 11100000 100_____
+#define UTF8_TOO_LARGE          (0x08)              // 11110100 1001____ 及更大
+#define UTF8_SURROGATE          (0x10)              // 11101101 101_____
+#define UTF8_OVERLONG_2         (0x20)              // 1100000_ 10______
+#define UTF8_TOO_LARGE_1000     (0x40)              // 11110101 1000____ 及更大
+#define UTF8_OVERLONG_4         (0x40)              // 11110000 1000____
+#define UTF8_TWO_CONTS          (0x80)              // 10______ 10______, 是否合法由前 2、3 个字节决定
+#define UTF8_CARRY              (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/* 每个字节前面第 n 个字节, 跨过 128 位的两半和上一块 */
+#define AVX2_PREV(input, prev, n) _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev), (input), 0x21), 16 - (n))
+
+JSTRING_TARGET_AVX2 static __m256i avx2_lookup(__m256i table, __m256i nibble) {
+    return _mm256_shuffle_epi8(table, nibble);
+}
+
+/**
+ * 校验一块 32 字节, 返回不为 0 的字节表示有错误
+ * 查表方法见 Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte"
+ */
+JSTRING_TARGET_AVX2 static __m256i avx2_utf8_check(__m256i input, __m256i prev) {
+    const __m256i           byte1High = _mm256_setr_epi8(
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        (char) UTF8_TWO_CONTS, (char) UTF8_TWO_CONTS, (char) UTF8_TWO_CONTS, (char) UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT, UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        (char) UTF8_TWO_CONTS, (char) UTF8_TWO_CONTS, (char) UTF8_TWO_CONTS, (char) UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT, UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+    const __m256i           byte1Low = _mm256_setr_epi8(
+        (char) (UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4), (char) (UTF8_CARRY | UTF8_OVERLONG_2),
+        (char) UTF8_CARRY, (char) UTF8_CARRY, (char) (UTF8_CARRY | UTF8_TOO_LARGE),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4), (char) (UTF8_CARRY | UTF8_OVERLONG_2),
+        (char) UTF8_CARRY, (char) UTF8_CARRY, (char) (UTF8_CARRY | UTF8_TOO_LARGE),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE),
+        (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000));
+    const __m256i           byte2High = _mm256_setr_epi8(
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4),
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4),
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+        (char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+    const __m256i           low4 = _mm256_set1_epi8(0x0F);
+    __m256i                 prev1 = AVX2_PREV(input, prev, 1);
+    __m256i                 special;
+    __m256i                 must23;
+
+    special = _mm256_and_si256(_mm256_and_si256(
+                    avx2_lookup(byte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low4)),
+                    avx2_lookup(byte1Low, _mm256_and_si256(prev1, low4))),
+                    avx2_lookup(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), low4)));
+
+    /* 前 2 个字节是 3、4 字节的首字节或前 3 个字节是 4 字节的首字节时, 必须是后续字节 */
+    must23 = _mm256_or_si256(_mm256_subs_epu8(AVX2_PREV(input, prev, 2), _mm256_set1_epi8(0xE0 - 0x80)),
+                             _mm256_subs_epu8(AVX2_PREV(input, prev, 3), _mm256_set1_epi8(0xF0 - 0x80)));
+
+    return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char) 0x80)), special);
+}
+
+JSTRING_TARGET_AVX2 static int avx2_utf8_valid(const unsigned char* data, size_t size) {
+    /* 最后 3 个字节是多字节字符的首字节, 下一块必须接着后续字节 */
+    const __m256i           maxValue = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                        (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+    __m256i                 error = _mm256_setzero_si256();
+    __m256i                 prev = _mm256_setzero_si256();
+    __m256i                 incomplete = _mm256_setzero_si256();
+    __m256i                 input;
+    unsigned char           tail[32];
+    size_t                  i = 0;
+
+    for (;;) {
+        if (i + 32 <= size) {
+            input = _mm256_loadu_si256((const __m256i*) (data + i));
+        } else {
+            /* 最后不足 32 字节补 0, 被截断的字符在这里报错 */
+            memset(tail, 0, sizeof (tail));
+            memcpy(tail, data + i, size - i);
+            input = _mm256_loadu_si256((const __m256i*) tail);
+        }
+
+        if (0 == _mm256_movemask_epi8(input)) {
+            error = _mm256_or_si256(error, incomplete);
+        } else {
+            error = _mm256_or_si256(error, avx2_utf8_check(input, prev));
+        }
+        incomplete = _mm256_subs_epu8(input, maxValue);
+        prev = input;
+
+        i += 32;
+        if (i > size) {
+            break;
+        }
+    }
+
+    return _mm256_testz_si256(error, error);
+}
+
+JSTRING_TARGET_AVX2 static size_t avx2_ascii_prefix(const unsigned char* data, size_t size) {
+    size_t                  i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        if (0 != _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*) (data + i)))) {
+            break;
+        }
+    }
+
+    return i + sse2_ascii_prefix(data + i, size - i);
+}
+
+JSTRING_TARGET_AVX2 static size_t avx2_utf8_length(const unsigned char* data, size_t size) {
+    const __m256i           limit = _mm256_set1_epi8(-65);
+    size_t                  num = 0;
+    size_t                  i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        num += __builtin_popcount((unsigned int) _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i*) (data + i)), limit)));
+    }
+
+    return num + scalar_utf8_length(data + i, size - i);
+}
+
+JSTRING_TARGET_AVX2 static size_t avx2_memchr(const unsigned char* data, size_t size, unsigned char c) {
+    const __m256i           key = _mm256_set1_epi8((char) c);
+    unsigned int            mask;
+    size_t                  i = 0;
+    size_t                  pos;
+
+    for (; i + 32 <= size; i += 32) {
+        mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (data + i)), key));
+        if (0 != mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    pos = sse2_memchr(data + i, size - i, c);
+
+    return JSTRING_NPOS == pos ? JSTRING_NPOS : i + pos;
+}
+
+JSTRING_TARGET_AVX2 static size_t avx2_memmem(const unsigned char* data, size_t size, const unsigned char* needle, size_t needleSize) {
+    const __m256i           first = _mm256_set1_epi8((char) needle[0]);
+    const __m256i           last = _mm256_set1_epi8((char) needle[needleSize - 1]);
+    unsigned int            mask;
+    unsigned int            bit;
+    size_t                  i = 0;
+    size_t                  pos;
+
+    if (needleSize > size) {
+        return JSTRING_NPOS;
+    }
+
+    for (; i + needleSize - 1 + 32 <= size; i += 32) {
+        mask = (unsigned int) _mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (data + i)), first),
+                                     _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (data + i + needleSize - 1)), last)));
+        for (; 0 != mask; mask &= mask - 1) {
+            bit = __builtin_ctz(mask);
+            if (0 == memcmp(data + i + bit + 1, needle + 1, needleSize - 1)) {
+                return i + bit;
+            }
+        }
+    }
+
+    pos = sse2_memmem(data + i, size - i, needle, needleSize);
+
+    return JSTRING_NPOS == pos ? JSTRING_NPOS : i + pos;
+}
+
+static const JStringImpl jstring_impl_avx2 = {
+    JSTRING_SIMD_AVX2,
+    avx2_ascii_prefix,
+    sse2_ascii_to_utf16,
+    sse2_ascii_to_utf32,
+    sse2_utf16_to_ascii,
+    avx2_utf8_valid,
+    avx2_utf8_length,
+    avx2_memchr,
+    avx2_memmem,
+};
+#endif
+
+/* CPU 是否支持 simd 对应的指令 */
+static const JStringImpl* jstring_impl_of(JStringSimd simd) {
+#ifdef JSTRING_X86
+    __builtin_cpu_init();
+    if (JSTRING_SIMD_AVX2 == simd && __builtin_cpu_supports("avx2")) {
+        return &jstring_impl_avx2;
+    }
+    if (JSTRING_SIMD_SSE2 == simd && __builtin_cpu_supports("sse2")) {
+        return &jstring_impl_sse2;
+    }
+#endif
+    return JSTRING_SIMD_NONE == simd ? &jstring_impl_scalar : JRET_PTR_NULL;
+}
+
+/* 第一次调用时选择 CPU 支持的最快实现, 多个线程同时选择结果相同 */
+static const JStringImpl* jstring_impl(void) {
+    const JStringImpl*      impl = __atomic_load_n(&jstring_impl_current, __ATOMIC_ACQUIRE);
+
+    if (JRET_PTR_NULL == impl) {
+        impl = jstring_impl_of(JSTRING_SIMD_AVX2);
+        if (JRET_PTR_NULL == impl) {
+            impl = jstring_impl_of(JSTRING_SIMD_SSE2);
+        }
+        if (JRET_PTR_NULL == impl) {
+            impl = &jstring_impl_scalar;
+        }
+        __atomic_store_n(&jstring_impl_current, impl, __ATOMIC_RELEASE);
+    }
+
+    return impl;
+}
+
+/* 64 位 hash, 每次混入 8 个字节 */
+static unsigned int string_hash(const unsigned char* data, size_t size) {
+    uint64_t                h = size * 0x9E3779B97F4A7C15ull;
+    uint64_t                k;
+    size_t                  i;
+
+    for (i = 0; i + 8 <= size; i += 8) {
+        memcpy(&k, data + i, 8);
+        h ^= k * 0x87C37B91114253D5ull;
+        h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ull;
+    }
+
+    if (i < size) {
+        k = 0;
+        memcpy(&k, data + i, size - i);
+        h ^= k * 0x87C37B91114253D5ull;
+        h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ull;
+    }
+
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+
+    return (unsigned int) h;
+}
+
+/* 保证能放下 size 字节, 按 1.5 倍扩容 */
+static int string_grow(JString* str, size_t size) {
+    size_t                  capacity = str->capacity + str->capacity / 2;
+    char*                   data = JRET_PTR_NULL;
+
+    if (size <= str->capacity) {
+        return JRET_OK;
+    }
+
+    if (capacity < size) {
+        capacity = size;
+    }
+
+    if (str->data == str->small) {
+        data = malloc(capacity + 1);
+        if (JRET_PTR_NULL != data) {
+            memcpy(data, str->small, str->size + 1);
+        }
+    } else {
+        data = realloc(str->data, capacity + 1);
+    }
+
+    if (JRET_PTR_NULL == data) {
+        return JRET_ERROR;
+    }
+
+    str->data = data;
+    str->capacity = capacity;
+
+    return JRET_OK;
+}
+
+
+JString* jstring_new(const char* str) {
+    return jstring_new_len(str, JRET_PTR_NULL == str ? 0 : strlen(str));
+}
+
+
+JString* jstring_new_len(const char* data, size_t size) {
+    JString*                str = malloc(sizeof (JString));
+
+    if (JRET_PTR_NULL == str) {
+        return JRET_PTR_NULL;
+    }
+
+    str->data = str->small;
+    str->size = 0;
+    str->capacity = JSTRING_SMALL_SIZE;
+    str->hash = 0;
+    str->hashValid = 0;
+    str->small[0] = '\0';
+
+    if (JRET_OK != jstring_append(str, data, size)) {
+        free(str);
+        return JRET_PTR_NULL;
+    }
+
+    return str;
+}
+
+
+void jstring_free(JString* str) {
+    if (JRET_PTR_NULL == str) {
+        return;
+    }
+
+    if (str->data != str->small) {
+        free(str->data);
+    }
+    free(str);
+}
+
+
+const char* jstring_data(JString* str) {
+    return str->data;
+}
+
+
+size_t jstring_size(JString* str) {
+    return str->size;
+}
+
+
+int jstring_append(JString* str, const char* data, size_t size) {
+    uintptr_t               begin = (uintptr_t) str->data;
+    size_t                  offset = (uintptr_t) data - begin;
+
+    if (0 == size) {
+        return JRET_OK;
+    }
+
+    if (size > (size_t) -1 - 1 - str->size) {
+        return JRET_ERROR;
+    }
+
+    if (JRET_OK != string_grow(str, str->size + size)) {
+        return JRET_ERROR;
+    }
+
+    /* 追加的是自己的一部分, 扩容后换成新地址 */
+    if ((uintptr_t) data >= begin && offset <= str->size) {
+        data = str->data + offset;
+    }
+
+    memmove(str->data + str->size, data, size);
+    str->size += size;
+    str->data[str->size] = '\0';
+    str->hashValid = 0;
+
+    return JRET_OK;
+}
+
+
+int jstring_reserve(JString* str, size_t size) {
+    return string_grow(str, size);
+}
+
+
+void jstring_clear(JString* str) {
+    str->size = 0;
+    str->data[0] = '\0';
+    str->hashValid = 0;
+}
+
+
+size_t jstring_find(JString* str, const char* needle, size_t size, size_t from) {
+    size_t                  pos;
+
+    if (from > str->size) {
+        return JSTRING_NPOS;
+    }
+
+    pos = jstring_memmem(str->data + from, str->size - from, needle, size);
+
+    return JSTRING_NPOS == pos ? JSTRING_NPOS : from + pos;
+}
+
+
+size_t jstring_find_byte(JString* str, char c, size_t from) {
+    size_t                  pos;
+
+    if (from >= str->size) {
+        return JSTRING_NPOS;
+    }
+
+    pos = jstring_memchr(str->data + from, str->size - from, c);
+
+    return JSTRING_NPOS == pos ? JSTRING_NPOS : from + pos;
+}
+
+
+int jstring_is_utf8(JString* str) {
+    return jstring_utf8_valid(str->data, str->size);
+}
+
+
+size_t jstring_length(JString* str) {
+    return jstring_utf8_length(str->data, str->size);
+}
+
+
+int jstring_equal(JString* str1, JString* str2) {
+    if (str1->size != str2->size) {
+        return 0;
+    }
+
+    if (str1->hashValid && str2->hashValid && str1->hash != str2->hash) {
+        return 0;
+    }
+
+    return 0 == memcmp(str1->data, str2->data, str1->size);
+}
+
+
+int jstring_compare(JString* str1, JString* str2) {
+    size_t                  size = str1->size < str2->size ? str1->size : str2->size;
+    int                     ret = memcmp(str1->data, str2->data, size);
+
+    if (0 == ret) {
+        ret = (str1->size > str2->size) - (str1->size < str2->size);
+    }
+
+    return ret < 0 ? JRET_SMALLER : (ret > 0 ? JRET_BIGGER : JRET_EQUAL);
+}
+
+
+unsigned int jstring_hash(JString* str) {
+    if (!str->hashValid) {
+        str->hash = string_hash((const unsigned char*) str->data, str->size);
+        str->hashValid = 1;
+    }
+
+    return str->hash;
+}
+
+
+unsigned int jstring_hash_func(void* value) {
+    return jstring_hash(value);
+}
+
+
+int jstring_equal_func(void* value1, void* value2) {
+    return jstring_equal(value1, value2);
+}
+
+
+int jstring_compare_func(void* value1, void* value2) {
+    return jstring_compare(value1, value2);
+}
+
+
+int jstring_utf8_valid(const char* data, size_t size) {
+    return jstring_impl()->utf8Valid((const unsigned char*) data, size);
+}
+
+
+size_t jstring_utf8_length(const char* data, size_t size) {
+    return jstring_impl()->utf8Length((const unsigned char*) data, size);
+}
+
+
+size_t jstring_utf8_to_utf16(const char* data, size_t size, uint16_t* out) {
+    const JStringImpl*      impl = jstring_impl();
+    const unsigned char*    p = (const unsigned char*) data;
+    size_t                  i = 0;
+    size_t                  num = 0;
+    size_t                  len;
+    uint32_t                cp;
+
+    while (i < size) {
+        if (p[i] < 0x80) {
+            len = impl->asciiToUtf16(p + i, size - i, out + num);
+            i += len;
+            num += len;
+            continue;
+        }
+
+        len = utf8_decode(p + i, size - i, &cp);
+        if (0 == len) {
+            return JSTRING_NPOS;
+        }
+        i += len;
+
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out[num ++] = (uint16_t) (0xD800 | (cp >> 10));
+            out[num ++] = (uint16_t) (0xDC00 | (cp & 0x3FF));
+        } else {
+            out[num ++] = (uint16_t) cp;
+        }
+    }
+
+    return num;
+}
+
+
+size_t jstring_utf8_to_utf32(const char* data, size_t size, uint32_t* out) {
+    const JStringImpl*      impl = jstring_impl();
+    const unsigned char*    p = (const unsigned char*) data;
+    size_t                  i = 0;
+    size_t                  num = 0;
+    size_t                  len;
+
+    while (i < size) {
+        if (p[i] < 0x80) {
+            len = impl->asciiToUtf32(p + i, size - i, out + num);
+            i += len;
+            num += len;
+            continue;
+        }
+
+        len = utf8_decode(p + i, size - i, out + num);
+        if (0 == len) {
+            return JSTRING_NPOS;
+        }
+        i += len;
+        ++ num;
+    }
+
+    return num;
+}
+
+
+size_t jstring_utf16_to_utf8(const uint16_t* data, size_t num, char* out) {
+    const JStringImpl*      impl = jstring_impl();
+    unsigned char*          p = (unsigned char*) out;
+    size_t                  i = 0;
+    size_t                  size = 0;
+    size_t                  len;
+    uint32_t                cp;
+
+    while (i < num) {
+        if (data[i] < 0x80) {
+            len = impl->utf16ToAscii(data + i, num - i, p + size);
+            i += len;
+            size += len;
+            continue;
+        }
+
+        cp = data[i ++];
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+            /* 高代理后面必须是低代理 */
+            if (cp >= 0xDC00 || i == num || data[i] < 0xDC00 || data[i] > 0xDFFF) {
+                return JSTRING_NPOS;
+            }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (data[i ++] - 0xDC00);
+        }
+        size += utf8_encode(cp, p + size);
+    }
+
+    return size;
+}
+
+
+size_t jstring_utf32_to_utf8(const uint32_t* data, size_t num, char* out) {
+    unsigned char*          p = (unsigned char*) out;
+    size_t                  size = 0;
+    size_t                  i;
+
+    for (i = 0; i < num; ++i) {
+        if (data[i] > 0x10FFFF || (data[i] >= 0xD800 && data[i] <= 0xDFFF)) {
+            return JSTRING_NPOS;
+        }
+        size += utf8_encode(data[i], p + size);
+    }
+
+    return size;
+}
+
+
+size_t jstring_memchr(const char* data, size_t size, char c) {
+    return jstring_impl()->memchr((const unsigned char*) data, size, (unsigned char) c);
+}
+
+
+size_t jstring_memmem(const char* data, size_t size, const char* needle, size_t needleSize) {
+    if (0 == needleSize) {
+        return 0;
+    }
+
+    if (needleSize > size) {
+        return JSTRING_NPOS;
+    }
+
+    return jstring_impl()->memmem((const unsigned char*) data, size, (const unsigned char*) needle, needleSize);
+}
+
+
+JStringSimd jstring_simd(void) {
+    return jstring_impl()->simd;
+}
+
+
+int jstring_set_simd(JStringSimd simd) {
+    const JStringImpl*      impl = jstring_impl_of(simd);
+
+    if (JRET_PTR_NULL == impl) {
+        return JRET_ERROR;
+    }
+
+    __atomic_store_n(&jstring_impl_current, impl, __ATOMIC_RELEASE);
+
+    return JRET_OK;
+}
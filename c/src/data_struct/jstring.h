@@ -0,0 +1,328 @@
+#ifndef JSTRING_H
+#define JSTRING_H
+#include "jret.h"
+
+/**
+ *  字符串
+ *
+ *  JString 保存任意字节(可以包含 0), 末尾总有一个 0, jstring_data 可以直接当 C 字符串用。
+ *  不超过 JSTRING_SMALL_SIZE 字节的短字符串存放在结构体内部, 只申请一次内存;
+ *  更长时才另外申请, 按 1.5 倍扩容。
+ *
+ *  unicode:
+ *      UTF-8 校验、统计字符数、UTF-8 与 UTF-16/UTF-32 互转, 输入是普通的缓冲区,
+ *      爬虫抓下来的大段文本不需要先复制到 JString 中。
+ *      校验按 RFC 3629: 拒绝过长编码、代理区(U+D800 ~ U+DFFF)和大于 U+10FFFF 的码点。
+ *
+ *  SIMD:
+ *      UTF-8 校验、统计字符数、查找字节和子串用 SIMD 实现, 转码的 ASCII 部分用 SIMD 批量处理。
+ *      第一次调用时按 CPU 支持的指令选择实现(x86 上 AVX2 > SSE2 > 纯 C),
+ *      编译时不需要加 -mavx2, 同一个库在不支持 AVX2 的机器上自动退回。
+ *      jstring_set_simd 可以强制使用某一种实现, 用于测试和性能对比。
+ *
+ *  作为容器的 key:
+ *      jstring_hash_func、jstring_equal_func 可以直接传给 jset_new,
+ *      jstring_compare_func 可以直接传给 avl_tree_new, 值是 JString*。
+ *      hash 值会缓存, 修改字符串后失效; 放进容器的字符串不能再修改。
+ *
+ *  用法:
+ *      JString* str = jstring_new("你好");
+ *      jstring_append(str, ", world", 7);
+ *      if (jstring_is_utf8(str)) {
+ *          printf("%s: %zu 个字符\n", jstring_data(str), jstring_length(str));
+ *      }
+ *      jstring_free(str);
+ *
+ *  注意：
+ *      不是线程安全的, 不修改字符串的函数可以在多个线程中同时调用。
+ *
+ *  调用：
+ *      jstring_new --- 创建
+ *      jstring_free --- 销毁
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 字符串 */
+typedef struct _JString JString;
+
+/* 结构体内部能存放的最大字节数, 不含末尾的 0 */
+#define JSTRING_SMALL_SIZE          (23)
+
+/* 查找不到或转码失败时返回的位置 */
+#define JSTRING_NPOS                ((size_t) -1)
+
+/* SIMD 实现 */
+typedef enum {
+    JSTRING_SIMD_NONE = 0,                          // 纯 C
+    JSTRING_SIMD_SSE2,
+    JSTRING_SIMD_AVX2,
+} JStringSimd;
+
+
+/**
+ *  创建字符串
+ *
+ *  @param str              C 字符串, RET_PTR_NULL 表示空字符串
+ *
+ *  @return                 成功: 返回字符串
+ *                          失败: 返回 RET_PTR_NULL (内存不足)
+ */
+JString* jstring_new(const char* str);
+
+
+/**
+ *  用 size 个字节创建字符串, 可以包含 0
+ *
+ *  @param data             内容
+ *  @param size             字节数
+ *
+ *  @return                 成功: 返回字符串
+ *                          失败: 返回 RET_PTR_NULL (内存不足)
+ */
+JString* jstring_new_len(const char* data, size_t size);
+
+
+/**
+ *  销毁字符串
+ *
+ *  @param str              字符串
+ */
+void jstring_free(JString* str);
+
+
+/**
+ *  内容, 末尾有一个 0
+ *
+ *  @param str              字符串
+ *
+ *  @return                 内容, 修改字符串后失效
+ */
+const char* jstring_data(JString* str);
+
+
+/**
+ *  字节数, 不含末尾的 0
+ */
+size_t jstring_size(JString* str);
+
+
+/**
+ *  在末尾追加 size 个字节
+ *
+ *  @param str              字符串
+ *  @param data             内容, 可以指向字符串自身
+ *  @param size             字节数
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足, 字符串不变)
+ */
+int jstring_append(JString* str, const char* data, size_t size);
+
+
+/**
+ *  预留空间, 长度到 size 字节之前追加不会再申请内存
+ *
+ *  @param str              字符串
+ *  @param size             字节数
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (内存不足)
+ */
+int jstring_reserve(JString* str, size_t size);
+
+
+/**
+ *  清空内容, 不释放空间
+ */
+void jstring_clear(JString* str);
+
+
+/**
+ *  查找子串
+ *
+ *  @param str              字符串
+ *  @param needle           子串
+ *  @param size             子串字节数, 为 0 时返回 from
+ *  @param from             开始的位置
+ *
+ *  @return                 找到: 返回位置
+ *                          没找到: 返回 JSTRING_NPOS
+ */
+size_t jstring_find(JString* str, const char* needle, size_t size, size_t from);
+
+
+/**
+ *  查找字节
+ *
+ *  @param str              字符串
+ *  @param c                字节
+ *  @param from             开始的位置
+ *
+ *  @return                 找到: 返回位置
+ *                          没找到: 返回 JSTRING_NPOS
+ */
+size_t jstring_find_byte(JString* str, char c, size_t from);
+
+
+/**
+ *  内容是否是合法的 UTF-8
+ *
+ *  @return                 合法返回 1, 否则返回 0
+ */
+int jstring_is_utf8(JString* str);
+
+
+/**
+ *  字符数(码点数), 内容应是合法的 UTF-8, 否则只统计非后续字节的个数
+ */
+size_t jstring_length(JString* str);
+
+
+/**
+ *  两个字符串内容是否相同
+ *
+ *  @return                 相同返回 1, 否则返回 0
+ */
+int jstring_equal(JString* str1, JString* str2);
+
+
+/**
+ *  按字节比较两个字符串, 一个是另一个的前缀时短的较小
+ *
+ *  @return                 str1 < str2     返回： RET_SMALLER
+ *                          str1 > str2     返回： RET_BIGGER
+ *                          str1 == str2    返回:  RET_EQUAL
+ */
+int jstring_compare(JString* str1, JString* str2);
+
+
+/**
+ *  hash 值, 计算后缓存到字符串中
+ */
+unsigned int jstring_hash(JString* str);
+
+
+/**
+ *  容器回调, 值是 JString*
+ *
+ *  jstring_hash_func       JSetHashFunc
+ *  jstring_equal_func      JSetEqualFunc
+ *  jstring_compare_func    JAVLTreeCompareFunc
+ */
+unsigned int jstring_hash_func(void* value);
+int jstring_equal_func(void* value1, void* value2);
+int jstring_compare_func(void* value1, void* value2);
+
+
+/**
+ *  校验 UTF-8
+ *
+ *  @param data             内容
+ *  @param size             字节数
+ *
+ *  @return                 合法返回 1, 否则返回 0
+ */
+int jstring_utf8_valid(const char* data, size_t size);
+
+
+/**
+ *  统计 UTF-8 字符数, 即不是后续字节(10xxxxxx)的字节数, 不校验
+ */
+size_t jstring_utf8_length(const char* data, size_t size);
+
+
+/**
+ *  UTF-8 转 UTF-16 (本机字节序, 不写 BOM), 同时校验输入
+ *
+ *  @param data             UTF-8 内容
+ *  @param size             字节数
+ *  @param out              输出, 至少 size 个单元
+ *
+ *  @return                 成功: 返回写入的单元数
+ *                          失败: 返回 JSTRING_NPOS (不是合法的 UTF-8)
+ */
+size_t jstring_utf8_to_utf16(const char* data, size_t size, uint16_t* out);
+
+
+/**
+ *  UTF-8 转 UTF-32, 同时校验输入
+ *
+ *  @param data             UTF-8 内容
+ *  @param size             字节数
+ *  @param out              输出, 至少 size 个单元
+ *
+ *  @return                 成功: 返回写入的码点数
+ *                          失败: 返回 JSTRING_NPOS (不是合法的 UTF-8)
+ */
+size_t jstring_utf8_to_utf32(const char* data, size_t size, uint32_t* out);
+
+
+/**
+ *  UTF-16 转 UTF-8
+ *
+ *  @param data             UTF-16 内容
+ *  @param num              单元数
+ *  @param out              输出, 至少 3 * num 字节, 不写末尾的 0
+ *
+ *  @return                 成功: 返回写入的字节数
+ *                          失败: 返回 JSTRING_NPOS (有不成对的代理)
+ */
+size_t jstring_utf16_to_utf8(const uint16_t* data, size_t num, char* out);
+
+
+/**
+ *  UTF-32 转 UTF-8
+ *
+ *  @param data             UTF-32 内容
+ *  @param num              码点数
+ *  @param out              输出, 至少 4 * num 字节, 不写末尾的 0
+ *
+ *  @return                 成功: 返回写入的字节数
+ *                          失败: 返回 JSTRING_NPOS (代理区或大于 U+10FFFF 的码点)
+ */
+size_t jstring_utf32_to_utf8(const uint32_t* data, size_t num, char* out);
+
+
+/**
+ *  在 data 中查找字节
+ *
+ *  @return                 找到: 返回位置
+ *                          没找到: 返回 JSTRING_NPOS
+ */
+size_t jstring_memchr(const char* data, size_t size, char c);
+
+
+/**
+ *  在 data 中查找子串
+ *
+ *  @return                 找到: 返回位置, 子串为空时返回 0
+ *                          没找到: 返回 JSTRING_NPOS
+ */
+size_t jstring_memmem(const char* data, size_t size, const char* needle, size_t needleSize);
+
+
+/**
+ *  当前使用的 SIMD 实现, 第一次调用时按 CPU 选择
+ */
+JStringSimd jstring_simd(void);
+
+
+/**
+ *  强制使用某一种 SIMD 实现, 影响所有线程, 应在使用字符串之前调用
+ *
+ *  @param simd             SIMD 实现
+ *
+ *  @return                 成功: RET_OK
+ *                          失败: RET_ERROR (CPU 或编译器不支持)
+ */
+int jstring_set_simd(JStringSimd simd);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JSTRING_H
@@ -0,0 +1,478 @@
+#define _GNU_SOURCE
+#include "jtimer_wheel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JTIMER_WHEEL_BITS0          (8)                             // 第 0 层 256 个槽
+#define JTIMER_WHEEL_BITS           (6)                             // 上层每层 64 个槽
+#define JTIMER_WHEEL_LEVELS         (4)
+#define JTIMER_WHEEL_SIZE0          (1u << JTIMER_WHEEL_BITS0)
+#define JTIMER_WHEEL_SIZE           (1u << JTIMER_WHEEL_BITS)
+#define JTIMER_WHEEL_MASK0          (JTIMER_WHEEL_SIZE0 - 1)
+#define JTIMER_WHEEL_MASK           (JTIMER_WHEEL_SIZE - 1)
+#define JTIMER_WHEEL_SLOTS          (JTIMER_WHEEL_SIZE0 + (JTIMER_WHEEL_LEVELS - 1) * JTIMER_WHEEL_SIZE)
+#define JTIMER_WHEEL_RANGE          (1ULL << (JTIMER_WHEEL_BITS0 + (JTIMER_WHEEL_LEVELS - 1) * JTIMER_WHEEL_BITS))
+
+/* JTimer.slot 除了槽下标以外的取值 */
+#define JTIMER_SLOT_NONE            (JTIMER_WHEEL_SLOTS)            // 未设置
+#define JTIMER_SLOT_HEAP            (JTIMER_WHEEL_SLOTS + 1)        // 在远期堆中
+#define JTIMER_SLOT_FIRING          (JTIMER_WHEEL_SLOTS + 2)        // 在本 tick 待触发的链表中
+#define JTIMER_SLOT_EXPIRED         (JTIMER_WHEEL_SLOTS + 3)        // 设置时已经过期
+
+struct _JTimerWheel {
+    JTimerLink              slots[JTIMER_WHEEL_SLOTS];              // 第 0 层在前, 然后是第 1~3 层
+    uint64_t                bitmap[JTIMER_WHEEL_SIZE0 / 64];        // 第 0 层非空槽的位图
+    JTimerLink              expired;                                // 设置时已经过期的定时器, 下一次推进时最先触发
+    JTimerLink              firing;
+    uint64_t                current;                                // 下一个要处理的 tick, 之前到期的都已触发
+    unsigned int            num;                                    // 时间轮和堆中的定时器总数
+    unsigned int            wheelNum;                               // 时间轮(包括已过期链表)中的定时器数
+    JBinaryHeap*            heap;                                   // 超出时间轮范围的定时器, 按到期时间的最小堆
+};
+
+static void link_init(JTimerLink* head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static int link_empty(JTimerLink* head) {
+    return head->next == head;
+}
+
+static void link_append(JTimerLink* head, JTimerLink* link) {
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void link_remove(JTimerLink* link) {
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+}
+
+/* 把 from 中的所有定时器移到空链表 to */
+static void link_move(JTimerLink* from, JTimerLink* to) {
+    if (link_empty(from)) {
+        link_init(to);
+        return;
+    }
+
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    link_init(from);
+}
+
+static int timer_compare(JBinaryHeapValue value1, JBinaryHeapValue value2) {
+    uint64_t                e1 = ((JTimer*) value1)->expire;
+    uint64_t                e2 = ((JTimer*) value2)->expire;
+
+    if (e1 > e2) {
+        return JRET_BIGGER;
+    } else if (e1 < e2) {
+        return JRET_SMALLER;
+    }
+
+    return JRET_EQUAL;
+}
+
+/**
+ *  按离 current 的距离选择槽
+ *  第 k 层(k >= 1)的槽 s 存放 (expire >> shift) % 64 == s 的定时器,
+ *  距离不超过这一层的范围, 保证槽下一次级联时定时器还没有到期; 调用者保证距离在时间轮范围内
+ */
+static unsigned int timer_wheel_slot(JTimerWheel* wheel, uint64_t expire) {
+    uint64_t                delta = expire - wheel->current;
+    unsigned int            shift = JTIMER_WHEEL_BITS0;
+    unsigned int            level;
+
+    if (delta < JTIMER_WHEEL_SIZE0) {
+        return (unsigned int) (expire & JTIMER_WHEEL_MASK0);
+    }
+
+    for (level = 1; level < JTIMER_WHEEL_LEVELS - 1; ++level, shift += JTIMER_WHEEL_BITS) {
+        if (delta < (1ULL << (shift + JTIMER_WHEEL_BITS))) {
+            break;
+        }
+    }
+
+    return JTIMER_WHEEL_SIZE0 + (level - 1) * JTIMER_WHEEL_SIZE + (unsigned int) ((expire >> shift) & JTIMER_WHEEL_MASK);
+}
+
+/* 放入时间轮中的槽, 调用者保证距离在时间轮范围内 */
+static void timer_wheel_place(JTimerWheel* wheel, JTimer* timer) {
+    unsigned int            slot;
+
+    if (timer->expire < wheel->current) {
+        timer->slot = JTIMER_SLOT_EXPIRED;
+        link_append(&wheel->expired, &timer->link);
+        return;
+    }
+
+    slot = timer_wheel_slot(wheel, timer->expire);
+    timer->slot = slot;
+    link_append(&wheel->slots[slot], &timer->link);
+    if (slot < JTIMER_WHEEL_SIZE0) {
+        wheel->bitmap[slot / 64] |= 1ULL << (slot % 64);
+    }
+}
+
+/* 从所在的槽或堆中取下, 不改变计数 */
+static void timer_wheel_unlink(JTimerWheel* wheel, JTimer* timer) {
+    if (JTIMER_SLOT_HEAP == timer->slot) {
+        binary_heap_remove(wheel->heap, timer->handle);
+    } else {
+        link_remove(&timer->link);
+        if (timer->slot < JTIMER_WHEEL_SIZE0 && link_empty(&wheel->slots[timer->slot])) {
+            wheel->bitmap[timer->slot / 64] &= ~(1ULL << (timer->slot % 64));
+        }
+    }
+    timer->slot = JTIMER_SLOT_NONE;
+}
+
+/* 堆中进入时间轮范围的定时器移入时间轮 */
+static void timer_wheel_migrate(JTimerWheel* wheel) {
+    JTimer*                 timer;
+
+    for (;;) {
+        timer = binary_heap_peek(wheel->heap);
+        if (JRET_PTR_NULL == timer || timer->expire - wheel->current >= JTIMER_WHEEL_RANGE) {
+            break;
+        }
+
+        binary_heap_pop(wheel->heap);
+        timer_wheel_place(wheel, timer);
+        ++ wheel->wheelNum;
+    }
+}
+
+/**
+ *  current 到达第 0 层的起点时, 把上层对应的槽重新分配到下面的层
+ *  某一层的下标不为 0 时, 更上层还没转到下一个槽, 不需要级联
+ */
+static void timer_wheel_cascade(JTimerWheel* wheel) {
+    JTimerLink              list;
+    JTimer*                 timer;
+    unsigned int            shift = JTIMER_WHEEL_BITS0;
+    unsigned int            level;
+    unsigned int            index;
+
+    for (level = 1; level < JTIMER_WHEEL_LEVELS; ++level, shift += JTIMER_WHEEL_BITS) {
+        index = (unsigned int) ((wheel->current >> shift) & JTIMER_WHEEL_MASK);
+        link_move(&wheel->slots[JTIMER_WHEEL_SIZE0 + (level - 1) * JTIMER_WHEEL_SIZE + index], &list);
+        while (!link_empty(&list)) {
+            timer = (JTimer*) list.next;
+            link_remove(&timer->link);
+            timer_wheel_place(wheel, timer);
+        }
+
+        if (0 != index) {
+            break;
+        }
+    }
+}
+
+/**
+ *  触发链表中的所有定时器
+ *  先把整个链表移到待触发链表, 回调中设置的定时器不会在这一轮触发,
+ *  回调中取消的定时器直接从待触发链表中取下
+ */
+static unsigned int timer_wheel_fire(JTimerWheel* wheel, JTimerLink* list) {
+    unsigned int            fired = 0;
+    JTimerLink*             link;
+    JTimer*                 timer;
+
+    if (link_empty(list)) {
+        return 0;
+    }
+
+    link_move(list, &wheel->firing);
+    for (link = wheel->firing.next; link != &wheel->firing; link = link->next) {
+        ((JTimer*) link)->slot = JTIMER_SLOT_FIRING;
+    }
+
+    while (!link_empty(&wheel->firing)) {
+        timer = (JTimer*) wheel->firing.next;
+        link_remove(&timer->link);
+        timer->slot = JTIMER_SLOT_NONE;
+        -- wheel->num;
+        -- wheel->wheelNum;
+        ++ fired;
+        timer->func(timer, timer->data);
+    }
+
+    return fired;
+}
+
+/**
+ *  处理 current 这个 tick: 先触发已过期链表, 再把 current 加 1, 触发第 0 层对应的槽
+ *  current 加 1 之后这个槽对应的是下一圈, 所以已过期链表要在这之前触发
+ */
+static unsigned int timer_wheel_tick(JTimerWheel* wheel) {
+    unsigned int            slot = (unsigned int) (wheel->current & JTIMER_WHEEL_MASK0);
+    unsigned int            fired;
+
+    fired = timer_wheel_fire(wheel, &wheel->expired);
+    ++ wheel->current;
+    wheel->bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+
+    return fired + timer_wheel_fire(wheel, &wheel->slots[slot]);
+}
+
+/**
+ *  第 0 层为空时, 下一个需要处理的 tick: 上层某个非空槽级联的时刻, 或者堆顶进入时间轮范围后的第一个级联时刻
+ *  中间的 tick 没有定时器到期, 级联的都是空槽, 可以直接跳过
+ */
+static uint64_t timer_wheel_next_cascade(JTimerWheel* wheel) {
+    uint64_t                next = UINT64_MAX;
+    unsigned int            shift = JTIMER_WHEEL_BITS0;
+    uint64_t                period;
+    uint64_t                tick;
+    JTimer*                 top;
+    unsigned int            level;
+    unsigned int            i;
+
+    for (level = 1; level < JTIMER_WHEEL_LEVELS; ++level, shift += JTIMER_WHEEL_BITS) {
+        period = 1ULL << (shift + JTIMER_WHEEL_BITS);
+        for (i = 0; i < JTIMER_WHEEL_SIZE; ++i) {
+            if (link_empty(&wheel->slots[JTIMER_WHEEL_SIZE0 + (level - 1) * JTIMER_WHEEL_SIZE + i])) {
+                continue;
+            }
+            tick = (wheel->current & ~(period - 1)) + ((uint64_t) i << shift);
+            if (tick < wheel->current) {
+                tick += period;
+            }
+            if (tick < next) {
+                next = tick;
+            }
+        }
+    }
+
+    top = binary_heap_peek(wheel->heap);
+    if (JRET_PTR_NULL != top) {
+        tick = top->expire - JTIMER_WHEEL_RANGE + 1;
+        if (tick < wheel->current) {
+            tick = wheel->current;
+        }
+        tick = (tick + JTIMER_WHEEL_MASK0) & ~(uint64_t) JTIMER_WHEEL_MASK0;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+
+    return next;
+}
+
+/**
+ *  current 之后下一个需要处理的 tick
+ *  current 是第 0 层的起点时要先级联; 否则找第 0 层这一圈剩下的非空槽,
+ *  没有时为下一圈的起点, 整个第 0 层都空时跳到下一次有定时器的级联
+ */
+static uint64_t timer_wheel_next_busy(JTimerWheel* wheel) {
+    uint64_t                base = wheel->current & ~(uint64_t) JTIMER_WHEEL_MASK0;
+    unsigned int            slot = (unsigned int) (wheel->current & JTIMER_WHEEL_MASK0);
+    unsigned int            word;
+    uint64_t                bits;
+    uint64_t                any = 0;
+
+    if (0 == slot || !link_empty(&wheel->expired)) {
+        return wheel->current;
+    }
+
+    for (word = 0; word < JTIMER_WHEEL_SIZE0 / 64; ++word) {
+        bits = wheel->bitmap[word];
+        any |= bits;
+        if (word < slot / 64) {
+            continue;
+        }
+        if (word == slot / 64) {
+            bits &= ~0ULL << (slot % 64);
+        }
+        if (0 != bits) {
+            return base + word * 64 + __builtin_ctzll(bits);
+        }
+    }
+
+    return 0 != any ? base + JTIMER_WHEEL_SIZE0 : timer_wheel_next_cascade(wheel);
+}
+
+JTimerWheel* timer_wheel_new(uint64_t now) {
+    JTimerWheel*            wheel = malloc(sizeof (JTimerWheel));
+    unsigned int            i;
+
+    if (JRET_PTR_NULL == wheel) {
+        return JRET_PTR_NULL;
+    }
+
+    wheel->heap = binary_heap_new_with_arity(JBINARY_HEAP_TYPE_MIN, 4, timer_compare);
+    if (JRET_PTR_NULL == wheel->heap) {
+        free(wheel);
+        return JRET_PTR_NULL;
+    }
+
+    for (i = 0; i < JTIMER_WHEEL_SLOTS; ++i) {
+        link_init(&wheel->slots[i]);
+    }
+    link_init(&wheel->expired);
+    link_init(&wheel->firing);
+    memset(wheel->bitmap, 0, sizeof (wheel->bitmap));
+    wheel->current = now;
+    wheel->num = 0;
+    wheel->wheelNum = 0;
+
+    return wheel;
+}
+
+void timer_wheel_free(JTimerWheel* wheel) {
+    if (JRET_PTR_NULL == wheel) {
+        return;
+    }
+
+    binary_heap_free(wheel->heap);
+    free(wheel);
+}
+
+void timer_wheel_timer_init(JTimer* timer, JTimerFunc func, void* data) {
+    timer->link.next = JRET_PTR_NULL;
+    timer->link.prev = JRET_PTR_NULL;
+    timer->expire = 0;
+    timer->func = func;
+    timer->data = data;
+    timer->slot = JTIMER_SLOT_NONE;
+    timer->handle = JBINARY_HEAP_HANDLE_INVALID;
+}
+
+int timer_wheel_timer_armed(JTimer* timer) {
+    return JTIMER_SLOT_NONE != timer->slot;
+}
+
+int timer_wheel_arm(JTimerWheel* wheel, JTimer* timer, uint64_t expire) {
+    if (JTIMER_SLOT_NONE != timer->slot) {
+        if (JTIMER_SLOT_HEAP != timer->slot) {
+            -- wheel->wheelNum;
+        }
+        timer_wheel_unlink(wheel, timer);
+        -- wheel->num;
+    }
+
+    timer->expire = expire;
+    if (expire > wheel->current && expire - wheel->current >= JTIMER_WHEEL_RANGE) {
+        if (JRET_OK != binary_heap_insert_with_handle(wheel->heap, timer, &timer->handle)) {
+            return JRET_ERROR;
+        }
+        timer->slot = JTIMER_SLOT_HEAP;
+    } else {
+        timer_wheel_place(wheel, timer);
+        ++ wheel->wheelNum;
+    }
+    ++ wheel->num;
+
+    return JRET_OK;
+}
+
+int timer_wheel_cancel(JTimerWheel* wheel, JTimer* timer) {
+    if (JTIMER_SLOT_NONE == timer->slot) {
+        return JRET_NOTFOUND;
+    }
+
+    if (JTIMER_SLOT_HEAP != timer->slot) {
+        -- wheel->wheelNum;
+    }
+    timer_wheel_unlink(wheel, timer);
+    -- wheel->num;
+
+    return JRET_OK;
+}
+
+unsigned int timer_wheel_advance(JTimerWheel* wheel, uint64_t now) {
+    unsigned int            fired = 0;
+    uint64_t                next;
+
+    /* 上次推进之后设置的已过期定时器, now 没有变化时也要触发 */
+    fired += timer_wheel_fire(wheel, &wheel->expired);
+
+    while (wheel->current <= now) {
+        if (0 == (wheel->current & JTIMER_WHEEL_MASK0)) {
+            timer_wheel_cascade(wheel);
+            timer_wheel_migrate(wheel);
+        }
+
+        fired += timer_wheel_tick(wheel);
+
+        next = timer_wheel_next_busy(wheel);
+        wheel->current = next <= now ? next : now + 1;
+    }
+
+    return fired;
+}
+
+int timer_wheel_next_expire(JTimerWheel* wheel, uint64_t* expire) {
+    uint64_t                best = UINT64_MAX;
+    unsigned int            shift = JTIMER_WHEEL_BITS0;
+    JTimerLink*             head;
+    JTimerLink*             link;
+    JTimer*                 top;
+    unsigned int            level;
+    unsigned int            index;
+    unsigned int            first;
+    unsigned int            slot;
+    unsigned int            i;
+
+    if (0 == wheel->num) {
+        return JRET_NOTFOUND;
+    }
+
+    for (link = wheel->expired.next; link != &wheel->expired; link = link->next) {
+        if (((JTimer*) link)->expire < best) {
+            best = ((JTimer*) link)->expire;
+        }
+    }
+
+    /* 第 0 层每槽 1 tick, 从 current 开始第一个非空槽就是这一层最早的到期时间 */
+    for (i = 0; i < JTIMER_WHEEL_SIZE0; ++i) {
+        slot = (unsigned int) ((wheel->current + i) & JTIMER_WHEEL_MASK0);
+        if (wheel->bitmap[slot / 64] & (1ULL << (slot % 64))) {
+            if (wheel->current + i < best) {
+                best = wheel->current + i;
+            }
+            break;
+        }
+    }
+
+    /**
+     *  上层按到期时间排列的槽从当前下标的下一个开始, 第一个非空槽中最早的就是这一层最早的;
+     *  current 正好是这一层级联的时刻且还没有级联时, 当前下标的槽最早
+     */
+    for (level = 1; level < JTIMER_WHEEL_LEVELS; ++level, shift += JTIMER_WHEEL_BITS) {
+        index = (unsigned int) ((wheel->current >> shift) & JTIMER_WHEEL_MASK);
+        first = 0 == (wheel->current & ((1ULL << shift) - 1)) ? 0 : 1;
+        for (i = first; i < first + JTIMER_WHEEL_SIZE; ++i) {
+            head = &wheel->slots[JTIMER_WHEEL_SIZE0 + (level - 1) * JTIMER_WHEEL_SIZE + ((index + i) & JTIMER_WHEEL_MASK)];
+            if (link_empty(head)) {
+                continue;
+            }
+            for (link = head->next; link != head; link = link->next) {
+                if (((JTimer*) link)->expire < best) {
+                    best = ((JTimer*) link)->expire;
+                }
+            }
+            break;
+        }
+    }
+
+    top = binary_heap_peek(wheel->heap);
+    if (JRET_PTR_NULL != top && top->expire < best) {
+        best = top->expire;
+    }
+
+    *expire = best;
+
+    return JRET_OK;
+}
+
+unsigned int timer_wheel_num(JTimerWheel* wheel) {
+    return wheel->num;
+}
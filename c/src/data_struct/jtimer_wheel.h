@@ -0,0 +1,183 @@
+#ifndef JTIMER_WHEEL_H
+#define JTIMER_WHEEL_H
+#include "jret.h"
+#include "jbinary_heap.h"
+
+/**
+ *  分层时间轮
+ *
+ *  大量定时器频繁设置和取消(连接超时这类大多在触发前就被取消的定时器)时代替 JBinaryHeap:
+ *  设置和取消都是 O(1), 不需要在堆里留下删除标记。
+ *
+ *  实现：
+ *      时间以 tick 为单位(毫秒或其它, 由用户决定), 分 4 层:
+ *          第 0 层 256 个槽, 每槽 1 tick;
+ *          第 1~3 层各 64 个槽, 每槽分别是 2^8、2^14、2^20 tick;
+ *      定时器按离当前时间的距离放入某一层的槽(双向链表), 第 0 层转满一圈时把上一层的一个槽
+ *      重新分配到下面的层(级联)。超过 2^26 tick 的定时器放在一个 JBinaryHeap 中,
+ *      距离进入时间轮范围时再移入时间轮。
+ *      timer_wheel_advance 逐 tick 推进, 第 0 层用位图跳过空槽; 同一 tick 到期的定时器之间顺序不固定。
+ *
+ *  用法(定时器嵌入用户结构体, 时间轮不申请定时器的内存)：
+ *      struct conn {
+ *          int             fd;
+ *          JTimer          timeout;
+ *      };
+ *
+ *      timer_wheel_timer_init(&c->timeout, on_timeout, c);
+ *      timer_wheel_arm(wheel, &c->timeout, now + 30000);
+ *      timer_wheel_cancel(wheel, &c->timeout);
+ *      timer_wheel_advance(wheel, now);                    // 触发所有到期的定时器
+ *
+ *  注意：
+ *      不是线程安全的。
+ *      回调中可以设置和取消任意定时器(包括自己)。
+ *
+ *  调用：
+ *      timer_wheel_new --- 创建
+ *      timer_wheel_free --- 销毁
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 时间轮 */
+typedef struct _JTimerWheel JTimerWheel;
+
+/* 定时器 */
+typedef struct _JTimer JTimer;
+
+/**
+ *  定时器回调
+ *
+ *  @param timer            到期的定时器, 回调时已经不在时间轮中, 可以再次设置
+ *  @param data             timer_wheel_timer_init 传入的用户数据
+ */
+typedef void (*JTimerFunc) (JTimer* timer, void* data);
+
+/* 槽中的双向链表 */
+typedef struct _JTimerLink JTimerLink;
+struct _JTimerLink {
+    JTimerLink*             next;
+    JTimerLink*             prev;
+};
+
+/* 定时器, 字段由时间轮维护, 用户只通过函数访问 */
+struct _JTimer {
+    JTimerLink              link;
+    uint64_t                expire;                 // 到期时间
+    JTimerFunc              func;
+    void*                   data;
+    unsigned int            slot;                   // 所在的槽, 或者未设置/在堆中/正在触发
+    JBinaryHeapHandle       handle;                 // 在堆中时的句柄
+};
+
+
+/**
+ *  创建时间轮
+ *
+ *  @param now              当前时间
+ *
+ *  @return                 成功: 返回时间轮
+ *                          失败: 返回 RET_PTR_NULL
+ */
+JTimerWheel* timer_wheel_new(uint64_t now);
+
+
+/**
+ *  销毁时间轮, 不会调用回调
+ *  定时器的内存由用户管理, 销毁后定时器需要重新 timer_wheel_timer_init 才能再用
+ *
+ *  @param wheel            时间轮
+ */
+void timer_wheel_free(JTimerWheel* wheel);
+
+
+/**
+ *  初始化定时器, 初始状态为未设置
+ *
+ *  @param timer            定时器
+ *  @param func             回调
+ *  @param data             传给回调的用户数据
+ */
+void timer_wheel_timer_init(JTimer* timer, JTimerFunc func, void* data);
+
+
+/**
+ *  定时器是否已设置(在时间轮中等待触发)
+ *
+ *  @param timer            定时器
+ *
+ *  @return                 已设置返回 1, 否则返回 0
+ */
+int timer_wheel_timer_armed(JTimer* timer);
+
+
+/**
+ *  设置定时器, 已经设置的定时器改为新的到期时间
+ *  到期时间不晚于上次推进的时间时, 下一次 timer_wheel_advance 就会触发(now 不变也会触发)
+ *  O(1), 只有超出时间轮范围(2^26 tick)的定时器是 O(log n)
+ *
+ *  @param wheel            时间轮
+ *  @param timer            定时器
+ *  @param expire           到期时间
+ *
+ *  @return                 成功：RET_OK
+ *                          失败：RET_ERROR (远期定时器放入堆时内存不足, 定时器变为未设置)
+ */
+int timer_wheel_arm(JTimerWheel* wheel, JTimer* timer, uint64_t expire);
+
+
+/**
+ *  取消定时器, O(1)
+ *
+ *  @param wheel            时间轮
+ *  @param timer            定时器
+ *
+ *  @return                 成功：RET_OK
+ *                          定时器没有设置：RET_NOTFOUND
+ */
+int timer_wheel_cancel(JTimerWheel* wheel, JTimer* timer);
+
+
+/**
+ *  推进到 now, 按到期时间顺序触发所有到期时间不晚于 now 的定时器
+ *  回调中设置的定时器: 到期时间在回调所在 tick 之后且不晚于 now 的在这次推进中触发,
+ *  不晚于回调所在 tick 的在下一个 tick 触发(可能是下一次推进)
+ *  第 0 层为空时直接跳到下一个有定时器的级联时刻, 推进很长时间的代价取决于定时器数而不是 tick 数
+ *
+ *  @param wheel            时间轮
+ *  @param now              当前时间, 小于上次推进的时间时什么也不做
+ *
+ *  @return                 触发的定时器数量
+ */
+unsigned int timer_wheel_advance(JTimerWheel* wheel, uint64_t now);
+
+
+/**
+ *  最早的到期时间, 用来计算 epoll_wait 等的超时; 有已经过期的定时器时返回的时间早于当前时间
+ *
+ *  @param wheel            时间轮
+ *  @param expire           返回到期时间
+ *
+ *  @return                 成功：RET_OK
+ *                          没有定时器：RET_NOTFOUND
+ */
+int timer_wheel_next_expire(JTimerWheel* wheel, uint64_t* expire);
+
+
+/**
+ *  已设置的定时器数量
+ *
+ *  @param wheel            时间轮
+ *
+ *  @return                 定时器数量
+ */
+unsigned int timer_wheel_num(JTimerWheel* wheel);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // JTIMER_WHEEL_H